@@ -0,0 +1,357 @@
+#include "aggregate.h"
+#include "columns.h"
+#include "dinamic_vector.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Inputs smaller than this are reduced on the calling thread only */
+#define AGG_PARALLEL_MIN 65536
+#define AGG_MAX_THREADS 16
+/* Upper bound on histogram size; keys beyond it are skipped */
+#define AGG_MAX_GROUPS (1 << 20)
+
+/*
+ * Work item for one thread: a row range and where its partial result goes.
+ */
+struct Agg_Task {
+    const int *values;
+    const int *by;
+    int begin;
+    int end;
+    enum Agg_Group g;
+    int first_key;
+    int n_groups;
+    struct Agg_Stats stats;     /* AGG_BY_NONE */
+    struct Agg_Stats *groups;   /* grouped: private histogram */
+};
+
+static void stats_init(struct Agg_Stats *s) {
+    s->count = 0;
+    s->sum = 0;
+    s->min = INT_MAX;
+    s->max = INT_MIN;
+}
+
+static void stats_merge(struct Agg_Stats *into, const struct Agg_Stats *from) {
+    into->count += from->count;
+    into->sum += from->sum;
+    if (from->min < into->min) into->min = from->min;
+    if (from->max > into->max) into->max = from->max;
+}
+
+/*
+ * Count, sum, min and max of col[begin..end-1], skipping COL_NULL.
+ * Four lanes at a time; sums are widened to 64 bits so they cannot overflow.
+ */
+static void reduce_range(const int *col, int begin, int end, struct Agg_Stats *s) {
+    stats_init(s);
+    int i = begin;
+#if defined(__SSE2__)
+    const __m128i vnull = _mm_set1_epi32(COL_NULL);
+    const __m128i vone = _mm_set1_epi32(1);
+    const __m128i vzero = _mm_setzero_si128();
+    __m128i vmin = _mm_set1_epi32(INT_MAX);
+    __m128i vmax = _mm_set1_epi32(INT_MIN);  /* == COL_NULL, so nulls never win */
+    __m128i vsum = _mm_setzero_si128();      /* two 64-bit lanes */
+    __m128i vcnt = _mm_setzero_si128();
+    for (; i + 4 <= end; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(col + i));
+        __m128i is_null = _mm_cmpeq_epi32(v, vnull);
+        __m128i valid = _mm_andnot_si128(is_null, v);            /* nulls -> 0 */
+        vcnt = _mm_add_epi32(vcnt, _mm_andnot_si128(is_null, vone));
+
+        __m128i sign = _mm_cmpgt_epi32(vzero, valid);
+        vsum = _mm_add_epi64(vsum, _mm_unpacklo_epi32(valid, sign));
+        vsum = _mm_add_epi64(vsum, _mm_unpackhi_epi32(valid, sign));
+
+        /* SSE2 has no pminsd/pmaxsd: select with compare masks */
+        __m128i for_min = _mm_or_si128(_mm_and_si128(is_null, _mm_set1_epi32(INT_MAX)), valid);
+        __m128i lt = _mm_cmpgt_epi32(vmin, for_min);
+        vmin = _mm_or_si128(_mm_and_si128(lt, for_min), _mm_andnot_si128(lt, vmin));
+        __m128i gt = _mm_cmpgt_epi32(v, vmax);
+        vmax = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, vmax));
+    }
+    int lanes_min[4], lanes_max[4], lanes_cnt[4];
+    long long lanes_sum[2];
+    _mm_storeu_si128((__m128i *)lanes_min, vmin);
+    _mm_storeu_si128((__m128i *)lanes_max, vmax);
+    _mm_storeu_si128((__m128i *)lanes_cnt, vcnt);
+    _mm_storeu_si128((__m128i *)lanes_sum, vsum);
+    for (int l = 0; l < 4; l++) {
+        if (lanes_min[l] < s->min) s->min = lanes_min[l];
+        if (lanes_max[l] > s->max) s->max = lanes_max[l];
+        s->count += lanes_cnt[l];
+    }
+    s->sum = lanes_sum[0] + lanes_sum[1];
+#endif
+    for (; i < end; i++) {
+        int v = col[i];
+        if (v == COL_NULL) continue;
+        s->count++;
+        s->sum += v;
+        if (v < s->min) s->min = v;
+        if (v > s->max) s->max = v;
+    }
+}
+
+/*
+ * Group key of one 'by' value, or COL_NULL when it has none.
+ */
+static int group_key(int by, enum Agg_Group g) {
+    if (by == COL_NULL) {
+        return COL_NULL;
+    }
+    if (g == AGG_BY_AGE_BAND) {
+        return (by < 0) ? COL_NULL : by / AGG_AGE_BAND;
+    }
+    int year = by / 10000;
+    int month = (by / 100) % 100;
+    if (month < 1 || month > 12) {
+        return COL_NULL;
+    }
+    return year * 12 + month - 1;
+}
+
+static void *agg_worker(void *arg) {
+    struct Agg_Task *t = (struct Agg_Task *)arg;
+    if (t->g == AGG_BY_NONE) {
+        reduce_range(t->values, t->begin, t->end, &t->stats);
+        return NULL;
+    }
+    for (int i = t->begin; i < t->end; i++) {
+        int v = t->values[i];
+        int key = group_key(t->by[i], t->g);
+        if (v == COL_NULL || key == COL_NULL) continue;
+        int slot = key - t->first_key;
+        if (slot < 0 || slot >= t->n_groups) continue;
+        struct Agg_Stats *s = &t->groups[slot];
+        s->count++;
+        s->sum += v;
+        if (v < s->min) s->min = v;
+        if (v > s->max) s->max = v;
+    }
+    return NULL;
+}
+
+static int agg_threads(int n, int requested) {
+    if (requested > 0) {
+        return requested < AGG_MAX_THREADS ? requested : AGG_MAX_THREADS;
+    }
+    if (n < AGG_PARALLEL_MIN) {
+        return 1;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    return cpus < AGG_MAX_THREADS ? (int)cpus : AGG_MAX_THREADS;
+}
+
+/*
+ * Split [0, n) evenly over 'count' tasks and run them; task 0 runs on the
+ * calling thread. Falls back to running a task inline if a thread cannot start.
+ */
+static void agg_run_tasks(struct Agg_Task *tasks, int count, int n) {
+    pthread_t tid[AGG_MAX_THREADS];
+    int started[AGG_MAX_THREADS];
+    for (int t = 0; t < count; t++) {
+        tasks[t].begin = (int)((long long)n * t / count);
+        tasks[t].end = (int)((long long)n * (t + 1) / count);
+    }
+    for (int t = 1; t < count; t++) {
+        started[t] = (pthread_create(&tid[t], NULL, agg_worker, &tasks[t]) == 0);
+        if (!started[t]) {
+            agg_worker(&tasks[t]);
+        }
+    }
+    agg_worker(&tasks[0]);
+    for (int t = 1; t < count; t++) {
+        if (started[t]) {
+            pthread_join(tid[t], NULL);
+        }
+    }
+}
+
+void agg_reduce(const int *col, int n, int threads, struct Agg_Stats *out) {
+    stats_init(out);
+    if (col == NULL || n <= 0) {
+        return;
+    }
+    struct Agg_Task tasks[AGG_MAX_THREADS];
+    int count = agg_threads(n, threads);
+    for (int t = 0; t < count; t++) {
+        tasks[t].values = col;
+        tasks[t].by = NULL;
+        tasks[t].g = AGG_BY_NONE;
+        tasks[t].groups = NULL;
+    }
+    agg_run_tasks(tasks, count, n);
+    for (int t = 0; t < count; t++) {
+        stats_merge(out, &tasks[t].stats);
+    }
+}
+
+int agg_group(const int *values, const int *by, int n, enum Agg_Group g, int threads,
+              struct Agg_Stats **groups, int *first_key) {
+    *groups = NULL;
+    *first_key = 0;
+    if (values == NULL || by == NULL || n <= 0 || g == AGG_BY_NONE) {
+        return 0;
+    }
+
+    /* Key range from the min/max of the grouping column (keys are monotonic in it) */
+    struct Agg_Stats range;
+    agg_reduce(by, n, threads, &range);
+    if (range.count == 0) {
+        return 0;
+    }
+    int lo = range.min, hi = range.max;
+    if (g == AGG_BY_AGE_BAND) {
+        if (hi < 0) return 0;
+        if (lo < 0) lo = 0;
+        lo /= AGG_AGE_BAND;
+        hi /= AGG_AGE_BAND;
+    } else {
+        lo = (lo / 10000) * 12;        /* January of the first year */
+        hi = (hi / 10000) * 12 + 11;   /* December of the last year */
+    }
+    long long span = (long long)hi - lo + 1;
+    int n_groups = (span > AGG_MAX_GROUPS) ? AGG_MAX_GROUPS : (int)span;
+
+    struct Agg_Task tasks[AGG_MAX_THREADS];
+    int count = agg_threads(n, threads);
+    for (int t = 0; t < count; t++) {
+        tasks[t].values = values;
+        tasks[t].by = by;
+        tasks[t].g = g;
+        tasks[t].first_key = lo;
+        tasks[t].n_groups = n_groups;
+        tasks[t].groups = (struct Agg_Stats *)malloc(sizeof(struct Agg_Stats) * (size_t)n_groups);
+        if (tasks[t].groups == NULL) {
+            exit(1);
+        }
+        for (int j = 0; j < n_groups; j++) {
+            stats_init(&tasks[t].groups[j]);
+        }
+    }
+    agg_run_tasks(tasks, count, n);
+
+    /* Merge private histograms into the first one */
+    for (int t = 1; t < count; t++) {
+        for (int j = 0; j < n_groups; j++) {
+            stats_merge(&tasks[0].groups[j], &tasks[t].groups[j]);
+        }
+        free(tasks[t].groups);
+    }
+    *groups = tasks[0].groups;
+    *first_key = lo;
+    return n_groups;
+}
+
+/*
+ * Print one aggregate value; dates are printed back as YYYY-MM-DD.
+ */
+static void print_value(FILE *out, const char *func, const struct Agg_Stats *s, int is_date) {
+    if (strcmp(func, "count") == 0) {
+        fprintf(out, "%ld", s->count);
+    } else if (s->count == 0) {
+        fprintf(out, "-");
+    } else if (strcmp(func, "sum") == 0) {
+        fprintf(out, "%lld", s->sum);
+    } else if (strcmp(func, "avg") == 0) {
+        fprintf(out, "%.2f", (double)s->sum / (double)s->count);
+    } else {
+        int v = (strcmp(func, "min") == 0) ? s->min : s->max;
+        if (is_date) {
+            fprintf(out, "%04d-%02d-%02d", v / 10000, (v / 100) % 100, v % 100);
+        } else {
+            fprintf(out, "%d", v);
+        }
+    }
+}
+
+int agg_run(struct Dinamic_Vector *dv, const char *command, int timed, FILE *out) {
+    char func[16] = "", column[16] = "", by_kw[16] = "", by_col[16] = "";
+    int parsed = sscanf(command, "%15s %15s %15s %15s", func, column, by_kw, by_col);
+
+    int valid_func = strcmp(func, "count") == 0 || strcmp(func, "min") == 0 || strcmp(func, "max") == 0
+                  || strcmp(func, "avg") == 0 || strcmp(func, "sum") == 0;
+    if (parsed < 2 || !valid_func || (parsed > 2 && (parsed != 4 || strcmp(by_kw, "by") != 0))) {
+        fprintf(out, "Uso: <count|min|max|avg|sum> <id|idade|data> [by <idade|mes>]\n");
+        return 1;
+    }
+
+    const struct Int_Columns *cols = dv_columns(dv);
+    const int *values;
+    int is_date = 0;
+    if (strcmp(column, "id") == 0) {
+        values = cols->id;
+    } else if (strcmp(column, "idade") == 0) {
+        values = cols->idade;
+    } else if (strcmp(column, "data") == 0) {
+        values = cols->data;
+        is_date = 1;
+    } else {
+        fprintf(out, "Coluna desconhecida: %s\n", column);
+        return 1;
+    }
+    if (is_date && (strcmp(func, "avg") == 0 || strcmp(func, "sum") == 0)) {
+        fprintf(out, "%s não se aplica a data.\n", func);
+        return 1;
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    if (parsed == 2) {
+        struct Agg_Stats s;
+        agg_reduce(values, cols->n, 0, &s);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        fprintf(out, "%s(%s) = ", func, column);
+        print_value(out, func, &s, is_date);
+        fprintf(out, "\n");
+    } else {
+        enum Agg_Group g;
+        const int *by;
+        if (strcmp(by_col, "idade") == 0) {
+            g = AGG_BY_AGE_BAND;
+            by = cols->idade;
+        } else if (strcmp(by_col, "mes") == 0) {
+            g = AGG_BY_MONTH;
+            by = cols->data;
+        } else {
+            fprintf(out, "Agrupamento desconhecido: %s (use idade ou mes)\n", by_col);
+            return 1;
+        }
+        struct Agg_Stats *groups = NULL;
+        int first_key = 0;
+        int n_groups = agg_group(values, by, cols->n, g, 0, &groups, &first_key);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        fprintf(out, "%-10s %s(%s)\n", (g == AGG_BY_AGE_BAND) ? "Faixa" : "Mes", func, column);
+        for (int j = 0; j < n_groups; j++) {
+            if (groups[j].count == 0) continue;  /* only groups that have rows */
+            int key = first_key + j;
+            if (g == AGG_BY_AGE_BAND) {
+                fprintf(out, "%3d-%-6d ", key * AGG_AGE_BAND, key * AGG_AGE_BAND + AGG_AGE_BAND - 1);
+            } else {
+                fprintf(out, "%04d-%02d    ", key / 12, key % 12 + 1);
+            }
+            print_value(out, func, &groups[j], is_date);
+            fprintf(out, "\n");
+        }
+        free(groups);
+    }
+
+    if (timed) {
+        double ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+        fprintf(out, "(%d linhas, %.3f ms)\n", cols->n, ms);
+    } else {
+        fprintf(out, "(%d linhas)\n", cols->n);
+    }
+    return 0;
+}
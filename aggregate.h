@@ -0,0 +1,63 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include <stdio.h>
+
+struct Dinamic_Vector;
+
+/*
+ * Aggregations (count, min, max, avg, sum) over the int columns of the
+ * vector (see columns.h), optionally grouped by age band or registration
+ * month. Reductions are SSE2 loops over contiguous arrays and large inputs
+ * are split across threads.
+ */
+
+/* Width of an age band in years: 0-9, 10-19, ... */
+#define AGG_AGE_BAND 10
+
+/*
+ * Partial or final result of a reduction; COL_NULL values are skipped.
+ */
+struct Agg_Stats {
+    long count;       /* non-null values seen */
+    long long sum;
+    int min;
+    int max;
+};
+
+enum Agg_Group {
+    AGG_BY_NONE,
+    AGG_BY_AGE_BAND,  /* key = idade / AGG_AGE_BAND */
+    AGG_BY_MONTH      /* key = year * 12 + month - 1, from the packed date */
+};
+
+/**
+ * Reduce col[0..n-1] into 'out'. 'threads' <= 0 picks a count from the input size.
+ */
+void agg_reduce(const int *col, int n, int threads, struct Agg_Stats *out);
+
+/**
+ * Reduce 'values' grouped by the key derived from 'by' (an idade column for
+ * AGG_BY_AGE_BAND, a packed data column for AGG_BY_MONTH). Rows whose key is
+ * null are skipped. On return '*groups' is a malloc'd array (caller frees)
+ * where entry j holds key '*first_key + j'.
+ * Returns the number of groups (0 if there is nothing to group).
+ * If malloc fails, exits(1).
+ */
+int agg_group(const int *values, const int *by, int n, enum Agg_Group g, int threads,
+              struct Agg_Stats **groups, int *first_key);
+
+/**
+ * Parse and run one aggregation command, printing the result to 'out':
+ *
+ *     <count|min|max|avg|sum> <id|idade|data> [by <idade|mes>]
+ *
+ * e.g. "avg idade", "count data by mes", "max idade by idade".
+ * "avg"/"sum" are not accepted on the data column. The result ends with
+ * the row count, plus the elapsed time if 'timed' (off in batch mode, so
+ * the output does not change from run to run).
+ * Returns 0 on success; returns 1 (after printing a message) on a bad command.
+ */
+int agg_run(struct Dinamic_Vector *dv, const char *command, int timed, FILE *out);
+
+#endif /* AGGREGATE_H */
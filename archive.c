@@ -0,0 +1,1055 @@
+#include "archive.h"
+#include "dinamic_vector.h"
+#include "schema.h"
+#include "slab.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+_Static_assert(PC_COUNT == 5, "archive.c encodes the five patient columns one by one");
+
+#define ARC_MAX_BLOCK_ROWS (1 << 20)  /* reader: larger blocks are refused */
+
+/*
+ * Form of a CPF or date value. CPF: MAIN is XXX.XXX.XXX-XX, ALT is 11
+ * digits. Date: MAIN is YYYY-MM-DD of a real calendar day. Anything else
+ * is kept as TEXT.
+ */
+enum { FORM_NULL, FORM_MAIN, FORM_ALT, FORM_TEXT };
+
+static double elapsed_since(const struct timespec *t0) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - t0->tv_sec) + (double)(now.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Byte buffers and varints                                               */
+/* ---------------------------------------------------------------------- */
+
+struct Arc_Buf {
+    unsigned char *p;
+    size_t len;
+    size_t cap;
+};
+
+static void buf_reserve(struct Arc_Buf *b, size_t extra) {
+    if (b->len + extra <= b->cap) {
+        return;
+    }
+    size_t cap = b->cap > 0 ? b->cap : 4096;
+    while (cap < b->len + extra) {
+        cap *= 2;
+    }
+    unsigned char *grown = (unsigned char *)realloc(b->p, cap);
+    if (grown == NULL) {
+        exit(1);
+    }
+    b->p = grown;
+    b->cap = cap;
+}
+
+static void put_byte(struct Arc_Buf *b, unsigned c) {
+    buf_reserve(b, 1);
+    b->p[b->len++] = (unsigned char)c;
+}
+
+static void put_bytes(struct Arc_Buf *b, const void *s, size_t n) {
+    buf_reserve(b, n);
+    memcpy(b->p + b->len, s, n);
+    b->len += n;
+}
+
+static void put_varint(struct Arc_Buf *b, unsigned long long v) {
+    buf_reserve(b, 10);
+    while (v >= 0x80) {
+        b->p[b->len++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    b->p[b->len++] = (unsigned char)v;
+}
+
+static unsigned long long zigzag(long long v) {
+    return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+static long long unzigzag(unsigned long long u) {
+    return (long long)(u >> 1) ^ -(long long)(u & 1);
+}
+
+/* Reader over one block payload: every get checks the end and sets 'bad' */
+struct Arc_In {
+    const unsigned char *p;
+    const unsigned char *end;
+    int bad;
+};
+
+static unsigned get_byte(struct Arc_In *in) {
+    if (in->p >= in->end) {
+        in->bad = 1;
+        return 0;
+    }
+    return *in->p++;
+}
+
+static const unsigned char *get_bytes(struct Arc_In *in, size_t n) {
+    if ((size_t)(in->end - in->p) < n) {
+        in->bad = 1;
+        return NULL;
+    }
+    const unsigned char *s = in->p;
+    in->p += n;
+    return s;
+}
+
+static unsigned long long get_varint(struct Arc_In *in) {
+    unsigned long long v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (in->p >= in->end) {
+            break;
+        }
+        unsigned c = *in->p++;
+        v |= (unsigned long long)(c & 0x7F) << shift;
+        if (c < 0x80) {
+            return v;
+        }
+    }
+    in->bad = 1;
+    return 0;
+}
+
+/* Varint straight from the file (header and block framing) */
+static int read_varint(FILE *fp, unsigned long long *v) {
+    *v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(fp);
+        if (c == EOF) {
+            return 1;
+        }
+        *v |= (unsigned long long)(c & 0x7F) << shift;
+        if (c < 0x80) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Word dictionary                                                        */
+/* ---------------------------------------------------------------------- */
+
+struct Arc_Dict {
+    char *text;      /* the words back to back */
+    size_t text_len;
+    size_t text_cap;
+    size_t *off;     /* word w is text[off[w] .. off[w]+len[w]) */
+    int *len;
+    long long *count;
+    int n;
+    int cap;
+    int *slot;       /* open addressing: word index, or -1 */
+    int n_slots;     /* power of two */
+    int *id;         /* writer: id of each word in the file, most frequent first */
+};
+
+static unsigned word_hash(const char *s, int len) {
+    unsigned h = 2166136261u;  /* FNV-1a */
+    for (int k = 0; k < len; k++) {
+        h = (h ^ (unsigned char)s[k]) * 16777619u;
+    }
+    return h;
+}
+
+static void dict_init(struct Arc_Dict *d) {
+    memset(d, 0, sizeof(*d));
+    d->n_slots = 1024;
+    d->slot = (int *)malloc(sizeof(int) * (size_t)d->n_slots);
+    if (d->slot == NULL) {
+        exit(1);
+    }
+    memset(d->slot, 0xFF, sizeof(int) * (size_t)d->n_slots);
+}
+
+static void dict_free(struct Arc_Dict *d) {
+    free(d->text);
+    free(d->off);
+    free(d->len);
+    free(d->count);
+    free(d->slot);
+    free(d->id);
+}
+
+static int *dict_probe(struct Arc_Dict *d, const char *s, int len) {
+    unsigned mask = (unsigned)d->n_slots - 1;
+    for (unsigned h = word_hash(s, len) & mask;; h = (h + 1) & mask) {
+        int w = d->slot[h];
+        if (w < 0 || (d->len[w] == len && memcmp(d->text + d->off[w], s, (size_t)len) == 0)) {
+            return &d->slot[h];
+        }
+    }
+}
+
+static void dict_grow_slots(struct Arc_Dict *d) {
+    free(d->slot);
+    d->n_slots *= 2;
+    d->slot = (int *)malloc(sizeof(int) * (size_t)d->n_slots);
+    if (d->slot == NULL) {
+        exit(1);
+    }
+    memset(d->slot, 0xFF, sizeof(int) * (size_t)d->n_slots);
+    for (int w = 0; w < d->n; w++) {
+        *dict_probe(d, d->text + d->off[w], d->len[w]) = w;
+    }
+}
+
+/* Append a word (no lookup); returns its index */
+static int dict_push(struct Arc_Dict *d, const char *s, int len) {
+    if (d->n == d->cap) {
+        d->cap = d->cap > 0 ? d->cap * 2 : 256;
+        d->off = (size_t *)realloc(d->off, sizeof(size_t) * (size_t)d->cap);
+        d->len = (int *)realloc(d->len, sizeof(int) * (size_t)d->cap);
+        d->count = (long long *)realloc(d->count, sizeof(long long) * (size_t)d->cap);
+        if (d->off == NULL || d->len == NULL || d->count == NULL) {
+            exit(1);
+        }
+    }
+    if (d->text == NULL || d->text_len + (size_t)len > d->text_cap) {
+        d->text_cap = d->text_cap > 0 ? d->text_cap : 4096;
+        while (d->text_len + (size_t)len > d->text_cap) {
+            d->text_cap *= 2;
+        }
+        d->text = (char *)realloc(d->text, d->text_cap);
+        if (d->text == NULL) {
+            exit(1);
+        }
+    }
+    memcpy(d->text + d->text_len, s, (size_t)len);
+    d->off[d->n] = d->text_len;
+    d->len[d->n] = len;
+    d->count[d->n] = 0;
+    d->text_len += (size_t)len;
+    return d->n++;
+}
+
+/* Index of the word, added if new */
+static int dict_add(struct Arc_Dict *d, const char *s, int len) {
+    int *slot = dict_probe(d, s, len);
+    if (*slot >= 0) {
+        return *slot;
+    }
+    int w = dict_push(d, s, len);
+    *slot = w;
+    if (2 * d->n > d->n_slots) {
+        dict_grow_slots(d);
+    }
+    return w;
+}
+
+struct Word_Rank {
+    long long count;
+    int w;
+};
+
+static int rank_cmp(const void *pa, const void *pb) {
+    const struct Word_Rank *a = (const struct Word_Rank *)pa;
+    const struct Word_Rank *b = (const struct Word_Rank *)pb;
+    if (a->count != b->count) {
+        return (a->count > b->count) ? -1 : 1;
+    }
+    return (a->w > b->w) - (a->w < b->w);
+}
+
+/* Give the most frequent words the smallest ids (shortest varints) */
+static void dict_rank(struct Arc_Dict *d, struct Word_Rank *order) {
+    for (int w = 0; w < d->n; w++) {
+        order[w].count = d->count[w];
+        order[w].w = w;
+    }
+    qsort(order, (size_t)d->n, sizeof(struct Word_Rank), rank_cmp);
+    d->id = (int *)malloc(sizeof(int) * (size_t)(d->n > 0 ? d->n : 1));
+    if (d->id == NULL) {
+        exit(1);
+    }
+    for (int k = 0; k < d->n; k++) {
+        d->id[order[k].w] = k;
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* Column forms                                                           */
+/* ---------------------------------------------------------------------- */
+
+static int is_digits(const char *s, int n) {
+    for (int k = 0; k < n; k++) {
+        if (s[k] < '0' || s[k] > '9') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static unsigned long long digits_value(const char *s, int n, unsigned long long v) {
+    for (int k = 0; k < n; k++) {
+        v = v * 10 + (unsigned long long)(s[k] - '0');
+    }
+    return v;
+}
+
+static int cpf_form(const char *s, unsigned long long *num) {
+    size_t n = strlen(s);
+    if (n == 14 && s[3] == '.' && s[7] == '.' && s[11] == '-' && is_digits(s, 3) && is_digits(s + 4, 3) &&
+        is_digits(s + 8, 3) && is_digits(s + 12, 2)) {
+        unsigned long long v = digits_value(s, 3, 0);
+        v = digits_value(s + 4, 3, v);
+        v = digits_value(s + 8, 3, v);
+        *num = digits_value(s + 12, 2, v);
+        return FORM_MAIN;
+    }
+    if (n == 11 && is_digits(s, 11)) {
+        *num = digits_value(s, 11, 0);
+        return FORM_ALT;
+    }
+    return FORM_TEXT;
+}
+
+/* Write the 11 digits of 'num' as text of the given form (NUL-terminated) */
+static void cpf_text(unsigned long long num, int form, char *out) {
+    char d[11];
+    for (int k = 10; k >= 0; k--) {
+        d[k] = (char)('0' + num % 10);
+        num /= 10;
+    }
+    if (form == FORM_ALT) {
+        memcpy(out, d, 11);
+        out[11] = '\0';
+        return;
+    }
+    memcpy(out, d, 3);
+    out[3] = '.';
+    memcpy(out + 4, d + 3, 3);
+    out[7] = '.';
+    memcpy(out + 8, d + 6, 3);
+    out[11] = '-';
+    memcpy(out + 12, d + 9, 2);
+    out[14] = '\0';
+}
+
+static int month_days(int y, int m) {
+    static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    return days[m - 1] + (m == 2 && leap);
+}
+
+/* Days since 1970-01-01 of a proleptic Gregorian date (H. Hinnant's algorithm) */
+static long long days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (unsigned)((153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1);
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (long long)doe - 719468;
+}
+
+static void civil_from_days(long long z, int *y, int *m, int *d) {
+    z += 719468;
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    *d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *y = (int)((long long)yoe + era * 400 + (*m <= 2));
+}
+
+static int date_form(const char *s, long long *day) {
+    if (strlen(s) != 10 || s[4] != '-' || s[7] != '-' || !is_digits(s, 4) || !is_digits(s + 5, 2) ||
+        !is_digits(s + 8, 2)) {
+        return FORM_TEXT;
+    }
+    int y = (int)digits_value(s, 4, 0), m = (int)digits_value(s + 5, 2, 0), d = (int)digits_value(s + 8, 2, 0);
+    if (m < 1 || m > 12 || d < 1 || d > month_days(y, m)) {
+        return FORM_TEXT;
+    }
+    *day = days_from_civil(y, m, d);
+    return FORM_MAIN;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Writer                                                                 */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * One block being encoded. Text is encoded as each row is visited (rows
+ * may be evicted by later dv_get calls in paged mode); ints and forms are
+ * staged until the block is complete.
+ */
+struct Block_Enc {
+    int n;
+    int *id;
+    unsigned char *id_ok;
+    int *idade;
+    unsigned char *idade_ok;
+    unsigned char *cpf_form;
+    unsigned char *data_form;
+    struct Arc_Buf cpf;     /* per row: 5-byte number, or varint length + text */
+    struct Arc_Buf nome;    /* per row: varint word count (0 = null), word ids */
+    struct Arc_Buf data;    /* per row: zigzag day difference, or varint length + text */
+    long long prev_day;
+    struct Arc_Buf out;     /* assembled payload */
+};
+
+static void put_text(struct Arc_Buf *b, const char *s) {
+    size_t n = strlen(s);
+    put_varint(b, n);
+    put_bytes(b, s, n);
+}
+
+static int int_of(const struct Field *f, int *v) {
+    if (f == NULL || f->type != FIELD_INT) {
+        return 0;
+    }
+    *v = f->i;
+    return 1;
+}
+
+static const char *str_of(const struct Field *f) {
+    return (f != NULL && f->type == FIELD_STRING && f->s != NULL) ? f->s : NULL;
+}
+
+/* Decimal digits of 'v' (its CSV width) */
+static int int_width(int v) {
+    char tmp[16];
+    return snprintf(tmp, sizeof(tmp), "%d", v);
+}
+
+/* Count every word of a name */
+static void count_words(struct Arc_Dict *d, const char *s) {
+    for (;;) {
+        const char *sp = strchr(s, ' ');
+        int len = sp != NULL ? (int)(sp - s) : (int)strlen(s);
+        int w = dict_add(d, s, len);  /* may grow d->count */
+        d->count[w]++;
+        if (sp == NULL) {
+            return;
+        }
+        s = sp + 1;
+    }
+}
+
+static void encode_name(struct Arc_Buf *b, struct Arc_Dict *d, const char *s) {
+    if (s == NULL) {
+        put_varint(b, 0);
+        return;
+    }
+    int words = 1;
+    for (const char *p = s; *p != '\0'; p++) {
+        words += (*p == ' ');
+    }
+    put_varint(b, (unsigned long long)words);
+    for (;;) {
+        const char *sp = strchr(s, ' ');
+        int len = sp != NULL ? (int)(sp - s) : (int)strlen(s);
+        put_varint(b, (unsigned long long)d->id[*dict_probe(d, s, len)]);
+        if (sp == NULL) {
+            return;
+        }
+        s = sp + 1;
+    }
+}
+
+/* Stage row 'row' into the block; returns its size as a CSV line */
+static long long stage_row(struct Block_Enc *e, struct Arc_Dict *d, const struct LinkedList *row) {
+    const struct Field *f[PC_COUNT];
+    schema_fields(row, f);
+    int k = e->n++;
+    long long csv = PC_COUNT;  /* commas and newline */
+
+    e->id_ok[k] = (unsigned char)int_of(f[PC_ID], &e->id[k]);
+    csv += e->id_ok[k] ? int_width(e->id[k]) : 0;
+    e->idade_ok[k] = (unsigned char)int_of(f[PC_IDADE], &e->idade[k]);
+    csv += e->idade_ok[k] ? int_width(e->idade[k]) : 0;
+
+    const char *cpf = str_of(f[PC_CPF]);
+    unsigned long long num = 0;
+    e->cpf_form[k] = (unsigned char)(cpf == NULL ? FORM_NULL : cpf_form(cpf, &num));
+    if (e->cpf_form[k] == FORM_MAIN || e->cpf_form[k] == FORM_ALT) {
+        unsigned char le[5];
+        for (int b = 0; b < 5; b++) {
+            le[b] = (unsigned char)(num >> (8 * b));
+        }
+        put_bytes(&e->cpf, le, 5);
+    } else if (e->cpf_form[k] == FORM_TEXT) {
+        put_text(&e->cpf, cpf);
+    }
+    csv += cpf != NULL ? (long long)strlen(cpf) : 0;
+
+    const char *nome = str_of(f[PC_NOME]);
+    encode_name(&e->nome, d, nome);
+    csv += nome != NULL ? (long long)strlen(nome) : 0;
+
+    const char *data = str_of(f[PC_DATA]);
+    long long day = 0;
+    e->data_form[k] = (unsigned char)(data == NULL ? FORM_NULL : date_form(data, &day));
+    if (e->data_form[k] == FORM_MAIN) {
+        put_varint(&e->data, zigzag(day - e->prev_day));
+        e->prev_day = day;
+    } else if (e->data_form[k] == FORM_TEXT) {
+        put_text(&e->data, data);
+    }
+    csv += data != NULL ? (long long)strlen(data) : 0;
+    return csv;
+}
+
+/* Null bitmap: a 0 byte if every value is present, else 1 and one bit per row */
+static void put_nulls(struct Arc_Buf *b, const unsigned char *ok, int n) {
+    int all = 1;
+    for (int k = 0; k < n && all; k++) {
+        all = ok[k];
+    }
+    put_byte(b, all ? 0 : 1);
+    if (all) {
+        return;
+    }
+    for (int k = 0; k < n; k += 8) {
+        unsigned bits = 0;
+        for (int j = 0; j < 8 && k + j < n; j++) {
+            bits |= (unsigned)(ok[k + j] != 0) << j;
+        }
+        put_byte(b, bits);
+    }
+}
+
+static void put_forms(struct Arc_Buf *b, const unsigned char *form, int n) {
+    for (int k = 0; k < n; k += 4) {
+        unsigned bits = 0;
+        for (int j = 0; j < 4 && k + j < n; j++) {
+            bits |= (unsigned)form[k + j] << (2 * j);
+        }
+        put_byte(b, bits);
+    }
+}
+
+static void put_deltas(struct Arc_Buf *b, const int *v, const unsigned char *ok, int n) {
+    put_nulls(b, ok, n);
+    long long prev = 0;
+    for (int k = 0; k < n; k++) {
+        if (ok[k]) {
+            put_varint(b, zigzag((long long)v[k] - prev));
+            prev = v[k];
+        }
+    }
+}
+
+/* Frame of reference: block minimum, bit width, then (v - min) packed LSB first */
+static void put_packed(struct Arc_Buf *b, const int *v, const unsigned char *ok, int n) {
+    put_nulls(b, ok, n);
+    long long lo = 0, hi = 0;
+    int seen = 0;
+    for (int k = 0; k < n; k++) {
+        if (ok[k]) {
+            lo = (!seen || v[k] < lo) ? v[k] : lo;
+            hi = (!seen || v[k] > hi) ? v[k] : hi;
+            seen = 1;
+        }
+    }
+    unsigned width = 0;
+    while (width < 32 && ((unsigned long long)(hi - lo) >> width) != 0) {
+        width++;
+    }
+    put_varint(b, zigzag(lo));
+    put_byte(b, width);
+    unsigned long long acc = 0;
+    unsigned bits = 0;
+    for (int k = 0; k < n; k++) {
+        if (!ok[k]) {
+            continue;
+        }
+        acc |= (unsigned long long)(v[k] - lo) << bits;
+        bits += width;
+        while (bits >= 8) {
+            put_byte(b, (unsigned)(acc & 0xFF));
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    if (bits > 0) {
+        put_byte(b, (unsigned)acc);
+    }
+}
+
+/* Assemble and write the staged block; returns 0, or 1 on a write error */
+static int flush_block(struct Block_Enc *e, FILE *fp) {
+    struct Arc_Buf *out = &e->out;
+    out->len = 0;
+    put_deltas(out, e->id, e->id_ok, e->n);
+    put_forms(out, e->cpf_form, e->n);
+    put_bytes(out, e->cpf.p, e->cpf.len);
+    put_bytes(out, e->nome.p, e->nome.len);
+    put_packed(out, e->idade, e->idade_ok, e->n);
+    put_forms(out, e->data_form, e->n);
+    put_bytes(out, e->data.p, e->data.len);
+
+    struct Arc_Buf frame = {NULL, 0, 0};
+    put_varint(&frame, (unsigned long long)e->n);
+    put_varint(&frame, out->len);
+    int bad = fwrite(frame.p, 1, frame.len, fp) != frame.len || fwrite(out->p, 1, out->len, fp) != out->len;
+    free(frame.p);
+    e->n = 0;
+    e->cpf.len = e->nome.len = e->data.len = 0;
+    e->prev_day = 0;
+    return bad;
+}
+
+static void *alloc_rows(size_t each) {
+    void *p = malloc(each * ARC_BLOCK_ROWS);
+    if (p == NULL) {
+        exit(1);
+    }
+    return p;
+}
+
+int arc_write(const struct Dinamic_Vector *dv, const char *path, struct Arc_Stats *st) {
+    struct Arc_Stats local;
+    if (st == NULL) {
+        st = &local;
+    }
+    memset(st, 0, sizeof(*st));
+    if (dv == NULL || path == NULL) {
+        return 1;
+    }
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return 1;
+    }
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int n = dv_size(dv);
+
+    /* pass 1: the word dictionary */
+    struct Arc_Dict dict;
+    dict_init(&dict);
+    for (int i = 0; i < n; i++) {
+        const struct Field *f[PC_COUNT];
+        schema_fields(dv_get(dv, i), f);
+        if (str_of(f[PC_NOME]) != NULL) {
+            count_words(&dict, f[PC_NOME]->s);
+        }
+    }
+    struct Word_Rank *order = (struct Word_Rank *)malloc(sizeof(struct Word_Rank) * (size_t)(dict.n > 0 ? dict.n : 1));
+    if (order == NULL) {
+        exit(1);
+    }
+    dict_rank(&dict, order);
+
+    struct Arc_Buf head = {NULL, 0, 0};
+    put_bytes(&head, ARC_MAGIC, strlen(ARC_MAGIC));
+    put_varint(&head, (unsigned long long)n);
+    put_varint(&head, ARC_BLOCK_ROWS);
+    put_varint(&head, (unsigned long long)dict.n);
+    for (int k = 0; k < dict.n; k++) {
+        int w = order[k].w;
+        put_varint(&head, (unsigned long long)dict.len[w]);
+        put_bytes(&head, dict.text + dict.off[w], (size_t)dict.len[w]);
+    }
+    free(order);
+    int bad = fwrite(head.p, 1, head.len, fp) != head.len;
+    free(head.p);
+
+    /* header line of the equivalent CSV */
+#define HEADER_WIDTH(name, header, kind) + (long long)sizeof(header)
+    st->csv_bytes = 0 PATIENT_SCHEMA(HEADER_WIDTH);
+#undef HEADER_WIDTH
+
+    /* pass 2: the blocks */
+    struct Block_Enc e;
+    memset(&e, 0, sizeof(e));
+    e.id = (int *)alloc_rows(sizeof(int));
+    e.idade = (int *)alloc_rows(sizeof(int));
+    e.id_ok = (unsigned char *)alloc_rows(1);
+    e.idade_ok = (unsigned char *)alloc_rows(1);
+    e.cpf_form = (unsigned char *)alloc_rows(1);
+    e.data_form = (unsigned char *)alloc_rows(1);
+    for (int i = 0; i < n && !bad; i++) {
+        st->csv_bytes += stage_row(&e, &dict, dv_get(dv, i));
+        if (e.n == ARC_BLOCK_ROWS || i == n - 1) {
+            bad = flush_block(&e, fp);
+            st->blocks++;
+        }
+    }
+    bad = bad || fputc(0, fp) == EOF;  /* end: a block of 0 rows */
+    st->bytes = ftell(fp);
+    bad = fclose(fp) != 0 || bad;
+
+    free(e.id);
+    free(e.idade);
+    free(e.id_ok);
+    free(e.idade_ok);
+    free(e.cpf_form);
+    free(e.data_form);
+    free(e.cpf.p);
+    free(e.nome.p);
+    free(e.data.p);
+    free(e.out.p);
+    st->rows = n;
+    st->words = dict.n;
+    dict_free(&dict);
+    st->seconds = elapsed_since(&t0);
+    return bad;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Reader                                                                 */
+/* ---------------------------------------------------------------------- */
+
+/* One block being decoded: columns first, rows built once all are valid */
+struct Block_Dec {
+    int cap;
+    int *id;
+    unsigned char *id_ok;
+    int *idade;
+    unsigned char *idade_ok;
+    unsigned char *form;
+    char **cpf;
+    char **nome;
+    char **data;
+    int *ids;        /* word ids of the name being decoded */
+    int ids_cap;
+};
+
+static void get_nulls(struct Arc_In *in, unsigned char *ok, int n) {
+    if (get_byte(in) == 0) {
+        memset(ok, 1, (size_t)n);
+        return;
+    }
+    const unsigned char *bits = get_bytes(in, (size_t)(n + 7) / 8);
+    for (int k = 0; k < n; k++) {
+        ok[k] = bits != NULL && (bits[k / 8] >> (k % 8)) & 1;
+    }
+}
+
+static void get_forms(struct Arc_In *in, unsigned char *form, int n) {
+    const unsigned char *bits = get_bytes(in, (size_t)(n + 3) / 4);
+    for (int k = 0; k < n; k++) {
+        form[k] = bits != NULL ? (bits[k / 4] >> (2 * (k % 4))) & 3 : FORM_NULL;
+    }
+}
+
+static void get_deltas(struct Arc_In *in, int *v, unsigned char *ok, int n) {
+    get_nulls(in, ok, n);
+    long long prev = 0;
+    for (int k = 0; k < n; k++) {
+        if (ok[k]) {
+            prev += unzigzag(get_varint(in));
+            v[k] = (int)prev;
+        }
+    }
+}
+
+static void get_packed(struct Arc_In *in, int *v, unsigned char *ok, int n) {
+    get_nulls(in, ok, n);
+    long long lo = unzigzag(get_varint(in));
+    unsigned width = get_byte(in);
+    if (width > 32) {
+        in->bad = 1;
+        return;
+    }
+    unsigned long long acc = 0, mask = (1ULL << width) - 1;
+    unsigned bits = 0;
+    for (int k = 0; k < n; k++) {
+        if (!ok[k]) {
+            continue;
+        }
+        while (bits < width) {
+            acc |= (unsigned long long)get_byte(in) << bits;
+            bits += 8;
+        }
+        v[k] = (int)(lo + (long long)(acc & mask));
+        acc >>= width;
+        bits -= width;
+    }
+}
+
+/* Text value of FORM_TEXT: varint length + bytes */
+static char *get_text(struct Arc_In *in) {
+    unsigned long long n = get_varint(in);
+    const unsigned char *s = get_bytes(in, (size_t)n);
+    return s != NULL ? slab_strndup((const char *)s, (size_t)n) : NULL;
+}
+
+static void get_cpfs(struct Arc_In *in, struct Block_Dec *b, int n) {
+    get_forms(in, b->form, n);
+    for (int k = 0; k < n && !in->bad; k++) {
+        if (b->form[k] == FORM_MAIN || b->form[k] == FORM_ALT) {
+            const unsigned char *le = get_bytes(in, 5);
+            if (le == NULL) {
+                break;
+            }
+            unsigned long long num = 0;
+            for (int j = 4; j >= 0; j--) {
+                num = (num << 8) | le[j];
+            }
+            char text[16];
+            cpf_text(num, b->form[k], text);
+            b->cpf[k] = slab_strdup(text);
+        } else if (b->form[k] == FORM_TEXT) {
+            b->cpf[k] = get_text(in);
+        }
+    }
+}
+
+static void get_names(struct Arc_In *in, struct Block_Dec *b, int n, const struct Arc_Dict *d) {
+    for (int k = 0; k < n && !in->bad; k++) {
+        unsigned long long words = get_varint(in);
+        if (words == 0) {
+            continue;
+        }
+        if (words > (unsigned long long)(in->end - in->p)) {
+            in->bad = 1;  /* every id takes at least one byte */
+            break;
+        }
+        if ((int)words > b->ids_cap) {
+            b->ids_cap = (int)words;
+            b->ids = (int *)realloc(b->ids, sizeof(int) * (size_t)b->ids_cap);
+            if (b->ids == NULL) {
+                exit(1);
+            }
+        }
+        size_t len = (size_t)words - 1;  /* the spaces */
+        for (int j = 0; j < (int)words; j++) {
+            unsigned long long w = get_varint(in);
+            if (in->bad || w >= (unsigned long long)d->n) {
+                in->bad = 1;
+                return;
+            }
+            b->ids[j] = (int)w;
+            len += (size_t)d->len[w];
+        }
+        char *s = slab_str_alloc(len + 1);
+        char *p = s;
+        for (int j = 0; j < (int)words; j++) {
+            int w = b->ids[j];
+            if (j > 0) {
+                *p++ = ' ';
+            }
+            memcpy(p, d->text + d->off[w], (size_t)d->len[w]);
+            p += d->len[w];
+        }
+        *p = '\0';
+        b->nome[k] = s;
+    }
+}
+
+static void get_dates(struct Arc_In *in, struct Block_Dec *b, int n) {
+    get_forms(in, b->form, n);
+    long long day = 0;
+    for (int k = 0; k < n && !in->bad; k++) {
+        if (b->form[k] == FORM_MAIN) {
+            day += unzigzag(get_varint(in));
+            int y, m, d;
+            civil_from_days(day, &y, &m, &d);
+            /* m and d are in range by construction; the checks also bound the text for the compiler */
+            if (y < 0 || y > 9999 || m < 1 || m > 12 || d < 1 || d > 31) {
+                in->bad = 1;
+                break;
+            }
+            char text[16];
+            snprintf(text, sizeof(text), "%04d-%02d-%02d", y, m, d);
+            b->data[k] = slab_strndup(text, 10);
+        } else if (b->form[k] == FORM_TEXT) {
+            b->data[k] = get_text(in);
+        } else if (b->form[k] != FORM_NULL) {
+            in->bad = 1;
+        }
+    }
+}
+
+static struct Field int_field(int ok, int v) {
+    struct Field f;
+    f.type = ok ? FIELD_INT : FIELD_NULL;
+    f.i = ok ? v : 0;
+    f.s = NULL;
+    return f;
+}
+
+static struct Field str_field(char *s) {
+    struct Field f;
+    f.type = (s != NULL) ? FIELD_STRING : FIELD_NULL;
+    f.i = 0;
+    f.s = s;
+    return f;
+}
+
+/* Decode one block payload and append its rows; returns 0, or 1 if it is malformed */
+static int decode_block(struct Dinamic_Vector *dv, struct Block_Dec *b, const unsigned char *p, size_t len,
+                        int n, const struct Arc_Dict *d) {
+    struct Arc_In in = {p, p + len, 0};
+    memset(b->cpf, 0, sizeof(char *) * (size_t)n);
+    memset(b->nome, 0, sizeof(char *) * (size_t)n);
+    memset(b->data, 0, sizeof(char *) * (size_t)n);
+    get_deltas(&in, b->id, b->id_ok, n);
+    if (!in.bad) {
+        get_cpfs(&in, b, n);
+    }
+    if (!in.bad) {
+        get_names(&in, b, n, d);
+    }
+    if (!in.bad) {
+        get_packed(&in, b->idade, b->idade_ok, n);
+    }
+    if (!in.bad) {
+        get_dates(&in, b, n);
+    }
+    if (in.bad || in.p != in.end) {
+        for (int k = 0; k < n; k++) {
+            slab_str_free(b->cpf[k]);
+            slab_str_free(b->nome[k]);
+            slab_str_free(b->data[k]);
+        }
+        return 1;
+    }
+    for (int k = 0; k < n; k++) {
+        struct LinkedList *row = ll_create();
+        ll_append_field(row, int_field(b->id_ok[k], b->id[k]));
+        ll_append_field(row, str_field(b->cpf[k]));
+        ll_append_field(row, str_field(b->nome[k]));
+        ll_append_field(row, int_field(b->idade_ok[k], b->idade[k]));
+        ll_append_field(row, str_field(b->data[k]));
+        ll_refresh_key(row);
+        dv_insert(dv, row);
+    }
+    return 0;
+}
+
+/* Read the word list of the header into 'd' */
+static int read_dict(FILE *fp, struct Arc_Dict *d) {
+    unsigned long long words;
+    if (read_varint(fp, &words) != 0 || words > (unsigned long long)ARC_MAX_BLOCK_ROWS * 64) {
+        return 1;
+    }
+    char *tmp = NULL;
+    size_t tmp_cap = 0;
+    for (unsigned long long k = 0; k < words; k++) {
+        unsigned long long len;
+        if (read_varint(fp, &len) != 0 || len > (1u << 20)) {
+            free(tmp);
+            return 1;
+        }
+        if (len > tmp_cap) {
+            tmp_cap = (size_t)len;
+            tmp = (char *)realloc(tmp, tmp_cap);
+            if (tmp == NULL) {
+                exit(1);
+            }
+        }
+        if (fread(tmp, 1, (size_t)len, fp) != (size_t)len) {
+            free(tmp);
+            return 1;
+        }
+        dict_push(d, tmp, (int)len);
+    }
+    free(tmp);
+    return 0;
+}
+
+int arc_read(struct Dinamic_Vector *dv, const char *path, struct Arc_Stats *st) {
+    struct Arc_Stats local;
+    if (st == NULL) {
+        st = &local;
+    }
+    memset(st, 0, sizeof(*st));
+    if (dv == NULL || path == NULL) {
+        return 1;
+    }
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return 1;
+    }
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    char magic[sizeof(ARC_MAGIC)];
+    unsigned long long rows, block_rows;
+    struct Arc_Dict dict;
+    memset(&dict, 0, sizeof(dict));
+    if (fread(magic, 1, strlen(ARC_MAGIC), fp) != strlen(ARC_MAGIC) ||
+        memcmp(magic, ARC_MAGIC, strlen(ARC_MAGIC)) != 0 || read_varint(fp, &rows) != 0 ||
+        read_varint(fp, &block_rows) != 0 || block_rows == 0 || block_rows > ARC_MAX_BLOCK_ROWS ||
+        read_dict(fp, &dict) != 0) {
+        dict_free(&dict);
+        fclose(fp);
+        return 1;
+    }
+
+    struct Block_Dec b;
+    b.cap = (int)block_rows;
+    b.id = (int *)malloc(sizeof(int) * block_rows);
+    b.idade = (int *)malloc(sizeof(int) * block_rows);
+    b.id_ok = (unsigned char *)malloc(block_rows);
+    b.idade_ok = (unsigned char *)malloc(block_rows);
+    b.form = (unsigned char *)malloc(block_rows);
+    b.cpf = (char **)malloc(sizeof(char *) * block_rows);
+    b.nome = (char **)malloc(sizeof(char *) * block_rows);
+    b.data = (char **)malloc(sizeof(char *) * block_rows);
+    b.ids = NULL;
+    b.ids_cap = 0;
+    if (b.id == NULL || b.idade == NULL || b.id_ok == NULL || b.idade_ok == NULL || b.form == NULL ||
+        b.cpf == NULL || b.nome == NULL || b.data == NULL) {
+        exit(1);
+    }
+
+    struct Arc_Buf payload = {NULL, 0, 0};
+    int bad = 0;
+    for (;;) {
+        unsigned long long n, len;
+        if (read_varint(fp, &n) != 0) {
+            bad = 1;  /* no end block: truncated */
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (n > block_rows || read_varint(fp, &len) != 0) {
+            bad = 1;
+            break;
+        }
+        payload.len = 0;
+        buf_reserve(&payload, (size_t)len);
+        if (fread(payload.p, 1, (size_t)len, fp) != (size_t)len ||
+            decode_block(dv, &b, payload.p, (size_t)len, (int)n, &dict) != 0) {
+            bad = 1;
+            break;
+        }
+        st->rows += (int)n;
+        st->blocks++;
+    }
+    bad = bad || (unsigned long long)st->rows != rows;
+    st->bytes = ftell(fp);
+    st->words = dict.n;
+    fclose(fp);
+
+    free(payload.p);
+    free(b.id);
+    free(b.idade);
+    free(b.id_ok);
+    free(b.idade_ok);
+    free(b.form);
+    free(b.cpf);
+    free(b.nome);
+    free(b.data);
+    free(b.ids);
+    dict_free(&dict);
+    st->seconds = elapsed_since(&t0);
+    return bad;
+}
+
+void arc_report(const struct Arc_Stats *st, FILE *out) {
+    fprintf(out, "%d registro(s) em %d bloco(s), %d palavra(s) no dicionário de nomes\n",
+            st->rows, st->blocks, st->words);
+    fprintf(out, "Arquivo compactado: %lld bytes", st->bytes);
+    if (st->csv_bytes > 0 && st->bytes > 0) {
+        fprintf(out, " (CSV: %lld bytes, %.2fx menor)", st->csv_bytes, (double)st->csv_bytes / (double)st->bytes);
+    }
+    fprintf(out, "\n");
+    fprintf(out, "Tempo: %.3f s (%.0f registros/s)\n", st->seconds,
+            st->seconds > 0 ? st->rows / st->seconds : 0.0);
+}
@@ -0,0 +1,71 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdio.h>
+
+struct Dinamic_Vector;
+
+/*
+ * Compressed columnar archive of the patient base, for storage and
+ * transfer (the CSV written by dv_write_to_csv stays the working format).
+ *
+ * Rows are cut into blocks of ARC_BLOCK_ROWS; inside a block each column
+ * is stored on its own, with an encoding chosen for its contents:
+ *
+ *     ID             differences from the previous ID, zigzag varints
+ *                    (1 byte per row for sequential IDs)
+ *     CPF            11 digits as a 5-byte number, plus a 2-bit form per
+ *                    row (formatted, digits only, or other text kept as is)
+ *     Nome           the words of the name as varint ids into a dictionary
+ *                    of every distinct word, most frequent first
+ *     Idade          bit-packed above the block minimum
+ *     Data_Cadastro  day numbers as differences from the previous date,
+ *                    with a 2-bit form per row like the CPF
+ *
+ * Nulls are a per-column bitmap (only when the block has any). Every value
+ * decodes back to exactly the text it came from. A block is written from
+ * and read into one buffer, so both directions stream through memory
+ * bounded by one block plus the word dictionary. Varints are base-128,
+ * least significant group first.
+ *
+ * File layout: ARC_MAGIC, varint row count, varint rows per block
+ * (ARC_BLOCK_ROWS when written; a reader takes it from the file), varint
+ * word count, the words (varint length + bytes), then the blocks (varint
+ * rows, varint payload bytes, payload), ended by a block of 0 rows.
+ */
+
+#define ARC_MAGIC "HPMSARC1"
+#define ARC_BLOCK_ROWS 4096
+
+struct Arc_Stats {
+    int rows;
+    int blocks;
+    int words;            /* dictionary entries */
+    long long bytes;      /* archive size */
+    long long csv_bytes;  /* size of the same rows as CSV */
+    double seconds;
+};
+
+/**
+ * Write every row of 'dv' to the archive 'path' (truncated); '*st' (if
+ * given) receives the sizes and the time taken.
+ * Returns 0 on success; returns 1 if the file cannot be written.
+ * If malloc fails, exits(1).
+ */
+int arc_write(const struct Dinamic_Vector *dv, const char *path, struct Arc_Stats *st);
+
+/**
+ * Append every row of the archive 'path' to 'dv', as dv_read_from_csv
+ * does for a CSV; '*st' (if given) receives the sizes and the time taken.
+ * Returns 0 on success; returns 1 if the file cannot be read or is not a
+ * valid archive (rows decoded before the error stay in 'dv').
+ * If malloc fails, exits(1).
+ */
+int arc_read(struct Dinamic_Vector *dv, const char *path, struct Arc_Stats *st);
+
+/**
+ * Print the row count, archive and CSV sizes, ratio and speed.
+ */
+void arc_report(const struct Arc_Stats *st, FILE *out);
+
+#endif /* ARCHIVE_H */
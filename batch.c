@@ -0,0 +1,402 @@
+#include "batch.h"
+#include "aggregate.h"
+#include "archive.h"
+#include "cursor.h"
+#include "dinamic_vector.h"
+#include "extsort.h"
+#include "ingest.h"
+#include "memstat.h"
+#include "normalize.h"
+#include "query.h"
+#include "schema.h"
+#include "snapshot.h"
+#include "trigram.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Rows per consult page; changed with "pagina <n>" */
+static int page_size = 20;
+
+/* Print elapsed times after results; changed with "tempos <sim|nao>" */
+static int show_times = 0;
+
+/*
+ * Print one page from 'c' and, if rows remain, the token to continue.
+ * Takes ownership of the cursor.
+ */
+static void batch_page(struct Dinamic_Vector *dv, struct Consult_Cursor *c, FILE *out) {
+    if (c->stale) {
+        fprintf(out, "Aviso: os dados mudaram desde o início desta consulta.\n");
+    }
+    schema_print_header(out);
+    int found = cursor_print_page(c, dv, page_size, out);
+    if (cursor_has_more(c, dv)) {
+        size_t size = cursor_token_size(c);
+        char *token = (char *)malloc(size);
+        if (token == NULL) {
+            exit(1);
+        }
+        cursor_token(c, token, size);
+        fprintf(out, "(%d registro(s); mais resultados: continua %s)\n", found, token);
+        free(token);
+    } else {
+        fprintf(out, "(%d registro(s); fim da consulta)\n", found);
+    }
+    cursor_close(c);
+}
+
+/*
+ * Run "consulta <modo> <texto>".
+ */
+static int batch_consult(struct Dinamic_Vector *dv, const char *args, FILE *out) {
+    char mode[16] = "";
+    int skip = 0;
+    if (sscanf(args, "%15s %n", mode, &skip) < 1 || args[skip] == '\0') {
+        fprintf(out, "Uso: consulta <nome|cpf|trecho|aprox> <texto>\n");
+        return 1;
+    }
+    const char *text = args + skip;
+    if (strcmp(mode, "nome") == 0) {
+        batch_page(dv, cursor_open(dv, PC_NOME, 0, text), out);
+    } else if (strcmp(mode, "cpf") == 0) {
+        batch_page(dv, cursor_open(dv, PC_CPF, 0, text), out);
+    } else if (strcmp(mode, "trecho") == 0) {
+        batch_page(dv, cursor_open(dv, PC_NOME, 1, text), out);
+    } else if (strcmp(mode, "aprox") == 0) {
+        tri_consult(dv, text, 5, out);
+    } else {
+        fprintf(out, "Modo de consulta desconhecido: %s\n", mode);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Run 'filter' and apply one change per matching row: a removal, or the
+ * values in 'proto'. Prints the counts. Returns 1 on a bad filter.
+ */
+static int batch_change(struct Dinamic_Vector *dv, const char *filter, const struct Dv_Change *proto, FILE *out) {
+    char err[128];
+    struct Query_Plan *plan = query_compile(filter, err, sizeof(err));
+    if (plan == NULL) {
+        fprintf(out, "Erro na consulta: %s\n", err);
+        return 1;
+    }
+    int *rows = NULL;
+    int found = query_execute(plan, dv, &rows);
+    query_free(plan);
+
+    struct Dv_Change *changes = (struct Dv_Change *)malloc(sizeof(struct Dv_Change) * (size_t)(found > 0 ? found : 1));
+    if (changes == NULL) {
+        exit(1);
+    }
+    for (int k = 0; k < found; k++) {
+        changes[k] = *proto;
+        changes[k].row = rows[k];
+    }
+    free(rows);
+    int rejected = 0;
+    int applied = dv_apply_changes(dv, changes, found, &rejected);
+    free(changes);
+    fprintf(out, "%s: %d registro(s)", proto->remove ? "Removidos" : "Atualizados", applied);
+    if (rejected > 0) {
+        fprintf(out, ", %d recusado(s) (CPF já cadastrado ou dados alterados por outro processo)", rejected);
+    }
+    fprintf(out, "\n");
+    return 0;
+}
+
+_Static_assert(PC_COUNT == 5, "parse_assignments names the four editable patient columns one by one");
+
+/*
+ * Parse "campo=valor, campo=valor" (campo: cpf, nome, idade, data; values
+ * may be "quoted") into 'c', using 'vals' as storage. Returns 1 on error.
+ */
+static int parse_assignments(char *text, struct Dv_Change *c, char vals[4][256]) {
+    const char *names[4] = {"cpf", "nome", "idade", "data"};
+    const char **slots[4] = {&c->cpf, &c->nome, &c->idade, &c->data};
+    char *p = text;
+    while (*p != '\0') {
+        while (isspace((unsigned char)*p) || *p == ',') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        char *eq = strchr(p, '=');
+        if (eq == NULL) {
+            return 1;
+        }
+        char *name_end = eq;
+        while (name_end > p && isspace((unsigned char)name_end[-1])) {
+            name_end--;
+        }
+        int field = -1;
+        for (int f = 0; f < 4; f++) {
+            if ((size_t)(name_end - p) == strlen(names[f]) && strncasecmp(p, names[f], strlen(names[f])) == 0) {
+                field = f;
+            }
+        }
+        if (field < 0) {
+            return 1;
+        }
+        p = eq + 1;
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        char *end;
+        if (*p == '"') {
+            end = strchr(++p, '"');
+            if (end == NULL) {
+                return 1;
+            }
+        } else {
+            end = p + strcspn(p, ",");
+            while (end > p && isspace((unsigned char)end[-1])) {
+                end--;
+            }
+        }
+        size_t len = (size_t)(end - p);
+        if (len >= sizeof(vals[field])) {
+            return 1;
+        }
+        memcpy(vals[field], p, len);
+        vals[field][len] = '\0';
+        *slots[field] = vals[field];
+        p = end + (*end == '"');
+    }
+    return 0;
+}
+
+/*
+ * Run "atualiza <filtro> SET campo=valor[, ...]".
+ */
+static int batch_update(struct Dinamic_Vector *dv, const char *args, FILE *out) {
+    char text[1024];
+    snprintf(text, sizeof(text), "%s", args);
+    /* the first " SET " outside quotes separates the filter from the
+       assignments (a quoted filter or new value may contain " SET ") */
+    char *set = NULL;
+    int quoted = 0;
+    for (char *p = text; *p != '\0' && set == NULL; p++) {
+        if (*p == '"') {
+            quoted = !quoted;
+        } else if (!quoted && strncasecmp(p, " SET ", 5) == 0) {
+            set = p;
+        }
+    }
+    struct Dv_Change proto = {0, 0, NULL, NULL, NULL, NULL};
+    char vals[4][256];
+    if (set == NULL || (*set = '\0', parse_assignments(set + 5, &proto, vals)) != 0 ||
+        (proto.cpf == NULL && proto.nome == NULL && proto.idade == NULL && proto.data == NULL)) {
+        fprintf(out, "Uso: atualiza <filtro> SET campo=valor[, campo=valor] (campos cpf, nome, idade, data)\n");
+        return 1;
+    }
+    int bad = normalize_update(proto.cpf != NULL ? vals[0] : NULL, proto.data != NULL ? vals[3] : NULL);
+    if (bad != 0) {
+        fprintf(out, "Atualização recusada: %s\n", valid_reason(bad));
+        return 1;
+    }
+    return batch_change(dv, text, &proto, out);
+}
+
+/*
+ * Run one of the commands that only read the rows. Returns -1 if 'verb' is
+ * not one of them, else the command's status.
+ */
+static int batch_read(struct Dinamic_Vector *dv, const char *verb, const char *args, FILE *out) {
+    if (strcmp(verb, "agg") == 0) {
+        return agg_run(dv, args, show_times, out);
+    } else if (strcmp(verb, "consulta") == 0) {
+        return batch_consult(dv, args, out);
+    } else if (strcmp(verb, "exporta") == 0) {
+        char path[256];
+        struct Arc_Stats as;
+        if (sscanf(args, "%255s", path) != 1) {
+            fprintf(out, "Uso: exporta <arquivo>\n");
+            return 1;
+        }
+        if (arc_write(dv, path, &as) != 0) {
+            fprintf(out, "Erro ao gravar %s\n", path);
+            return 1;
+        }
+        arc_report(&as, out);
+        return 0;
+    } else if (strcmp(verb, "valida") == 0) {
+        int invalid = dv_validate(dv, out, 20);
+        fprintf(out, "(%d registro(s) com CPF ou data inválidos)\n", invalid);
+        return 0;
+    } else if (strcmp(verb, "query") == 0) {
+        return query_run(dv, args, show_times, out);
+    }
+    return -1;
+}
+
+/*
+ * Run "em <ponto> <comando>": a read-only command on snapshot <ponto>.
+ */
+static int batch_in_snapshot(struct Dinamic_Vector *dv, const char *args, FILE *out) {
+    int id = 0;
+    char verb[16] = "";
+    int skip = 0;
+    if (sscanf(args, "%d %15s %n", &id, verb, &skip) < 2) {
+        fprintf(out, "Uso: em <ponto> <agg|consulta|exporta|query|valida> ...\n");
+        return 1;
+    }
+    struct Dinamic_Vector *view = snap_view(dv, id);
+    if (view == NULL) {
+        fprintf(out, "Ponto de restauração %d não existe.\n", id);
+        return 1;
+    }
+    int status = batch_read(view, verb, args + skip, out);
+    if (status < 0) {
+        fprintf(out, "Comando não permitido num ponto de restauração: %s\n", verb);
+        status = 1;
+    }
+    snap_view_close(dv, view);
+    return status;
+}
+
+/*
+ * Run "snapshot [rótulo]", "snapshots", "restaura <ponto>" and
+ * "descarta <ponto>". Returns -1 if 'verb' is none of them.
+ */
+static int batch_snapshot(struct Dinamic_Vector *dv, const char *verb, const char *args, FILE *out) {
+    if (strcmp(verb, "snapshot") == 0) {
+        int id = snap_take(dv, args, 0);
+        if (id < 0) {
+            fprintf(out, "Pontos de restauração não disponíveis nos modos paginado e compartilhado.\n");
+            return 1;
+        }
+        fprintf(out, "Ponto de restauração %d criado (%d registro(s)).\n", id, dv_size(dv));
+        return 0;
+    } else if (strcmp(verb, "snapshots") == 0) {
+        snap_list(dv, out);
+        return 0;
+    } else if (strcmp(verb, "restaura") == 0 || strcmp(verb, "descarta") == 0) {
+        int id = 0;
+        int restore = (verb[0] == 'r');
+        if (sscanf(args, "%d", &id) != 1) {
+            fprintf(out, "Uso: %s <ponto>\n", verb);
+            return 1;
+        }
+        if ((restore ? snap_restore(dv, id) : snap_drop(dv, id)) != 0) {
+            fprintf(out, "Ponto de restauração %d não existe.\n", id);
+            return 1;
+        }
+        if (restore) {
+            fprintf(out, "Base restaurada ao ponto %d (%d registro(s)).\n", id, dv_size(dv));
+        } else {
+            fprintf(out, "Ponto de restauração %d descartado.\n", id);
+        }
+        return 0;
+    }
+    return -1;
+}
+
+int batch_run(struct Dinamic_Vector *dv, FILE *in, FILE *out) {
+    char line[1024];
+    int failed = 0;
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *cmd = line + strspn(line, " \t");
+        if (cmd[0] == '\0' || cmd[0] == '#') {
+            continue;
+        }
+
+        char verb[16] = "";
+        int skip = 0;
+        sscanf(cmd, "%15s %n", verb, &skip);
+        const char *args = cmd + skip;
+
+        fprintf(out, "> %s\n", cmd);
+        fflush(out);
+        /* shared mode: see other processes' changes; the read-only commands
+           hold the store to the end, so a scan sees a single epoch */
+        dv_hold(dv);
+        int status = batch_read(dv, verb, args, out);
+        if (status < 0 && strcmp(verb, "continua") == 0) {
+            struct Consult_Cursor *c = cursor_resume(dv, args);
+            status = (c == NULL);
+            if (c == NULL) {
+                fprintf(out, "Token inválido.\n");
+            } else {
+                batch_page(dv, c, out);
+            }
+        }
+        dv_release(dv);
+        if (status >= 0 || (status = batch_snapshot(dv, verb, args, out)) >= 0) {
+            failed |= status;
+        } else if (strcmp(verb, "em") == 0) {
+            failed |= batch_in_snapshot(dv, args, out);
+        } else if (strcmp(verb, "pagina") == 0) {
+            int n = atoi(args);
+            if (n <= 0) {
+                fprintf(out, "Uso: pagina <n> (n > 0)\n");
+                failed = 1;
+            } else {
+                page_size = n;
+            }
+        } else if (strcmp(verb, "tempos") == 0) {
+            char value[8] = "";
+            sscanf(args, "%7s", value);
+            if (strcmp(value, "sim") == 0 || strcmp(value, "nao") == 0) {
+                show_times = (strcmp(value, "sim") == 0);
+            } else {
+                fprintf(out, "Uso: tempos <sim|nao>\n");
+                failed = 1;
+            }
+        } else if (strcmp(verb, "buffer") == 0) {
+            if (dv->pool == NULL) {
+                fprintf(out, "Modo paginado inativo (use --paginado).\n");
+            } else {
+                pool_report(dv->pool, dv->row_cache, out);
+            }
+        } else if (strcmp(verb, "memoria") == 0) {
+            struct Mem_Report mr;
+            mem_measure(dv, &mr);
+            mem_report(&mr, out);
+        } else if (strcmp(verb, "importa") == 0) {
+            char path[256];
+            int producers = 0;
+            if (sscanf(args, "%255s %d", path, &producers) < 1) {
+                fprintf(out, "Uso: importa <arquivo.csv> [produtores]\n");
+                failed = 1;
+            } else if (ingest_import_csv(dv, path, producers, show_times, out) != 0) {
+                fprintf(out, "Erro ao ler %s\n", path);
+                failed = 1;
+            }
+        } else if (strcmp(verb, "mescla") == 0) {
+            char path[256];
+            long kib = 0;
+            struct Ext_Import_Stats st;
+            if (sscanf(args, "%255s %ld", path, &kib) < 1 || kib < 0) {
+                fprintf(out, "Uso: mescla <arquivo.csv> [memoria_kb]\n");
+                failed = 1;
+            } else if (ext_import_csv(dv, path, (size_t)kib << 10, &st, out) != 0) {
+                fprintf(out, "Erro ao ler %s ou ao gravar arquivos temporários\n", path);
+                failed = 1;
+            } else {
+                ext_report(&st, out);
+            }
+        } else if (strcmp(verb, "remove") == 0) {
+            struct Dv_Change proto = {0, 1, NULL, NULL, NULL, NULL};
+            if (args[0] == '\0') {
+                fprintf(out, "Uso: remove <filtro>\n");
+                failed = 1;
+            } else {
+                failed |= batch_change(dv, args, &proto, out);
+            }
+        } else if (strcmp(verb, "atualiza") == 0) {
+            failed |= batch_update(dv, args, out);
+        } else {
+            fprintf(out, "Comando desconhecido: %s\n", verb);
+            failed = 1;
+        }
+        fflush(stdout);
+    }
+    return failed;
+}
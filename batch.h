@@ -0,0 +1,43 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+
+struct Dinamic_Vector;
+
+/**
+ * Run commands read from 'in', one per line, writing results to 'out'.
+ * Blank lines and lines starting with '#' are ignored. Commands:
+ *
+ *     agg <count|min|max|avg|sum> <id|idade|data> [by <idade|mes>]
+ *     consulta <nome|cpf|trecho|aprox> <texto>   first page of matches, then a token
+ *     continua <token>                           next page of a consult
+ *     pagina <n>                                 page size for consult (default 20)
+ *     tempos <sim|nao>                           print elapsed times (default nao)
+ *     buffer                                     buffer pool hit rates (--paginado)
+ *     memoria                                    memory used per structure (see memstat.h)
+ *     exporta <arquivo>                          write a compressed archive (see archive.h)
+ *     importa <arquivo.csv> [produtores]         concurrent import (see ingest.h)
+ *     mescla <arquivo.csv> [memoria_kb]          sorted bulk merge (see extsort.h)
+ *     query <filtro>          (see query.h)
+ *     valida                                     list rows with a bad CPF or date
+ *     remove <filtro>                            remove every matching row
+ *     atualiza <filtro> SET campo=valor[, ...]   update every matching row
+ *     snapshot [rotulo]                          take a snapshot (see snapshot.h)
+ *     snapshots                                  list the snapshots
+ *     em <ponto> <comando>                       agg, consulta, exporta, query or
+ *                                                valida on snapshot <ponto>
+ *     restaura <ponto>                           roll the base back to <ponto>
+ *     descarta <ponto>                           drop snapshot <ponto>
+ *
+ * remove and atualiza apply all their rows in one pass (dv_apply_changes).
+ * A consult token printed by "em" continues against the current base.
+ * Elapsed times are left out unless "tempos sim", so the same commands on
+ * the same base print the same output.
+ *
+ * Returns 0 if every command succeeded; returns 1 if any command failed
+ * (processing continues after a failure).
+ */
+int batch_run(struct Dinamic_Vector *dv, FILE *in, FILE *out);
+
+#endif /* BATCH_H */
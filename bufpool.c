@@ -0,0 +1,318 @@
+#include "bufpool.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct Buffer_Pool *pool_open(const char *path, int n_frames) {
+    if (path == NULL || n_frames < 1) {
+        return NULL;
+    }
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    if (fseek(fp, 0, SEEK_END) != 0) {
+        fclose(fp);
+        return NULL;
+    }
+    long size = ftell(fp);
+    if (size < 0) {
+        fclose(fp);
+        return NULL;
+    }
+
+    struct Buffer_Pool *pool = (struct Buffer_Pool *)malloc(sizeof(struct Buffer_Pool));
+    if (pool == NULL) {
+        exit(1);
+    }
+    pool->fp = fp;
+    pool->file_size = size;
+    pool->n_frames = n_frames;
+    pool->n_buckets = 1;
+    while (pool->n_buckets < 2 * n_frames) {
+        pool->n_buckets *= 2;
+    }
+    pool->frames = (char *)malloc((size_t)n_frames * POOL_PAGE_SIZE);
+    pool->frame_page = (long *)malloc(sizeof(long) * (size_t)n_frames);
+    pool->frame_len = (int *)malloc(sizeof(int) * (size_t)n_frames);
+    pool->frame_ref = (unsigned char *)calloc((size_t)n_frames, 1);
+    pool->chain = (int *)malloc(sizeof(int) * (size_t)n_frames);
+    pool->bucket = (int *)malloc(sizeof(int) * (size_t)pool->n_buckets);
+    pool->line_cap = 256;
+    pool->line = (char *)malloc(pool->line_cap);
+    if (pool->frames == NULL || pool->frame_page == NULL || pool->frame_len == NULL ||
+        pool->frame_ref == NULL || pool->chain == NULL || pool->bucket == NULL || pool->line == NULL) {
+        exit(1);
+    }
+    for (int f = 0; f < n_frames; f++) {
+        pool->frame_page[f] = -1;
+        pool->chain[f] = -1;
+    }
+    for (int b = 0; b < pool->n_buckets; b++) {
+        pool->bucket[b] = -1;
+    }
+    pool->hand = 0;
+    pool->hits = 0;
+    pool->misses = 0;
+    return pool;
+}
+
+static int page_bucket(const struct Buffer_Pool *pool, long page) {
+    unsigned long h = (unsigned long)page * 0x9E3779B97F4A7C15UL;
+    return (int)((h >> 20) & (unsigned long)(pool->n_buckets - 1));
+}
+
+static void unlink_frame(struct Buffer_Pool *pool, int f) {
+    int *link = &pool->bucket[page_bucket(pool, pool->frame_page[f])];
+    while (*link != f) {
+        link = &pool->chain[*link];
+    }
+    *link = pool->chain[f];
+}
+
+/*
+ * Return the frame holding 'page', reading it into a CLOCK victim on a miss.
+ * Returns -1 on a read error.
+ */
+static int pool_frame(struct Buffer_Pool *pool, long page) {
+    for (int f = pool->bucket[page_bucket(pool, page)]; f >= 0; f = pool->chain[f]) {
+        if (pool->frame_page[f] == page) {
+            pool->hits++;
+            pool->frame_ref[f] = 1;
+            return f;
+        }
+    }
+    pool->misses++;
+
+    int f;
+    for (;;) {
+        f = pool->hand;
+        pool->hand = (pool->hand + 1) % pool->n_frames;
+        if (pool->frame_page[f] < 0 || !pool->frame_ref[f]) {
+            break;
+        }
+        pool->frame_ref[f] = 0;
+    }
+    if (pool->frame_page[f] >= 0) {
+        unlink_frame(pool, f);
+        pool->frame_page[f] = -1;
+    }
+
+    char *data = pool->frames + (size_t)f * POOL_PAGE_SIZE;
+    if (fseek(pool->fp, page * POOL_PAGE_SIZE, SEEK_SET) != 0) {
+        return -1;
+    }
+    size_t got = fread(data, 1, POOL_PAGE_SIZE, pool->fp);
+    if (got == 0 && ferror(pool->fp)) {
+        return -1;
+    }
+    pool->frame_page[f] = page;
+    pool->frame_len[f] = (int)got;
+    pool->frame_ref[f] = 1;
+    int b = page_bucket(pool, page);
+    pool->chain[f] = pool->bucket[b];
+    pool->bucket[b] = f;
+    return f;
+}
+
+const char *pool_read_line(struct Buffer_Pool *pool, long off) {
+    if (pool == NULL || off < 0 || off > pool->file_size) {
+        return NULL;
+    }
+    size_t len = 0;
+    for (;;) {
+        long page = off / POOL_PAGE_SIZE;
+        int in_page = (int)(off % POOL_PAGE_SIZE);
+        int f = pool_frame(pool, page);
+        if (f < 0) {
+            return NULL;
+        }
+        const char *data = pool->frames + (size_t)f * POOL_PAGE_SIZE;
+        int avail = pool->frame_len[f] - in_page;
+        if (avail <= 0) {
+            break;  /* end of file */
+        }
+        const char *nl = memchr(data + in_page, '\n', (size_t)avail);
+        size_t take = (nl != NULL) ? (size_t)(nl - (data + in_page)) : (size_t)avail;
+        if (len + take + 1 > pool->line_cap) {
+            while (len + take + 1 > pool->line_cap) {
+                pool->line_cap *= 2;
+            }
+            char *grown = (char *)realloc(pool->line, pool->line_cap);
+            if (grown == NULL) {
+                exit(1);
+            }
+            pool->line = grown;
+        }
+        memcpy(pool->line + len, data + in_page, take);
+        len += take;
+        if (nl != NULL || pool->frame_len[f] < POOL_PAGE_SIZE) {
+            break;
+        }
+        off += (long)take;  /* line continues on the next page */
+    }
+    if (len > 0 && pool->line[len - 1] == '\r') {
+        len--;
+    }
+    pool->line[len] = '\0';
+    return pool->line;
+}
+
+void pool_close(struct Buffer_Pool *pool) {
+    if (pool == NULL) {
+        return;
+    }
+    fclose(pool->fp);
+    free(pool->frames);
+    free(pool->frame_page);
+    free(pool->frame_len);
+    free(pool->frame_ref);
+    free(pool->chain);
+    free(pool->bucket);
+    free(pool->line);
+    free(pool);
+}
+
+struct Row_Cache *rc_create(int cap) {
+    struct Row_Cache *rc = (struct Row_Cache *)malloc(sizeof(struct Row_Cache));
+    if (rc == NULL) {
+        exit(1);
+    }
+    rc->cap = (cap > 0) ? cap : 1;
+    rc->n = 0;
+    rc->hand = 0;
+    rc->ring = (int *)malloc(sizeof(int) * (size_t)rc->cap);
+    rc->ref_cap = 1024;
+    rc->ref = (unsigned char *)calloc((size_t)rc->ref_cap, 1);
+    if (rc->ring == NULL || rc->ref == NULL) {
+        exit(1);
+    }
+    rc->hits = 0;
+    rc->misses = 0;
+    return rc;
+}
+
+static void rc_reserve(struct Row_Cache *rc, int row) {
+    if (row < rc->ref_cap) {
+        return;
+    }
+    int cap = rc->ref_cap;
+    while (cap <= row) {
+        cap *= 2;
+    }
+    unsigned char *grown = (unsigned char *)realloc(rc->ref, (size_t)cap);
+    if (grown == NULL) {
+        exit(1);
+    }
+    memset(grown + rc->ref_cap, 0, (size_t)(cap - rc->ref_cap));
+    rc->ref = grown;
+    rc->ref_cap = cap;
+}
+
+void rc_touch(struct Row_Cache *rc, int row) {
+    rc_reserve(rc, row);
+    rc->ref[row] = 1;
+    rc->hits++;
+}
+
+int rc_admit(struct Row_Cache *rc, int row, int (*evictable)(const void *ctx, int row), const void *ctx) {
+    rc_reserve(rc, row);
+    rc->misses++;
+    rc->ref[row] = 0;
+    if (rc->n < rc->cap) {
+        rc->ring[rc->n++] = row;
+        return -1;
+    }
+    for (;;) {
+        int slot = rc->hand;
+        int victim = rc->ring[slot];
+        rc->hand = (rc->hand + 1) % rc->n;
+        if (!evictable(ctx, victim)) {
+            /* pinned for good (changed in memory): it just stops being tracked */
+            rc->ring[slot] = row;
+            return -1;
+        }
+        if (rc->ref[victim]) {
+            rc->ref[victim] = 0;
+            continue;
+        }
+        rc->ring[slot] = row;
+        return victim;
+    }
+}
+
+void rc_remove_row(struct Row_Cache *rc, int row) {
+    if (rc == NULL) {
+        return;
+    }
+    for (int k = 0; k < rc->n; k++) {
+        if (rc->ring[k] == row) {
+            rc->ring[k] = rc->ring[--rc->n];
+            k--;
+        } else if (rc->ring[k] > row) {
+            rc->ring[k]--;
+        }
+    }
+    if (rc->hand >= rc->n) {
+        rc->hand = 0;
+    }
+    if (row < rc->ref_cap) {
+        memmove(&rc->ref[row], &rc->ref[row + 1], (size_t)(rc->ref_cap - row - 1));
+        rc->ref[rc->ref_cap - 1] = 0;
+    }
+}
+
+void rc_remap(struct Row_Cache *rc, const int *map, int n) {
+    if (rc == NULL) {
+        return;
+    }
+    int kept = 0;
+    for (int k = 0; k < rc->n; k++) {
+        int row = rc->ring[k];
+        if (row < n && map[row] >= 0) {
+            rc->ring[kept++] = map[row];
+        }
+    }
+    rc->n = kept;
+    if (rc->hand >= rc->n) {
+        rc->hand = 0;
+    }
+    /* map only moves rows down, so the ref bits can be compacted in place */
+    int limit = (n < rc->ref_cap) ? n : rc->ref_cap;
+    for (int p = 0; p < limit; p++) {
+        if (map[p] >= 0) {
+            rc->ref[map[p]] = rc->ref[p];
+        }
+    }
+    int live = 0;
+    for (int p = 0; p < n; p++) {
+        live += (map[p] >= 0);
+    }
+    if (live < rc->ref_cap) {
+        memset(rc->ref + live, 0, (size_t)(rc->ref_cap - live));
+    }
+}
+
+void rc_free(struct Row_Cache *rc) {
+    if (rc == NULL) {
+        return;
+    }
+    free(rc->ring);
+    free(rc->ref);
+    free(rc);
+}
+
+static double hit_rate(unsigned long hits, unsigned long misses) {
+    unsigned long total = hits + misses;
+    return total ? 100.0 * (double)hits / (double)total : 0.0;
+}
+
+void pool_report(const struct Buffer_Pool *pool, const struct Row_Cache *rc, FILE *out) {
+    if (pool != NULL) {
+        fprintf(out, "Páginas: %d quadros de %d bytes, %lu acertos, %lu faltas (%.1f%% de acerto)\n",
+                pool->n_frames, POOL_PAGE_SIZE, pool->hits, pool->misses, hit_rate(pool->hits, pool->misses));
+    }
+    if (rc != NULL) {
+        fprintf(out, "Registros: %d de %d em memória, %lu acertos, %lu faltas (%.1f%% de acerto)\n",
+                rc->n, rc->cap, rc->hits, rc->misses, hit_rate(rc->hits, rc->misses));
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef BUFPOOL_H
+#define BUFPOOL_H
+
+#include <stdio.h>
+
+/*
+ * Out-of-core storage (--paginado): the CSV file stays on disk and is read
+ * in fixed-size pages through a buffer pool of 'n_frames' frames. A row is
+ * located by the byte offset of its line, so the vector only keeps one
+ * offset per row; its LinkedList is parsed on access and kept in a bounded
+ * cache of resident rows.
+ *
+ * Both the page frames and the resident rows are evicted with CLOCK: each
+ * entry has a reference bit set on every hit; the hand clears set bits and
+ * evicts the first entry whose bit is already clear.
+ */
+
+#define POOL_PAGE_SIZE 4096
+
+struct Buffer_Pool {
+    FILE *fp;
+    long file_size;
+    int n_frames;
+    char *frames;               /* n_frames * POOL_PAGE_SIZE bytes */
+    long *frame_page;           /* page held by each frame, -1 if free */
+    int *frame_len;             /* valid bytes in the frame (last page may be short) */
+    unsigned char *frame_ref;   /* CLOCK reference bits */
+    int *bucket;                /* page hash -> first frame, -1 if none */
+    int *chain;                 /* next frame in the same bucket */
+    int n_buckets;              /* power of two */
+    int hand;
+    char *line;                 /* buffer returned by pool_read_line */
+    size_t line_cap;
+    unsigned long hits;
+    unsigned long misses;
+};
+
+/*
+ * Resident parsed rows, by row position. The owner (dinamic_vector.c)
+ * decides which rows may be evicted and frees them.
+ */
+struct Row_Cache {
+    int cap;                    /* max resident rows */
+    int n;
+    int *ring;                  /* resident row positions */
+    int hand;
+    unsigned char *ref;         /* reference bit per row position */
+    int ref_cap;
+    unsigned long hits;
+    unsigned long misses;
+};
+
+/**
+ * Open 'path' for paged reads with 'n_frames' frames.
+ * Returns NULL if the file cannot be opened. If malloc fails, exits(1).
+ */
+struct Buffer_Pool *pool_open(const char *path, int n_frames);
+
+/**
+ * Read the line starting at byte 'off' (without its newline or '\r').
+ * Returns a NUL-terminated buffer owned by the pool, valid until the next
+ * call, or NULL on a read error.
+ */
+const char *pool_read_line(struct Buffer_Pool *pool, long off);
+
+/**
+ * Close the file and free the pool. Safe if pool==NULL.
+ */
+void pool_close(struct Buffer_Pool *pool);
+
+/**
+ * Create a row cache holding at most 'cap' rows. If malloc fails, exits(1).
+ */
+struct Row_Cache *rc_create(int cap);
+
+/**
+ * Record a hit on resident row 'row'.
+ */
+void rc_touch(struct Row_Cache *rc, int row);
+
+/**
+ * Record that 'row' became resident. If the cache is full, the CLOCK hand
+ * looks for a victim among the resident rows for which evictable(ctx, row)
+ * is true; that row leaves the cache and is returned so the caller can free
+ * it. Returns -1 if nothing had to (or could) be evicted.
+ */
+int rc_admit(struct Row_Cache *rc, int row, int (*evictable)(const void *ctx, int row), const void *ctx);
+
+/**
+ * Forget row 'row' and shift the positions after it down by one
+ * (the row was removed from the vector).
+ */
+void rc_remove_row(struct Row_Cache *rc, int row);
+
+/**
+ * Batch form of rc_remove_row: row p of the first 'n' rows becomes map[p],
+ * or is forgotten if map[p] == -1. Safe if rc==NULL.
+ */
+void rc_remap(struct Row_Cache *rc, const int *map, int n);
+
+/**
+ * Free the cache. Safe if rc==NULL.
+ */
+void rc_free(struct Row_Cache *rc);
+
+/**
+ * Print page and row hit rates to 'out'. Either pointer may be NULL.
+ */
+void pool_report(const struct Buffer_Pool *pool, const struct Row_Cache *rc, FILE *out);
+
+#endif /* BUFPOOL_H */
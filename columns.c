@@ -0,0 +1,121 @@
+#include "columns.h"
+#include "dinamic_vector.h"
+#include "schema.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+int col_pack_date(const char *s) {
+    if (s == NULL) {
+        return COL_NULL;
+    }
+    int digits[8];
+    int n = 0;
+    size_t len = strlen(s);
+    /* accept YYYY-MM-DD and YYYYMMDD only */
+    if (len == 10 && s[4] == '-' && s[7] == '-') {
+        for (size_t i = 0; i < len; i++) {
+            if (i == 4 || i == 7) continue;
+            if (s[i] < '0' || s[i] > '9') return COL_NULL;
+            digits[n++] = s[i] - '0';
+        }
+    } else if (len == 8) {
+        for (size_t i = 0; i < len; i++) {
+            if (s[i] < '0' || s[i] > '9') return COL_NULL;
+            digits[n++] = s[i] - '0';
+        }
+    } else {
+        return COL_NULL;
+    }
+    int packed = 0;
+    for (int i = 0; i < 8; i++) {
+        packed = packed * 10 + digits[i];
+    }
+    return packed;
+}
+
+static int *col_alloc(int n) {
+    int *c = (int *)malloc(sizeof(int) * (size_t)(n > 0 ? n : 1));
+    if (c == NULL) {
+        exit(1);
+    }
+    return c;
+}
+
+/*
+ * Split c->data into zones at month changes (see COL_ZONE_MIN_ROWS).
+ */
+static void col_build_zones(struct Int_Columns *c) {
+    c->zones = (struct Col_Zone *)malloc(sizeof(struct Col_Zone) * (size_t)(c->n / COL_ZONE_MIN_ROWS + 1));
+    if (c->zones == NULL) {
+        exit(1);
+    }
+    c->n_zones = 0;
+    struct Col_Zone *z = NULL;
+    for (int i = 0; i < c->n; i++) {
+        int d = c->data[i];
+        if (z == NULL || (i - z->begin >= COL_ZONE_MIN_ROWS && d / 100 != c->data[i - 1] / 100)) {
+            z = &c->zones[c->n_zones++];
+            z->begin = i;
+            z->min = INT_MAX;
+            z->max = INT_MIN;
+        }
+        z->end = i + 1;
+        if (d != COL_NULL) {
+            if (d < z->min) z->min = d;
+            if (d > z->max) z->max = d;
+        }
+    }
+}
+
+const struct Int_Columns *dv_columns(struct Dinamic_Vector *dv) {
+    if (dv == NULL) {
+        return NULL;
+    }
+    if (dv->cols != NULL && dv->cols->epoch == dv->epoch) {
+        return dv->cols;
+    }
+    col_free(dv->cols);
+
+    struct Int_Columns *c = (struct Int_Columns *)malloc(sizeof(struct Int_Columns));
+    if (c == NULL) {
+        exit(1);
+    }
+    int n = dv_size(dv);
+    c->n = n;
+    c->epoch = dv->epoch;
+    c->id = col_alloc(n);
+    c->idade = col_alloc(n);
+    c->data = col_alloc(n);
+
+    /* shared mode: the segment already keeps these columns as ints */
+    int filled = (dv->shm != NULL) && shm_fill_columns(dv->shm, c->id, c->idade, c->data, n);
+    for (int i = 0; i < n && !filled; i++) {
+        struct LinkedList *row = dv_get(dv, i);
+        struct ListNode *node = row->first;
+        c->id[i] = c->idade[i] = c->data[i] = COL_NULL;
+        for (int col = 0; node != NULL && col < PC_COUNT; col++, node = node->next) {
+            if (col == PC_ID && node->field.type == FIELD_INT) {
+                c->id[i] = node->field.i;
+            } else if (col == PC_IDADE && node->field.type == FIELD_INT) {
+                c->idade[i] = node->field.i;
+            } else if (col == PC_DATA && node->field.type == FIELD_STRING) {
+                c->data[i] = col_pack_date(node->field.s);
+            }
+        }
+    }
+    col_build_zones(c);
+    dv->cols = c;
+    return c;
+}
+
+void col_free(struct Int_Columns *c) {
+    if (c == NULL) {
+        return;
+    }
+    free(c->id);
+    free(c->idade);
+    free(c->data);
+    free(c->zones);
+    free(c);
+}
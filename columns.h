@@ -0,0 +1,60 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+struct Dinamic_Vector;
+
+/*
+ * Contiguous int copies of the numeric columns of the vector, for tight
+ * loops (aggregations, filters, sorting) that should not chase list nodes.
+ *
+ *   id[i]    - column 0
+ *   idade[i] - column 3
+ *   data[i]  - column 4 packed as YYYYMMDD (2024-12-01 -> 20241201)
+ *
+ * Empty or unparsable values are stored as COL_NULL.
+ * The cache lives in the vector and is rebuilt when its epoch is stale.
+ *
+ * Alongside 'data' a zone map splits the rows into contiguous zones, one
+ * per registration month where rows are clustered by month (as after a
+ * partitioned load, see partition.h), with the min/max date of each zone.
+ * A date filter only needs to scan the zones whose range it overlaps.
+ */
+#define COL_NULL (-2147483647 - 1)
+
+/* A new zone starts where the month changes, once the current one has this many rows */
+#define COL_ZONE_MIN_ROWS 64
+
+struct Col_Zone {
+    int begin, end;       /* rows [begin, end) */
+    int min, max;         /* non-null dates in the zone; min > max if all null */
+};
+
+struct Int_Columns {
+    int n;                /* number of rows */
+    int *id;
+    int *idade;
+    int *data;
+    struct Col_Zone *zones;
+    int n_zones;
+    unsigned long epoch;  /* vector epoch the columns were extracted at */
+};
+
+/**
+ * Pack a "YYYY-MM-DD" (or "YYYYMMDD") date into the int YYYYMMDD.
+ * Returns COL_NULL if 's' is NULL or not in one of those shapes.
+ */
+int col_pack_date(const char *s);
+
+/**
+ * Return the columns of 'dv', extracting them again if the vector changed
+ * since the last call. The result is owned by 'dv'.
+ * If malloc fails, exits(1).
+ */
+const struct Int_Columns *dv_columns(struct Dinamic_Vector *dv);
+
+/**
+ * Free the columns. Safe if c==NULL.
+ */
+void col_free(struct Int_Columns *c);
+
+#endif /* COLUMNS_H */
@@ -0,0 +1,240 @@
+#include "cpf_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Number of bits set per key in the Bloom filter */
+#define BLOOM_PROBES 4
+/* Bloom filter bits per table slot */
+#define BLOOM_BITS_PER_SLOT 16
+
+/*
+ * splitmix64 finalizer: spreads the key bits for both the table and the filter.
+ */
+static unsigned long long mix64(unsigned long long x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+unsigned long long cpf_key(const char *cpf) {
+    if (cpf == NULL || cpf[0] == '\0') {
+        return 0;
+    }
+    unsigned long long digits = 0;
+    int n_digits = 0;
+    int other = 0;
+    for (const char *p = cpf; *p != '\0'; p++) {
+        if (*p >= '0' && *p <= '9') {
+            if (n_digits < 11) {
+                digits = digits * 10 + (unsigned long long)(*p - '0');
+            }
+            n_digits++;
+        } else if (*p != '.' && *p != '-' && *p != ' ') {
+            other = 1;
+        }
+    }
+    if (n_digits == 11 && !other) {
+        return digits + 1;
+    }
+    /* Not a plain CPF: FNV-1a over the raw text, tagged with the top bit */
+    unsigned long long h = 0xCBF29CE484222325ULL;
+    for (const char *p = cpf; *p != '\0'; p++) {
+        h ^= (unsigned char)*p;
+        h *= 0x100000001B3ULL;
+    }
+    h |= 0x8000000000000000ULL;
+    if (h == CPF_TOMBSTONE) {
+        h--;
+    }
+    return h;
+}
+
+int cpf_key_is_exact(unsigned long long key) {
+    return key != 0 && (key & 0x8000000000000000ULL) == 0;
+}
+
+static void bloom_set(struct Cpf_Index *ix, unsigned long long key) {
+    unsigned long long h = mix64(key ^ 0x9E3779B97F4A7C15ULL);
+    unsigned long h1 = (unsigned long)h;
+    unsigned long h2 = (unsigned long)(h >> 32) | 1;
+    for (int j = 0; j < BLOOM_PROBES; j++) {
+        unsigned long bit = (h1 + j * h2) & (ix->bloom_bits - 1);
+        ix->bloom[bit >> 3] |= (unsigned char)(1u << (bit & 7));
+    }
+}
+
+static int bloom_maybe(const struct Cpf_Index *ix, unsigned long long key) {
+    unsigned long long h = mix64(key ^ 0x9E3779B97F4A7C15ULL);
+    unsigned long h1 = (unsigned long)h;
+    unsigned long h2 = (unsigned long)(h >> 32) | 1;
+    for (int j = 0; j < BLOOM_PROBES; j++) {
+        unsigned long bit = (h1 + j * h2) & (ix->bloom_bits - 1);
+        if ((ix->bloom[bit >> 3] & (1u << (bit & 7))) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Allocate empty table and filter arrays for 'cap' slots.
+ * On malloc failure, exit(1).
+ */
+static void cpf_index_alloc(struct Cpf_Index *ix, int cap) {
+    ix->cap = cap;
+    ix->used = 0;
+    ix->tombs = 0;
+    ix->keys = (unsigned long long *)calloc((size_t)cap, sizeof(unsigned long long));
+    ix->rows = (int *)malloc(sizeof(int) * (size_t)cap);
+    ix->bloom_bits = (unsigned long)cap * BLOOM_BITS_PER_SLOT;
+    ix->bloom = (unsigned char *)calloc(ix->bloom_bits / 8, 1);
+    if (ix->keys == NULL || ix->rows == NULL || ix->bloom == NULL) {
+        exit(1);
+    }
+}
+
+struct Cpf_Index *cpf_index_create(int expected) {
+    struct Cpf_Index *ix = (struct Cpf_Index *)malloc(sizeof(struct Cpf_Index));
+    if (ix == NULL) {
+        exit(1);
+    }
+    int cap = 16;
+    while (cap < expected + expected / 3 + 1) {
+        cap *= 2;
+    }
+    cpf_index_alloc(ix, cap);
+    return ix;
+}
+
+/*
+ * Insert without any growth check. Keys must be live (not 0 / tombstone).
+ */
+static void cpf_index_put(struct Cpf_Index *ix, unsigned long long key, int row) {
+    int mask = ix->cap - 1;
+    int slot = (int)(mix64(key) & (unsigned long long)mask);
+    while (ix->keys[slot] != 0 && ix->keys[slot] != CPF_TOMBSTONE) {
+        slot = (slot + 1) & mask;
+    }
+    if (ix->keys[slot] == CPF_TOMBSTONE) {
+        ix->tombs--;
+    }
+    ix->keys[slot] = key;
+    ix->rows[slot] = row;
+    ix->used++;
+    bloom_set(ix, key);
+}
+
+/*
+ * Rebuild table and filter with room for the live entries; drops tombstones
+ * and stale Bloom bits. On malloc failure, exit(1).
+ */
+static void cpf_index_rehash(struct Cpf_Index *ix) {
+    unsigned long long *old_keys = ix->keys;
+    int *old_rows = ix->rows;
+    int old_cap = ix->cap;
+    int cap = ix->cap;
+    if ((ix->used + 1) * 2 >= cap) {
+        cap *= 2;
+    }
+    free(ix->bloom);
+    cpf_index_alloc(ix, cap);
+    for (int i = 0; i < old_cap; i++) {
+        if (old_keys[i] != 0 && old_keys[i] != CPF_TOMBSTONE) {
+            cpf_index_put(ix, old_keys[i], old_rows[i]);
+        }
+    }
+    free(old_keys);
+    free(old_rows);
+}
+
+int cpf_index_find(const struct Cpf_Index *ix, unsigned long long key) {
+    int slot = -1;
+    return cpf_index_next(ix, key, &slot);
+}
+
+int cpf_index_next(const struct Cpf_Index *ix, unsigned long long key, int *slot) {
+    if (ix == NULL || key == 0 || (*slot < 0 && !bloom_maybe(ix, key))) {
+        return -1;
+    }
+    int mask = ix->cap - 1;
+    int i = (*slot < 0) ? (int)(mix64(key) & (unsigned long long)mask) : ((*slot + 1) & mask);
+    while (ix->keys[i] != 0) {
+        if (ix->keys[i] == key) {
+            *slot = i;
+            return ix->rows[i];
+        }
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+void cpf_index_add(struct Cpf_Index *ix, unsigned long long key, int row) {
+    if (ix == NULL || key == 0) {
+        return;
+    }
+    /* keep load (live + tombstones) under 3/4 */
+    if ((ix->used + ix->tombs + 1) * 4 > ix->cap * 3) {
+        cpf_index_rehash(ix);
+    }
+    cpf_index_put(ix, key, row);
+}
+
+void cpf_index_remove(struct Cpf_Index *ix, unsigned long long key, int row) {
+    if (ix == NULL || key == 0) {
+        return;
+    }
+    int mask = ix->cap - 1;
+    int slot = (int)(mix64(key) & (unsigned long long)mask);
+    while (ix->keys[slot] != 0) {
+        if (ix->keys[slot] == key && ix->rows[slot] == row) {
+            ix->keys[slot] = CPF_TOMBSTONE;
+            ix->used--;
+            ix->tombs++;
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+void cpf_index_shift_after(struct Cpf_Index *ix, int row) {
+    if (ix == NULL) {
+        return;
+    }
+    for (int i = 0; i < ix->cap; i++) {
+        if (ix->keys[i] != 0 && ix->keys[i] != CPF_TOMBSTONE && ix->rows[i] > row) {
+            ix->rows[i]--;
+        }
+    }
+}
+
+void cpf_index_remap(struct Cpf_Index *ix, const int *map) {
+    if (ix == NULL) {
+        return;
+    }
+    for (int i = 0; i < ix->cap; i++) {
+        if (ix->keys[i] == 0 || ix->keys[i] == CPF_TOMBSTONE) {
+            continue;
+        }
+        int to = map[ix->rows[i]];
+        if (to < 0) {
+            ix->keys[i] = CPF_TOMBSTONE;
+            ix->used--;
+            ix->tombs++;
+        } else {
+            ix->rows[i] = to;
+        }
+    }
+}
+
+void cpf_index_free(struct Cpf_Index *ix) {
+    if (ix == NULL) {
+        return;
+    }
+    free(ix->keys);
+    free(ix->rows);
+    free(ix->bloom);
+    free(ix);
+}
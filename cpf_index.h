@@ -0,0 +1,87 @@
+#ifndef CPF_INDEX_H
+#define CPF_INDEX_H
+
+/*
+ * Exact hash index CPF -> row position, fronted by a Bloom filter.
+ *
+ * CPFs are reduced to a 64-bit key (see cpf_key). A lookup first probes the
+ * Bloom filter, which answers "definitely absent" for most new CPFs without
+ * touching the table; only possible hits go to the open-addressing table.
+ * The table is a multimap so that duplicates already present in a file can
+ * be indexed and reported instead of silently dropped.
+ */
+struct Cpf_Index {
+    unsigned long long *keys;   /* 0 = empty slot, CPF_TOMBSTONE = deleted */
+    int *rows;                  /* row position stored with each key */
+    int cap;                    /* table capacity (power of two) */
+    int used;                   /* live entries */
+    int tombs;                  /* deleted entries still occupying slots */
+    unsigned char *bloom;       /* Bloom filter bit array */
+    unsigned long bloom_bits;   /* number of bits in 'bloom' (power of two) */
+};
+
+#define CPF_TOMBSTONE 0xFFFFFFFFFFFFFFFFULL
+
+/**
+ * Reduce a CPF string to its index key.
+ * A CPF with exactly 11 digits (formatted or not) maps to its numeric value + 1,
+ * so "123.456.789-09" and "12345678909" collide on purpose.
+ * Any other non-empty string maps to a hash with the top bit set.
+ * Returns 0 for NULL or empty strings (no key: not constrained).
+ */
+unsigned long long cpf_key(const char *cpf);
+
+/**
+ * Return 1 if 'key' came from an exact 11-digit CPF (no confirmation needed), else 0.
+ */
+int cpf_key_is_exact(unsigned long long key);
+
+/**
+ * Create an empty index sized for about 'expected' entries.
+ * If malloc fails, exits(1).
+ */
+struct Cpf_Index *cpf_index_create(int expected);
+
+/**
+ * Return the row stored for 'key', or -1 if absent.
+ * If several rows share the key, the first one found is returned.
+ */
+int cpf_index_find(const struct Cpf_Index *ix, unsigned long long key);
+
+/**
+ * Iterate the rows stored for 'key': start with *slot = -1; each call
+ * returns the next row (in table order), or -1 when there are no more.
+ * The index must not change during the iteration.
+ */
+int cpf_index_next(const struct Cpf_Index *ix, unsigned long long key, int *slot);
+
+/**
+ * Add the pair (key, row). Grows the table and the filter when needed.
+ * Keys equal to 0 are ignored. If realloc fails, exits(1).
+ */
+void cpf_index_add(struct Cpf_Index *ix, unsigned long long key, int row);
+
+/**
+ * Remove the pair (key, row) if present. The Bloom filter keeps the bits;
+ * they are dropped the next time the table grows.
+ */
+void cpf_index_remove(struct Cpf_Index *ix, unsigned long long key, int row);
+
+/**
+ * Decrement every stored row position greater than 'row'.
+ * Used after the vector removes 'row' and shifts the tail left.
+ */
+void cpf_index_shift_after(struct Cpf_Index *ix, int row);
+
+/**
+ * Move every stored row position p to map[p] in one pass over the table;
+ * entries with map[p] == -1 are removed. Used after a batch compaction.
+ */
+void cpf_index_remap(struct Cpf_Index *ix, const int *map);
+
+/**
+ * Free the index. Safe if ix==NULL.
+ */
+void cpf_index_free(struct Cpf_Index *ix);
+
+#endif /* CPF_INDEX_H */
@@ -0,0 +1,149 @@
+#include "cursor.h"
+#include "dinamic_vector.h"
+#include "fold.h"
+#include "schema.h"
+#include "slab.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+struct Consult_Cursor *cursor_open(const struct Dinamic_Vector *dv, int column, int substring, const char *search) {
+    if (dv == NULL || search == NULL || column < 0 || column >= PC_COUNT) {
+        return NULL;
+    }
+    struct Consult_Cursor *c = (struct Consult_Cursor *)malloc(sizeof(struct Consult_Cursor));
+    if (c == NULL) {
+        exit(1);
+    }
+    c->column = column;
+    c->substring = substring;
+    c->search = strdup(search);
+    if (c->search == NULL) {
+        exit(1);
+    }
+    c->search_len = strlen(search);
+    c->folded = NULL;
+    c->folded_len = 0;
+    if (column == PC_NOME) {
+        c->folded = fold_key(search, &c->folded_len);
+    }
+    c->pos = 0;
+    c->epoch = dv->epoch;
+    c->stale = 0;
+    return c;
+}
+
+/*
+ * Does row 'i' match the cursor's search?
+ */
+static int cursor_match(const struct Consult_Cursor *c, const struct Dinamic_Vector *dv, int i) {
+    struct LinkedList *row = dv_get(dv, i);
+    if (c->column == PC_NOME) {
+        return c->substring ? fold_contains(row->key, row->key_len, c->folded, c->folded_len)
+                            : fold_has_prefix(row->key, row->key_len, c->folded, c->folded_len);
+    }
+    struct Field *field = get_field_by_index(dv, i, c->column);
+    if (field == NULL || field->type != FIELD_STRING || field->s == NULL) {
+        return 0;
+    }
+    return c->substring ? strstr(field->s, c->search) != NULL
+                        : strncasecmp(field->s, c->search, c->search_len) == 0;
+}
+
+int cursor_next(struct Consult_Cursor *c, const struct Dinamic_Vector *dv, int *rows, int page_size) {
+    if (c == NULL || dv == NULL || page_size <= 0) {
+        return 0;
+    }
+    int found = 0;
+    int n = dv_size(dv);
+    while (c->pos < n && found < page_size) {
+        if (cursor_match(c, dv, c->pos)) {
+            rows[found++] = c->pos;
+        }
+        c->pos++;
+    }
+    return found;
+}
+
+int cursor_has_more(struct Consult_Cursor *c, const struct Dinamic_Vector *dv) {
+    if (c == NULL || dv == NULL) {
+        return 0;
+    }
+    /* rows skipped here would be skipped by the next page anyway */
+    int n = dv_size(dv);
+    while (c->pos < n && !cursor_match(c, dv, c->pos)) {
+        c->pos++;
+    }
+    return c->pos < n;
+}
+
+int cursor_print_page(struct Consult_Cursor *c, const struct Dinamic_Vector *dv, int page_size, FILE *out) {
+    int *rows = (int *)malloc(sizeof(int) * (size_t)(page_size > 0 ? page_size : 1));
+    if (rows == NULL) {
+        exit(1);
+    }
+    int found = cursor_next(c, dv, rows, page_size);
+    for (int k = 0; k < found; k++) {
+        ll_fprint(out, dv_get(dv, rows[k]));
+    }
+    free(rows);
+    return found;
+}
+
+/*
+ * Token layout: <column>.<substring>.<pos>.<epoch>.<search as hex>
+ * Hex keeps the token a single word whatever the search text contains.
+ */
+size_t cursor_token_size(const struct Consult_Cursor *c) {
+    /* 3 ints, an unsigned long, 4 dots and the terminator fit in 80 bytes */
+    return 80 + 2 * c->search_len;
+}
+
+void cursor_token(const struct Consult_Cursor *c, char *buf, size_t size) {
+    int len = snprintf(buf, size, "%d.%d.%d.%lu.", c->column, c->substring, c->pos, c->epoch);
+    for (size_t i = 0; i < c->search_len && len >= 0 && (size_t)len + 3 <= size; i++) {
+        len += snprintf(buf + len, size - (size_t)len, "%02x", (unsigned char)c->search[i]);
+    }
+}
+
+struct Consult_Cursor *cursor_resume(const struct Dinamic_Vector *dv, const char *token) {
+    int column, substring, pos, used = 0;
+    unsigned long epoch;
+    if (token == NULL || sscanf(token, "%d.%d.%d.%lu.%n", &column, &substring, &pos, &epoch, &used) < 4 || used == 0) {
+        return NULL;
+    }
+    const char *hex = token + used;
+    size_t hex_len = strspn(hex, "0123456789abcdef");
+    if (hex_len % 2 != 0 || hex[hex_len] != '\0' || pos < 0) {
+        return NULL;
+    }
+    char *search = (char *)malloc(hex_len / 2 + 1);
+    if (search == NULL) {
+        exit(1);
+    }
+    for (size_t i = 0; i < hex_len / 2; i++) {
+        unsigned byte;
+        sscanf(hex + 2 * i, "%2x", &byte);
+        search[i] = (char)byte;
+    }
+    search[hex_len / 2] = '\0';
+
+    struct Consult_Cursor *c = cursor_open(dv, column, substring != 0, search);
+    free(search);
+    if (c == NULL) {
+        return NULL;
+    }
+    c->pos = pos;
+    c->stale = (epoch != dv->epoch);
+    c->epoch = epoch;
+    return c;
+}
+
+void cursor_close(struct Consult_Cursor *c) {
+    if (c == NULL) {
+        return;
+    }
+    free(c->search);
+    slab_str_free(c->folded);
+    free(c);
+}
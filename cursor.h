@@ -0,0 +1,79 @@
+#ifndef CURSOR_H
+#define CURSOR_H
+
+#include <stdio.h>
+
+struct Dinamic_Vector;
+
+/*
+ * Cursor over the rows matching a consult (prefix or substring search on one
+ * column), returned page by page. A cursor only remembers the search and the
+ * next row position to examine, so each page costs O(page) memory no matter
+ * how many rows match.
+ *
+ * A cursor can be turned into a text token and resumed later (e.g. by a
+ * batch client). If the vector changed since the cursor was opened, the
+ * resumed cursor is flagged 'stale': it still continues from the same row
+ * position, but rows may have shifted.
+ */
+struct Consult_Cursor {
+    int column;           /* column searched (2 = Nome uses folded keys) */
+    int substring;        /* 0: prefix match, 1: match anywhere */
+    char *search;         /* search text as given */
+    size_t search_len;
+    char *folded;         /* fold_key(search) when column == 2 */
+    int folded_len;
+    int pos;              /* next row position to examine */
+    unsigned long epoch;  /* vector epoch when the cursor was opened */
+    int stale;            /* resumed after the vector changed */
+};
+
+/**
+ * Open a cursor for rows whose column 'column' (0..4) starts with (or, if
+ * 'substring', contains) 'search'. Only string fields can match. Returns NULL on invalid arguments.
+ * If malloc fails, exits(1).
+ */
+struct Consult_Cursor *cursor_open(const struct Dinamic_Vector *dv, int column, int substring, const char *search);
+
+/**
+ * Fill 'rows' with the positions of up to 'page_size' next matches.
+ * Returns how many were written; 0 means the cursor is exhausted.
+ */
+int cursor_next(struct Consult_Cursor *c, const struct Dinamic_Vector *dv, int *rows, int page_size);
+
+/**
+ * Return 1 if another row matches, else 0. Moves the cursor up to that
+ * row (past the rows that do not match), so a token made afterwards
+ * resumes there.
+ */
+int cursor_has_more(struct Consult_Cursor *c, const struct Dinamic_Vector *dv);
+
+/**
+ * Print the next page of matches to 'out' (rows only, no header).
+ * Returns the number of rows printed.
+ */
+int cursor_print_page(struct Consult_Cursor *c, const struct Dinamic_Vector *dv, int page_size, FILE *out);
+
+/**
+ * Bytes a buffer needs to hold the cursor's token, terminator included.
+ */
+size_t cursor_token_size(const struct Consult_Cursor *c);
+
+/**
+ * Write a resumable token for the cursor's current position into 'buf'
+ * ('size' >= cursor_token_size(c), or the search text is cut short).
+ */
+void cursor_token(const struct Consult_Cursor *c, char *buf, size_t size);
+
+/**
+ * Recreate a cursor from a token made by cursor_token.
+ * Returns NULL if the token is malformed.
+ */
+struct Consult_Cursor *cursor_resume(const struct Dinamic_Vector *dv, const char *token);
+
+/**
+ * Free a cursor. Safe if c==NULL.
+ */
+void cursor_close(struct Consult_Cursor *c);
+
+#endif /* CURSOR_H */
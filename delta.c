@@ -0,0 +1,335 @@
+#include "delta.h"
+#include "linkedlist.h"
+#include "schema.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DELTA_POLL_MS 200  /* delta_tail: wait between polls when following */
+
+static const char *const delta_ops[] = {"insere", "atualiza", "remove"};
+enum { DELTA_INSERE, DELTA_ATUALIZA, DELTA_REMOVE };
+
+#define COL_HEADER(name, header, kind) header,
+static const char *const col_headers[PC_COUNT] = { PATIENT_SCHEMA(COL_HEADER) };
+#undef COL_HEADER
+
+/* Make room for 'extra' more bytes in the pending buffer */
+static void delta_reserve(struct Delta_Log *log, size_t extra) {
+    if (log->len + extra <= log->cap) {
+        return;
+    }
+    size_t cap = log->cap > 0 ? log->cap : 4096;
+    while (cap < log->len + extra) {
+        cap *= 2;
+    }
+    char *grown = (char *)realloc(log->buf, cap);
+    if (grown == NULL) {
+        exit(1);
+    }
+    log->buf = grown;
+    log->cap = cap;
+}
+
+/* Append 's' to the pending buffer, tabs and line breaks turned into spaces */
+static void delta_put(struct Delta_Log *log, const char *s) {
+    size_t n = strlen(s);
+    delta_reserve(log, n + 1);
+    for (size_t k = 0; k < n; k++) {
+        char c = s[k];
+        log->buf[log->len++] = (c == '\t' || c == '\n' || c == '\r') ? ' ' : c;
+    }
+}
+
+static void delta_put_char(struct Delta_Log *log, char c) {
+    delta_reserve(log, 1);
+    log->buf[log->len++] = c;
+}
+
+/* Text of a column value: "" for a null or missing column */
+static const char *field_text(const struct Field *f, char *num) {
+    if (f == NULL || f->type == FIELD_NULL) {
+        return "";
+    }
+    if (f->type == FIELD_INT) {
+        snprintf(num, 16, "%d", f->i);
+        return num;
+    }
+    return f->s != NULL ? f->s : "";
+}
+
+/* Start a record: op and key */
+static void delta_begin(struct Delta_Log *log, int op, const struct Field *cpf) {
+    char num[16];
+    delta_put(log, delta_ops[op]);
+    delta_put_char(log, '\t');
+    delta_put(log, field_text(cpf, num));
+}
+
+static void delta_put_column(struct Delta_Log *log, int col, const struct Field *f) {
+    char num[16];
+    delta_put_char(log, '\t');
+    delta_put(log, col_headers[col]);
+    delta_put_char(log, '=');
+    delta_put(log, field_text(f, num));
+}
+
+static void delta_end(struct Delta_Log *log) {
+    delta_put_char(log, '\n');
+    log->pending++;
+}
+
+struct Delta_Log *delta_open(const char *path) {
+    int fd = open(path, O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    /* a new file gets its first line; an existing one must start with it */
+    size_t magic_len = strlen(DELTA_MAGIC);
+    char head[sizeof(DELTA_MAGIC)];
+    flock(fd, LOCK_EX);
+    ssize_t got = pread(fd, head, magic_len, 0);
+    int ok = (got == 0) ? write(fd, DELTA_MAGIC "\n", magic_len + 1) == (ssize_t)(magic_len + 1)
+                        : got == (ssize_t)magic_len && memcmp(head, DELTA_MAGIC, magic_len) == 0;
+    flock(fd, LOCK_UN);
+    if (!ok) {
+        close(fd);
+        return NULL;
+    }
+    struct Delta_Log *log = (struct Delta_Log *)malloc(sizeof(struct Delta_Log));
+    if (log == NULL) {
+        exit(1);
+    }
+    log->fd = fd;
+    log->buf = NULL;
+    log->len = 0;
+    log->cap = 0;
+    log->pending = 0;
+    log->last_seq = 0;
+    log->seen_size = -1;
+    return log;
+}
+
+void delta_insert(struct Delta_Log *log, const struct LinkedList *row) {
+    if (log == NULL) {
+        return;
+    }
+    const struct Field *f[PC_COUNT];
+    schema_fields(row, f);
+    delta_begin(log, DELTA_INSERE, f[PC_CPF]);
+    for (int c = 0; c < PC_COUNT; c++) {
+        if (c != PC_ID) {
+            delta_put_column(log, c, f[c]);
+        }
+    }
+    delta_end(log);
+}
+
+void delta_update(struct Delta_Log *log, const struct LinkedList *before, const struct LinkedList *after) {
+    if (log == NULL) {
+        return;
+    }
+    const struct Field *old[PC_COUNT], *now[PC_COUNT];
+    schema_fields(before, old);
+    schema_fields(after, now);
+    size_t start = log->len;
+    int changed = 0;
+    delta_begin(log, DELTA_ATUALIZA, old[PC_CPF]);
+    for (int c = 0; c < PC_COUNT; c++) {
+        if (c != PC_ID && schema_cmp[c](before, after) != 0) {
+            delta_put_column(log, c, now[c]);
+            changed++;
+        }
+    }
+    if (changed == 0) {
+        log->len = start;  /* same values written back: nothing to send */
+        return;
+    }
+    delta_end(log);
+}
+
+void delta_remove(struct Delta_Log *log, const struct LinkedList *row) {
+    if (log == NULL) {
+        return;
+    }
+    const struct Field *f[PC_COUNT];
+    schema_fields(row, f);
+    delta_begin(log, DELTA_REMOVE, f[PC_CPF]);
+    delta_end(log);
+}
+
+/*
+ * Seq of the last record of the file, whose size is 'size' (the caller
+ * holds the lock). Reads backwards from the end to the start of the last
+ * line, so only the tail of the file is touched.
+ */
+static long long last_seq_of(int fd, long long size) {
+    char chunk[DELTA_SCAN_BYTES];
+    long long end = size - 1;  /* skip the newline that ends the last line */
+    long long start = 0;
+    while (end > 0 && start == 0) {
+        long long from = end > (long long)sizeof(chunk) ? end - (long long)sizeof(chunk) : 0;
+        ssize_t got = pread(fd, chunk, (size_t)(end - from), (off_t)from);
+        if (got <= 0) {
+            return 0;
+        }
+        for (ssize_t k = got - 1; k >= 0; k--) {
+            if (chunk[k] == '\n') {
+                start = from + k + 1;
+                break;
+            }
+        }
+        end = from;
+    }
+    char head[24];
+    ssize_t got = pread(fd, head, sizeof(head) - 1, (off_t)start);
+    if (got <= 0 || head[0] == '#') {
+        return 0;  /* only the first line: no records yet */
+    }
+    head[got] = '\0';
+    return atoll(head);
+}
+
+int delta_commit(struct Delta_Log *log) {
+    if (log == NULL || log->pending == 0) {
+        return 0;
+    }
+    flock(log->fd, LOCK_EX);
+    struct stat st;
+    if (fstat(log->fd, &st) != 0) {
+        flock(log->fd, LOCK_UN);
+        return -1;
+    }
+    /* another process appended since our last commit: read its last seq */
+    if ((long long)st.st_size != log->seen_size) {
+        log->last_seq = last_seq_of(log->fd, (long long)st.st_size);
+    }
+    size_t out_cap = log->len + (size_t)log->pending * 21;
+    char *out = (char *)malloc(out_cap);
+    if (out == NULL) {
+        exit(1);
+    }
+    size_t out_len = 0;
+    long long seq = log->last_seq;
+    for (size_t k = 0; k < log->len;) {
+        const char *line = log->buf + k;
+        size_t n = (size_t)((const char *)memchr(line, '\n', log->len - k) - line) + 1;
+        out_len += (size_t)snprintf(out + out_len, 21, "%lld\t", ++seq);
+        memcpy(out + out_len, line, n);
+        out_len += n;
+        k += n;
+    }
+    size_t done = 0;
+    while (done < out_len) {
+        ssize_t w = write(log->fd, out + done, out_len - done);
+        if (w <= 0) {
+            break;
+        }
+        done += (size_t)w;
+    }
+    free(out);
+    int written = -1;
+    if (done == out_len) {
+        written = log->pending;
+        log->last_seq = seq;
+        log->seen_size = (long long)st.st_size + (long long)out_len;
+        log->len = 0;
+        log->pending = 0;
+    } else if (ftruncate(log->fd, st.st_size) != 0) {
+        log->seen_size = -1;  /* a partial line may be left: rescan next time */
+    }
+    flock(log->fd, LOCK_UN);
+    return written;
+}
+
+void delta_close(struct Delta_Log *log) {
+    if (log == NULL) {
+        return;
+    }
+    close(log->fd);
+    free(log->buf);
+    free(log);
+}
+
+/*
+ * Move to the start of the line after the current position.
+ * Returns 0, or 1 at the end of the file.
+ */
+static int skip_line(FILE *fp) {
+    int c;
+    while ((c = fgetc(fp)) != EOF && c != '\n') {
+    }
+    return c == EOF;
+}
+
+/*
+ * Position 'fp' at the start of a line such that every earlier record has
+ * seq <= 'after'. Records are in seq order, so the search halves the byte
+ * range until it is small enough to scan.
+ */
+static void seek_after(FILE *fp, long data_start, long long after) {
+    char head[24];
+    fseek(fp, 0, SEEK_END);
+    long lo = data_start, hi = ftell(fp);
+    while (hi - lo > DELTA_SCAN_BYTES) {
+        long mid = lo + (hi - lo) / 2;
+        fseek(fp, mid, SEEK_SET);
+        if (skip_line(fp) || fgets(head, sizeof(head), fp) == NULL) {
+            hi = mid;
+            continue;
+        }
+        long long seq = atoll(head);
+        if (strchr(head, '\n') == NULL && skip_line(fp)) {
+            hi = mid;  /* the probed record is not complete yet */
+            continue;
+        }
+        if (seq <= after) {
+            lo = ftell(fp);
+        } else {
+            hi = mid;
+        }
+    }
+    fseek(fp, lo, SEEK_SET);
+}
+
+int delta_tail(const char *path, long long after, int follow, FILE *out) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return 1;
+    }
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t n = getline(&line, &line_cap, fp);
+    if (n < 0 || strncmp(line, DELTA_MAGIC, strlen(DELTA_MAGIC)) != 0) {
+        free(line);
+        fclose(fp);
+        return 1;
+    }
+    seek_after(fp, ftell(fp), after);
+    const struct timespec pause = {0, DELTA_POLL_MS * 1000000L};
+    for (;;) {
+        long pos = ftell(fp);
+        n = getline(&line, &line_cap, fp);
+        if (n > 0 && line[n - 1] == '\n') {
+            if (atoll(line) > after) {
+                fwrite(line, 1, (size_t)n, out);
+            }
+            continue;
+        }
+        if (!follow) {
+            break;
+        }
+        /* end of file, or a record still being written: wait and retry */
+        fflush(out);
+        clearerr(fp);
+        fseek(fp, pos, SEEK_SET);
+        nanosleep(&pause, NULL);
+    }
+    free(line);
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+struct LinkedList;
+
+/*
+ * Change-data-capture feed: every insert, update and removal of the store
+ * becomes one change record, appended to a delta file when the base is
+ * saved. Downstream systems tail the file from the last sequence number
+ * they applied instead of diffing the whole CSV.
+ *
+ * The file is text. The first line is DELTA_MAGIC; every other line is one
+ * change:
+ *
+ *     <seq> \t <op> \t <cpf> [\t <Coluna>=<valor>]...
+ *
+ *     insere    <cpf>  every column but ID
+ *     atualiza  <cpf>  the columns whose value changed (CPF= if it changed)
+ *     remove    <cpf>
+ *
+ * 'seq' grows by one per record across sessions. The record key is the
+ * CPF the row had before the change: the ID column is a position that
+ * removals renumber, so it is never sent. The key must name one row, so
+ * the feed is not started on a base with empty or repeated CPFs
+ * (dv_cpf_ambiguous), and while it runs the store refuses to give a row an
+ * empty CPF (repeated ones are always refused). Column names are the CSV header
+ * names; an empty value is a null. Values never contain tabs or line breaks
+ * (they are turned into spaces).
+ *
+ * Records stay in memory until delta_commit, called after a successful
+ * save, so the feed never holds changes the saved base does not. The base
+ * is saved when the session ends (menu option Q), so a consumer sees a
+ * session's changes only then: the feed's latency is the session length. The
+ * append takes an exclusive flock on the file: processes sharing a store
+ * (shared mode) number their records without gaps or repeats.
+ */
+
+#define DELTA_MAGIC "# hpms-delta 1"
+#define DELTA_SCAN_BYTES 4096  /* read size when scanning the file */
+
+struct Delta_Log {
+    int fd;               /* delta file, opened for appending */
+    char *buf;            /* pending records, one line each, no seq yet */
+    size_t len;
+    size_t cap;
+    int pending;          /* records in 'buf' */
+    long long last_seq;   /* seq of the last record in the file ... */
+    long long seen_size;  /* ... when it had this size (-1: unknown) */
+};
+
+/**
+ * Open (or create) the delta file 'path' for appending.
+ * Returns NULL if it cannot be opened or is not a delta file.
+ * If malloc fails, exits(1).
+ */
+struct Delta_Log *delta_open(const char *path);
+
+/**
+ * Record the insertion of 'row'. Does nothing if log==NULL.
+ */
+void delta_insert(struct Delta_Log *log, const struct LinkedList *row);
+
+/**
+ * Record the change of a row from 'before' to 'after'; nothing is recorded
+ * if no column changed. Does nothing if log==NULL.
+ */
+void delta_update(struct Delta_Log *log, const struct LinkedList *before, const struct LinkedList *after);
+
+/**
+ * Record the removal of 'row'. Does nothing if log==NULL.
+ */
+void delta_remove(struct Delta_Log *log, const struct LinkedList *row);
+
+/**
+ * Number the pending records and append them to the file in one write.
+ * Returns the number of records written (0 if log==NULL), or -1 if the
+ * write failed (the records stay pending).
+ */
+int delta_commit(struct Delta_Log *log);
+
+/**
+ * Close the file and free 'log'; pending records are dropped. Safe if log==NULL.
+ */
+void delta_close(struct Delta_Log *log);
+
+/**
+ * Copy to 'out' every record of the delta file 'path' whose seq is greater
+ * than 'after'. The first such record is found by binary search over the
+ * file, so the cost depends on the records sent, not on the file size.
+ * With 'follow', keep polling for records appended later (never returns
+ * unless the file becomes unreadable).
+ * Returns 0 on success; returns 1 if the file cannot be read or is not a
+ * delta file.
+ */
+int delta_tail(const char *path, long long after, int follow, FILE *out);
+
+#endif /* DELTA_H */
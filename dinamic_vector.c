@@ -1,7 +1,11 @@
 #include "dinamic_vector.h"
+#include "normalize.h"
+#include "schema.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "fold.h"
+#include "cursor.h"
 
 /* initial capacity: static int can be adjusted if needed */
 static int initial_cap = 4;
@@ -22,6 +26,21 @@ struct Dinamic_Vector *dv_create(void) {
         free(dv);
         exit(1);
     }
+    dv->src = NULL;
+    dv->src_size = 0;
+    dv->src_off = NULL;
+    dv->renumbered = 0;
+    dv->cpf_idx = NULL;
+    dv->tri_idx = NULL;
+    dv->cols = NULL;
+    dv->parts = NULL;
+    dv->pool = NULL;
+    dv->row_cache = NULL;
+    dv->shm = NULL;
+    dv->epoch = 0;
+    dv->checked = NULL;
+    dv->delta = NULL;
+    dv->snaps = NULL;
     return dv;
 }
 
@@ -39,6 +58,60 @@ static void dv_reallocate(struct Dinamic_Vector *dv) {
         exit(1);
     }
     dv->v = new_block;
+    if (dv->src_off != NULL) {
+        long *new_off = (long *)realloc(dv->src_off, sizeof(long) * dv->n_max);
+        if (new_off == NULL) {
+            exit(1);
+        }
+        dv->src_off = new_off;
+    }
+}
+
+/*
+ * Return the CPF text of a row, or "" if it has none.
+ */
+_Static_assert(PC_CPF == 1, "row_cpf reads the second node");
+static const char *row_cpf(const struct LinkedList *row) {
+    if (row == NULL || row->first == NULL || row->first->next == NULL) {
+        return "";
+    }
+    const struct Field *f = &row->first->next->field;
+    return (f->type == FIELD_STRING && f->s != NULL) ? f->s : "";
+}
+
+static unsigned long long row_cpf_key(const struct LinkedList *row) {
+    return cpf_key(row_cpf(row));
+}
+
+/*
+ * Append one slot: a parsed row, or NULL plus the offset of its line in
+ * dv->src (lazy mode). Resize if needed.
+ */
+static void dv_push_slot(struct Dinamic_Vector *dv, struct LinkedList *row, long off) {
+    if (dv->n == dv->n_max) {
+        dv_reallocate(dv);
+    }
+    snap_touch(dv, dv->n, dv->n + 1);  /* the slot was a row of a snapshot taken before a removal */
+    if (dv->src_off != NULL) {
+        dv->src_off[dv->n] = off;
+    }
+    dv->v[dv->n++] = row;
+    dv->epoch++;
+}
+
+/*
+ * Return the row at 'idx' ready to be changed in place: if a snapshot holds
+ * 'row' (see snapshot.h), it keeps that version and the vector gets a copy.
+ */
+static struct LinkedList *dv_own_row(struct Dinamic_Vector *dv, int idx, struct LinkedList *row) {
+    snap_touch(dv, idx, idx + 1);
+    if (row->shares == 0) {
+        return row;
+    }
+    struct LinkedList *copy = ll_copy(row);
+    snap_release_row(row);
+    dv->v[idx] = copy;
+    return copy;
 }
 
 /*
@@ -49,10 +122,272 @@ void dv_insert(struct Dinamic_Vector *dv, struct LinkedList *list_ptr) {
     if (dv == NULL || list_ptr == NULL) {
         exit(1);
     }
-    if (dv->n == dv->n_max) {
-        dv_reallocate(dv);
+    unsigned long before = dv->epoch;
+    tri_row_added(dv, dv->n, list_ptr);
+    dv_push_slot(dv, list_ptr, -1);
+    tri_changed(dv, before);
+    part_touch(dv->parts, list_ptr);
+    if (dv->cpf_idx != NULL) {
+        cpf_index_add(dv->cpf_idx, row_cpf_key(list_ptr), dv->n - 1);
+    }
+}
+
+/*
+ * Return the index built over every row, building it on first use.
+ * Conflicting rows are printed to 'report' when it is not NULL.
+ * '*conflicts' (if given) receives the number of duplicates seen.
+ */
+static struct Cpf_Index *dv_cpf_index(struct Dinamic_Vector *dv, FILE *report, int *conflicts) {
+    int found = 0;
+    if (dv->cpf_idx == NULL) {
+        struct Cpf_Index *ix = cpf_index_create(dv->n);
+        for (int i = 0; i < dv->n; i++) {
+            unsigned long long key = row_cpf_key(dv_get(dv, i));
+            int prev = cpf_index_find(ix, key);
+            if (prev >= 0) {
+                found++;
+                if (report != NULL) {
+                    fprintf(report, "Registro %d: CPF %s repete o registro %d\n",
+                            i + 1, row_cpf(dv_get(dv, i)), prev + 1);
+                }
+            }
+            cpf_index_add(ix, key, i);
+        }
+        dv->cpf_idx = ix;
+    }
+    if (conflicts != NULL) {
+        *conflicts = found;
+    }
+    return dv->cpf_idx;
+}
+
+int dv_find_cpf(struct Dinamic_Vector *dv, const char *cpf) {
+    if (dv == NULL) {
+        return -1;
+    }
+    unsigned long long key = cpf_key(cpf);
+    int slot = -1;
+    int row;
+    while ((row = dv_cpf_next(dv, key, &slot)) >= 0) {
+        /* Hashed (non 11-digit) keys are confirmed against the stored text;
+           rows whose text only shares the hash do not hide a later match */
+        if (cpf_key_is_exact(key) || strcmp(row_cpf(dv_get(dv, row)), cpf) == 0) {
+            return row;
+        }
+    }
+    return -1;
+}
+
+int dv_cpf_next(struct Dinamic_Vector *dv, unsigned long long key, int *slot) {
+    if (dv->shm != NULL) {
+        return shm_cpf_next(dv->shm, key, slot);
+    }
+    return cpf_index_next(dv_cpf_index(dv, NULL, NULL), key, slot);
+}
+
+/*
+ * The delta feed identifies a record by its CPF: while it is on, a row may
+ * not get an empty CPF (repeated ones are refused anyway).
+ */
+static int delta_refuses(const struct Dinamic_Vector *dv, const char *cpf) {
+    return dv->delta != NULL && (cpf == NULL || cpf[0] == '\0');
+}
+
+int dv_cpf_ambiguous(struct Dinamic_Vector *dv) {
+    int count = 0;
+    for (int i = 0; i < dv->n; i++) {
+        unsigned long long key = row_cpf_key(dv_get(dv, i));
+        int slot = -1;
+        if (key == 0) {
+            count++;
+        } else if (dv_cpf_next(dv, key, &slot) >= 0 && dv_cpf_next(dv, key, &slot) >= 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int dv_insert_unique(struct Dinamic_Vector *dv, struct LinkedList *list_ptr) {
+    if (dv == NULL || list_ptr == NULL) {
+        exit(1);
+    }
+    if (delta_refuses(dv, row_cpf(list_ptr)) || dv_find_cpf(dv, row_cpf(list_ptr)) >= 0) {
+        return 1;
+    }
+    if (dv->shm != NULL && shm_append(dv->shm, list_ptr) != SHM_OK) {
+        return 2;
+    }
+    dv_insert(dv, list_ptr);
+    delta_insert(dv->delta, list_ptr);
+    return 0;
+}
+
+/* 0 if an update of row 'idx' to CPF 'cpf' ("-" or NULL: kept) is allowed, else 1 */
+static int dv_update_check(struct Dinamic_Vector *dv, int idx, const char *cpf) {
+    if (dv == NULL || idx < 0 || idx >= dv->n) {
+        return 1;
+    }
+    if (cpf != NULL && strcmp(cpf, "-") != 0) {
+        int owner = dv_find_cpf(dv, cpf);
+        if ((owner >= 0 && owner != idx) || delta_refuses(dv, cpf)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int dv_update(struct Dinamic_Vector *dv, int idx, const char *cpf, const char *nome, const char *idade, const char *data) {
+    if (dv_update_check(dv, idx, cpf) != 0) {
+        return 1;
+    }
+    int changes_cpf = (cpf != NULL && strcmp(cpf, "-") != 0);
+    int renames = (nome != NULL && strcmp(nome, "-") != 0);
+    unsigned long before = dv->epoch;
+    /* fetched after the lookup: building the index may evict rows (paged mode) */
+    struct LinkedList *row = dv_get(dv, idx);
+    if (dv->shm != NULL) {
+        /* the segment is written first, from an updated copy */
+        struct LinkedList *next = ll_copy(row);
+        ll_update_fields(next, cpf, nome, idade, data);
+        if (shm_replace(dv->shm, idx, next) != SHM_OK) {
+            ll_free(next);
+            return 2;
+        }
+        delta_update(dv->delta, row, next);
+        ll_free(row);
+        dv->v[idx] = next;
+        if (renames) {
+            tri_row_renamed(dv, idx, next);
+        }
+        dv->epoch++;
+        tri_changed(dv, before);
+        return 0;
+    }
+    row = dv_own_row(dv, idx, row);
+    if (changes_cpf) {
+        cpf_index_remove(dv->cpf_idx, row_cpf_key(row), idx);
+    }
+    if (dv->pool != NULL) {
+        dv->src_off[idx] = -1;  /* differs from the file now: keep it in memory */
+    }
+    struct LinkedList *old = (dv->delta != NULL) ? ll_copy(row) : NULL;
+    part_touch(dv->parts, row);  /* old month, and the new one if the date changes */
+    ll_update_fields(row, cpf, nome, idade, data);
+    part_touch(dv->parts, row);
+    delta_update(dv->delta, old, row);
+    ll_free(old);
+    if (renames) {
+        tri_row_renamed(dv, idx, row);
+    }
+    dv->epoch++;
+    tri_changed(dv, before);
+    if (changes_cpf) {
+        cpf_index_add(dv->cpf_idx, row_cpf_key(row), idx);
+    }
+    return 0;
+}
+
+int dv_report_cpf_conflicts(struct Dinamic_Vector *dv, FILE *out) {
+    if (dv == NULL) {
+        return 0;
+    }
+    int conflicts = 0;
+    cpf_index_free(dv->cpf_idx);  /* rebuild so every row is checked */
+    dv->cpf_idx = NULL;
+    dv_cpf_index(dv, out, &conflicts);
+    return conflicts;
+}
+
+/* Date text of a row (column 4), or NULL if it has none */
+static const char *row_date(const struct LinkedList *row) {
+    const struct ListNode *node = (row != NULL) ? row->first : NULL;
+    for (int k = 0; k < PC_DATA && node != NULL; k++) {
+        node = node->next;
+    }
+    return (node != NULL && node->field.type == FIELD_STRING) ? node->field.s : NULL;
+}
+
+void dv_check_rows(struct LinkedList *const *rows, int n, unsigned char *flags) {
+    struct Valid_Batch batch;
+    valid_reset(&batch);
+    for (int k = 0; k < n; k++) {
+        valid_add(&batch, row_cpf(rows[k]), row_date(rows[k]));
     }
-    dv->v[dv->n++] = list_ptr;
+    valid_run(&batch, flags);
+}
+
+/*
+ * Load-time check: run the staged batch for rows first..first+n-1 and
+ * record the invalid ones in dv->checked.
+ */
+static void dv_note_invalid(struct Dinamic_Vector *dv, struct Valid_Batch *batch, int first) {
+    unsigned char flags[VALID_BATCH];
+    struct Valid_Rows *vr = dv->checked;
+    valid_run(batch, flags);
+    for (int k = 0; k < batch->n; k++) {
+        if (flags[k] == 0) {
+            continue;
+        }
+        if (vr->n == vr->cap) {
+            vr->cap = vr->cap ? vr->cap * 2 : 64;
+            int *grown = (int *)realloc(vr->rows, sizeof(int) * (size_t)vr->cap);
+            if (grown == NULL) {
+                exit(1);
+            }
+            vr->rows = grown;
+        }
+        vr->rows[vr->n++] = first + k;
+    }
+    valid_reset(batch);
+}
+
+/* Print one invalid row of the report */
+static void dv_report_invalid(struct Dinamic_Vector *dv, FILE *out, int i) {
+    struct LinkedList *row = dv_get(dv, i);
+    fprintf(out, "Registro inválido (%s): ", valid_reason(valid_row(row_cpf(row), row_date(row))));
+    ll_fprint(out, row);
+}
+
+int dv_validate(struct Dinamic_Vector *dv, FILE *out, int max_listed) {
+    if (dv == NULL) {
+        return 0;
+    }
+    if (dv->checked != NULL && dv->checked->epoch == dv->epoch) {
+        int invalid = dv->checked->n;
+        for (int k = 0; out != NULL && k < invalid && k < max_listed; k++) {
+            dv_report_invalid(dv, out, dv->checked->rows[k]);
+        }
+        if (out != NULL && invalid > max_listed) {
+            fprintf(out, "... e mais %d registro(s) inválido(s).\n", invalid - max_listed);
+        }
+        return invalid;
+    }
+    struct Valid_Batch batch;
+    unsigned char flags[VALID_BATCH];
+    int invalid = 0;
+    for (int start = 0; start < dv->n; start += VALID_BATCH) {
+        int count = (dv->n - start < VALID_BATCH) ? dv->n - start : VALID_BATCH;
+        /* values are copied when staged, so paged mode may evict the rows meanwhile */
+        valid_reset(&batch);
+        for (int k = 0; k < count; k++) {
+            struct LinkedList *row = dv_get(dv, start + k);
+            valid_add(&batch, row_cpf(row), row_date(row));
+        }
+        valid_run(&batch, flags);
+        for (int k = 0; k < count; k++) {
+            if (flags[k] == 0) {
+                continue;
+            }
+            if (out != NULL && invalid < max_listed) {
+                dv_report_invalid(dv, out, start + k);
+            }
+            invalid++;
+        }
+    }
+    if (out != NULL && invalid > max_listed) {
+        fprintf(out, "... e mais %d registro(s) inválido(s).\n", invalid - max_listed);
+    }
+    return invalid;
 }
 
 /*
@@ -66,13 +401,66 @@ int dv_size(const struct Dinamic_Vector *dv) {
 }
 
 /*
- * Return the LinkedList* stored at index i.
+ * CSV line backing row i (lazy or paged mode). In paged mode the text lives
+ * in the pool's line buffer until the next read. On a read error, exit(1).
+ */
+static const char *dv_source_line(const struct Dinamic_Vector *dv, int i) {
+    if (dv->pool == NULL) {
+        return dv->src + dv->src_off[i];
+    }
+    const char *line = pool_read_line(dv->pool, dv->src_off[i]);
+    if (line == NULL) {
+        exit(1);
+    }
+    return line;
+}
+
+/* Paged mode: only rows that can be read back from the file are evicted */
+static int dv_row_evictable(const void *ctx, int i) {
+    const struct Dinamic_Vector *dv = (const struct Dinamic_Vector *)ctx;
+    return dv->src_off[i] >= 0;
+}
+
+/*
+ * Parse the CSV line backing row i (lazy or paged mode) and cache the result
+ * in dv->v[i]; in paged mode this may evict another resident row.
+ * The vector is logically const: only the cache slots change.
+ * On malloc failure, exit(1).
+ */
+static struct LinkedList *dv_materialize(const struct Dinamic_Vector *dv, int i) {
+    struct LinkedList *row = (dv->shm != NULL) ? shm_row(dv->shm, i) : schema_parse_row(dv_source_line(dv, i));
+    if (row == NULL) {
+        exit(1);
+    }
+    if (dv->renumbered && row->first != NULL) {
+        row->first->field.type = FIELD_INT;
+        row->first->field.i = i + 1;
+    }
+    dv->v[i] = row;
+    if (dv->row_cache != NULL) {
+        int victim = rc_admit(dv->row_cache, i, dv_row_evictable, dv);
+        if (victim >= 0) {
+            ll_free(dv->v[victim]);
+            dv->v[victim] = NULL;
+        }
+    }
+    return row;
+}
+
+/*
+ * Return the LinkedList* stored at index i, parsing it first if needed.
  * If dv==NULL or i out of bounds, exit(1).
  */
 struct LinkedList *dv_get(const struct Dinamic_Vector *dv, int i) {
     if (dv == NULL || i < 0 || i >= dv->n) {
         exit(1);
     }
+    if (dv->v[i] == NULL) {
+        return dv_materialize(dv, i);
+    }
+    if (dv->row_cache != NULL) {
+        rc_touch(dv->row_cache, i);
+    }
     return dv->v[i];
 }
 
@@ -85,76 +473,38 @@ void dv_free(struct Dinamic_Vector *dv) {
         return;
     }
     free(dv->v);
+    free(dv->src);
+    free(dv->src_off);
+    cpf_index_free(dv->cpf_idx);
+    tri_free(dv->tri_idx);
+    col_free(dv->cols);
+    part_free(dv->parts);
+    pool_close(dv->pool);
+    rc_free(dv->row_cache);
+    shm_detach(dv->shm);
+    delta_close(dv->delta);
+    if (dv->checked != NULL) {
+        free(dv->checked->rows);
+        free(dv->checked);
+    }
     free(dv);
 }
 
 /*
- * Helper to split a CSV line into exactly 5 tokens, preserving empty fields.
- * Returns a newly malloc’d array of 5 char* (each strndup’d, possibly empty string).
- * *num_tokens is set to 5.  
- * On any malloc failure, exit(1).  
+ * Public entry to the row parser (used by the ingestion queue's producers).
+ * Reentrant: touches no shared state.
  */
-static char **split_csv_line(const char *line, int *num_tokens) {
-    /* We expect 5 columns per line. Allocate array of length 5. */
-    int expected = 5;
-    char **fields = (char **)malloc(sizeof(char *) * expected);
-    if (fields == NULL) {
-        exit(1);
-    }
-
-    int start = 0;
-    int field_index = 0;
-    int len = (int)strlen(line);
-
-    for (int i = 0; i <= len && field_index < expected; i++) {
-        if (line[i] == ',' || line[i] == '\n' || line[i] == '\r' || line[i] == '\0') {
-            /* substring is line[start..i-1], length = i-start */
-            int sublen = i - start;
-            /* Remove any trailing '\r' or '\n' characters inside the field */
-            while (sublen > 0 && (line[start + sublen -1] == '\r' || line[start + sublen -1] == '\n')) {
-                sublen--;
-            }
-            char *token = (char *)malloc(sublen + 1);
-            if (token == NULL) {
-                /* free previously allocated tokens */
-                for (int j = 0; j < field_index; j++) {
-                    free(fields[j]);
-                }
-                free(fields);
-                exit(1);
-            }
-            if (sublen > 0) {
-                memcpy(token, &line[start], sublen);
-            }
-            token[sublen] = '\0';
-            fields[field_index++] = token;
-            start = i + 1;
-        }
+struct LinkedList *dv_row_from_csv_line(const char *line) {
+    if (line == NULL) {
+        return NULL;
     }
-    /* if fewer than expected fields (e.g., missing trailing columns), fill with empty */
-    while (field_index < expected) {
-        char *empty = (char *)malloc(1);
-        if (empty == NULL) {
-            for (int j = 0; j < field_index; j++) {
-                free(fields[j]);
-            }
-            free(fields);
-            exit(1);
-        }
-        empty[0] = '\0';
-        fields[field_index++] = empty;
-    }
-
-    *num_tokens = expected;
-    return fields;
+    return schema_parse_row(line);
 }
 
 /**
  * Reads a CSV file and appends each data row to the dynamic vector 'dv'.
- * Skips the header. For each non-empty line, splits into 5 fields:
- *   - Fields 0 and 3: convert to int (FIELD_INT), or FIELD_NULL if empty.
- *   - Fields 1, 2, and 4: store as string (FIELD_STRING), or FIELD_NULL if empty.
- * Each row is stored as a LinkedList and inserted into 'dv'.
+ * Skips the header. Each non-empty line is parsed by schema_parse_row and the
+ * resulting LinkedList is inserted into 'dv'.
  * Frees all temporary memory. Returns 0 on success, 1 on error.
  */
 int dv_read_from_csv(struct Dinamic_Vector *dv, const char *filename) {
@@ -174,6 +524,17 @@ int dv_read_from_csv(struct Dinamic_Vector *dv, const char *filename) {
         return 1;
     }
 
+    /* Validation stage: rows are staged while hot and checked VALID_BATCH at a time */
+    if (dv->checked == NULL) {
+        dv->checked = (struct Valid_Rows *)calloc(1, sizeof(struct Valid_Rows));
+        if (dv->checked == NULL) {
+            exit(1);
+        }
+    }
+    struct Valid_Batch batch;
+    valid_reset(&batch);
+    int first = dv->n;
+
     /* Process each subsequent line */
     while (fgets(line, sizeof(line), fp) != NULL) {
         /* Skip blank or too-short lines */
@@ -181,115 +542,239 @@ int dv_read_from_csv(struct Dinamic_Vector *dv, const char *filename) {
             continue;
         }
 
-        int num_tokens = 0;
-        char **tokens = split_csv_line(line, &num_tokens);
-        /* num_tokens will always be 5 */
-
-        /* Create a linked list for this row */
-        struct LinkedList *row_list = ll_create();  /* exit(1) on failure */
-
-        /* For columns 0..4 build a Field and append */
-        for (int idx = 0; idx < num_tokens; idx++) {
-            struct Field field;
-            if (tokens[idx][0] == '\0') {
-                /* empty string → treat as NULL field */
-                field.type = FIELD_NULL;
-                field.i = 0;
-                field.s = NULL;
-            } else if (idx == 0 || idx == 3) {
-                /* ID or Age: integer column */
-                field.type = FIELD_INT;
-                field.i = atoi(tokens[idx]);
-                field.s = NULL;
-            } else {
-                /* CPF, Name or Date: string column */
-                field.type = FIELD_STRING;
-                field.s = strdup(tokens[idx]);
-                if (field.s == NULL) {
-                    /* on failure, clean up and exit */
-                    free(tokens[idx]);
-                    for (int j = idx + 1; j < num_tokens; j++) {
-                        free(tokens[j]);
-                    }
-                    free(tokens);
-                    ll_free(row_list);
-                    fclose(fp);
-                    return 1;
-                }
-            }
-            ll_append_field(row_list, field);  /* exit(1) on malloc failure */
-        }
+        struct LinkedList *row_list = schema_parse_row(line);  /* exit(1) on malloc failure */
 
         /* Insert this row’s list into dv */
         dv_insert(dv, row_list);  /* exit(1) if dv==NULL */
-
-        /* Free the temporary tokens */
-        for (int i = 0; i < num_tokens; i++) {
-            free(tokens[i]);
+        valid_add(&batch, row_cpf(row_list), row_date(row_list));
+        if (batch.n == VALID_BATCH) {
+            dv_note_invalid(dv, &batch, first);
+            first = dv->n;
         }
-        free(tokens);
     }
+    dv_note_invalid(dv, &batch, first);
+    dv->checked->epoch = dv->epoch;
 
     fclose(fp);
     return 0;
 }
 
 /**
- * Write all data from the dynamic vector to a CSV file.
- * Creates the header line and then writes each record.
- * 
- * Returns 0 on success; returns 1 on any error.
+ * Lazy load: slurp the whole file, then scan it for newlines with memchr.
+ * Each data line is NUL-terminated in place and only its offset is kept;
+ * dv->v[i] stays NULL until dv_get parses it.
+ * Returns 0 on success, 1 on error.
  */
-int dv_write_to_csv(const struct Dinamic_Vector *dv, const char *filename) {
-    if (dv == NULL || filename == NULL) {
+int dv_read_from_csv_lazy(struct Dinamic_Vector *dv, const char *filename) {
+    if (dv == NULL || filename == NULL || dv->src != NULL) {
         return 1;
     }
 
-    FILE *fp = fopen(filename, "w");
+    FILE *fp = fopen(filename, "rb");
     if (fp == NULL) {
         return 1;
     }
+    if (fseek(fp, 0, SEEK_END) != 0) {
+        fclose(fp);
+        return 1;
+    }
+    long size = ftell(fp);
+    if (size < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        return 1;
+    }
 
-    // Write header
-    fprintf(fp, "ID,CPF,Nome,Idade,Data_Cadastro\n");
-
-    // Write each record
-    for (int i = 0; i < dv_size(dv); i++) {
-        struct LinkedList *row = dv_get(dv, i);
-        if (row == NULL) continue;
+    char *buf = (char *)malloc((size_t)size + 1);
+    if (buf == NULL) {
+        fclose(fp);
+        return 1;
+    }
+    if (fread(buf, 1, (size_t)size, fp) != (size_t)size) {
+        free(buf);
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+    buf[size] = '\0';
 
-        struct ListNode *node = row->first;
-        int field_count = 0;
+    /* Offsets are kept alongside dv->v, with the same capacity */
+    long *off = (long *)malloc(sizeof(long) * dv->n_max);
+    if (off == NULL) {
+        free(buf);
+        return 1;
+    }
+    for (int i = 0; i < dv->n; i++) {
+        off[i] = -1;
+    }
+    dv->src = buf;
+    dv->src_size = (size_t)size + 1;
+    dv->src_off = off;
 
-        while (node != NULL && field_count < 5) {
-            if (field_count > 0) {
-                fprintf(fp, ",");
-            }
+    /* Skip header line; an empty file is an error, as in dv_read_from_csv */
+    if (size == 0) {
+        return 1;
+    }
+    char *end = buf + size;
+    char *nl = memchr(buf, '\n', (size_t)size);
+    char *p = (nl != NULL) ? nl + 1 : end;
 
-            if (node->field.type == FIELD_INT) {
-                fprintf(fp, "%d", node->field.i);
-            } else if (node->field.type == FIELD_STRING && node->field.s != NULL) {
-                fprintf(fp, "%s", node->field.s);
-            }
-            // For FIELD_NULL or NULL strings, print nothing (empty field)
+    while (p < end) {
+        nl = memchr(p, '\n', (size_t)(end - p));
+        char *line_end = (nl != NULL) ? nl : end;
+        long len = (long)(line_end - p);
+        *line_end = '\0';
 
-            node = node->next;
-            field_count++;
+        /* Skip blank or too-short lines (the newline counted in dv_read_from_csv) */
+        if (len > 0 && p[0] != '\r' && len + (nl != NULL) >= 2) {
+            dv_push_slot(dv, NULL, (long)(p - buf));
         }
+        p = line_end + 1;
+    }
+    return 0;
+}
 
-        // Fill remaining fields if the row has fewer than 5 fields
-        while (field_count < 5) {
-            if (field_count > 0) {
-                fprintf(fp, ",");
+int dv_read_from_csv_paged(struct Dinamic_Vector *dv, const char *filename, int n_frames, int max_rows) {
+    if (dv == NULL || filename == NULL || dv->src != NULL || dv->pool != NULL) {
+        return 1;
+    }
+    struct Buffer_Pool *pool = pool_open(filename, n_frames);
+    if (pool == NULL) {
+        return 1;
+    }
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        pool_close(pool);
+        return 1;
+    }
+
+    long *off = (long *)malloc(sizeof(long) * dv->n_max);
+    char *chunk = (char *)malloc(65536);
+    if (off == NULL || chunk == NULL) {
+        exit(1);
+    }
+    for (int i = 0; i < dv->n; i++) {
+        off[i] = -1;
+    }
+    dv->src_off = off;
+    dv->pool = pool;
+    dv->row_cache = rc_create(max_rows);
+
+    /* One streaming pass records where each data line starts; only the
+       offsets stay in memory. Same skip rules as dv_read_from_csv_lazy. */
+    long pos = 0;         /* file offset of chunk[0] */
+    long line_start = 0;  /* offset of the current line */
+    char first = 0;       /* first byte of the current line */
+    int header = 1;
+    size_t got;
+    while ((got = fread(chunk, 1, 65536, fp)) > 0) {
+        size_t k = 0;
+        while (k < got) {
+            if (pos + (long)k == line_start) {
+                first = chunk[k];
+            }
+            char *nl = memchr(chunk + k, '\n', got - k);
+            if (nl == NULL) {
+                break;
+            }
+            long end = pos + (long)(nl - chunk);
+            long len = end - line_start;
+            if (header) {
+                header = 0;
+            } else if (len > 0 && first != '\r' && len + 1 >= 2) {
+                dv_push_slot(dv, NULL, line_start);
             }
-            field_count++;
+            line_start = end + 1;
+            k = (size_t)(nl - chunk) + 1;
         }
+        pos += (long)got;
+    }
+    /* last line without a trailing newline */
+    if (line_start < pos && !header && first != '\r' && pos - line_start >= 2) {
+        dv_push_slot(dv, NULL, line_start);
+    }
+    free(chunk);
+    fclose(fp);
+    return (pos == 0) ? 1 : 0;  /* an empty file is an error, as in dv_read_from_csv */
+}
 
+/*
+ * Write row 'i' of 'dv' as one CSV line.
+ */
+static void dv_write_row(FILE *fp, const struct Dinamic_Vector *dv, int i) {
+    if (dv->v[i] == NULL && dv->shm == NULL) {
+        // Never parsed or evicted (lazy/paged mode): copy the original line, renumbering if needed
+        const char *line = dv_source_line(dv, i);
+        size_t len = strcspn(line, "\r");
+        if (dv->renumbered) {
+            const char *rest = strchr(line, ',');
+            fprintf(fp, "%d", i + 1);
+            line = (rest != NULL) ? rest : line + len;
+            len = strcspn(line, "\r");
+        }
+        fwrite(line, 1, len, fp);
         fprintf(fp, "\n");
+        return;
     }
+    schema_write_row(fp, dv_get(dv, i));
+}
 
-    fclose(fp);
-    return 0;
+/*
+ * Write the header, then rows[0..n-1] (or every row if rows==NULL).
+ */
+static int dv_write_csv(const struct Dinamic_Vector *dv, const char *filename, const int *rows, int n) {
+    if (dv == NULL || filename == NULL) {
+        return 1;
+    }
+
+    /* Paged mode may be reading 'filename' itself: write aside, then rename */
+    char *tmp = NULL;
+    if (dv->pool != NULL) {
+        tmp = (char *)malloc(strlen(filename) + 5);
+        if (tmp == NULL) {
+            exit(1);
+        }
+        sprintf(tmp, "%s.tmp", filename);
+    }
+
+    FILE *fp = fopen(tmp != NULL ? tmp : filename, "w");
+    if (fp == NULL) {
+        free(tmp);
+        return 1;
+    }
+
+    // Write header
+    schema_write_header(fp);
+
+    // Write each record
+    for (int k = 0; k < n; k++) {
+        dv_write_row(fp, dv, (rows != NULL) ? rows[k] : k);
+    }
+
+    int status = (fclose(fp) != 0) ? 1 : 0;
+    if (tmp != NULL) {
+        if (status == 0 && rename(tmp, filename) != 0) {
+            status = 1;
+        }
+        free(tmp);
+    }
+    return status;
+}
+
+/**
+ * Write all data from the dynamic vector to a CSV file.
+ * Creates the header line and then writes each record.
+ * 
+ * Returns 0 on success; returns 1 on any error.
+ */
+int dv_write_to_csv(const struct Dinamic_Vector *dv, const char *filename) {
+    return dv_write_csv(dv, filename, NULL, dv_size(dv));
+}
+
+int dv_write_rows_to_csv(const struct Dinamic_Vector *dv, const char *filename, const int *rows, int n) {
+    if (rows == NULL) {
+        return 1;
+    }
+    return dv_write_csv(dv, filename, rows, n);
 }
 
 /**
@@ -302,7 +787,7 @@ void dv_print_all(const struct Dinamic_Vector *dv) {
         return;
     }
     int total = dv_size(dv);
-    printf("ID CPF Nome Idade Data_Cadastro\n");
+    schema_print_header(stdout);
 
     for (int i = 0; i < total; i++) {
         struct LinkedList *row = dv_get(dv, i);  /* exit(1) if dv==NULL or out of bounds */
@@ -327,38 +812,54 @@ struct Field *get_field_by_index(const struct Dinamic_Vector *dv, int line, int
    return NULL;
 }
 
-void dv_consult_by_field(const struct Dinamic_Vector *dv, const char *search, int field_index) {
-   if (dv == NULL || search == NULL || field_index < 0 || field_index > 4) {
-       printf("Erro: Parâmetros inválidos.\n");
-       return;
-   }
-
-   printf("ID CPF Nome Idade Data_Cadastro\n");
-
-   size_t search_len = strlen(search); // Store the length of 'search' before the loop
-   int found = 0; // Flag to track if any match is found
-
-   for (int i = 0; i < dv_size(dv); i++) {
-       struct LinkedList *row = dv_get(dv, i);
-       struct Field *field = get_field_by_index(dv, i, field_index);
+/*
+ * Print every row matched by a consult cursor, or a message if none matched.
+ */
+static void dv_consult_all(const struct Dinamic_Vector *dv, struct Consult_Cursor *c) {
+   schema_print_header(stdout);
 
-       if (field != NULL && field->type == FIELD_STRING && strncasecmp(field->s, search, search_len) == 0) {
-           ll_print(row); // Print the entire row if the field matches
-           found = 1; // Set flag to indicate a match was found
-       }
+   int found = 0; // Number of matches printed so far
+   int page;
+   while ((page = cursor_print_page(c, dv, 64, stdout)) > 0) {
+       found += page;
    }
+   cursor_close(c);
 
    if (!found) {
        printf("Nenhum usuário registrado com essas credenciais.\n");
    }
 }
 
+void dv_consult_by_field(const struct Dinamic_Vector *dv, const char *search, int field_index) {
+   if (dv == NULL || search == NULL || field_index < 0 || field_index >= PC_COUNT) {
+       printf("Erro: Parâmetros inválidos.\n");
+       return;
+   }
+   // Names are matched on the folded keys kept in each row (accents/case ignored)
+   dv_consult_all(dv, cursor_open(dv, field_index, 0, search));
+}
+
+void dv_consult_name_substring(const struct Dinamic_Vector *dv, const char *search) {
+   if (dv == NULL || search == NULL) {
+       printf("Erro: Parâmetros inválidos.\n");
+       return;
+   }
+   dv_consult_all(dv, cursor_open(dv, PC_NOME, 1, search));
+}
+
 /**
  * Reassign IDs for all rows in the vector, starting from 1.
  * Assumes ID is always the first field (index 0).
  */
 void dv_reassign_ids(struct Dinamic_Vector *dv) {
     if (!dv) return;
+    if (!dv->renumbered) {
+        snap_save_ids(dv);  /* the file IDs are about to be overwritten */
+    }
+    dv->renumbered = 1;  /* rows still unparsed pick up their new ID in dv_materialize */
+    unsigned long before = dv->epoch;
+    dv->epoch++;
+    tri_changed(dv, before);  /* names are unchanged */
     for (int i = 0; i < dv->n; i++) {
         struct LinkedList *row = dv->v[i];
         if (row && row->first) {
@@ -372,14 +873,247 @@ void dv_reassign_ids(struct Dinamic_Vector *dv) {
  * Remove the row at index 'idx' from the vector, shifting others left.
  * Frees the LinkedList at that position.
  */
-void dv_remove(struct Dinamic_Vector *dv, int idx) {
-    if (!dv || idx < 0 || idx >= dv->n) return;
-    ll_free(dv->v[idx]);
+int dv_remove(struct Dinamic_Vector *dv, int idx) {
+    if (!dv || idx < 0 || idx >= dv->n) return 1;
+    /* fetched before the segment shifts (shared mode) */
+    const struct LinkedList *gone = (dv->delta != NULL) ? dv_get(dv, idx) : NULL;
+    if (dv->shm != NULL && shm_remove(dv->shm, idx) != SHM_OK) {
+        return 1;
+    }
+    delta_remove(dv->delta, gone);
+    if (dv->cpf_idx != NULL) {
+        cpf_index_remove(dv->cpf_idx, row_cpf_key(dv_get(dv, idx)), idx);
+        cpf_index_shift_after(dv->cpf_idx, idx);
+    }
+    if (dv->parts != NULL) {
+        part_touch(dv->parts, dv_get(dv, idx));
+    }
+    snap_touch(dv, idx, dv->n);
+    snap_release_row(dv->v[idx]);
+    rc_remove_row(dv->row_cache, idx);
     for (int i = idx; i < dv->n - 1; i++) {
         dv->v[i] = dv->v[i + 1];
     }
+    if (dv->src_off != NULL) {
+        memmove(&dv->src_off[idx], &dv->src_off[idx + 1], sizeof(long) * (dv->n - 1 - idx));
+    }
+    unsigned long before = dv->epoch;
+    tri_row_removed(dv, idx);
     dv->n--;
+    dv->epoch++;
+    tri_changed(dv, before);
     dv_reassign_ids(dv);
+    return 0;
+}
+
+static int change_cmp(const void *pa, const void *pb) {
+    const struct Dv_Change *a = *(const struct Dv_Change *const *)pa;
+    const struct Dv_Change *b = *(const struct Dv_Change *const *)pb;
+    if (a->row != b->row) {
+        return (a->row < b->row) ? -1 : 1;
+    }
+    return (a < b) ? -1 : (a > b);  /* same row: input order */
+}
+
+/*
+ * Shared mode: every write goes to the segment on its own, from the highest
+ * row down so the positions still to be visited do not move.
+ */
+static int dv_apply_changes_shm(struct Dinamic_Vector *dv, struct Dv_Change **order, int n, int *rejected) {
+    int applied = 0;
+    for (int k = n - 1; k >= 0; k--) {
+        struct Dv_Change *c = order[k];
+        if (c->row < 0 || c->row >= dv->n) {
+            (*rejected)++;
+            continue;
+        }
+        int done = c->remove ? dv_remove(dv, c->row)
+                             : dv_update(dv, c->row, c->cpf, c->nome, c->idade, c->data);
+        if (done == 0) {
+            applied++;
+        } else {
+            (*rejected)++;
+        }
+    }
+    return applied;
+}
+
+int dv_apply_changes(struct Dinamic_Vector *dv, struct Dv_Change *changes, int n, int *rejected) {
+    int refused = 0;
+    if (rejected == NULL) {
+        rejected = &refused;
+    }
+    *rejected = 0;
+    if (dv == NULL || changes == NULL || n <= 0) {
+        return 0;
+    }
+    struct Dv_Change **order = (struct Dv_Change **)malloc(sizeof(struct Dv_Change *) * (size_t)n);
+    if (order == NULL) {
+        exit(1);
+    }
+    for (int k = 0; k < n; k++) {
+        order[k] = &changes[k];
+    }
+    qsort(order, (size_t)n, sizeof(struct Dv_Change *), change_cmp);
+    if (dv->shm != NULL) {
+        int applied = dv_apply_changes_shm(dv, order, n, rejected);
+        free(order);
+        return applied;
+    }
+
+    /* map[p]: new position of row p after compaction, negative if removed */
+    int *map = (int *)malloc(sizeof(int) * (size_t)(dv->n > 0 ? dv->n : 1));
+    if (map == NULL) {
+        exit(1);
+    }
+    for (int i = 0; i < dv->n; i++) {
+        map[i] = i;
+    }
+    int applied = 0;
+    int removed = 0;
+    for (int k = 0; k < n; k++) {
+        struct Dv_Change *c = order[k];
+        if (c->row < 0 || c->row >= dv->n) {
+            order[k] = NULL;
+            (*rejected)++;
+        } else if (c->remove && map[c->row] >= 0) {
+            map[c->row] = -1;
+            removed++;
+        }
+    }
+
+    /* the index must exist before the removals drop their keys from it:
+       built later, by the first lookup, it would index the removed rows too */
+    dv_cpf_index(dv, NULL, NULL);
+
+    /* removals first, so their CPFs are free for the updates */
+    for (int k = 0; k < n; k++) {
+        struct Dv_Change *c = order[k];
+        if (c == NULL || !c->remove) {
+            continue;
+        }
+        if (map[c->row] == -2) {
+            (*rejected)++;  /* same row removed twice */
+            continue;
+        }
+        map[c->row] = -2;
+        struct LinkedList *row = dv_get(dv, c->row);
+        cpf_index_remove(dv->cpf_idx, row_cpf_key(row), c->row);
+        part_touch(dv->parts, row);
+        delta_remove(dv->delta, row);
+        applied++;
+    }
+    for (int k = 0; k < n; k++) {
+        struct Dv_Change *c = order[k];
+        if (c == NULL || c->remove) {
+            continue;
+        }
+        if (map[c->row] < 0) {
+            (*rejected)++;  /* the row is removed by this batch */
+            continue;
+        }
+        int changes_cpf = (c->cpf != NULL && strcmp(c->cpf, "-") != 0);
+        if (changes_cpf) {
+            int owner = dv_find_cpf(dv, c->cpf);
+            if ((owner >= 0 && owner != c->row) || delta_refuses(dv, c->cpf)) {
+                (*rejected)++;
+                continue;
+            }
+        }
+        /* fetched after the lookup: building the index may evict rows (paged mode) */
+        struct LinkedList *row = dv_own_row(dv, c->row, dv_get(dv, c->row));
+        if (changes_cpf) {
+            cpf_index_remove(dv->cpf_idx, row_cpf_key(row), c->row);
+        }
+        if (dv->pool != NULL) {
+            dv->src_off[c->row] = -1;
+        }
+        struct LinkedList *old = (dv->delta != NULL) ? ll_copy(row) : NULL;
+        part_touch(dv->parts, row);
+        ll_update_fields(row, c->cpf, c->nome, c->idade, c->data);
+        part_touch(dv->parts, row);
+        delta_update(dv->delta, old, row);
+        ll_free(old);
+        if (c->nome != NULL && strcmp(c->nome, "-") != 0) {
+            tri_row_renamed(dv, c->row, row);
+        }
+        if (changes_cpf) {
+            cpf_index_add(dv->cpf_idx, row_cpf_key(row), c->row);
+        }
+        applied++;
+    }
+
+    if (removed > 0) {
+        /* single compaction: every kept row moves at most once */
+        int w = 0;
+        while (map[w] >= 0) {
+            w++;  /* rows before the first removal stay where they are */
+        }
+        snap_touch(dv, w, dv->n);
+        for (int i = w; i < dv->n; i++) {
+            if (map[i] < 0) {
+                snap_release_row(dv->v[i]);
+                continue;
+            }
+            map[i] = w;
+            dv->v[w] = dv->v[i];
+            if (dv->src_off != NULL) {
+                dv->src_off[w] = dv->src_off[i];
+            }
+            w++;
+        }
+        cpf_index_remap(dv->cpf_idx, map);
+        tri_rows_remapped(dv, map, w);
+        rc_remap(dv->row_cache, map, dv->n);
+        dv->n = w;
+        dv_reassign_ids(dv);
+    }
+    if (applied > 0) {
+        unsigned long before = dv->epoch;  /* after dv_reassign_ids, which keeps the index current */
+        dv->epoch++;
+        tri_changed(dv, before);
+    }
+    free(map);
+    free(order);
+    return applied;
+}
+
+int dv_sync(struct Dinamic_Vector *dv) {
+    if (dv == NULL || dv->shm == NULL) {
+        return 0;
+    }
+    unsigned long epoch;
+    int n = shm_size(dv->shm, &epoch);
+    if (epoch == dv->shm->seen) {
+        return 0;
+    }
+    for (int i = 0; i < dv->n; i++) {
+        ll_free(dv->v[i]);
+    }
+    while (dv->n_max < n) {
+        dv_reallocate(dv);
+    }
+    for (int i = 0; i < n; i++) {
+        dv->v[i] = NULL;
+    }
+    dv->n = n;
+    dv->shm->seen = epoch;
+    dv->epoch++;
+    return 1;
+}
+
+int dv_hold(struct Dinamic_Vector *dv) {
+    if (dv == NULL || dv->shm == NULL) {
+        return 0;
+    }
+    shm_hold(dv->shm);
+    return dv_sync(dv);
+}
+
+void dv_release(struct Dinamic_Vector *dv) {
+    if (dv != NULL && dv->shm != NULL) {
+        shm_release(dv->shm);
+    }
 }
 
 /**
@@ -390,11 +1124,12 @@ void dv_free_all(struct Dinamic_Vector *dv) {
     if (dv == NULL) {
         return;
     }
+    snap_free(dv->snaps);  /* first: it frees the rows only snapshots hold */
+    dv->snaps = NULL;
     
-    // Free each LinkedList inside the vector
+    // Free each LinkedList inside the vector (unparsed lazy rows are NULL)
     for (int i = 0; i < dv_size(dv); i++) {
-        struct LinkedList *row = dv_get(dv, i);
-        ll_free(row);
+        ll_free(dv->v[i]);
     }
     
     // Free the dynamic vector itself
@@ -2,6 +2,14 @@
 #define DINAMIC_VECTOR_H
 
 #include "linkedlist.h"
+#include "cpf_index.h"
+#include "trigram.h"
+#include "columns.h"
+#include "partition.h"
+#include "bufpool.h"
+#include "shm_store.h"
+#include "delta.h"
+#include "snapshot.h"
 
 /*
  * A dynamic array (vector) whose elements are pointers to struct LinkedList.
@@ -10,7 +18,33 @@
 struct Dinamic_Vector {
     int n;           /* number of elements currently stored */
     int n_max;       /* current capacity (max elements before realloc) */
-    struct LinkedList **v;  /* array of pointers to LinkedList */
+    struct LinkedList **v;  /* array of pointers to LinkedList (NULL = row not parsed yet, lazy mode) */
+    char *src;       /* lazy mode: whole CSV file in memory, one NUL-terminated line per row; NULL otherwise */
+    size_t src_size; /* bytes allocated for 'src' */
+    long *src_off;   /* lazy/paged mode: offset of each row's line inside 'src' or the file (-1 if the row is only in memory) */
+    int renumbered;  /* set once dv_reassign_ids ran; rows parsed afterwards take ID = index + 1 */
+    struct Cpf_Index *cpf_idx;  /* CPF uniqueness index; NULL until first needed */
+    struct Trigram_Index *tri_idx;  /* fuzzy name index; rebuilt when its epoch is stale */
+    struct Int_Columns *cols;       /* int column cache; rebuilt when its epoch is stale */
+    struct Partition_Set *parts;    /* partitioned storage (dirty months); NULL for a single CSV */
+    struct Buffer_Pool *pool;       /* paged mode: pages of the CSV file; NULL otherwise */
+    struct Row_Cache *row_cache;    /* paged mode: parsed rows kept in memory */
+    struct Shm_Store *shm;          /* shared mode: rows live in a shared segment, v[] is a view */
+    unsigned long epoch;  /* bumped on every change to the rows; derived caches compare against it */
+    struct Valid_Rows *checked;     /* invalid rows found while loading; NULL if not checked */
+    struct Delta_Log *delta;        /* change feed (see delta.h); NULL when not recorded */
+    struct Snapshot_Set *snaps;     /* point-in-time snapshots (see snapshot.h); NULL until one is taken */
+};
+
+/*
+ * Rows whose CPF or date failed the checks of normalize.h, recorded by
+ * dv_read_from_csv while the rows are parsed. Valid for epoch 'epoch' only.
+ */
+struct Valid_Rows {
+    int *rows;
+    int n;
+    int cap;
+    unsigned long epoch;
 };
 
 /**
@@ -21,10 +55,70 @@ struct Dinamic_Vector *dv_create(void);
 
 /**
  * Insert 'list_ptr' at the end of 'dv'; if dv is full, its capacity doubles.
+ * Only the local vector changes: in shared mode use dv_insert_unique.
  * If dv==NULL or list_ptr==NULL or realloc fails, exits(1).
  */
 void dv_insert(struct Dinamic_Vector *dv, struct LinkedList *list_ptr);
 
+/**
+ * Insert 'list_ptr' at the end of 'dv' only if its CPF is not already stored.
+ * Returns 0 on success; returns 1 if the CPF is a duplicate (or empty while
+ * the delta feed is on), or 2 if the shared store refused the write (full,
+ * or changed by another process). If not inserted, the caller keeps ownership of the row.
+ * If dv==NULL or list_ptr==NULL, exits(1).
+ */
+int dv_insert_unique(struct Dinamic_Vector *dv, struct LinkedList *list_ptr);
+
+/**
+ * Return the index of the row whose CPF equals 'cpf' (formatting ignored),
+ * or -1 if there is none. Builds the CPF index on first use.
+ */
+int dv_find_cpf(struct Dinamic_Vector *dv, const char *cpf);
+
+/**
+ * Iterate the rows whose CPF has index key 'key' (cpf_key), duplicates
+ * included: start with *slot = -1; each call returns the next row, in no
+ * particular order, or -1 when there are no more. The vector must not
+ * change during the iteration. Builds the CPF index on first use.
+ */
+int dv_cpf_next(struct Dinamic_Vector *dv, unsigned long long key, int *slot);
+
+/**
+ * Update the row at index 'idx' through ll_update_fields, keeping the CPF
+ * index consistent. A '-' argument leaves that field unchanged.
+ * Returns 0 on success; returns 1 if idx is invalid or the new CPF already
+ * belongs to another row (or is empty while the delta feed is on), or 2 if the shared store refused the write
+ * (nothing is changed).
+ */
+int dv_update(struct Dinamic_Vector *dv, int idx, const char *cpf, const char *nome, const char *idade, const char *data);
+
+/**
+ * Build the CPF index over every row and print one line to 'out' for each row
+ * whose CPF repeats an earlier one. Returns the number of conflicts found.
+ */
+int dv_report_cpf_conflicts(struct Dinamic_Vector *dv, FILE *out);
+
+/**
+ * Number of rows whose CPF is empty or shared with another row: rows the
+ * delta feed could not tell apart. Builds the CPF index on first use.
+ */
+int dv_cpf_ambiguous(struct Dinamic_Vector *dv);
+
+/**
+ * Check the CPF and date of 'n' rows as one batch (see normalize.h);
+ * flags[k] receives the VALID_BAD_* bits of rows[k]. n <= VALID_BATCH.
+ */
+void dv_check_rows(struct LinkedList *const *rows, int n, unsigned char *flags);
+
+/**
+ * Check every row's CPF (check digits) and date (calendar), VALID_BATCH
+ * rows at a time, and print the first 'max_listed' invalid rows to 'out'
+ * (if not NULL). Right after dv_read_from_csv the rows were already checked
+ * during the load and only the report is printed. Rows are kept as they are.
+ * Returns the number of invalid rows.
+ */
+int dv_validate(struct Dinamic_Vector *dv, FILE *out, int max_listed);
+
 /**
  * Return how many elements are currently stored in 'dv'; if dv==NULL, returns 0.
  */
@@ -32,6 +126,7 @@ int dv_size(const struct Dinamic_Vector *dv);
 
 /**
  * Return the struct LinkedList* stored at index 'i'.  
+ * In lazy mode the row is parsed from its CSV line the first time it is accessed.
  * If dv==NULL or i is out of bounds, exits(1).
  */
 struct LinkedList *dv_get(const struct Dinamic_Vector *dv, int i);
@@ -68,9 +163,39 @@ void dv_free(struct Dinamic_Vector *dv);
  */
 int dv_read_from_csv(struct Dinamic_Vector *dv, const char *filename);
 
+/**
+ * Parse one CSV data line into a new row, with the same rules as
+ * dv_read_from_csv. Safe to call from several threads at once.
+ * Returns the row, or NULL if line==NULL or a string copy fails.
+ */
+struct LinkedList *dv_row_from_csv_line(const char *line);
+
+/**
+ * Lazy variant of dv_read_from_csv: the file is read into memory in one go and
+ * only the start of each data line is recorded (newline scan, no parsing).
+ * Rows are parsed into their LinkedList on first access through dv_get.
+ * The header line and blank lines are skipped exactly as in dv_read_from_csv.
+ *
+ * Returns 0 on success; returns 1 on any error:
+ *   - File open/read failure
+ *   - Memory allocation failure
+ *   - 'dv' was already loaded lazily
+ */
+int dv_read_from_csv_lazy(struct Dinamic_Vector *dv, const char *filename);
+
+/**
+ * Out-of-core load (see bufpool.h): stream the file once to record the
+ * offset of each data line, then serve rows through a buffer pool of
+ * 'n_frames' pages, keeping at most 'max_rows' parsed rows that match the
+ * file in memory. Rows inserted or changed stay in memory until saved.
+ * Returns 0 on success, 1 on error.
+ */
+int dv_read_from_csv_paged(struct Dinamic_Vector *dv, const char *filename, int n_frames, int max_rows);
+
 /**
  * Write all data from the dynamic vector to a CSV file.
  * Creates a backup of the original file before writing.
+ * Rows that were never parsed (lazy mode) are written back from their original line.
  * 
  * Returns 0 on success; returns 1 on any error:
  *   - File open failure
@@ -78,6 +203,12 @@ int dv_read_from_csv(struct Dinamic_Vector *dv, const char *filename);
  */
 int dv_write_to_csv(const struct Dinamic_Vector *dv, const char *filename);
 
+/**
+ * Write the header and the rows at positions rows[0..n-1] of 'dv' to a CSV file.
+ * Returns 0 on success; returns 1 on any error.
+ */
+int dv_write_rows_to_csv(const struct Dinamic_Vector *dv, const char *filename, const int *rows, int n);
+
 /**
  * Print every LinkedList stored in 'dv'.  
  * For each i in [0..dv_size(dv)-1], prints:
@@ -96,9 +227,17 @@ struct Field *get_field_by_index(const struct Dinamic_Vector *dv, int line, int
  * Consult patients by a specific field value.
  * Searches through all records and prints matching ones.
  * The field to search is specified by its index (e.g., 1=CPF, 2=Name, etc.).
+ * Names (index 2) are compared as folded prefixes, so "joao" finds "João Silva".
+ * For page-by-page results use the cursor API (cursor.h) instead.
  */
 void dv_consult_by_field(const struct Dinamic_Vector *dv, const char *search, int field_index);
 
+/**
+ * Consult patients whose name contains 'search' anywhere.
+ * Matching is accent-, case- and whitespace-insensitive (folded keys, see fold.h).
+ */
+void dv_consult_name_substring(const struct Dinamic_Vector *dv, const char *search);
+
 
 /**
  * Consult patients by a specific field value.
@@ -115,13 +254,58 @@ void dv_reassign_ids(struct Dinamic_Vector *dv);
  /**
  * Remove a record at the specified index from the dynamic vector.
  * After removal, IDs are automatically reassigned to maintain sequential numbering.
+ * Returns 0 on success; returns 1 if idx is invalid or the shared store
+ * refused the write.
  */
-void dv_remove(struct Dinamic_Vector *dv, int idx);
+int dv_remove(struct Dinamic_Vector *dv, int idx);
 
+/*
+ * One entry of a change batch: row 'row' is removed, or updated with the
+ * given values (NULL or "-" keeps a field, as in dv_update).
+ */
+struct Dv_Change {
+    int row;
+    int remove;
+    const char *cpf;
+    const char *nome;
+    const char *idade;
+    const char *data;
+};
 
 /**
- * Remove a record at the specified index from the dynamic vector.
- * After removal, IDs are automatically reassigned to maintain sequential numbering.
+ * Apply 'n' changes in one pass: entries are sorted by row (entries for the
+ * same row keep their order; a removal wins over updates), updates are done
+ * in place, and removed rows are dropped by a single compaction followed by
+ * one remap of the CPF index and one renumbering of the IDs.
+ * An entry is rejected if its row is out of range or its new CPF belongs to
+ * another row that stays. In shared mode the changes go through dv_update /
+ * dv_remove one by one (highest row first).
+ * Returns the number of changes applied; '*rejected' (if given) receives the
+ * number refused. 'changes' is reordered.
+ * If malloc fails, exits(1).
+ */
+int dv_apply_changes(struct Dinamic_Vector *dv, struct Dv_Change *changes, int n, int *rejected);
+
+/**
+ * Shared mode: if another process changed the store, drop the rows parsed
+ * so far and resize the view to the current segment.
+ * Returns 1 if the view changed, else 0 (always 0 outside shared mode).
+ */
+int dv_sync(struct Dinamic_Vector *dv);
+
+/**
+ * Shared mode: hold the store for one read-only command. Takes the shared
+ * lock once and syncs the view under it, so every row read until
+ * dv_release comes from the same epoch even while other processes write.
+ * No write may be made while held. Returns what dv_sync returns (always 0
+ * outside shared mode).
+ */
+int dv_hold(struct Dinamic_Vector *dv);
+void dv_release(struct Dinamic_Vector *dv);
+
+
+/**
+ * Free every row, the snapshots (see snapshot.h) and the vector itself.
  */
 void dv_free_all(struct Dinamic_Vector *dv);
 
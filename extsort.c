@@ -0,0 +1,479 @@
+#include "extsort.h"
+#include "cpf_index.h"
+#include "dinamic_vector.h"
+#include "normalize.h"
+#include "schema.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * One normalized input row, as a CSV data line of the PATIENT_SCHEMA
+ * columns with ID 0 (numbered when applied), plus its sort key and input
+ * position (ties keep file order, so the first copy of a CPF wins).
+ * Run files hold the same fields back to back: key, seq, len, text.
+ */
+struct Ext_Rec {
+    unsigned long long key;
+    unsigned long long seq;
+    unsigned int len;
+    char *text;
+};
+
+struct Ext_Runs {
+    FILE **files;
+    int n;
+    int cap;
+};
+
+static void runs_add(struct Ext_Runs *runs, FILE *fp) {
+    if (runs->n == runs->cap) {
+        runs->cap = runs->cap ? runs->cap * 2 : 16;
+        FILE **grown = (FILE **)realloc(runs->files, sizeof(FILE *) * (size_t)runs->cap);
+        if (grown == NULL) {
+            exit(1);
+        }
+        runs->files = grown;
+    }
+    runs->files[runs->n++] = fp;
+}
+
+static void runs_close(struct Ext_Runs *runs) {
+    for (int k = 0; k < runs->n; k++) {
+        fclose(runs->files[k]);
+    }
+    free(runs->files);
+    runs->files = NULL;
+    runs->n = runs->cap = 0;
+}
+
+static int rec_less(const struct Ext_Rec *a, const struct Ext_Rec *b) {
+    if (a->key != b->key) {
+        return a->key < b->key;
+    }
+    return a->seq < b->seq;
+}
+
+static int rec_cmp(const void *pa, const void *pb) {
+    const struct Ext_Rec *a = (const struct Ext_Rec *)pa;
+    const struct Ext_Rec *b = (const struct Ext_Rec *)pb;
+    return rec_less(a, b) ? -1 : rec_less(b, a) ? 1 : 0;
+}
+
+static int rec_write(FILE *fp, const struct Ext_Rec *r) {
+    return fwrite(&r->key, sizeof(r->key), 1, fp) == 1 &&
+           fwrite(&r->seq, sizeof(r->seq), 1, fp) == 1 &&
+           fwrite(&r->len, sizeof(r->len), 1, fp) == 1 &&
+           fwrite(r->text, 1, r->len, fp) == r->len;
+}
+
+/*
+ * Read the next record of a run into 'r', its text into '*buf' (grown as
+ * needed). Returns 1 if a record was read, 0 at the end of the run.
+ */
+static int rec_read(FILE *fp, struct Ext_Rec *r, char **buf, size_t *cap) {
+    if (fread(&r->key, sizeof(r->key), 1, fp) != 1 ||
+        fread(&r->seq, sizeof(r->seq), 1, fp) != 1 ||
+        fread(&r->len, sizeof(r->len), 1, fp) != 1) {
+        return 0;
+    }
+    if ((size_t)r->len + 1 > *cap) {
+        *cap = (size_t)r->len + 1;
+        char *grown = (char *)realloc(*buf, *cap);
+        if (grown == NULL) {
+            exit(1);
+        }
+        *buf = grown;
+    }
+    if (fread(*buf, 1, r->len, fp) != r->len) {
+        return 0;
+    }
+    (*buf)[r->len] = '\0';
+    r->text = *buf;
+    return 1;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Phase 1: sorted runs                                                   */
+/* ---------------------------------------------------------------------- */
+
+struct Ext_Buffer {
+    struct Ext_Rec *recs;
+    int n;
+    int cap;
+    char *arena;
+    size_t used;
+    size_t arena_cap;
+};
+
+/* Sort the buffered rows and write them as a new run. Returns 1 on error. */
+static int flush_run(struct Ext_Buffer *b, struct Ext_Runs *runs) {
+    if (b->n == 0) {
+        return 0;
+    }
+    qsort(b->recs, (size_t)b->n, sizeof(struct Ext_Rec), rec_cmp);
+    FILE *fp = tmpfile();
+    if (fp == NULL) {
+        return 1;
+    }
+    for (int k = 0; k < b->n; k++) {
+        if (!rec_write(fp, &b->recs[k])) {
+            fclose(fp);
+            return 1;
+        }
+    }
+    if (fflush(fp) != 0) {
+        fclose(fp);
+        return 1;
+    }
+    rewind(fp);
+    runs_add(runs, fp);
+    b->n = 0;
+    b->used = 0;
+    return 0;
+}
+
+/*
+ * Split a data line (no line break) into its PC_COUNT columns in place, like
+ * schema_parse_row: missing trailing columns are empty, extra ones ignored.
+ */
+static void split_columns(char *line, char *col[PC_COUNT]) {
+    int k = 0;
+    col[k++] = line;
+    for (char *p = line; *p != '\0' && k < PC_COUNT; p++) {
+        if (*p == ',') {
+            *p = '\0';
+            col[k++] = p + 1;
+        }
+    }
+    while (k < PC_COUNT) {
+        col[k++] = "";
+    }
+    char *comma = strchr(col[PC_COUNT - 1], ',');
+    if (comma != NULL) {
+        *comma = '\0';
+    }
+}
+
+/*
+ * Join 'vals' into one data line at 'out' (room for every value plus
+ * PC_COUNT bytes). Returns its length.
+ */
+static size_t join_columns(char *out, const char *const vals[PC_COUNT]) {
+    size_t len = 0;
+    for (int c = 0; c < PC_COUNT; c++) {
+        size_t n = strlen(vals[c]);
+        memcpy(out + len, vals[c], n);
+        len += n;
+        out[len++] = (c + 1 < PC_COUNT) ? ',' : '\0';
+    }
+    return len - 1;
+}
+
+/*
+ * Count a rejected input line and list it on 'report' while under the limit.
+ */
+static void reject_line(struct Ext_Import_Stats *st, FILE *report, unsigned long long seq, const char *reason, const char *text) {
+    if (report != NULL && st->invalid < EXT_REPORT_MAX) {
+        fprintf(report, "Linha %llu rejeitada (%s): %s\n", seq + 1, reason, text);
+    }
+    st->invalid++;
+}
+
+/*
+ * Check the rows added to 'b' since position 'first' (staged in 'vb') and
+ * drop the invalid ones from the buffer.
+ */
+static void check_pending(struct Ext_Buffer *b, int first, struct Valid_Batch *vb,
+                          struct Ext_Import_Stats *st, FILE *report) {
+    unsigned char flags[VALID_BATCH];
+    valid_run(vb, flags);
+    int w = first;
+    for (int k = 0; k < vb->n; k++) {
+        struct Ext_Rec *r = &b->recs[first + k];
+        if (flags[k] != 0) {
+            reject_line(st, report, r->seq, valid_reason(flags[k]), r->text);
+        } else {
+            b->recs[w++] = *r;
+        }
+    }
+    b->n = w;
+    valid_reset(vb);
+}
+
+static int build_runs(FILE *fp, size_t mem_bytes, struct Ext_Runs *runs, struct Ext_Import_Stats *st, FILE *report) {
+    struct Ext_Buffer b;
+    b.arena_cap = mem_bytes / 4 * 3;
+    b.cap = (int)(mem_bytes / 4 / sizeof(struct Ext_Rec));
+    b.n = 0;
+    b.used = 0;
+    b.arena = (char *)malloc(b.arena_cap);
+    b.recs = (struct Ext_Rec *)malloc(sizeof(struct Ext_Rec) * (size_t)b.cap);
+    if (b.arena == NULL || b.recs == NULL) {
+        exit(1);
+    }
+
+    char line[1024];
+    int failed = 0;
+    /* rows from 'first' on are staged in 'vb' and not checked yet */
+    struct Valid_Batch vb;
+    int first = 0;
+    valid_reset(&vb);
+    /* Read and discard header line */
+    if (fgets(line, sizeof(line), fp) == NULL) {
+        line[0] = '\0';
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        size_t len = strcspn(line, "\r\n");
+        if (line[len] == '\0' && !feof(fp)) {
+            /* longer than any valid row: drop the rest of it */
+            int c;
+            while ((c = fgetc(fp)) != EOF && c != '\n') {
+            }
+            st->read++;
+            reject_line(st, report, st->read, "linha longa demais", "...");
+            continue;
+        }
+        line[len] = '\0';
+        /* Skip blank lines, as dv_read_from_csv does */
+        if (len == 0) {
+            continue;
+        }
+        st->read++;
+
+        char *col[PC_COUNT];
+        char cpf[NORM_CPF_LEN + 1];
+        char date[NORM_DATE_LEN + 1];
+        split_columns(line, col);
+        int bad_cpf = normalize_cpf(col[PC_CPF], cpf);
+        if (bad_cpf || normalize_date(col[PC_DATA], date) != 0) {
+            reject_line(st, report, st->read, bad_cpf ? "CPF inválido" : "data inválida", bad_cpf ? col[PC_CPF] : col[PC_DATA]);
+            continue;
+        }
+
+        const char *vals[PC_COUNT];
+        for (int c = 0; c < PC_COUNT; c++) {
+            vals[c] = col[c];
+        }
+        vals[PC_ID] = "0";
+        vals[PC_CPF] = cpf;
+        vals[PC_DATA] = date;
+        size_t need = PC_COUNT;  /* commas and terminator */
+        for (int c = 0; c < PC_COUNT; c++) {
+            need += strlen(vals[c]);
+        }
+        if (b.n == b.cap || b.used + need > b.arena_cap) {
+            check_pending(&b, first, &vb, st, report);
+            if (flush_run(&b, runs) != 0) {
+                failed = 1;
+                break;
+            }
+            first = 0;
+        }
+        struct Ext_Rec *r = &b.recs[b.n++];
+        r->text = b.arena + b.used;
+        r->len = (unsigned int)join_columns(r->text, vals);
+        r->key = cpf_key(cpf);
+        r->seq = st->read;
+        b.used += r->len + 1;
+        valid_add(&vb, cpf, date);
+        if (vb.n == VALID_BATCH) {
+            check_pending(&b, first, &vb, st, report);
+            first = b.n;
+        }
+    }
+    if (!failed) {
+        check_pending(&b, first, &vb, st, report);
+        failed = flush_run(&b, runs);
+    }
+    free(b.arena);
+    free(b.recs);
+    return failed;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Phase 2: k-way merge                                                   */
+/* ---------------------------------------------------------------------- */
+
+struct Ext_Reader {
+    FILE *fp;
+    struct Ext_Rec cur;
+    char *buf;
+    size_t cap;
+};
+
+/* Called with every record in order; returns 1 to abort the merge */
+typedef int (*Ext_Emit)(void *ctx, const struct Ext_Rec *r);
+
+static void heap_sift_down(int *heap, int n, int i, const struct Ext_Reader *rd) {
+    for (;;) {
+        int least = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < n && rec_less(&rd[heap[l]].cur, &rd[heap[least]].cur)) {
+            least = l;
+        }
+        if (r < n && rec_less(&rd[heap[r]].cur, &rd[heap[least]].cur)) {
+            least = r;
+        }
+        if (least == i) {
+            return;
+        }
+        int tmp = heap[i];
+        heap[i] = heap[least];
+        heap[least] = tmp;
+        i = least;
+    }
+}
+
+/* Merge runs 'in[0..n-1]' into 'emit'. Returns 1 if 'emit' aborted. */
+static int merge_runs(FILE **in, int n, Ext_Emit emit, void *ctx) {
+    struct Ext_Reader *rd = (struct Ext_Reader *)calloc((size_t)n, sizeof(struct Ext_Reader));
+    int *heap = (int *)malloc(sizeof(int) * (size_t)n);
+    if (rd == NULL || heap == NULL) {
+        exit(1);
+    }
+    int live = 0;
+    for (int k = 0; k < n; k++) {
+        rd[k].fp = in[k];
+        if (rec_read(rd[k].fp, &rd[k].cur, &rd[k].buf, &rd[k].cap)) {
+            heap[live++] = k;
+        }
+    }
+    for (int i = live / 2 - 1; i >= 0; i--) {
+        heap_sift_down(heap, live, i, rd);
+    }
+
+    int failed = 0;
+    while (live > 0 && !failed) {
+        struct Ext_Reader *top = &rd[heap[0]];
+        failed = emit(ctx, &top->cur);
+        if (!rec_read(top->fp, &top->cur, &top->buf, &top->cap)) {
+            heap[0] = heap[--live];
+        }
+        heap_sift_down(heap, live, 0, rd);
+    }
+
+    for (int k = 0; k < n; k++) {
+        free(rd[k].buf);
+    }
+    free(rd);
+    free(heap);
+    return failed;
+}
+
+static int emit_to_run(void *ctx, const struct Ext_Rec *r) {
+    return !rec_write((FILE *)ctx, r);
+}
+
+/* Merge groups of EXT_FANIN runs until at most EXT_FANIN remain. */
+static int reduce_runs(struct Ext_Runs *runs, struct Ext_Import_Stats *st) {
+    while (runs->n > EXT_FANIN) {
+        struct Ext_Runs next = {NULL, 0, 0};
+        for (int g = 0; g < runs->n; g += EXT_FANIN) {
+            int count = (runs->n - g < EXT_FANIN) ? runs->n - g : EXT_FANIN;
+            FILE *out = tmpfile();
+            if (out == NULL || merge_runs(runs->files + g, count, emit_to_run, out) || fflush(out) != 0) {
+                if (out != NULL) {
+                    fclose(out);
+                }
+                runs_close(&next);
+                return 1;
+            }
+            rewind(out);
+            runs_add(&next, out);
+        }
+        runs_close(runs);
+        *runs = next;
+        st->passes++;
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Phase 3: apply                                                         */
+/* ---------------------------------------------------------------------- */
+
+struct Ext_Apply {
+    struct Dinamic_Vector *dv;
+    struct Ext_Import_Stats *st;
+    unsigned long long last_key;
+};
+
+_Static_assert(PC_ID == 0, "emit_to_store numbers each row through its first column");
+
+static int emit_to_store(void *ctx, const struct Ext_Rec *r) {
+    struct Ext_Apply *a = (struct Ext_Apply *)ctx;
+    if (a->last_key == r->key) {
+        a->st->dup_input++;
+        return 0;
+    }
+    a->last_key = r->key;
+
+    struct LinkedList *row = dv_row_from_csv_line(r->text);
+    if (row == NULL) {
+        exit(1);
+    }
+    row->first->field.type = FIELD_INT;
+    row->first->field.i = dv_size(a->dv) + 1;
+
+    int status = dv_insert_unique(a->dv, row);
+    if (status == 0) {
+        a->st->inserted++;
+        return 0;
+    }
+    ll_free(row);
+    if (status == 1) {
+        a->st->dup_store++;
+    } else {
+        a->st->refused++;
+    }
+    return 0;
+}
+
+int ext_import_csv(struct Dinamic_Vector *dv, const char *path, size_t mem_bytes, struct Ext_Import_Stats *stats, FILE *report) {
+    struct Ext_Import_Stats st;
+    memset(&st, 0, sizeof(st));
+    if (dv == NULL || path == NULL) {
+        return 1;
+    }
+    if (mem_bytes == 0) {
+        mem_bytes = EXT_DEFAULT_MEM;
+    } else if (mem_bytes < EXT_MIN_MEM) {
+        mem_bytes = EXT_MIN_MEM;
+    }
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return 1;
+    }
+    struct Ext_Runs runs = {NULL, 0, 0};
+    int failed = build_runs(fp, mem_bytes, &runs, &st, report);
+    if (report != NULL && st.invalid > EXT_REPORT_MAX) {
+        fprintf(report, "... e mais %zu linha(s) rejeitada(s).\n", st.invalid - EXT_REPORT_MAX);
+    }
+    fclose(fp);
+    st.runs = runs.n;
+
+    if (!failed) {
+        failed = reduce_runs(&runs, &st);
+    }
+    if (!failed && runs.n > 0) {
+        struct Ext_Apply apply = {dv, &st, 0};
+        failed = merge_runs(runs.files, runs.n, emit_to_store, &apply);
+        st.passes++;
+    }
+    runs_close(&runs);
+    if (stats != NULL) {
+        *stats = st;
+    }
+    return failed;
+}
+
+void ext_report(const struct Ext_Import_Stats *st, FILE *out) {
+    fprintf(out, "Lidos: %zu, inseridos: %zu, CPF repetido no arquivo: %zu, CPF já cadastrado: %zu, inválidos: %zu\n",
+            st->read, st->inserted, st->dup_input, st->dup_store, st->invalid);
+    if (st->refused > 0) {
+        fprintf(out, "Recusados pelo armazenamento: %zu\n", st->refused);
+    }
+    fprintf(out, "(%d sequência(s) ordenada(s), %d passada(s) de intercalação)\n", st->runs, st->passes);
+}
@@ -0,0 +1,61 @@
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+struct Dinamic_Vector;
+
+/*
+ * Bulk merge of an external patient file whose size is not bounded by RAM.
+ *
+ * 1. Runs: the input is read line by line; each row's CPF and date are
+ *    normalized, checked VALID_BATCH rows at a time (check digits and
+ *    calendar, see normalize.h) and kept in a buffer of at most the memory
+ *    budget. A full buffer is sorted by CPF and written to an anonymous
+ *    temporary file.
+ * 2. Merge: the runs are merged with a min-heap, EXT_FANIN at a time; when
+ *    there are more runs than that, extra passes merge them into longer runs.
+ * 3. Apply: the last pass yields the rows in CPF order, so repeated CPFs in
+ *    the input are adjacent and only the first one (in file order) is kept;
+ *    rows whose CPF is already stored are skipped via the CPF index, and the
+ *    rest are appended with ID = position, in the same pass.
+ *
+ * Only the run buffer and one read buffer per merged run live in memory
+ * besides the store itself.
+ */
+
+#define EXT_FANIN 64
+#define EXT_DEFAULT_MEM (64UL << 20)  /* run buffer when no budget is given */
+#define EXT_MIN_MEM (64UL << 10)
+#define EXT_REPORT_MAX 20   /* rejected lines listed on the report */
+
+struct Ext_Import_Stats {
+    size_t read;         /* data lines read */
+    size_t invalid;      /* lines rejected: malformed or invalid CPF or date */
+    size_t dup_input;    /* repeated CPF inside the input */
+    size_t dup_store;    /* CPF already in the store */
+    size_t refused;      /* refused by the store (shared segment full or stale) */
+    size_t inserted;
+    int runs;            /* sorted runs written in phase 1 */
+    int passes;          /* merge passes, including the final one */
+};
+
+/**
+ * Merge the data lines of CSV 'path' (same columns as bd_paciente.csv; the
+ * ID column is ignored) into 'dv' as described above, using a run buffer of
+ * 'mem_bytes' (0: EXT_DEFAULT_MEM; raised to EXT_MIN_MEM if smaller).
+ * '*stats' (if given) receives the totals; the first EXT_REPORT_MAX rejected
+ * lines are listed on 'report' (if not NULL).
+ * Returns 0 on success; returns 1 if the file cannot be read or a temporary
+ * file cannot be written.
+ * If malloc fails, exits(1).
+ */
+int ext_import_csv(struct Dinamic_Vector *dv, const char *path, size_t mem_bytes, struct Ext_Import_Stats *stats, FILE *report);
+
+/**
+ * Print 'stats' as produced by ext_import_csv.
+ */
+void ext_report(const struct Ext_Import_Stats *stats, FILE *out);
+
+#endif /* EXTSORT_H */
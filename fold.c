@@ -0,0 +1,113 @@
+#include "fold.h"
+#include "slab.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Base letter for each UTF-8 sequence 0xC3 0x80..0xBF (U+00C0..U+00FF):
+ * upper case block first, then lower case block.
+ */
+static const char latin1_fold[64] =
+    "aaaaaaaceeeeiiiidnooooox" "ouuuuyts"
+    "aaaaaaaceeeeiiiidnooooo/" "ouuuuyty";
+
+char *fold_key(const char *s, int *len) {
+    size_t in_len = (s != NULL) ? strlen(s) : 0;
+    /* folding never grows the text; round up and add the SIMD tail padding */
+    size_t cap = FOLD_KEY_CAP(in_len);
+    char *key = slab_str_alloc(cap);
+    memset(key, 0, cap);
+
+    int out = 0;
+    int pending_space = 0;
+    for (size_t i = 0; i < in_len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            pending_space = (out > 0);
+            continue;
+        }
+        if (pending_space) {
+            key[out++] = ' ';
+            pending_space = 0;
+        }
+        if (c == 0xC3 && i + 1 < in_len && ((unsigned char)s[i + 1] & 0xC0) == 0x80) {
+            key[out++] = latin1_fold[(unsigned char)s[i + 1] - 0x80];
+            i++;
+        } else if (c >= 'A' && c <= 'Z') {
+            key[out++] = (char)(c - 'A' + 'a');
+        } else {
+            key[out++] = (char)c;
+        }
+    }
+    key[out] = '\0';
+    if (len != NULL) {
+        *len = out;
+    }
+    return key;
+}
+
+int fold_has_prefix(const char *key, int key_len, const char *q, int q_len) {
+    if (q_len > key_len) {
+        return 0;
+    }
+#if defined(__SSE2__)
+    for (int i = 0; i < q_len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(key + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(q + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+        int remaining = q_len - i;
+        unsigned want = (remaining >= 16) ? 0xFFFFu : ((1u << remaining) - 1);
+        if ((mask & want) != want) {
+            return 0;
+        }
+    }
+    return 1;
+#else
+    return memcmp(key, q, (size_t)q_len) == 0;
+#endif
+}
+
+int fold_contains(const char *key, int key_len, const char *q, int q_len) {
+    if (q_len == 0) {
+        return 1;
+    }
+    if (q_len > key_len) {
+        return 0;
+    }
+#if defined(__SSE2__)
+    /* Compare the query's first and last bytes against 16 positions at once;
+       only positions where both match are checked with memcmp. */
+    __m128i first = _mm_set1_epi8(q[0]);
+    __m128i last = _mm_set1_epi8(q[q_len - 1]);
+    int last_start = key_len - q_len;
+    for (int i = 0; i <= last_start; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(key + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(key + i + q_len - 1));
+        __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                                   _mm_cmpeq_epi8(last, block_last));
+        unsigned mask = (unsigned)_mm_movemask_epi8(eq);
+        int limit = last_start - i + 1;
+        if (limit < 16) {
+            mask &= (1u << limit) - 1;
+        }
+        while (mask != 0) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(key + i + bit, q, (size_t)q_len) == 0) {
+                return 1;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return 0;
+#else
+    for (int i = 0; i + q_len <= key_len; i++) {
+        if (key[i] == q[0] && memcmp(key + i, q, (size_t)q_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+#endif
+}
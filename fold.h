@@ -0,0 +1,36 @@
+#ifndef FOLD_H
+#define FOLD_H
+
+/*
+ * Folded search keys: lowercase, accents stripped (UTF-8 Latin-1 letters such
+ * as "ã", "É", "ç" become "a", "e", "c") and whitespace collapsed to single
+ * spaces with no leading/trailing blanks. "  JOÃO   Silva " -> "joao silva".
+ *
+ * Key buffers are zero padded past the end (FOLD_PAD bytes at least) so the
+ * matchers below can always load 16 bytes at a time without bounds checks.
+ */
+#define FOLD_PAD 16
+
+/* Bytes fold_key allocates for an input of 'in_len' bytes */
+#define FOLD_KEY_CAP(in_len) ((((size_t)(in_len) + 1 + 15) & ~(size_t)15) + FOLD_PAD)
+
+/**
+ * Return a new padded folded copy of 's' (free it with slab_str_free);
+ * '*len' (if not NULL) receives the folded length. A NULL 's' folds to the
+ * empty key. If malloc fails, exits(1).
+ */
+char *fold_key(const char *s, int *len);
+
+/**
+ * Return 1 if folded key 'key' starts with folded query 'q', else 0.
+ * Both buffers must come from fold_key.
+ */
+int fold_has_prefix(const char *key, int key_len, const char *q, int q_len);
+
+/**
+ * Return 1 if folded query 'q' occurs anywhere in folded key 'key', else 0.
+ * Both buffers must come from fold_key. An empty query always matches.
+ */
+int fold_contains(const char *key, int key_len, const char *q, int q_len);
+
+#endif /* FOLD_H */
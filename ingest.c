@@ -0,0 +1,324 @@
+#include "ingest.h"
+#include "dinamic_vector.h"
+#include "normalize.h"
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Bytes of file per position reserved by the CSV import */
+#define INGEST_CHUNK (16 * 1024)
+/* Positions in the ring */
+#define INGEST_SLOTS 64
+/* Idle drains spent yielding before the applier starts sleeping */
+#define INGEST_SPIN 64
+#define INGEST_MAX_PRODUCERS 64
+
+static void ingest_apply(struct Ingest_Queue *q, struct LinkedList *row) {
+    if (row->first != NULL) {
+        row->first->field.type = FIELD_INT;
+        row->first->field.i = dv_size(q->dv) + 1;
+    }
+    int status = dv_insert_unique(q->dv, row);
+    if (status != 0) {
+        if (status == 2) {
+            q->stats.refused++;
+        } else {
+            q->stats.duplicates++;
+        }
+        ll_free(row);
+        return;
+    }
+    q->stats.applied++;
+}
+
+static void *ingest_applier(void *arg) {
+    struct Ingest_Queue *q = (struct Ingest_Queue *)arg;
+    size_t tail = 0;
+    int idle = 0;
+    for (;;) {
+        /* positions are applied strictly in order: wait for 'tail' itself */
+        struct Ingest_Slot *slot = &q->slots[tail & q->mask];
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) == tail + 1) {
+            struct LinkedList **rows = slot->rows;
+            int n = slot->n;
+            slot->rows = NULL;
+            slot->n = 0;
+            atomic_store_explicit(&slot->seq, tail + q->mask + 1, memory_order_release);
+            tail++;
+            for (int k = 0; k < n; k++) {
+                ingest_apply(q, rows[k]);
+            }
+            free(rows);
+            if (n > 0) {
+                q->stats.batches++;
+                if ((size_t)n > q->stats.max_batch) {
+                    q->stats.max_batch = (size_t)n;
+                }
+            }
+            idle = 0;
+            continue;
+        }
+        /* closed and every reserved position consumed: nothing can arrive anymore */
+        if (atomic_load_explicit(&q->closed, memory_order_acquire) &&
+            atomic_load_explicit(&q->head, memory_order_acquire) == tail) {
+            break;
+        }
+        if (++idle < INGEST_SPIN) {
+            sched_yield();
+        } else {
+            struct timespec pause = {0, 50000};
+            nanosleep(&pause, NULL);
+        }
+    }
+    return NULL;
+}
+
+struct Ingest_Queue *ingest_start(struct Dinamic_Vector *dv, int capacity) {
+    struct Ingest_Queue *q = (struct Ingest_Queue *)malloc(sizeof(struct Ingest_Queue));
+    if (q == NULL) {
+        exit(1);
+    }
+    size_t cap = 2;
+    while (cap < (size_t)(capacity > 0 ? capacity : 1)) {
+        cap *= 2;
+    }
+    q->slots = (struct Ingest_Slot *)malloc(sizeof(struct Ingest_Slot) * cap);
+    if (q->slots == NULL) {
+        exit(1);
+    }
+    for (size_t i = 0; i < cap; i++) {
+        atomic_init(&q->slots[i].seq, i);
+        q->slots[i].rows = NULL;
+        q->slots[i].n = 0;
+    }
+    q->mask = cap - 1;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->closed, 0);
+    q->dv = dv;
+    memset(&q->stats, 0, sizeof(q->stats));
+    if (pthread_create(&q->applier, NULL, ingest_applier, q) != 0) {
+        free(q->slots);
+        free(q);
+        return NULL;
+    }
+    return q;
+}
+
+size_t ingest_reserve(struct Ingest_Queue *q) {
+    return atomic_fetch_add_explicit(&q->head, 1, memory_order_relaxed);
+}
+
+void ingest_publish(struct Ingest_Queue *q, size_t pos, struct LinkedList **rows, int n) {
+    struct Ingest_Slot *slot = &q->slots[pos & q->mask];
+    /* ring full: the applier has not freed this slot from the previous lap yet */
+    while (atomic_load_explicit(&slot->seq, memory_order_acquire) != pos) {
+        sched_yield();
+    }
+    slot->rows = rows;
+    slot->n = n;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+}
+
+void ingest_stop(struct Ingest_Queue *q, struct Ingest_Stats *stats) {
+    if (q == NULL) {
+        return;
+    }
+    atomic_store_explicit(&q->closed, 1, memory_order_release);
+    pthread_join(q->applier, NULL);
+    if (stats != NULL) {
+        *stats = q->stats;
+    }
+    free(q->slots);
+    free(q);
+}
+
+/* ---------------------------------------------------------------------- */
+/* CSV import                                                             */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * One producer: reserve a position, parse chunk number 'position' of the
+ * file (lines starting in [cut[pos], cut[pos + 1])), check the rows
+ * VALID_BATCH at a time and publish the valid ones; until the chunks run
+ * out. Positions and chunks are taken in the same order, so the applier
+ * sees the rows in file order.
+ */
+struct Ingest_Producer {
+    struct Ingest_Queue *q;
+    char **cut;
+    size_t n_chunks;
+    size_t rejected;  /* rows with a bad CPF or date, dropped */
+    struct LinkedList *pending[VALID_BATCH];
+    int n_pending;
+    struct LinkedList **out;  /* valid rows of the current chunk */
+    int n_out;
+    int out_cap;
+};
+
+static void producer_flush(struct Ingest_Producer *p) {
+    unsigned char flags[VALID_BATCH];
+    dv_check_rows(p->pending, p->n_pending, flags);
+    for (int k = 0; k < p->n_pending; k++) {
+        if (flags[k] != 0) {
+            p->rejected++;
+            ll_free(p->pending[k]);
+            continue;
+        }
+        if (p->n_out == p->out_cap) {
+            p->out_cap = p->out_cap > 0 ? p->out_cap * 2 : 256;
+            struct LinkedList **grown =
+                (struct LinkedList **)realloc(p->out, sizeof(struct LinkedList *) * (size_t)p->out_cap);
+            if (grown == NULL) {
+                exit(1);
+            }
+            p->out = grown;
+        }
+        p->out[p->n_out++] = p->pending[k];
+    }
+    p->n_pending = 0;
+}
+
+static void *ingest_producer(void *arg) {
+    struct Ingest_Producer *p = (struct Ingest_Producer *)arg;
+    p->rejected = 0;
+    p->n_pending = 0;
+    for (;;) {
+        size_t pos = ingest_reserve(p->q);
+        if (pos >= p->n_chunks) {
+            ingest_publish(p->q, pos, NULL, 0);
+            break;
+        }
+        p->out = NULL;
+        p->n_out = 0;
+        p->out_cap = 0;
+        char *line = p->cut[pos];
+        char *end = p->cut[pos + 1];
+        while (line < end) {
+            char *nl = memchr(line, '\n', (size_t)(end - line));
+            char *line_end = (nl != NULL) ? nl : end;
+            *line_end = '\0';
+            /* same skip rule as dv_read_from_csv: blank or too-short lines */
+            if (line_end - line >= 1 && line[0] != '\r') {
+                struct LinkedList *row = dv_row_from_csv_line(line);
+                if (row == NULL) {
+                    exit(1);
+                }
+                p->pending[p->n_pending++] = row;
+                if (p->n_pending == VALID_BATCH) {
+                    producer_flush(p);
+                }
+            }
+            line = line_end + 1;
+        }
+        producer_flush(p);
+        ingest_publish(p->q, pos, p->out, p->n_out);
+    }
+    return NULL;
+}
+
+int ingest_import_csv(struct Dinamic_Vector *dv, const char *path, int producers, int timed, FILE *out) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return 1;
+    }
+    if (fseek(fp, 0, SEEK_END) != 0) {
+        fclose(fp);
+        return 1;
+    }
+    long size = ftell(fp);
+    if (size < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        return 1;
+    }
+    char *buf = (char *)malloc((size_t)size + 1);
+    if (buf == NULL) {
+        exit(1);
+    }
+    if (fread(buf, 1, (size_t)size, fp) != (size_t)size) {
+        free(buf);
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+    buf[size] = '\0';
+
+    if (producers <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        producers = (cpus > 0) ? (int)cpus : 1;
+    }
+    if (producers > INGEST_MAX_PRODUCERS) {
+        producers = INGEST_MAX_PRODUCERS;
+    }
+
+    /* skip the header, then cut the rest into chunks: a line belongs to the
+       chunk it starts in, so chunk k starts at the first line start at or
+       after data + k * INGEST_CHUNK (the cuts are taken before any producer
+       writes terminators into the buffer) */
+    char *end = buf + size;
+    char *data = memchr(buf, '\n', (size_t)size);
+    data = (data != NULL) ? data + 1 : end;
+    size_t n_chunks = ((size_t)(end - data) + INGEST_CHUNK - 1) / INGEST_CHUNK;
+    char **cut = (char **)malloc(sizeof(char *) * (n_chunks + 1));
+    if (cut == NULL) {
+        exit(1);
+    }
+    cut[0] = data;
+    for (size_t k = 1; k < n_chunks; k++) {
+        char *target = data + k * INGEST_CHUNK;
+        char *nl = memchr(target - 1, '\n', (size_t)(end - (target - 1)));
+        cut[k] = (nl != NULL) ? nl + 1 : end;
+    }
+    cut[n_chunks] = end;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    struct Ingest_Queue *q = ingest_start(dv, INGEST_SLOTS);
+    if (q == NULL) {
+        free(cut);
+        free(buf);
+        return 1;
+    }
+    struct Ingest_Producer tasks[INGEST_MAX_PRODUCERS];
+    pthread_t tid[INGEST_MAX_PRODUCERS];
+    int started[INGEST_MAX_PRODUCERS];
+    for (int t = 0; t < producers; t++) {
+        tasks[t].q = q;
+        tasks[t].cut = cut;
+        tasks[t].n_chunks = n_chunks;
+        started[t] = (pthread_create(&tid[t], NULL, ingest_producer, &tasks[t]) == 0);
+        if (!started[t]) {
+            ingest_producer(&tasks[t]);
+        }
+    }
+    for (int t = 0; t < producers; t++) {
+        if (started[t]) {
+            pthread_join(tid[t], NULL);
+        }
+    }
+    struct Ingest_Stats stats;
+    ingest_stop(q, &stats);
+    size_t rejected = 0;
+    for (int t = 0; t < producers; t++) {
+        rejected += tasks[t].rejected;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    free(cut);
+    free(buf);
+
+    double ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    fprintf(out, "Importados: %zu registro(s), %zu recusado(s) (CPF repetido), %zu rejeitado(s) (CPF ou data inválidos)\n",
+            stats.applied, stats.duplicates, rejected);
+    if (stats.refused > 0) {
+        fprintf(out, "%zu registro(s) recusado(s) pelo segmento compartilhado (cheio ou alterado por outro processo)\n",
+                stats.refused);
+    }
+    fprintf(out, "(%d produtor(es), %zu lote(s), maior lote %zu", producers, stats.batches, stats.max_batch);
+    if (timed) {
+        fprintf(out, ", %.3f ms, %.0f registros/s", ms,
+                ms > 0 ? (double)(stats.applied + stats.duplicates + stats.refused + rejected) * 1e3 / ms : 0.0);
+    }
+    fprintf(out, ")\n");
+    return 0;
+}
@@ -0,0 +1,97 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+
+struct Dinamic_Vector;
+struct LinkedList;
+
+/*
+ * Concurrent insert path: any number of producer threads prepare batches
+ * of rows and hand them to a bounded lock-free ring; one applier thread
+ * drains it and inserts the rows with dv_insert_unique (CPF index and the
+ * other structures are kept up to date by the vector).
+ *
+ * The ring is multi-producer / single-consumer and ordered by position. A
+ * producer reserves a position with one fetch-add on 'head' before it
+ * prepares its batch, then publishes the batch by storing seq = pos + 1
+ * once the slot is free for that lap (seq == pos); the applier takes the
+ * positions strictly in order once their seq says they are published, then
+ * frees the slot for the next lap with seq = pos + capacity. Rows are thus
+ * applied in reservation order whichever producer finishes first: the CSV
+ * import reserves one position per chunk of the file, in file order, so
+ * IDs and which of two lines with the same CPF wins are the same as in a
+ * single-threaded import. Producers never block each other; they only wait
+ * (yielding) when the ring is full.
+ *
+ * While the queue runs, the vector belongs to the applier thread: other
+ * threads must not touch it until ingest_stop returns.
+ */
+
+struct Ingest_Slot {
+    atomic_size_t seq;
+    struct LinkedList **rows;  /* malloc'd; freed by the applier */
+    int n;
+};
+
+struct Ingest_Stats {
+    size_t applied;     /* rows inserted */
+    size_t duplicates;  /* rows refused because their CPF is present, and freed */
+    size_t refused;     /* rows the shared store refused (full or changed by another process), freed */
+    size_t batches;     /* non-empty batches applied */
+    size_t max_batch;   /* largest batch */
+};
+
+struct Ingest_Queue {
+    struct Ingest_Slot *slots;
+    size_t mask;                /* capacity - 1 (power of two) */
+    _Alignas(64) atomic_size_t head;  /* next position to reserve (producers) */
+    atomic_int closed;
+    struct Dinamic_Vector *dv;
+    struct Ingest_Stats stats;  /* written by the applier only */
+    pthread_t applier;
+};
+
+/**
+ * Create a queue of at least 'capacity' slots feeding 'dv' and start its
+ * applier thread. Returns NULL if the thread cannot be started.
+ * If malloc fails, exits(1).
+ */
+struct Ingest_Queue *ingest_start(struct Dinamic_Vector *dv, int capacity);
+
+/**
+ * Reserve the next position (any thread). Every reserved position must be
+ * published, even with no rows, or the applier waits for it forever.
+ */
+size_t ingest_reserve(struct Ingest_Queue *q);
+
+/**
+ * Publish the 'n' rows of 'rows' (malloc'd array, may be NULL if n == 0)
+ * at position 'pos' from ingest_reserve. The queue takes ownership of the
+ * array and the rows; each row's ID is set to its final position when
+ * applied. Waits while the slot is still used by the previous lap.
+ */
+void ingest_publish(struct Ingest_Queue *q, size_t pos, struct LinkedList **rows, int n);
+
+/**
+ * Apply what is left, stop the applier and free the queue.
+ * '*stats' (if given) receives the totals.
+ */
+void ingest_stop(struct Ingest_Queue *q, struct Ingest_Stats *stats);
+
+/**
+ * Import the data lines of CSV 'path' (same format as bd_paciente.csv):
+ * 'producers' threads (<= 0: one per CPU) take chunks of the file in turn
+ * and parse them; the rows are applied in file order and each takes ID =
+ * its position, so the result does not depend on 'producers'. Rows with
+ * an invalid CPF or date (see normalize.h) and rows whose CPF is already
+ * present (or an earlier line's) are skipped. Prints totals to 'out', and
+ * the elapsed time and throughput if 'timed' (off in batch mode).
+ * Returns 0 on success; returns 1 if the file cannot be read.
+ */
+int ingest_import_csv(struct Dinamic_Vector *dv, const char *path, int producers, int timed, FILE *out);
+
+#endif /* INGEST_H */
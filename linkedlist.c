@@ -1,17 +1,21 @@
 #include "linkedlist.h"
+#include "fold.h"
+#include "schema.h"
+#include "slab.h"
 
 /*
  * Create and return a new, empty linked list.
  * If malloc fails, exit(1).
  */
 struct LinkedList *ll_create(void) {
-    struct LinkedList *l = (struct LinkedList *)malloc(sizeof(struct LinkedList));
-    if (l == NULL) {
-        exit(1);
-    }
+    struct LinkedList *l = (struct LinkedList *)slab_alloc(SLAB_ROW);
     l->count = 0;
+    l->shares = 0;
     l->first = NULL;
     l->last = NULL;
+    l->key = NULL;
+    l->key_len = 0;
+    l->flags = 0;
     return l;
 }
 
@@ -24,14 +28,7 @@ void ll_append_field(struct LinkedList *l, struct Field field) {
         exit(1);
     }
 
-    struct ListNode *node = (struct ListNode *)malloc(sizeof(struct ListNode));
-    if (node == NULL) {
-        if (field.type == FIELD_STRING) {
-            free(field.s);
-        }
-        exit(1);
-    }
-
+    struct ListNode *node = (struct ListNode *)slab_alloc(SLAB_NODE);
     node->field = field;
     node->next = NULL;
     node->prev = l->last;
@@ -45,33 +42,35 @@ void ll_append_field(struct LinkedList *l, struct Field field) {
     l->count++;
 }
 
+/*
+ * Recompute the folded Nome key of a row.
+ */
+void ll_refresh_key(struct LinkedList *l) {
+    if (!l) return;
+    const struct Field *f[PC_COUNT];
+    schema_fields(l, f);
+    const char *nome = NULL;
+    if (f[PC_NOME] != NULL && f[PC_NOME]->type == FIELD_STRING) {
+        nome = f[PC_NOME]->s;
+    }
+    slab_str_free(l->key);
+    l->key = fold_key(nome, &l->key_len);
+}
+
+_Static_assert(PC_COUNT == 5, "ll_update_fields takes the four editable patient columns one by one");
+
 /*
  * Update multiple fields in a LinkedList row.
  * For each parameter, if it is "-", the field is not updated.
  */
 int ll_update_fields(struct LinkedList *l, const char *cpf, const char *nome, const char *idade, const char *data) {
     if (!l) return 1;
-    struct ListNode *cur = l->first;
-    int idx = 0;
-    while (cur) {
-        if (idx == 1 && cpf && strcmp(cpf, "-") != 0) { // CPF
-            free(cur->field.s);
-            cur->field.s = strdup(cpf);
-        }
-        if (idx == 2 && nome && strcmp(nome, "-") != 0) { // Name
-            free(cur->field.s);
-            cur->field.s = strdup(nome);
-        }
-        if (idx == 3 && idade && strcmp(idade, "-") != 0) { // Age
-            cur->field.i = atoi(idade);
-        }
-        if (idx == 4 && data && strcmp(data, "-") != 0) { // Register_Date
-            free(cur->field.s);
-            cur->field.s = strdup(data);
-        }
-        cur = cur->next;
-        idx++;
-    }
+    const char *vals[PC_COUNT] = {NULL};
+    vals[PC_CPF] = cpf;
+    vals[PC_NOME] = nome;
+    vals[PC_IDADE] = idade;
+    vals[PC_DATA] = data;
+    schema_update_row(l, vals);
     return 0;
 }
 
@@ -83,7 +82,7 @@ void ll_remove_all_fields(struct LinkedList *l) {
     struct ListNode *cur = l->first;
     while (cur) {
         if (cur->field.type == FIELD_STRING && cur->field.s)
-            free(cur->field.s);
+            slab_str_free(cur->field.s);
         cur = cur->next;
     }
 }
@@ -114,10 +113,10 @@ int ll_remove_node(struct LinkedList *l, int index) {
     }
 
     if (current->field.type == FIELD_STRING) {
-        free(current->field.s);
+        slab_str_free(current->field.s);
     }
 
-    free(current);
+    slab_free(SLAB_NODE, current);
     l->count--;
     return 0;
 }
@@ -130,10 +129,7 @@ int ll_add_node(struct LinkedList *l, int position, struct Field new_field) {
         return 1;
     }
 
-    struct ListNode *new_node = (struct ListNode *)malloc(sizeof(struct ListNode));
-    if (new_node == NULL) {
-        return 1;
-    }
+    struct ListNode *new_node = (struct ListNode *)slab_alloc(SLAB_NODE);
 
     new_node->field = new_field;
     new_node->next = NULL;
@@ -175,44 +171,18 @@ int ll_add_node(struct LinkedList *l, int position, struct Field new_field) {
 }
 
 /*
- * Create a new LinkedList with fields initialized from the given parameters.
+ * Print all non-null fields in 'l'. Then print a newline.
+ * If l==NULL, just prints a newline.
  */
-struct LinkedList *ll_create_from_fields(int id, const char *cpf, const char *nome, int idade, const char *data) {
-    struct LinkedList *l = ll_create();
-    struct Field field;
-    field.type = FIELD_INT; field.i = id; field.s = NULL;
-    ll_append_field(l, field);
-    field.type = FIELD_STRING; field.s = strdup(cpf);
-    ll_append_field(l, field);
-    field.type = FIELD_STRING; field.s = strdup(nome);
-    ll_append_field(l, field);
-    field.type = FIELD_INT; field.i = idade; field.s = NULL;
-    ll_append_field(l, field);
-    field.type = FIELD_STRING; field.s = strdup(data);
-    ll_append_field(l, field);
-    return l;
+void ll_print(const struct LinkedList *l) {
+    ll_fprint(stdout, l);
 }
 
 /*
- * Print all non-null fields in 'l'. Then print a newline.
- * If l==NULL, just prints a newline.
+ * Print all non-null fields in 'l' to 'out', then a newline.
  */
-void ll_print(const struct LinkedList *l) {
-    if (l == NULL) {
-        printf("\n");
-        return;
-    }
-    struct ListNode *cur = l->first;
-    while (cur != NULL) {
-        struct Field f = cur->field;
-        if (f.type == FIELD_INT) {
-            printf("%d ", f.i);
-        } else if (f.type == FIELD_STRING) {
-            printf("%s ", f.s);
-        }
-        cur = cur->next;
-    }
-    printf("\n");
+void ll_fprint(FILE *out, const struct LinkedList *l) {
+    schema_print_row(out, l);
 }
 
 /**
@@ -226,7 +196,7 @@ struct LinkedList *ll_copy(const struct LinkedList *src) {
         struct Field f;
         f.type = cur->field.type;
         if (f.type == FIELD_STRING && cur->field.s) {
-            f.s = strdup(cur->field.s);
+            f.s = slab_strdup(cur->field.s);
         } else {
             f.i = cur->field.i;
             f.s = NULL;
@@ -234,6 +204,7 @@ struct LinkedList *ll_copy(const struct LinkedList *src) {
         ll_append_field(copy, f);
         cur = cur->next;
     }
+    ll_refresh_key(copy);
     return copy;
 }
 
@@ -258,8 +229,8 @@ int ll_is_empty(const struct LinkedList *l) {
 }
 
 /*
- * Free every node in l, free any malloc’d strings inside fields,
- * then free l itself. Safe if l==NULL.
+ * Free every node in l, free the strings inside fields, then free l
+ * itself. Safe if l==NULL.
  */
 void ll_free(struct LinkedList *l) {
     if (l == NULL) {
@@ -269,10 +240,11 @@ void ll_free(struct LinkedList *l) {
     while (cur != NULL) {
         struct ListNode *next = cur->next;
         if (cur->field.type == FIELD_STRING) {
-            free(cur->field.s);
+            slab_str_free(cur->field.s);
         }
-        free(cur);
+        slab_free(SLAB_NODE, cur);
         cur = next;
     }
-    free(l);
+    slab_str_free(l->key);
+    slab_free(SLAB_ROW, l);
 }
\ No newline at end of file
@@ -17,7 +17,7 @@ enum FieldType {
 /*
  * Field struct: holds either an integer or a string.
  * If type == FIELD_INT, use 'i'.
- * If type == FIELD_STRING, use 's' (must be malloc'd).
+ * If type == FIELD_STRING, use 's' (from slab_str_alloc, see slab.h).
  * If type == FIELD_NULL, neither is used.
  */
 struct Field {
@@ -37,11 +37,19 @@ struct ListNode {
 
 /*
  * LinkedList struct: a doubly linked list of Fields.
+ * 'key' caches the folded form of the Nome column (see fold.h) so name
+ * searches never re-fold rows; it is refreshed whenever the name changes.
+ * 'shares' and 'flags' belong to the snapshots (see snapshot.h): a row
+ * held by a snapshot must not be changed in place or freed by the vector.
  */
 struct LinkedList {
     int count;
+    int shares;      /* snapshot chunks holding this row; 0 for a new row */
     struct ListNode *first;
     struct ListNode *last;
+    char *key;       /* folded Nome (column 2), NULL until ll_refresh_key */
+    int key_len;     /* length of 'key' */
+    int flags;       /* SNAP_ROW_* bits */
 };
 
 /**
@@ -52,21 +60,26 @@ struct LinkedList *ll_create(void);
 
 /**
  * Append a Field 'f' to the end of list 'l'.
- * Takes ownership of 'f' (if FIELD_STRING, f.s must be malloc'd).
+ * Takes ownership of 'f' (if FIELD_STRING, f.s must come from slab_str_alloc).
  * Exits(1) on malloc failure or if l == NULL.
  */
 void ll_append_field(struct LinkedList *l, struct Field f);
 
 /**
- * Print all non-null fields in 'l'.
- * For each node, if field.type==FIELD_INT: print "%d ".
+ * Print all non-null fields in 'l' (a patient row, see schema.h).
+ * For each column, if field.type==FIELD_INT: print "%d ".
  * If field.type==FIELD_STRING: print "%s ".
  * If field.type==FIELD_NULL: skip (print nothing).
- * After all nodes, print a newline.
+ * After all columns, print a newline.
  * If l==NULL or empty, prints just a newline.
  */
 void ll_print(const struct LinkedList *l);
 
+/**
+ * Same as ll_print, but writes to 'out'.
+ */
+void ll_fprint(FILE *out, const struct LinkedList *l);
+
 /**
  * Return the number of nodes currently in 'l'.
  * If l==NULL, returns 0.
@@ -110,16 +123,19 @@ void ll_remove_all_fields(struct LinkedList *l);
 struct LinkedList *ll_copy(const struct LinkedList *src);
 
 /**
- * Update multiple fields in a LinkedList row.
- * For each parameter, if it is "-", the field is not updated.
- * Returns 0 on success.
+ * Recompute the folded search key of a row from its Nome column (index 2).
+ * Safe if l==NULL. Exits(1) on malloc failure.
  */
-int ll_update_fields(struct LinkedList *l, const char *cpf, const char *nome, const char *idade, const char *data);
+void ll_refresh_key(struct LinkedList *l);
 
 /**
- * Create a new LinkedList (row) from the given fields.
- * Returns a pointer to the new LinkedList.
+ * Update multiple fields in a LinkedList row (schema_update_row on the
+ * CPF, Nome, Idade and Data_Cadastro columns).
+ * For each parameter, if it is "-", the field is not updated; an empty
+ * value makes the field FIELD_NULL.
+ * The folded name key is refreshed when the name changes.
+ * Returns 0 on success.
  */
-struct LinkedList *ll_create_from_fields(int id, const char *cpf, const char *nome, int idade, const char *data);
+int ll_update_fields(struct LinkedList *l, const char *cpf, const char *nome, const char *idade, const char *data);
 
 #endif /* LINKEDLIST_H */
\ No newline at end of file
@@ -4,6 +4,20 @@
 #include <string.h>
 #include "dinamic_vector.h"
 #include "linkedlist.h"
+#include "trigram.h"
+#include "aggregate.h"
+#include "archive.h"
+#include "batch.h"
+#include "query.h"
+#include "cursor.h"
+#include "extsort.h"
+#include "ingest.h"
+#include "memstat.h"
+#include "normalize.h"
+#include "schema.h"
+#include "trace.h"
+#include "delta.h"
+#include "snapshot.h"
 
 /**
  * Print the main menu options for the Hospital Patient Management System
@@ -17,52 +31,134 @@ void print_menu(){
     printf("4 - Adicionar pacientes\n");
     printf("5 - Imprimir todos os pacientes\n");
     printf("6 - Limpar terminal\n");
+    printf("7 - Estatísticas\n");
+    printf("8 - Filtrar pacientes\n");
+    printf("9 - Importar pacientes de um CSV\n");
+    printf("10 - Mesclar arquivo externo grande (ordenação externa)\n");
+    printf("11 - Relatório de uso de memória\n");
+    printf("12 - Pontos de restauração (desfazer alterações)\n");
     printf("Q - Sair do sistema\n");
 }
 
 /**
- * Format CPF from digits-only string to XXX.XXX.XXX-XX format
- * If input already has formatting, returns it as-is
- * If input has exactly 11 digits, formats it properly
+ * Show the rows matching a consult 10 at a time, asking before each new page.
+ * Returns the number of pages shown.
  */
-void format_cpf(char *cpf) {
-    // Only format if we have exactly 11 digits (no formatting)
-    if (strlen(cpf) == 11) {
-        char formatted[15];
-        int format_idx, digit_idx = 0;
-        for (format_idx = 0; format_idx < 14; format_idx++) {
-            if (format_idx == 3 || format_idx == 7) {
-                formatted[format_idx] = '.';
-            } else if (format_idx == 11) {
-                formatted[format_idx] = '-';
-            } else {
-                formatted[format_idx] = cpf[digit_idx++];
-            }
+int consult_paged(struct Dinamic_Vector *dv, int column, int substring, const char *search) {
+    const int page_size = TRACE_PAGE_ROWS;
+    char answer[10];
+    struct Consult_Cursor *cursor = cursor_open(dv, column, substring, search);
+    if (cursor == NULL) {
+        printf("Erro: Parâmetros inválidos.\n");
+        return 0;
+    }
+
+    schema_print_header(stdout);
+    int total = 0;
+    int pages = 0;
+    for (;;) {
+        dv_hold(dv);  /* shared mode: one page, one epoch (not held while asking) */
+        total += cursor_print_page(cursor, dv, page_size, stdout);
+        pages++;
+        int more = cursor_has_more(cursor, dv);
+        dv_release(dv);
+        if (!more) {
+            break;
+        }
+        printf("[Sistema]\nMostrar mais resultados? (S/N)\n[Usuario]\n");
+        if (scanf("%9s", answer) != 1 || strcasecmp(answer, "S") != 0) {
+            break;
         }
-        formatted[14] = '\0';
-        strcpy(cpf, formatted);
     }
-    // If not 11 digits, leave the original input unchanged
+    if (total == 0) {
+        printf("Nenhum usuário registrado com essas credenciais.\n");
+    }
+    cursor_close(cursor);
+    return pages;
+}
+
+/**
+ * Take the automatic restore point that undoes the change about to be made.
+ * Returns its id, or -1 in modes without snapshots. Every point taken is
+ * settled by undo_settle once the change is done.
+ */
+int undo_point(struct Dinamic_Vector *dv, const char *label) {
+    return snap_take(dv, label, 1);
 }
 
 /**
- * Format date from YYYYMMDD to YYYY-MM-DD format
- * If input already has formatting, returns it as-is
- * If input has exactly 8 digits, formats it properly
+ * End of the change undo point 'id' covers: a point for a change that
+ * applied nothing is dropped (it would only push an older one out);
+ * otherwise the user is told its number.
  */
-void format_date(char *date_input) {
-    // Only format if we have exactly 8 digits (no formatting)
-    if (strlen(date_input) == 8) {
-        char formatted[11];
-        sprintf(formatted, "%.4s-%.2s-%.2s", 
-                date_input,      // YYYY
-                date_input + 4,  // MM  
-                date_input + 6); // DD
-        strcpy(date_input, formatted);
+void undo_settle(struct Dinamic_Vector *dv, int id, int applied) {
+    snap_settle(dv, id, applied);
+    if (id > 0 && applied) {
+        printf("[Sistema]\nPara desfazer: opção 12, ponto %d.\n", id);
     }
 }
 
-int main() {
+/**
+ * Submenu of option 12: create, list, consult and restore snapshots.
+ */
+void snapshot_menu(struct Dinamic_Vector *dv) {
+    char choice[10], line[256];
+    int id;
+    printf("[Sistema]\n");
+    printf("1 - Criar ponto de restauração\n");
+    printf("2 - Listar pontos\n");
+    printf("3 - Filtrar pacientes num ponto (somente leitura)\n");
+    printf("4 - Restaurar a base a um ponto\n");
+    printf("5 - Retornar ao menu principal\n");
+    printf("\n[Usuario]\n");
+    if (scanf("%9s", choice) != 1) {
+        return;
+    }
+    if (strcmp(choice, "1") == 0) {
+        printf("\n[Sistema]\nDigite um rótulo para o ponto:\n[Usuario]\n");
+        scanf(" %255[^\n]", line);
+        id = snap_take(dv, line, 0);
+        if (id < 0) {
+            printf("[Sistema]\nPontos de restauração não disponíveis nos modos paginado e compartilhado.\n");
+        } else {
+            printf("[Sistema]\nPonto de restauração %d criado.\n", id);
+        }
+    } else if (strcmp(choice, "2") == 0) {
+        printf("\n[Sistema]\n");
+        snap_list(dv, stdout);
+    } else if (strcmp(choice, "3") == 0) {
+        printf("\n[Sistema]\nDigite o número do ponto:\n[Usuario]\n");
+        if (scanf("%d", &id) != 1) {
+            id = 0;
+        }
+        printf("\n[Sistema]\nDigite o filtro (como na opção 8):\n[Usuario]\n");
+        scanf(" %255[^\n]", line);
+        struct Dinamic_Vector *view = snap_view(dv, id);
+        if (view == NULL) {
+            printf("[Sistema]\nPonto de restauração %d não existe.\n", id);
+            return;
+        }
+        query_run(view, line, 1, stdout);
+        snap_view_close(dv, view);
+    } else if (strcmp(choice, "4") == 0) {
+        printf("\n[Sistema]\nDigite o número do ponto:\n[Usuario]\n");
+        if (scanf("%d", &id) != 1 || snap_find(dv, id) == NULL) {
+            printf("[Sistema]\nPonto de restauração inexistente.\n");
+            return;
+        }
+        printf("[Sistema]\nAs alterações feitas depois do ponto %d serão desfeitas. Confirma? (S/N)\n[Usuario]\n", id);
+        if (scanf("%9s", choice) == 1 && strcasecmp(choice, "S") == 0) {
+            snap_restore(dv, id);
+            printf("[Sistema]\nBase restaurada ao ponto %d (%d registro(s)).\n", id, dv_size(dv));
+        } else {
+            printf("[Sistema]\nRestauração cancelada.\n");
+        }
+    } else if (strcmp(choice, "5") != 0) {
+        printf("Opção inválida.\n");
+    }
+}
+
+int main(int argc, char *argv[]) {
     setlocale(LC_ALL, "pt_BR.UTF-8"); // Without this, the program may not handle UTF-8 characters correctly
     system("chcp 65001 > nul");
     
@@ -72,6 +168,79 @@ int main() {
     char search_input[256]; // To store search input in consultation
     char cpf[256], nome[256], idade[256], data[256];
     char confirm[10]; // To confirm updates or deletions
+    int lazy = 0; // --lazy: only index line offsets at startup, parse rows on first access
+    int batch = 0; // --batch: run commands from stdin (see batch.h) and exit without saving
+    int partitioned = 0; // --particoes: one CSV per registration month in part_dir (see partition.h)
+    const char *part_dir = "bd_paciente.d";
+    int paged_frames = 0; // --paginado[=N]: rows stay on disk, read through a pool of N pages (see bufpool.h)
+    const char *shm_name = NULL; // --compartilhado[=nome]: rows live in a shared-memory segment (see shm_store.h)
+    const char *archive_path = NULL; // --compactado=arquivo: load the rows from a compressed archive (see archive.h)
+    const char *trace_path = NULL; // --gravar=arquivo: record the session's operations (see trace.h)
+    const char *delta_path = NULL; // --delta[=arquivo]: publish the saved changes (see delta.h)
+    long long delta_from = -1; // --delta-desde=N / --delta-seguir=N: print the changes after N and exit (or follow)
+    int delta_follow = 0;
+    char pages_text[16], id_text[16]; // trace arguments
+    long long issued; // trace time of the current operation
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--lazy") == 0) {
+            lazy = 1;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = 1;
+        } else if (strcmp(argv[i], "--particoes") == 0) {
+            partitioned = 1;
+        } else if (strncmp(argv[i], "--compartilhado", 15) == 0) {
+            shm_name = (argv[i][15] == '=') ? argv[i] + 16 : "/hpms_bd_paciente";
+        } else if (strncmp(argv[i], "--remover-segmento", 18) == 0) {
+            const char *name = (argv[i][18] == '=') ? argv[i] + 19 : "/hpms_bd_paciente";
+            if (shm_destroy(name) != 0) {
+                printf("Segmento %s não encontrado.\n", name);
+                return 1;
+            }
+            printf("Segmento %s removido.\n", name);
+            return 0;
+        } else if (strncmp(argv[i], "--delta-desde=", 14) == 0) {
+            delta_from = atoll(argv[i] + 14);
+        } else if (strncmp(argv[i], "--delta-seguir=", 15) == 0) {
+            delta_from = atoll(argv[i] + 15);
+            delta_follow = 1;
+        } else if (strncmp(argv[i], "--delta", 7) == 0) {
+            delta_path = (argv[i][7] == '=') ? argv[i] + 8 : "bd_paciente.delta";
+        } else if (strncmp(argv[i], "--compactado=", 13) == 0) {
+            archive_path = argv[i] + 13;
+        } else if (strncmp(argv[i], "--gravar=", 9) == 0) {
+            trace_path = argv[i] + 9;
+        } else if (strncmp(argv[i], "--paginado", 10) == 0) {
+            paged_frames = (argv[i][10] == '=') ? atoi(argv[i] + 11) : 0;
+            if (paged_frames <= 0) {
+                paged_frames = 1024; // 4 MiB of pages
+            }
+        }
+    }
+    if (delta_from >= 0) {
+        const char *path = (delta_path != NULL) ? delta_path : "bd_paciente.delta";
+        if (delta_tail(path, delta_from, delta_follow, stdout) != 0) {
+            printf("Não foi possível ler o arquivo de alterações %s.\n", path);
+            return 1;
+        }
+        return 0;
+    }
+    if (archive_path != NULL) {
+        shm_name = NULL; // the archive is decoded into memory, like an eager CSV load
+        partitioned = 0;
+        paged_frames = 0;
+        lazy = 0;
+    }
+    if (shm_name != NULL) {
+        partitioned = 0;
+        paged_frames = 0;
+        lazy = 1; // rows are read from the segment on access; the loader already checked the file
+    } else if (partitioned) {
+        lazy = 0; // partitions are loaded eagerly, in parallel
+        paged_frames = 0;
+    } else if (paged_frames > 0) {
+        lazy = 1; // like lazy mode, rows are parsed on access and checks are deferred
+    }
 
     /* Step 1: Create the dynamic vector */
     struct Dinamic_Vector *BDPaciente = dv_create();  // exit(1) on failure, but dv_create never returns NULL */
@@ -80,11 +249,62 @@ int main() {
     }
 
     /* Step 2: Read CSV into patient_db (each row → one LinkedList of heterogeneous fields) */
-    if (dv_read_from_csv(BDPaciente, filename) != 0) {
-        dv_free(BDPaciente);
+    struct Arc_Stats arc_stats;
+    int load_status = archive_path != NULL ? arc_read(BDPaciente, archive_path, &arc_stats)
+                    : shm_name != NULL ? shm_load(BDPaciente, shm_name, filename)
+                    : partitioned ? part_open(BDPaciente, part_dir, filename)
+                    : paged_frames > 0 ? dv_read_from_csv_paged(BDPaciente, filename, paged_frames, 4 * paged_frames)
+                    : lazy ? dv_read_from_csv_lazy(BDPaciente, filename)
+                           : dv_read_from_csv(BDPaciente, filename);
+    if (load_status != 0) {
+        if (archive_path != NULL) {
+            printf("Erro ao ler o arquivo compactado %s.\n", archive_path);
+        }
+        dv_free_all(BDPaciente);
         return 1;
     }
 
+    if (batch) {
+        int status = batch_run(BDPaciente, stdin, stdout);
+        dv_free_all(BDPaciente);
+        return status;
+    }
+
+    if (archive_path != NULL) {
+        printf("[Sistema]\nBase carregada de %s:\n", archive_path);
+        arc_report(&arc_stats, stdout);
+        printf("\n");
+    }
+
+    /* Step 3: Check the CPF uniqueness constraint and the CPF/date contents over the loaded rows.
+       In lazy mode this is deferred to the first insert/update. */
+    if (!lazy) {
+        int conflicts = dv_report_cpf_conflicts(BDPaciente, stdout);
+        if (conflicts > 0) {
+            printf("[Sistema]\nAtenção: %d registro(s) com CPF duplicado no arquivo.\n\n", conflicts);
+        }
+        int invalid = dv_validate(BDPaciente, stdout, 20);
+        if (invalid > 0) {
+            printf("[Sistema]\nAtenção: %d registro(s) com CPF ou data inválidos no arquivo.\n\n", invalid);
+        }
+    }
+
+    if (delta_path != NULL) {
+        // Each record names its row by CPF: the feed needs CPFs that are set and unique
+        int ambiguous = dv_cpf_ambiguous(BDPaciente);
+        if (ambiguous > 0) {
+            printf("[Sistema]\nFeed de alterações desativado: %d registro(s) com CPF vazio ou repetido "
+                   "(o feed identifica cada registro pelo CPF).\n\n", ambiguous);
+        } else if ((BDPaciente->delta = delta_open(delta_path)) == NULL) {
+            printf("[Sistema]\nNão foi possível abrir o arquivo de alterações %s.\n\n", delta_path);
+        }
+    }
+
+    struct Trace_Writer *trace = NULL;
+    if (trace_path != NULL && (trace = trace_open(trace_path)) == NULL) {
+        printf("[Sistema]\nNão foi possível gravar a sessão em %s.\n\n", trace_path);
+    }
+
     printf("HealthSys Log in!\n");
     printf("\n");
     printf("Bem Vindo ao sistema de gerenciamento de clientes!\n");
@@ -93,7 +313,12 @@ int main() {
     while (strcasecmp(user_choice, "Q") != 0) {
         printf("\n");
         printf("[Usuario]\n");
-        scanf("%s", user_choice);
+        if (scanf("%s", user_choice) != 1) {
+            strcpy(user_choice, "Q"); // end of input (scripted session): leave as with Q
+        }
+        if (dv_sync(BDPaciente)) {
+            printf("[Sistema]\nDados atualizados por outro processo.\n");
+        }
         
         if (strcmp(user_choice, "1") == 0) {
             printf("\nConsultando pacientes...\n");
@@ -102,19 +327,38 @@ int main() {
             printf("Escolha o modo de consulta:\n");
             printf("1 - Por nome\n");
             printf("2 - Por CPF\n");
-            printf("3 - Retornar ao menu principal\n");
+            printf("3 - Por trecho do nome\n");
+            printf("4 - Busca aproximada por nome\n");
+            printf("5 - Retornar ao menu principal\n");
             printf("\n[Usuario]\n");
             scanf("%s", user_choice);
 
             if (strcmp(user_choice, "1") == 0) {
                 printf("\n[Sistema]\nDigite o nome:\n[Usuario]\n");
-                scanf("%s", search_input);
-                dv_consult_by_field(BDPaciente, search_input, 2); // Name is in column 2
+                scanf(" %255[^\n]", search_input); // whole line: names have spaces
+                issued = trace_now(trace);
+                snprintf(pages_text, sizeof(pages_text), "%d", consult_paged(BDPaciente, PC_NOME, 0, search_input));
+                trace_add(trace, issued, TR_CONSULTA_NOME, 2, search_input, pages_text);
             } else if (strcmp(user_choice, "2") == 0) {
                 printf("\n[Sistema]\nDigite o CPF:\n[Usuario]\n");
                 scanf("%s", search_input);
-                dv_consult_by_field(BDPaciente, search_input, 1); // CPF is in column 1
+                issued = trace_now(trace);
+                snprintf(pages_text, sizeof(pages_text), "%d", consult_paged(BDPaciente, PC_CPF, 0, search_input));
+                trace_add(trace, issued, TR_CONSULTA_CPF, 2, search_input, pages_text);
             } else if (strcmp(user_choice, "3") == 0) {
+                printf("\n[Sistema]\nDigite parte do nome:\n[Usuario]\n");
+                scanf(" %255[^\n]", search_input);
+                issued = trace_now(trace);
+                snprintf(pages_text, sizeof(pages_text), "%d", consult_paged(BDPaciente, PC_NOME, 1, search_input));
+                trace_add(trace, issued, TR_CONSULTA_TRECHO, 2, search_input, pages_text);
+            } else if (strcmp(user_choice, "4") == 0) {
+                printf("\n[Sistema]\nDigite o nome (mesmo com erros de digitação):\n[Usuario]\n");
+                scanf(" %255[^\n]", search_input);
+                trace_add(trace, trace_now(trace), TR_CONSULTA_APROX, 1, search_input);
+                dv_hold(BDPaciente);
+                tri_consult(BDPaciente, search_input, 5, stdout); // 5 closest names
+                dv_release(BDPaciente);
+            } else if (strcmp(user_choice, "5") == 0) {
                 continue; // Return to main menu
                 print_menu(); // If this isn't here may cause confusion for the user
             } else {
@@ -138,15 +382,36 @@ int main() {
             fgets(idade, sizeof(idade), stdin); idade[strcspn(idade, "\n")] = 0;
             fgets(data, sizeof(data), stdin); data[strcspn(data, "\n")] = 0;
 
+            // Same rules as option 4: digits-only CPF and date are formatted
+            int bad = normalize_update(cpf, data);
+            if (bad != 0) {
+                printf("[Sistema]\n%s. Atualização cancelada.\n", (bad & VALID_BAD_CPF) ? "CPF inválido" : "Data inválida");
+                ll_free(preview);
+                continue;
+            }
+
             ll_update_fields(preview, cpf, nome, idade, data);
 
             printf("[Sistema]\nConfirma os novos valores para o registro abaixo? (S/N)\n");
-            printf("ID CPF Nome Idade Data_Cadastro\n");
+            schema_print_header(stdout);
             ll_print(preview);
             fgets(confirm, sizeof(confirm), stdin);
             if (strcasecmp(confirm, "S\n") == 0 || strcasecmp(confirm, "S") == 0) {
-                ll_update_fields(row, cpf, nome, idade, data);
-                printf("[Sistema]\nRegistro atualizado com sucesso.\n");
+                snprintf(id_text, sizeof(id_text), "%d", id);
+                trace_add(trace, trace_now(trace), TR_ATUALIZA, 5, id_text, cpf, nome, idade, data);
+                snprintf(search_input, sizeof(search_input), "antes de atualizar o ID %d", id);
+                int point = undo_point(BDPaciente, search_input);
+                int status = dv_update(BDPaciente, id - 1, cpf, nome, idade, data);
+                undo_settle(BDPaciente, point, status == 0);
+                if (status == 0) {
+                    printf("[Sistema]\nRegistro atualizado com sucesso.\n");
+                } else if (status == 2) {
+                    printf("[Sistema]\nOs dados foram alterados por outro processo (ou o segmento está cheio). Atualização cancelada.\n");
+                } else if (cpf[0] == '\0' && BDPaciente->delta != NULL) {
+                    printf("[Sistema]\nCom o feed de alterações ativo o CPF é obrigatório. Atualização cancelada.\n");
+                } else {
+                    printf("[Sistema]\nJá existe um paciente com este CPF. Atualização cancelada.\n");
+                }
             } else {
                 printf("[Sistema]\nAtualização cancelada.\n");
             }
@@ -162,12 +427,21 @@ int main() {
             }
             struct LinkedList *row = dv_get(BDPaciente, id - 1);
             printf("[Sistema]\nTem certeza de que deseja excluir o registro abaixo? (S/N)\n");
-            printf("ID CPF Nome Idade Data_Cadastro\n");
+            schema_print_header(stdout);
             ll_print(row);
             fgets(user_choice, sizeof(user_choice), stdin);
             if (strcasecmp(user_choice, "S\n") == 0 || strcasecmp(user_choice, "S") == 0) {
-                dv_remove(BDPaciente, id - 1);
-                printf("[Sistema]\nRegistro removido com sucesso.\n");
+                snprintf(id_text, sizeof(id_text), "%d", id);
+                trace_add(trace, trace_now(trace), TR_REMOVE, 1, id_text);
+                snprintf(search_input, sizeof(search_input), "antes de remover o ID %d", id);
+                int point = undo_point(BDPaciente, search_input);
+                int status = dv_remove(BDPaciente, id - 1);
+                undo_settle(BDPaciente, point, status == 0);
+                if (status == 0) {
+                    printf("[Sistema]\nRegistro removido com sucesso.\n");
+                } else {
+                    printf("[Sistema]\nOs dados foram alterados por outro processo. Remoção cancelada.\n");
+                }
             } else {
                 printf("[Sistema]\nRemoção cancelada.\n");
             }
@@ -186,6 +460,23 @@ int main() {
             
             // Format CPF if user entered only digits
             format_cpf(cpf);
+            if (valid_row(cpf, NULL) != 0) {
+                printf("[Sistema]\nCPF inválido (dígitos verificadores não conferem). Inserção cancelada.\n");
+                print_menu();
+                continue;
+            }
+            if (cpf[0] == '\0' && BDPaciente->delta != NULL) {
+                printf("[Sistema]\nCom o feed de alterações ativo o CPF é obrigatório. Inserção cancelada.\n");
+                print_menu();
+                continue;
+            }
+
+            int existing = dv_find_cpf(BDPaciente, cpf);
+            if (existing >= 0) {
+                printf("[Sistema]\nJá existe um paciente com este CPF (ID %d). Inserção cancelada.\n", existing + 1);
+                print_menu();
+                continue;
+            }
             
             printf("Nome: ");
             fgets(nome, sizeof(nome), stdin);
@@ -199,13 +490,24 @@ int main() {
             fgets(data, sizeof(data), stdin);
             data[strcspn(data, "\n")] = 0; // Remove newline
             format_date(data);
+            if (valid_row(NULL, data) != 0) {
+                printf("[Sistema]\nData inválida. Inserção cancelada.\n");
+                print_menu();
+                continue;
+            }
 
-            int id = dv_size(BDPaciente) + 1;
-            int idade_int = atoi(idade);
-            struct LinkedList *new_row = ll_create_from_fields(id, cpf, nome, idade_int, data);
+            char id[16];
+            snprintf(id, sizeof(id), "%d", dv_size(BDPaciente) + 1);
+            const char *vals[PC_COUNT] = {NULL};
+            vals[PC_ID] = id;
+            vals[PC_CPF] = cpf;
+            vals[PC_NOME] = nome;
+            vals[PC_IDADE] = idade;
+            vals[PC_DATA] = data;
+            struct LinkedList *new_row = schema_row_from_texts(vals);
 
             printf("\n[Sistema]\nConfirma a inserção do registro abaixo? (S/N)\n");
-            printf("ID CPF Nome Idade Data_Cadastro\n");
+            schema_print_header(stdout);
             ll_print(new_row);
             
             printf("\n[Usuario]\n");
@@ -213,8 +515,17 @@ int main() {
             user_choice[strcspn(user_choice, "\n")] = 0; // Remove newline
             
             if (strcasecmp(user_choice, "S") == 0) {
-                dv_insert(BDPaciente, new_row);
-                printf("[Sistema]\nO registro foi inserido com sucesso.\n");
+                trace_add(trace, trace_now(trace), TR_INSERE, 4, cpf, nome, idade, data);
+                int point = undo_point(BDPaciente, "antes de inserir");
+                int status = dv_insert_unique(BDPaciente, new_row);
+                undo_settle(BDPaciente, point, status == 0);
+                if (status == 0) {
+                    printf("[Sistema]\nO registro foi inserido com sucesso.\n");
+                } else {
+                    ll_free(new_row);
+                    printf(status == 2 ? "[Sistema]\nOs dados foram alterados por outro processo (ou o segmento está cheio). Inserção cancelada.\n"
+                                       : "[Sistema]\nJá existe um paciente com este CPF. Inserção cancelada.\n");
+                }
             } else {
                 ll_free(new_row);
                 printf("[Sistema]\nInserção cancelada.\n");
@@ -222,16 +533,84 @@ int main() {
 
         } else if (strcmp(user_choice, "5") == 0) {
             printf("\nImprimindo todos os pacientes...\n");
+            trace_add(trace, trace_now(trace), TR_IMPRIME, 0);
+            dv_hold(BDPaciente);  // shared mode: the whole listing sees one epoch
             dv_print_all(BDPaciente);  // This will print all rows
+            dv_release(BDPaciente);
         } else if (strcasecmp(user_choice, "6") == 0) {
             system("clear"); // Hopefully it works on linux
+        } else if (strcmp(user_choice, "7") == 0) {
+            printf("\n[Sistema]\nDigite a agregação: <count|min|max|avg|sum> <id|idade|data> [by <idade|mes>]\n");
+            printf("Exemplos: avg idade | count data by mes | max idade by idade\n[Usuario]\n");
+            scanf(" %255[^\n]", search_input);
+            trace_add(trace, trace_now(trace), TR_ESTATISTICA, 1, search_input);
+            dv_hold(BDPaciente);
+            agg_run(BDPaciente, search_input, 1, stdout);
+            dv_release(BDPaciente);
+        } else if (strcmp(user_choice, "8") == 0) {
+            printf("\n[Sistema]\nDigite o filtro (colunas id, cpf, nome, idade, data; operadores = != < <= > >= ^= ~=; AND, OR, NOT):\n");
+            printf("Exemplo: idade>=60 AND nome^=\"Maria\" AND data>=2024-12-01\n[Usuario]\n");
+            scanf(" %255[^\n]", search_input);
+            trace_add(trace, trace_now(trace), TR_FILTRA, 1, search_input);
+            dv_hold(BDPaciente);
+            query_run(BDPaciente, search_input, 1, stdout);
+            dv_release(BDPaciente);
+        } else if (strcmp(user_choice, "9") == 0) {
+            printf("\n[Sistema]\nDigite o caminho do arquivo CSV (mesmo formato de bd_paciente.csv):\n[Usuario]\n");
+            scanf(" %255[^\n]", search_input);
+            printf("[Sistema]\n");
+            trace_add(trace, trace_now(trace), TR_IMPORTA, 1, search_input);
+            int before = dv_size(BDPaciente);  /* the import only appends rows */
+            int point = undo_point(BDPaciente, "antes de importar");
+            if (ingest_import_csv(BDPaciente, search_input, 0, 1, stdout) != 0) {
+                printf("Erro ao ler o arquivo %s.\n", search_input);
+            }
+            undo_settle(BDPaciente, point, dv_size(BDPaciente) > before);
+        } else if (strcmp(user_choice, "10") == 0) {
+            struct Ext_Import_Stats st;
+            printf("\n[Sistema]\nDigite o caminho do arquivo CSV (mesmo formato de bd_paciente.csv):\n[Usuario]\n");
+            scanf(" %255[^\n]", search_input);
+            printf("[Sistema]\n");
+            trace_add(trace, trace_now(trace), TR_MESCLA, 1, search_input);
+            int before = dv_size(BDPaciente);  /* the merge only appends rows */
+            int point = undo_point(BDPaciente, "antes de mesclar");
+            if (ext_import_csv(BDPaciente, search_input, 0, &st, stdout) != 0) {
+                printf("Erro ao ler o arquivo %s ou ao gravar arquivos temporários.\n", search_input);
+            } else {
+                ext_report(&st, stdout);
+            }
+            undo_settle(BDPaciente, point, dv_size(BDPaciente) > before);
+        } else if (strcmp(user_choice, "11") == 0) {
+            struct Mem_Report mr;
+            trace_add(trace, trace_now(trace), TR_MEMORIA, 0);
+            mem_measure(BDPaciente, &mr);
+            printf("\n[Sistema]\n");
+            mem_report(&mr, stdout);
+        } else if (strcmp(user_choice, "12") == 0) {
+            snapshot_menu(BDPaciente);
         } else if (strcasecmp(user_choice, "Q") == 0) {
             printf("\nSaindo do sistema...\n");
-            // Save data to CSV before exiting
-            if (dv_write_to_csv(BDPaciente, filename) != 0) {
+            // Save data to CSV before exiting (partitioned: only the months that changed)
+            int written = 0;
+            if (partitioned ? part_save(BDPaciente, &written) != 0
+                            : dv_write_to_csv(BDPaciente, filename) != 0) {
                 printf("Erro ao salvar dados no arquivo.\n");
             } else {
-                printf("Dados salvos com sucesso.\n");
+                if (partitioned) {
+                    printf("Dados salvos com sucesso (%d partição(ões) regravada(s)).\n", written);
+                } else {
+                    printf("Dados salvos com sucesso.\n");
+                }
+                // The saved changes go out on the delta feed only now
+                int sent = delta_commit(BDPaciente->delta);
+                if (sent > 0) {
+                    printf("%d alteração(ões) publicada(s) em %s.\n", sent, delta_path);
+                } else if (sent < 0) {
+                    printf("Erro ao gravar o arquivo de alterações %s.\n", delta_path);
+                }
+            }
+            if (paged_frames > 0) {
+                pool_report(BDPaciente->pool, BDPaciente->row_cache, stdout);
             }
         } else {
             printf("Opção inválida, tente novamente.\n");
@@ -241,6 +620,8 @@ int main() {
         print_menu(); // Print the menu again after each operation
     }
     
+    trace_close(trace);
+
     /* Step 4: Free each LinkedList inside patient_db, then free patient_db itself */
     dv_free_all(BDPaciente);
 
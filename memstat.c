@@ -0,0 +1,346 @@
+#include "memstat.h"
+#include "dinamic_vector.h"
+#include "fold.h"
+#include "schema.h"
+#include "slab.h"
+#include <string.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+/* Bookkeeping word glibc keeps in front of every chunk */
+#define MEM_CHUNK_HEADER sizeof(size_t)
+
+static const char *const part_names[MEM_PARTS] = {
+    "Vetor (ponteiros e offsets)",
+    "Cabeçalhos de lista",
+    "Nós (ListNode)",
+    "Strings dos campos",
+    "Chaves de nome",
+    "Índice de CPF",
+    "Índice de trigramas",
+    "Colunas int",
+    "Partições",
+    "Páginas (buffer pool)",
+    "Texto do CSV (lazy)",
+    "Validação",
+    "Alterações pendentes",
+    "Pontos de restauração",
+    "Slabs (espaço livre)",
+};
+
+/*
+ * Account one heap block of 'requested' bytes at 'p' (ignored if NULL).
+ */
+static void mem_add(struct Mem_Usage *u, const void *p, size_t requested) {
+    if (p == NULL) {
+        return;
+    }
+    u->blocks++;
+    u->requested += requested;
+#if defined(__GLIBC__)
+    u->usable += malloc_usable_size((void *)p);
+    u->headers += MEM_CHUNK_HEADER;
+#else
+    u->usable += requested;
+#endif
+}
+
+/*
+ * Account one object of slab class 'cls' (a heap block if pools are off).
+ */
+static void mem_add_pooled(struct Mem_Usage *u, int cls, const void *p, size_t requested) {
+#if SLAB_POOLED
+    if (p == NULL) {
+        return;
+    }
+    u->blocks++;
+    u->requested += requested;
+    u->usable += slab_class_size(cls);
+#else
+    (void)cls;
+    mem_add(u, p, requested);
+#endif
+}
+
+/*
+ * Account a string from slab_str_alloc: its class, or the malloc block
+ * starting at the class byte.
+ */
+static void mem_add_str(struct Mem_Usage *u, const char *s, size_t requested) {
+    if (s == NULL) {
+        return;
+    }
+    int cls = slab_str_class(s);
+    if (cls < 0) {
+        mem_add(u, s - 1, requested);
+    } else {
+        mem_add_pooled(u, cls, s - 1, requested);
+    }
+}
+
+/*
+ * Account the blocks of one row: header, nodes, strings and name key.
+ */
+static void mem_row(const struct LinkedList *row, struct Mem_Usage *headers, struct Mem_Usage *nodes,
+                    struct Mem_Usage *strings, struct Mem_Usage *keys) {
+    mem_add_pooled(headers, SLAB_ROW, row, sizeof(struct LinkedList));
+    const char *nome = NULL;
+    int col = 0;
+    for (const struct ListNode *node = row->first; node != NULL; node = node->next, col++) {
+        mem_add_pooled(nodes, SLAB_NODE, node, sizeof(struct ListNode));
+        if (node->field.type == FIELD_STRING && node->field.s != NULL) {
+            mem_add_str(strings, node->field.s, strlen(node->field.s) + 1);
+            if (col == PC_NOME) {
+                nome = node->field.s;
+            }
+        }
+    }
+    mem_add_str(keys, row->key, FOLD_KEY_CAP(nome != NULL ? strlen(nome) : 0));
+}
+
+static void mem_rows(const struct Dinamic_Vector *dv, struct Mem_Report *r) {
+    for (int i = 0; i < dv->n; i++) {
+        const struct LinkedList *row = dv->v[i];
+        if (row == NULL) {
+            continue;  /* not parsed yet, or evicted */
+        }
+        r->resident++;
+        mem_row(row, &r->part[MEM_ROW_HEADERS], &r->part[MEM_NODES], &r->part[MEM_STRINGS], &r->part[MEM_KEYS]);
+    }
+}
+
+/*
+ * Snapshots: their arrays, plus every detached row once (a row can sit in
+ * chunks of several snapshots; SNAP_ROW_MARK flags the ones counted).
+ */
+static void mem_snapshots(const struct Dinamic_Vector *dv, struct Mem_Report *r) {
+    const struct Snapshot_Set *set = dv->snaps;
+    if (set == NULL) {
+        return;
+    }
+    struct Mem_Usage *u = &r->part[MEM_SNAPSHOTS];
+    mem_add(u, set, sizeof(struct Snapshot_Set));
+    mem_add(u, set->s, sizeof(struct Snapshot) * (size_t)set->cap);
+    for (int pass = 0; pass < 2; pass++) {
+        for (int k = 0; k < set->n; k++) {
+            const struct Snapshot *s = &set->s[k];
+            if (pass == 0) {
+                mem_add(u, s->ids, sizeof(long long) * (size_t)(s->n > 0 ? s->n : 1));
+                mem_add(u, s->chunks, sizeof(struct LinkedList **) * (size_t)s->n_chunks);
+            }
+            for (int c = 0; s->chunks != NULL && c < s->n_chunks; c++) {
+                struct LinkedList **chunk = s->chunks[c];
+                if (chunk == NULL) {
+                    continue;
+                }
+                if (pass == 0) {
+                    mem_add(u, chunk, sizeof(struct LinkedList *) * SNAP_CHUNK_ROWS);
+                }
+                for (int j = 0; j < SNAP_CHUNK_ROWS; j++) {
+                    struct LinkedList *row = chunk[j];
+                    if (row == NULL || !(row->flags & SNAP_ROW_DETACHED)) {
+                        continue;
+                    }
+                    if (pass == 1) {
+                        row->flags &= ~SNAP_ROW_MARK;
+                    } else if (!(row->flags & SNAP_ROW_MARK)) {
+                        row->flags |= SNAP_ROW_MARK;
+                        mem_row(row, u, u, u, u);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Slabs: the bytes of every slab not taken by an object in use. Objects in
+ * other threads' caches count as in use (see slab_stats).
+ */
+static void mem_slabs(struct Mem_Report *r) {
+#if SLAB_POOLED
+    struct Slab_Stats st;
+    slab_stats(&st);
+    struct Mem_Usage *u = &r->part[MEM_SLAB_FREE];
+    for (int cls = 0; cls < SLAB_CLASSES; cls++) {
+        if (st.slabs[cls] == 0) {
+            continue;
+        }
+        u->blocks += st.slabs[cls];
+        u->usable += st.slabs[cls] * SLAB_BYTES - st.in_use[cls] * st.size[cls];
+#if defined(__GLIBC__)
+        u->headers += st.slabs[cls] * MEM_CHUNK_HEADER;
+#endif
+    }
+#else
+    (void)r;
+#endif
+}
+
+static void mem_indexes(const struct Dinamic_Vector *dv, struct Mem_Report *r) {
+    const struct Cpf_Index *ix = dv->cpf_idx;
+    if (ix != NULL) {
+        struct Mem_Usage *u = &r->part[MEM_CPF_INDEX];
+        mem_add(u, ix, sizeof(struct Cpf_Index));
+        mem_add(u, ix->keys, sizeof(unsigned long long) * (size_t)ix->cap);
+        mem_add(u, ix->rows, sizeof(int) * (size_t)ix->cap);
+        mem_add(u, ix->bloom, ix->bloom_bits / 8);
+    }
+    const struct Trigram_Index *tri = dv->tri_idx;
+    if (tri != NULL) {
+        struct Mem_Usage *u = &r->part[MEM_TRIGRAM];
+        int total = tri->start[TRI_CODES];
+        mem_add(u, tri, sizeof(struct Trigram_Index));
+        mem_add(u, tri->start, sizeof(int) * (TRI_CODES + 1));
+        mem_add(u, tri->post, sizeof(int) * (size_t)(total > 0 ? total : 1));
+        mem_add(u, tri->head, sizeof(int) * TRI_CODES);
+        mem_add(u, tri->link, sizeof(int) * (size_t)tri->links_cap);
+        mem_add(u, tri->link_entry, sizeof(int) * (size_t)tri->links_cap);
+        mem_add(u, tri->entry_row, sizeof(int) * (size_t)tri->entries_cap);
+        mem_add(u, tri->entry_tris, sizeof(unsigned short) * (size_t)tri->entries_cap);
+        mem_add(u, tri->row_entry, sizeof(int) * (size_t)tri->rows_cap);
+    }
+    const struct Int_Columns *c = dv->cols;
+    if (c != NULL) {
+        struct Mem_Usage *u = &r->part[MEM_COLUMNS];
+        size_t col_bytes = sizeof(int) * (size_t)(c->n > 0 ? c->n : 1);
+        mem_add(u, c, sizeof(struct Int_Columns));
+        mem_add(u, c->id, col_bytes);
+        mem_add(u, c->idade, col_bytes);
+        mem_add(u, c->data, col_bytes);
+        mem_add(u, c->zones, sizeof(struct Col_Zone) * (size_t)(c->n / COL_ZONE_MIN_ROWS + 1));
+    }
+    const struct Partition_Set *ps = dv->parts;
+    if (ps != NULL) {
+        struct Mem_Usage *u = &r->part[MEM_PARTITIONS];
+        mem_add(u, ps, sizeof(struct Partition_Set));
+        mem_add(u, ps->dir, strlen(ps->dir) + 1);
+        mem_add(u, ps->p, sizeof(struct Partition) * (size_t)ps->n_max);
+    }
+    const struct Buffer_Pool *pool = dv->pool;
+    if (pool != NULL) {
+        struct Mem_Usage *u = &r->part[MEM_PAGES];
+        size_t frames = (size_t)pool->n_frames;
+        mem_add(u, pool, sizeof(struct Buffer_Pool));
+        mem_add(u, pool->frames, frames * POOL_PAGE_SIZE);
+        mem_add(u, pool->frame_page, sizeof(long) * frames);
+        mem_add(u, pool->frame_len, sizeof(int) * frames);
+        mem_add(u, pool->frame_ref, frames);
+        mem_add(u, pool->chain, sizeof(int) * frames);
+        mem_add(u, pool->bucket, sizeof(int) * (size_t)pool->n_buckets);
+        mem_add(u, pool->line, pool->line_cap);
+    }
+    const struct Row_Cache *rc = dv->row_cache;
+    if (rc != NULL) {
+        struct Mem_Usage *u = &r->part[MEM_PAGES];
+        mem_add(u, rc, sizeof(struct Row_Cache));
+        mem_add(u, rc->ring, sizeof(int) * (size_t)rc->cap);
+        mem_add(u, rc->ref, (size_t)rc->ref_cap);
+    }
+    const struct Valid_Rows *vr = dv->checked;
+    if (vr != NULL) {
+        struct Mem_Usage *u = &r->part[MEM_CHECKS];
+        mem_add(u, vr, sizeof(struct Valid_Rows));
+        mem_add(u, vr->rows, sizeof(int) * (size_t)vr->cap);
+    }
+    const struct Delta_Log *log = dv->delta;
+    if (log != NULL) {
+        struct Mem_Usage *u = &r->part[MEM_DELTA];
+        mem_add(u, log, sizeof(struct Delta_Log));
+        mem_add(u, log->buf, log->cap);
+    }
+}
+
+void mem_measure(const struct Dinamic_Vector *dv, struct Mem_Report *r) {
+    memset(r, 0, sizeof(*r));
+    if (dv == NULL) {
+        return;
+    }
+    r->rows = dv->n;
+    struct Mem_Usage *u = &r->part[MEM_VECTOR];
+    mem_add(u, dv, sizeof(struct Dinamic_Vector));
+    mem_add(u, dv->v, sizeof(struct LinkedList *) * (size_t)dv->n_max);
+    mem_add(u, dv->src_off, sizeof(long) * (size_t)dv->n_max);
+    mem_add(&r->part[MEM_SOURCE], dv->src, dv->src_size);
+    mem_rows(dv, r);
+    mem_indexes(dv, r);
+    mem_snapshots(dv, r);
+    mem_slabs(r);
+    if (dv->shm != NULL) {
+        r->shared = dv->shm->size;
+    }
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    r->heap_known = 1;
+    r->heap_arena = mi.arena;
+    r->heap_in_use = mi.uordblks + mi.hblkhd;
+    r->heap_free = mi.fordblks;
+    r->heap_mmapped = mi.hblkhd;
+#endif
+}
+
+/* Bytes a part really takes from the heap: usable bytes plus chunk headers */
+static size_t part_footprint(const struct Mem_Usage *u) {
+    return u->usable + u->headers;
+}
+
+/* printf pads by bytes: widen the field by the UTF-8 continuation bytes */
+static int utf8_extra(const char *s) {
+    int extra = 0;
+    for (; *s != '\0'; s++) {
+        extra += ((unsigned char)*s & 0xC0) == 0x80;
+    }
+    return extra;
+}
+
+static double pct(size_t part, size_t whole) {
+    return whole > 0 ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+void mem_report(const struct Mem_Report *r, FILE *out) {
+    struct Mem_Usage total = {0, 0, 0, 0};
+    size_t total_footprint = 0;
+    fprintf(out, "%-28s %10s %14s %12s %14s\n", "Estrutura", "Blocos", "Solicitado", "Sobrecarga", "Total");
+    for (int k = 0; k < MEM_PARTS; k++) {
+        const struct Mem_Usage *u = &r->part[k];
+        if (u->blocks == 0) {
+            continue;
+        }
+        size_t foot = part_footprint(u);
+        fprintf(out, "%-*s %10zu %14zu %12zu %14zu\n",
+                28 + utf8_extra(part_names[k]), part_names[k],
+                u->blocks, u->requested, foot - u->requested, foot);
+        total.blocks += u->blocks;
+        total.requested += u->requested;
+        total.usable += u->usable;
+        total.headers += u->headers;
+        total_footprint += foot;
+    }
+    fprintf(out, "%-28s %10zu %14zu %12zu %14zu\n", "Total", total.blocks, total.requested,
+            total_footprint - total.requested, total_footprint);
+
+    fprintf(out, "Registros: %d (%d em memória)\n", r->rows, r->resident);
+    if (r->resident > 0) {
+        size_t row_bytes = part_footprint(&r->part[MEM_ROW_HEADERS]) + part_footprint(&r->part[MEM_NODES]) +
+                           part_footprint(&r->part[MEM_STRINGS]) + part_footprint(&r->part[MEM_KEYS]);
+        size_t row_data = r->part[MEM_STRINGS].requested;
+        fprintf(out, "Bytes por registro em memória: %.1f (%.1f de texto útil)\n",
+                (double)row_bytes / r->resident, (double)row_data / r->resident);
+    }
+    if (r->rows > 0) {
+        fprintf(out, "Bytes por registro com vetor, índices e caches: %.1f\n", (double)total_footprint / r->rows);
+    }
+    fprintf(out, "Sobrecarga do alocador: %zu bytes de folga + %zu de cabeçalhos (%.1f%% do total)\n",
+            total.usable - total.requested, total_footprint - total.usable,
+            pct(total_footprint - total.requested, total_footprint));
+    if (r->heap_known) {
+        fprintf(out, "Heap: %zu bytes em uso (%zu via mmap), %zu livres retidos na arena de %zu (fragmentação %.1f%%)\n",
+                r->heap_in_use, r->heap_mmapped, r->heap_free, r->heap_arena, pct(r->heap_free, r->heap_arena));
+    } else {
+        fprintf(out, "Heap: totais do alocador indisponíveis nesta plataforma\n");
+    }
+    if (r->shared > 0) {
+        fprintf(out, "Segmento compartilhado: %zu bytes mapeados (fora do heap)\n", r->shared);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef MEMSTAT_H
+#define MEMSTAT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+struct Dinamic_Vector;
+
+/*
+ * Memory footprint of the store, broken down per structure.
+ *
+ * The report walks the vector and its derived structures when asked (no
+ * counters on the hot paths): for every heap block it adds the bytes the
+ * code requested and, with glibc, the bytes the allocator actually handed
+ * out (malloc_usable_size) plus one chunk header. The difference between
+ * the two is the allocator overhead: slack rounded into each block and the
+ * per-block headers. Row headers, nodes, strings and keys come from the
+ * slab pools (see slab.h): they count at their class size with no header,
+ * and the space of the slabs not handed out is a part of its own. Heap-wide
+ * totals (mallinfo2) give the free space trapped inside the heap, i.e.
+ * fragmentation.
+ */
+
+enum Mem_Part {
+    MEM_VECTOR,       /* the vector: struct, row pointer array, line offsets */
+    MEM_ROW_HEADERS,  /* one struct LinkedList per resident row */
+    MEM_NODES,        /* one struct ListNode per field */
+    MEM_STRINGS,      /* string payloads of the fields */
+    MEM_KEYS,         /* folded name keys (see fold.h) */
+    MEM_CPF_INDEX,
+    MEM_TRIGRAM,
+    MEM_COLUMNS,      /* int column cache and zone maps */
+    MEM_PARTITIONS,
+    MEM_PAGES,        /* buffer pool frames and row cache (paged mode) */
+    MEM_SOURCE,       /* CSV text kept in memory (lazy mode) */
+    MEM_CHECKS,       /* rows that failed validation */
+    MEM_DELTA,        /* change records not yet committed (see delta.h) */
+    MEM_SNAPSHOTS,    /* snapshot chunk copies and the rows only snapshots hold */
+    MEM_SLAB_FREE,    /* slab space not handed out (free lists, thread caches, uncarved) */
+    MEM_PARTS
+};
+
+struct Mem_Usage {
+    size_t blocks;     /* heap blocks and pool objects */
+    size_t requested;  /* bytes asked for */
+    size_t usable;     /* bytes handed out by the allocator (>= requested) */
+    size_t headers;    /* allocator bookkeeping in front of the heap blocks */
+};
+
+struct Mem_Report {
+    struct Mem_Usage part[MEM_PARTS];
+    int rows;               /* rows in the vector */
+    int resident;           /* rows parsed and held in memory */
+    size_t shared;          /* shared segment mapping (not heap), 0 if none */
+    int heap_known;         /* the heap_* fields are filled (glibc only) */
+    size_t heap_arena;      /* main arena obtained from the system */
+    size_t heap_in_use;     /* bytes in allocated chunks, arena + mmap */
+    size_t heap_free;       /* free bytes kept inside the arena */
+    size_t heap_mmapped;    /* large blocks served by mmap */
+};
+
+/**
+ * Fill '*r' with the current footprint of 'dv'.
+ */
+void mem_measure(const struct Dinamic_Vector *dv, struct Mem_Report *r);
+
+/**
+ * Print 'r' as a table per structure, followed by bytes per row, allocator
+ * overhead and heap fragmentation.
+ */
+void mem_report(const struct Mem_Report *r, FILE *out);
+
+#endif /* MEMSTAT_H */
@@ -0,0 +1,416 @@
+#include "normalize.h"
+#include <ctype.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+
+void format_cpf(char *cpf) {
+    // Only format if we have exactly 11 digits (no formatting)
+    if (strlen(cpf) == 11) {
+        char formatted[15];
+        int format_idx, digit_idx = 0;
+        for (format_idx = 0; format_idx < 14; format_idx++) {
+            if (format_idx == 3 || format_idx == 7) {
+                formatted[format_idx] = '.';
+            } else if (format_idx == 11) {
+                formatted[format_idx] = '-';
+            } else {
+                formatted[format_idx] = cpf[digit_idx++];
+            }
+        }
+        formatted[14] = '\0';
+        strcpy(cpf, formatted);
+    }
+    // If not 11 digits, leave the original input unchanged
+}
+
+void format_date(char *date_input) {
+    // Only format if we have exactly 8 digits (no formatting)
+    if (strlen(date_input) == 8) {
+        char formatted[11];
+        sprintf(formatted, "%.4s-%.2s-%.2s", 
+                date_input,      // YYYY
+                date_input + 4,  // MM  
+                date_input + 6); // DD
+        strcpy(date_input, formatted);
+    }
+}
+
+/*
+ * Copy 'in' without surrounding blanks into 'out' (at most 'cap' - 1 bytes).
+ * Returns 1 if it did not fit.
+ */
+static int copy_trimmed(const char *in, char *out, size_t cap) {
+    while (*in == ' ' || *in == '\t') {
+        in++;
+    }
+    size_t len = strlen(in);
+    while (len > 0 && isspace((unsigned char)in[len - 1])) {
+        len--;
+    }
+    int truncated = (len >= cap);
+    if (truncated) {
+        len = cap - 1;
+    }
+    memcpy(out, in, len);
+    out[len] = '\0';
+    return truncated;
+}
+
+/*
+ * Return 1 if 's' matches 'shape', where '9' stands for any digit and every
+ * other character must appear as is.
+ */
+static int has_shape(const char *s, const char *shape) {
+    for (; *shape != '\0'; s++, shape++) {
+        if (*shape == '9' ? !isdigit((unsigned char)*s) : *s != *shape) {
+            return 0;
+        }
+    }
+    return *s == '\0';
+}
+
+int normalize_cpf(const char *in, char out[NORM_CPF_LEN + 1]) {
+    if (in == NULL || copy_trimmed(in, out, NORM_CPF_LEN + 1)) {
+        return 1;
+    }
+    format_cpf(out);
+    return has_shape(out, "999.999.999-99") ? 0 : 1;
+}
+
+int normalize_date(const char *in, char out[NORM_DATE_LEN + 1]) {
+    if (in == NULL || copy_trimmed(in, out, NORM_DATE_LEN + 1)) {
+        return 1;
+    }
+    if (out[0] == '\0') {
+        return 0;
+    }
+    format_date(out);
+    if (!has_shape(out, "9999-99-99")) {
+        return 1;
+    }
+    int month = (out[5] - '0') * 10 + (out[6] - '0');
+    int day = (out[8] - '0') * 10 + (out[9] - '0');
+    return (month >= 1 && month <= 12 && day >= 1 && day <= 31) ? 0 : 1;
+}
+
+void valid_reset(struct Valid_Batch *b) {
+    b->n = 0;
+}
+
+/*
+ * Copy 'text' into slot 'i' of the columns 'col' (byte k into col[k][i],
+ * zero padded) and return its length, or 0 if it cannot be one of the
+ * accepted forms (longer than 15 bytes). text == NULL stages an empty value.
+ */
+static int stage_slot(unsigned char col[16][VALID_BATCH], int i, const char *text) {
+    size_t len = (text != NULL) ? strlen(text) : 0;
+    if (len > 15) {
+        len = 0;
+    }
+    for (size_t k = 0; k < 16; k++) {
+        col[k][i] = (k < len) ? (unsigned char)text[k] : 0;
+    }
+    return (int)len;
+}
+
+int valid_add(struct Valid_Batch *b, const char *cpf, const char *date) {
+    if (b->n == VALID_BATCH) {
+        return -1;
+    }
+    int i = b->n++;
+    b->skip[i] = 0;
+    b->bad[i] = 0;
+    if (cpf == NULL || cpf[0] == '\0') {
+        b->cpf_len[i] = (unsigned char)stage_slot(b->cpf, i, NULL);
+        b->skip[i] |= VALID_BAD_CPF;
+    } else {
+        b->cpf_len[i] = (unsigned char)stage_slot(b->cpf, i, cpf);
+        if (b->cpf_len[i] != 11 && b->cpf_len[i] != NORM_CPF_LEN) {
+            b->bad[i] |= VALID_BAD_CPF;
+        }
+    }
+    if (date == NULL || date[0] == '\0') {
+        b->date_len[i] = (unsigned char)stage_slot(b->date, i, NULL);
+        b->skip[i] |= VALID_BAD_DATE;
+    } else {
+        b->date_len[i] = (unsigned char)stage_slot(b->date, i, date);
+        if (b->date_len[i] != 8 && b->date_len[i] != NORM_DATE_LEN) {
+            b->bad[i] |= VALID_BAD_DATE;
+        }
+    }
+    return i;
+}
+
+/* Positions of the digits in the formatted forms */
+static const int cpf_at[11] = {0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13};
+static const int date_at[8] = {0, 1, 2, 3, 5, 6, 8, 9};
+
+#if defined(__SSE2__)
+_Static_assert(VALID_BATCH % 16 == 0, "valid_run checks 16 slots per vector");
+
+/* Column k of 'col' for slots g..g+15 */
+#define COLUMN(col, k, g) _mm_load_si128((const __m128i *)&(col)[k][g])
+
+/* 0xFF in the bytes of 'v' holding '0'..'9' */
+static __m128i digit_bytes(__m128i v) {
+    const __m128i nine = _mm_set1_epi8(9);
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    return _mm_cmpeq_epi8(_mm_max_epu8(d, nine), nine);
+}
+
+/* Byte 'k' of each slot: column at[k] for the formatted slots ('fmt'), column k for the bare ones */
+static __m128i pick_column(const unsigned char col[16][VALID_BATCH], const int *at, int k, int g, __m128i fmt) {
+    return _mm_or_si128(_mm_and_si128(fmt, COLUMN(col, at[k], g)), _mm_andnot_si128(fmt, COLUMN(col, k, g)));
+}
+
+/* Bytes 0..7 (half 0) or 8..15 (half 1) of 'v' as 16-bit values */
+static __m128i widen(__m128i v, int half) {
+    return half ? _mm_unpackhi_epi8(v, _mm_setzero_si128()) : _mm_unpacklo_epi8(v, _mm_setzero_si128());
+}
+
+/* x * w + acc on 16-bit values */
+static __m128i mul_add(__m128i acc, __m128i x, int w) {
+    return _mm_add_epi16(acc, _mm_mullo_epi16(x, _mm_set1_epi16((short)w)));
+}
+
+/* cpf_digit of eight 16-bit sums (< 600): the mod 11 of sum * 10 by multiply-high */
+static __m128i cpf_digit_epi16(__m128i sum) {
+    __m128i x = _mm_mullo_epi16(sum, _mm_set1_epi16(10));
+    __m128i q = _mm_mulhi_epu16(x, _mm_set1_epi16(5958));  /* x / 11 for x < 6000 */
+    __m128i r = _mm_sub_epi16(x, _mm_mullo_epi16(q, _mm_set1_epi16(11)));
+    return _mm_andnot_si128(_mm_cmpeq_epi16(r, _mm_set1_epi16(10)), r);
+}
+
+/*
+ * CPFs of slots g..g+15, one slot per byte: each vector holds one column
+ * (the same character position of 16 CPFs). The formatted slots take
+ * their digits from the columns after the punctuation; then the
+ * punctuation, digit range and all-equal tests are byte compares, and the
+ * weighted sums run on 16-bit halves. Returns 0xFF for each bad slot.
+ */
+static __m128i check_cpf_group(const struct Valid_Batch *b, int g) {
+    const unsigned char (*col)[VALID_BATCH] = b->cpf;
+    __m128i fmt = _mm_cmpeq_epi8(_mm_load_si128((const __m128i *)&b->cpf_len[g]), _mm_set1_epi8(NORM_CPF_LEN));
+    __m128i punct = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(COLUMN(col, 3, g), _mm_set1_epi8('.')),
+                                                _mm_cmpeq_epi8(COLUMN(col, 7, g), _mm_set1_epi8('.'))),
+                                  _mm_cmpeq_epi8(COLUMN(col, 11, g), _mm_set1_epi8('-')));
+    __m128i ok = _mm_or_si128(_mm_andnot_si128(fmt, _mm_set1_epi8(-1)), punct);
+    __m128i same = _mm_set1_epi8(-1);
+    __m128i d[11];
+    for (int k = 0; k < 11; k++) {
+        __m128i v = pick_column(col, cpf_at, k, g, fmt);
+        ok = _mm_and_si128(ok, digit_bytes(v));
+        d[k] = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+        same = _mm_and_si128(same, _mm_cmpeq_epi8(d[k], d[0]));
+    }
+    ok = _mm_andnot_si128(same, ok);
+    __m128i good[2];
+    for (int half = 0; half < 2; half++) {
+        __m128i s1 = _mm_setzero_si128();
+        __m128i s2 = _mm_setzero_si128();
+        for (int k = 0; k < 9; k++) {
+            __m128i x = widen(d[k], half);
+            s1 = mul_add(s1, x, 10 - k);
+            s2 = mul_add(s2, x, 11 - k);
+        }
+        __m128i dv1 = widen(d[9], half);
+        s2 = mul_add(s2, dv1, 2);
+        good[half] = _mm_and_si128(_mm_cmpeq_epi16(cpf_digit_epi16(s1), dv1),
+                                   _mm_cmpeq_epi16(cpf_digit_epi16(s2), widen(d[10], half)));
+    }
+    ok = _mm_and_si128(ok, _mm_packs_epi16(good[0], good[1]));
+    return _mm_andnot_si128(ok, _mm_set1_epi8(-1));
+}
+
+/*
+ * Dates of slots g..g+15, laid out like the CPFs: dashes and digits are
+ * byte compares, then year, month and day are built on 16-bit halves and
+ * checked against the month length (30 or 31 by the month's parity, which
+ * flips at August; February 28 or 29 by y % 4, y % 100 and (y / 100) % 4,
+ * the division by multiply-high). Returns 0xFF for each bad slot.
+ */
+static __m128i check_date_group(const struct Valid_Batch *b, int g) {
+    const unsigned char (*col)[VALID_BATCH] = b->date;
+    __m128i fmt = _mm_cmpeq_epi8(_mm_load_si128((const __m128i *)&b->date_len[g]), _mm_set1_epi8(NORM_DATE_LEN));
+    __m128i dashes = _mm_and_si128(_mm_cmpeq_epi8(COLUMN(col, 4, g), _mm_set1_epi8('-')),
+                                   _mm_cmpeq_epi8(COLUMN(col, 7, g), _mm_set1_epi8('-')));
+    __m128i ok = _mm_or_si128(_mm_andnot_si128(fmt, _mm_set1_epi8(-1)), dashes);
+    __m128i d[8];
+    for (int k = 0; k < 8; k++) {
+        __m128i v = pick_column(col, date_at, k, g, fmt);
+        ok = _mm_and_si128(ok, digit_bytes(v));
+        d[k] = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    }
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i three = _mm_set1_epi16(3);
+    __m128i good[2];
+    for (int half = 0; half < 2; half++) {
+        __m128i y = zero, m = zero, day = zero;
+        y = mul_add(mul_add(mul_add(mul_add(y, widen(d[0], half), 1000), widen(d[1], half), 100),
+                            widen(d[2], half), 10), widen(d[3], half), 1);
+        m = mul_add(mul_add(m, widen(d[4], half), 10), widen(d[5], half), 1);
+        day = mul_add(mul_add(day, widen(d[6], half), 10), widen(d[7], half), 1);
+        __m128i century = _mm_srli_epi16(_mm_mulhi_epu16(y, _mm_set1_epi16(5243)), 3);  /* y / 100 */
+        __m128i rest = _mm_sub_epi16(y, _mm_mullo_epi16(century, _mm_set1_epi16(100)));
+        __m128i leap = _mm_and_si128(_mm_cmpeq_epi16(_mm_and_si128(y, three), zero),
+                                     _mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi16(rest, zero), _mm_set1_epi16(-1)),
+                                                  _mm_cmpeq_epi16(_mm_and_si128(century, three), zero)));
+        __m128i days = _mm_add_epi16(_mm_set1_epi16(30), _mm_and_si128(_mm_xor_si128(m, _mm_srli_epi16(m, 3)), one));
+        __m128i feb = _mm_cmpeq_epi16(m, _mm_set1_epi16(2));
+        days = _mm_or_si128(_mm_andnot_si128(feb, days), _mm_and_si128(feb, _mm_sub_epi16(_mm_set1_epi16(28), leap)));
+        __m128i in_range = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi16(y, zero), _mm_cmpgt_epi16(m, zero)),
+                                         _mm_and_si128(_mm_cmplt_epi16(m, _mm_set1_epi16(13)), _mm_cmpgt_epi16(day, zero)));
+        good[half] = _mm_andnot_si128(_mm_cmpgt_epi16(day, days), in_range);
+    }
+    ok = _mm_and_si128(ok, _mm_packs_epi16(good[0], good[1]));
+    return _mm_andnot_si128(ok, _mm_set1_epi8(-1));
+}
+
+void valid_run(const struct Valid_Batch *b, unsigned char *flags) {
+    for (int g = 0; g < b->n; g += 16) {
+        __m128i bad = _mm_or_si128(_mm_and_si128(check_cpf_group(b, g), _mm_set1_epi8(VALID_BAD_CPF)),
+                                   _mm_and_si128(check_date_group(b, g), _mm_set1_epi8(VALID_BAD_DATE)));
+        __m128i f = _mm_or_si128(_mm_load_si128((const __m128i *)&b->bad[g]),
+                                 _mm_andnot_si128(_mm_load_si128((const __m128i *)&b->skip[g]), bad));
+        _Alignas(16) unsigned char out[16];
+        _mm_store_si128((__m128i *)out, f);
+        memcpy(flags + g, out, (size_t)((b->n - g < 16) ? b->n - g : 16));
+    }
+}
+#else
+/*
+ * Mod-11 check digit from a weighted digit sum.
+ */
+static int cpf_digit(int sum) {
+    int r = (sum * 10) % 11;
+    return (r == 10) ? 0 : r;
+}
+
+static int month_days(int year, int month) {
+    static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return days[month - 1] + (month == 2 && leap);
+}
+
+static int date_ok(int year, int month, int day) {
+    return year >= 1 && month >= 1 && month <= 12 && day >= 1 && day <= month_days(year, month);
+}
+
+/*
+ * Pack the digits of slot 'i' (the formatted form when len == 'fmt_len')
+ * into 'd' as values 0..9. Returns 1 if the punctuation does not match or
+ * a digit position holds something else.
+ */
+static int pack_digits(const unsigned char col[16][VALID_BATCH], int i, int len, int fmt_len,
+                       const int *at, int n, const char *shape, int *d) {
+    if (len == fmt_len) {
+        for (int k = 0; shape[k] != '\0'; k++) {
+            if (shape[k] != '9' && col[k][i] != (unsigned char)shape[k]) {
+                return 1;
+            }
+        }
+    }
+    for (int k = 0; k < n; k++) {
+        int x = col[(len == fmt_len) ? at[k] : k][i] - '0';
+        if (x < 0 || x > 9) {
+            return 1;
+        }
+        d[k] = x;
+    }
+    return 0;
+}
+
+static int check_cpf_slot(const struct Valid_Batch *b, int i) {
+    int d[11];
+    if (pack_digits(b->cpf, i, b->cpf_len[i], NORM_CPF_LEN, cpf_at, 11, "999.999.999-99", d)) {
+        return 1;
+    }
+    int same = 1;
+    int s1 = 0;
+    int s2 = 0;
+    for (int k = 0; k < 11; k++) {
+        same &= (d[k] == d[0]);
+    }
+    if (same) {
+        return 1;
+    }
+    for (int k = 0; k < 9; k++) {
+        s1 += d[k] * (10 - k);
+    }
+    for (int k = 0; k < 10; k++) {
+        s2 += d[k] * (11 - k);
+    }
+    return cpf_digit(s1) != d[9] || cpf_digit(s2) != d[10];
+}
+
+static int check_date_slot(const struct Valid_Batch *b, int i) {
+    int d[8];
+    if (pack_digits(b->date, i, b->date_len[i], NORM_DATE_LEN, date_at, 8, "9999-99-99", d)) {
+        return 1;
+    }
+    return !date_ok(d[0] * 1000 + d[1] * 100 + d[2] * 10 + d[3], d[4] * 10 + d[5], d[6] * 10 + d[7]);
+}
+
+void valid_run(const struct Valid_Batch *b, unsigned char *flags) {
+    for (int i = 0; i < b->n; i++) {
+        unsigned char f = b->bad[i];
+        if (!((f | b->skip[i]) & VALID_BAD_CPF) && check_cpf_slot(b, i)) {
+            f |= VALID_BAD_CPF;
+        }
+        if (!((f | b->skip[i]) & VALID_BAD_DATE) && check_date_slot(b, i)) {
+            f |= VALID_BAD_DATE;
+        }
+        flags[i] = f;
+    }
+}
+#endif
+
+int valid_row(const char *cpf, const char *date) {
+    struct Valid_Batch b;
+    unsigned char flags[1];
+    valid_reset(&b);
+    valid_add(&b, cpf, date);
+    valid_run(&b, flags);
+    return flags[0];
+}
+
+/* A value that replaces the current one in an update */
+static int is_new_value(const char *v) {
+    return v != NULL && v[0] != '\0' && strcmp(v, "-") != 0;
+}
+
+int normalize_update(char *cpf, char *date) {
+    char norm_cpf[NORM_CPF_LEN + 1];
+    char norm_date[NORM_DATE_LEN + 1];
+    int bad = 0;
+    const char *check_cpf = NULL;
+    const char *check_date = NULL;
+    if (is_new_value(cpf)) {
+        if (normalize_cpf(cpf, norm_cpf) != 0) {
+            bad |= VALID_BAD_CPF;
+        } else {
+            strcpy(cpf, norm_cpf);
+            check_cpf = cpf;
+        }
+    }
+    if (is_new_value(date)) {
+        if (normalize_date(date, norm_date) != 0) {
+            bad |= VALID_BAD_DATE;
+        } else {
+            strcpy(date, norm_date);
+            check_date = date;
+        }
+    }
+    return bad | valid_row(check_cpf, check_date);
+}
+
+const char *valid_reason(int flags) {
+    if ((flags & VALID_BAD_CPF) && (flags & VALID_BAD_DATE)) {
+        return "CPF e data inválidos";
+    }
+    return (flags & VALID_BAD_CPF) ? "CPF inválido" : (flags & VALID_BAD_DATE) ? "data inválida" : "válido";
+}
@@ -0,0 +1,106 @@
+#ifndef NORMALIZE_H
+#define NORMALIZE_H
+
+/*
+ * Input rules for the CPF and Data_Cadastro columns, shared by the menu and
+ * the bulk import: CPFs are stored as XXX.XXX.XXX-XX and dates as YYYY-MM-DD,
+ * and both may be typed as bare digits.
+ */
+
+#define NORM_CPF_LEN 14   /* XXX.XXX.XXX-XX */
+#define NORM_DATE_LEN 10  /* YYYY-MM-DD */
+
+/**
+ * Format CPF from digits-only string to XXX.XXX.XXX-XX format
+ * If input already has formatting, returns it as-is
+ * If input has exactly 11 digits, formats it properly
+ * 'cpf' must have room for NORM_CPF_LEN + 1 bytes.
+ */
+void format_cpf(char *cpf);
+
+/**
+ * Format date from YYYYMMDD to YYYY-MM-DD format
+ * If input already has formatting, returns it as-is
+ * If input has exactly 8 digits, formats it properly
+ * 'date_input' must have room for NORM_DATE_LEN + 1 bytes.
+ */
+void format_date(char *date_input);
+
+/**
+ * Write the canonical form of CPF 'in' (surrounding blanks ignored, then
+ * format_cpf) into 'out'. Returns 0 if it is XXX.XXX.XXX-XX; returns 1
+ * otherwise ('out' then holds the rejected text, possibly truncated).
+ */
+int normalize_cpf(const char *in, char out[NORM_CPF_LEN + 1]);
+
+/**
+ * Same for a date: returns 0 if 'in' is empty ('out' = "") or becomes
+ * YYYY-MM-DD with month 01-12 and day 01-31; returns 1 otherwise.
+ */
+int normalize_date(const char *in, char out[NORM_DATE_LEN + 1]);
+
+/*
+ * Content checks, run over batches of rows: CPF check digits (mod 11, and
+ * not all digits equal) and calendar dates (month length, leap years).
+ *
+ * The batch is stored column-wise: valid_add writes byte k of a slot's
+ * value into column k, so one 16-byte vector holds the same character
+ * position of 16 slots. valid_run (SSE2 when available) checks 16 slots
+ * per step: the formatted slots take their digits from the columns after
+ * the punctuation, punctuation and digit tests are byte compares, and the
+ * weighted digit sums, mod 11 and calendar rules run on 16-bit halves. The
+ * plain C fallback checks the slots one by one with the same rules.
+ * Absent values (NULL or empty) are not checked.
+ */
+
+#define VALID_BATCH 64
+#define VALID_BAD_CPF 1
+#define VALID_BAD_DATE 2
+
+struct Valid_Batch {
+    _Alignas(16) unsigned char cpf[16][VALID_BATCH];   /* byte k of slot i's CPF at [k][i], zero padded */
+    _Alignas(16) unsigned char date[16][VALID_BATCH];  /* same for the date */
+    _Alignas(16) unsigned char cpf_len[VALID_BATCH];
+    _Alignas(16) unsigned char date_len[VALID_BATCH];
+    _Alignas(16) unsigned char skip[VALID_BATCH];  /* VALID_BAD_* bits of the values that are absent */
+    _Alignas(16) unsigned char bad[VALID_BATCH];   /* VALID_BAD_* bits already known when staging */
+    int n;
+};
+
+/**
+ * Empty the batch.
+ */
+void valid_reset(struct Valid_Batch *b);
+
+/**
+ * Stage one row's CPF and date (same forms as format_cpf / format_date
+ * accept) and return its slot, or -1 if the batch is full.
+ */
+int valid_add(struct Valid_Batch *b, const char *cpf, const char *date);
+
+/**
+ * Check every staged row; flags[i] receives the VALID_BAD_* bits of slot i.
+ */
+void valid_run(const struct Valid_Batch *b, unsigned char *flags);
+
+/**
+ * Check a single CPF/date pair. Returns its VALID_BAD_* bits.
+ */
+int valid_row(const char *cpf, const char *date);
+
+/**
+ * Check the new CPF and date of an update, in place: NULL, "-" (field
+ * kept) and "" (field cleared) are left alone; any other value is replaced
+ * by its normalize_cpf / normalize_date form, so both buffers need room for
+ * NORM_CPF_LEN + 1 and NORM_DATE_LEN + 1 bytes. Returns the VALID_BAD_*
+ * bits of the values that are malformed or fail valid_row (0: both may be
+ * stored).
+ */
+int normalize_update(char *cpf, char *date);
+
+/**
+ * Short Portuguese description of 'flags' for reports.
+ */
+const char *valid_reason(int flags);
+
+#endif /* NORMALIZE_H */
@@ -0,0 +1,343 @@
+#include "order.h"
+#include "columns.h"
+#include "dinamic_vector.h"
+#include "schema.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Inputs smaller than this are sorted on the calling thread only */
+#define ORDER_PARALLEL_MIN 65536
+#define ORDER_MAX_THREADS 16
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+/*
+ * (key, row) pair being sorted; 'key' is the column value mapped so that
+ * unsigned ascending order is the requested order.
+ */
+struct Radix_Pair {
+    unsigned key;
+    int row;
+};
+
+/*
+ * One thread's share of a radix pass: a chunk of the input, its bucket
+ * counts, then its write cursors.
+ */
+struct Radix_Task {
+    const struct Radix_Pair *src;
+    struct Radix_Pair *dst;
+    int begin;
+    int end;
+    int shift;
+    int count[RADIX_BUCKETS];
+};
+
+static unsigned order_key(int v, int desc) {
+    unsigned u = (unsigned)v ^ 0x80000000u;  /* signed -> unsigned order; COL_NULL -> 0 */
+    return desc ? ~u : u;
+}
+
+static void *radix_count(void *arg) {
+    struct Radix_Task *t = (struct Radix_Task *)arg;
+    memset(t->count, 0, sizeof(t->count));
+    for (int i = t->begin; i < t->end; i++) {
+        t->count[(t->src[i].key >> t->shift) & (RADIX_BUCKETS - 1)]++;
+    }
+    return NULL;
+}
+
+static void *radix_scatter(void *arg) {
+    struct Radix_Task *t = (struct Radix_Task *)arg;
+    for (int i = t->begin; i < t->end; i++) {
+        int d = (t->src[i].key >> t->shift) & (RADIX_BUCKETS - 1);
+        t->dst[t->count[d]++] = t->src[i];
+    }
+    return NULL;
+}
+
+/*
+ * Run fn on every task; task 0 on the calling thread.
+ */
+static void run_tasks(void *(*fn)(void *), struct Radix_Task *tasks, int count) {
+    pthread_t tid[ORDER_MAX_THREADS];
+    int started[ORDER_MAX_THREADS];
+    for (int t = 1; t < count; t++) {
+        started[t] = (pthread_create(&tid[t], NULL, fn, &tasks[t]) == 0);
+        if (!started[t]) {
+            fn(&tasks[t]);
+        }
+    }
+    fn(&tasks[0]);
+    for (int t = 1; t < count; t++) {
+        if (started[t]) {
+            pthread_join(tid[t], NULL);
+        }
+    }
+}
+
+static int order_threads(int n, int requested) {
+    if (requested > 0) {
+        return requested < ORDER_MAX_THREADS ? requested : ORDER_MAX_THREADS;
+    }
+    if (n < ORDER_PARALLEL_MIN) {
+        return 1;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    return cpus < ORDER_MAX_THREADS ? (int)cpus : ORDER_MAX_THREADS;
+}
+
+void order_radix(const int *keys, int *rows, int n, int desc, int threads) {
+    if (n < 2) {
+        return;
+    }
+    struct Radix_Pair *a = (struct Radix_Pair *)malloc(sizeof(struct Radix_Pair) * (size_t)n);
+    struct Radix_Pair *b = (struct Radix_Pair *)malloc(sizeof(struct Radix_Pair) * (size_t)n);
+    if (a == NULL || b == NULL) {
+        exit(1);
+    }
+    for (int i = 0; i < n; i++) {
+        a[i].key = order_key(keys[rows[i]], desc);
+        a[i].row = rows[i];
+    }
+
+    struct Radix_Task tasks[ORDER_MAX_THREADS];
+    int count = order_threads(n, threads);
+    for (int t = 0; t < count; t++) {
+        tasks[t].begin = (int)((long long)n * t / count);
+        tasks[t].end = (int)((long long)n * (t + 1) / count);
+    }
+
+    for (int shift = 0; shift < 32; shift += RADIX_BITS) {
+        for (int t = 0; t < count; t++) {
+            tasks[t].src = a;
+            tasks[t].dst = b;
+            tasks[t].shift = shift;
+        }
+        run_tasks(radix_count, tasks, count);
+
+        /* Exclusive prefix over (digit, thread) keeps the sort stable.
+           A pass where every key has the same digit is skipped. */
+        int offset = 0;
+        int skip = 0;
+        for (int d = 0; d < RADIX_BUCKETS; d++) {
+            int total = 0;
+            for (int t = 0; t < count; t++) {
+                int c = tasks[t].count[d];
+                tasks[t].count[d] = offset;
+                offset += c;
+                total += c;
+            }
+            if (total == n) {
+                skip = 1;
+            }
+        }
+        if (skip) {
+            continue;
+        }
+        run_tasks(radix_scatter, tasks, count);
+        struct Radix_Pair *swap = a; a = b; b = swap;
+    }
+
+    for (int i = 0; i < n; i++) {
+        rows[i] = a[i].row;
+    }
+    free(a);
+    free(b);
+}
+
+/*
+ * Comparison used by the heap and merge sort: < 0 if element a comes first.
+ * Elements are indexes into the caller's input; ties fall back to input order.
+ */
+typedef int (*Order_Cmp)(const void *ctx, int a, int b);
+
+static int cmp_uint_keys(const void *ctx, int a, int b) {
+    const unsigned *u = (const unsigned *)ctx;
+    if (u[a] != u[b]) return (u[a] < u[b]) ? -1 : 1;
+    return (a > b) - (a < b);
+}
+
+struct Text_Keys {
+    const char **text;
+    int desc;
+};
+
+static int cmp_text_keys(const void *ctx, int a, int b) {
+    const struct Text_Keys *k = (const struct Text_Keys *)ctx;
+    int c = strcmp(k->text[a], k->text[b]);
+    if (c != 0) return k->desc ? -c : c;
+    return (a > b) - (a < b);
+}
+
+static void heap_down(int *h, int n, int i, Order_Cmp cmp, const void *ctx) {
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && cmp(ctx, h[l], h[m]) > 0) m = l;
+        if (r < n && cmp(ctx, h[r], h[m]) > 0) m = r;
+        if (m == i) return;
+        int t = h[i]; h[i] = h[m]; h[m] = t;
+        i = m;
+    }
+}
+
+/*
+ * Select the k first of elements 0..n-1 under 'cmp' into out[0..k-1], in order.
+ * A max-heap holds the current k best; its root is the one to evict.
+ */
+static int heap_select(int n, int k, Order_Cmp cmp, const void *ctx, int *out) {
+    if (k > n) k = n;
+    if (k <= 0) return 0;
+    int size = 0;
+    for (int i = 0; i < n; i++) {
+        if (size < k) {
+            int c = size++;
+            out[c] = i;
+            while (c > 0 && cmp(ctx, out[(c - 1) / 2], out[c]) < 0) {
+                int p = (c - 1) / 2;
+                int t = out[p]; out[p] = out[c]; out[c] = t;
+                c = p;
+            }
+        } else if (cmp(ctx, i, out[0]) < 0) {
+            out[0] = i;
+            heap_down(out, size, 0, cmp, ctx);
+        }
+    }
+    /* heap sort in place: repeatedly move the root (last in order) to the end */
+    for (int end = size - 1; end > 0; end--) {
+        int t = out[0]; out[0] = out[end]; out[end] = t;
+        heap_down(out, end, 0, cmp, ctx);
+    }
+    return size;
+}
+
+/*
+ * Stable bottom-up merge sort of element indexes 0..n-1 into 'idx'.
+ */
+static void merge_sort(int *idx, int n, Order_Cmp cmp, const void *ctx) {
+    int *tmp = (int *)malloc(sizeof(int) * (size_t)(n > 0 ? n : 1));
+    if (tmp == NULL) {
+        exit(1);
+    }
+    for (int i = 0; i < n; i++) idx[i] = i;
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = lo + width < n ? lo + width : n;
+            int hi = lo + 2 * width < n ? lo + 2 * width : n;
+            int a = lo, b = mid, k = lo;
+            while (a < mid && b < hi) {
+                tmp[k++] = (cmp(ctx, idx[b], idx[a]) < 0) ? idx[b++] : idx[a++];
+            }
+            while (a < mid) tmp[k++] = idx[a++];
+            while (b < hi) tmp[k++] = idx[b++];
+        }
+        memcpy(idx, tmp, sizeof(int) * (size_t)n);
+    }
+    free(tmp);
+}
+
+int order_topk_int(const int *keys, const int *rows, int n, int k, int desc, int *out) {
+    unsigned *u = (unsigned *)malloc(sizeof(unsigned) * (size_t)(n > 0 ? n : 1));
+    int *pick = (int *)malloc(sizeof(int) * (size_t)(k > 0 ? k : 1));
+    if (u == NULL || pick == NULL) {
+        exit(1);
+    }
+    for (int i = 0; i < n; i++) {
+        u[i] = order_key(keys[rows[i]], desc);
+    }
+    int m = heap_select(n, k, cmp_uint_keys, u, pick);
+    for (int i = 0; i < m; i++) {
+        out[i] = rows[pick[i]];
+    }
+    free(pick);
+    free(u);
+    return m;
+}
+
+int order_rows(struct Dinamic_Vector *dv, int *rows, int n, enum Query_Column col, int desc, int limit) {
+    if (limit >= n) {
+        limit = -1;  /* keeps every row: plain sort */
+    }
+
+    if (col == QC_ID || col == QC_IDADE || col == QC_DATA) {
+        const struct Int_Columns *cols = dv_columns(dv);
+        const int *keys = (col == QC_ID) ? cols->id : (col == QC_IDADE) ? cols->idade : cols->data;
+        if (limit >= 0) {
+            int *top = (int *)malloc(sizeof(int) * (size_t)(limit > 0 ? limit : 1));
+            if (top == NULL) {
+                exit(1);
+            }
+            int m = order_topk_int(keys, rows, n, limit, desc, top);
+            memcpy(rows, top, sizeof(int) * (size_t)m);
+            free(top);
+            return m;
+        }
+        order_radix(keys, rows, n, desc, 0);
+        return n;
+    }
+
+    /* Text columns: folded name key, or the CPF as stored. The keys are
+       copied into one arena: in paged mode a row may be evicted (and its
+       strings freed) by a later dv_get. */
+    struct Text_Keys k;
+    k.desc = desc;
+    k.text = (const char **)malloc(sizeof(char *) * (size_t)(n > 0 ? n : 1));
+    size_t *at = (size_t *)malloc(sizeof(size_t) * (size_t)(n > 0 ? n : 1));
+    int *idx = (int *)malloc(sizeof(int) * (size_t)(n > 0 ? n : 1));
+    size_t arena_cap = 4096, arena_len = 0;
+    char *arena = (char *)malloc(arena_cap);
+    if (k.text == NULL || at == NULL || idx == NULL || arena == NULL) {
+        exit(1);
+    }
+    for (int i = 0; i < n; i++) {
+        const char *t;
+        if (col == QC_NOME) {
+            t = dv_get(dv, rows[i])->key;
+        } else {
+            struct Field *f = get_field_by_index(dv, rows[i], PC_CPF);
+            t = (f != NULL && f->type == FIELD_STRING && f->s != NULL) ? f->s : "";
+        }
+        size_t len = strlen(t) + 1;
+        if (arena_len + len > arena_cap) {
+            while (arena_len + len > arena_cap) {
+                arena_cap *= 2;
+            }
+            char *grown = (char *)realloc(arena, arena_cap);
+            if (grown == NULL) {
+                exit(1);
+            }
+            arena = grown;
+        }
+        memcpy(arena + arena_len, t, len);
+        at[i] = arena_len;
+        arena_len += len;
+    }
+    for (int i = 0; i < n; i++) {
+        k.text[i] = arena + at[i];
+    }
+    free(at);
+    int m;
+    if (limit >= 0) {
+        m = heap_select(n, limit, cmp_text_keys, &k, idx);
+    } else {
+        merge_sort(idx, n, cmp_text_keys, &k);
+        m = n;
+    }
+    /* idx refers to positions in 'rows'; gather through a copy */
+    int *copy = (int *)malloc(sizeof(int) * (size_t)(n > 0 ? n : 1));
+    if (copy == NULL) {
+        exit(1);
+    }
+    memcpy(copy, rows, sizeof(int) * (size_t)n);
+    for (int i = 0; i < m; i++) {
+        rows[i] = copy[idx[i]];
+    }
+    free(copy);
+    free(idx);
+    free(k.text);
+    free(arena);
+    return m;
+}
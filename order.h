@@ -0,0 +1,39 @@
+#ifndef ORDER_H
+#define ORDER_H
+
+#include "query.h"
+
+struct Dinamic_Vector;
+
+/*
+ * Ordering of result rows (ORDER BY / LIMIT in query.h).
+ *
+ * Rows are never moved: only an array of row positions is permuted.
+ * Int columns (id, idade, packed data) use a stable LSD radix sort over
+ * (key, position) pairs, split across threads for large inputs; text
+ * columns (nome folded key, cpf) use a stable merge sort. When a limit k
+ * is given, a bounded heap selects the k first rows without sorting all.
+ * Ties keep vector order. Null values sort first ascending, last descending.
+ */
+
+/**
+ * Order 'rows[0..n-1]' (row positions of 'dv') by column 'col'.
+ * If 'limit' >= 0, only the first 'limit' rows are kept.
+ * Returns the number of rows left in 'rows'.
+ * If malloc fails, exits(1).
+ */
+int order_rows(struct Dinamic_Vector *dv, int *rows, int n, enum Query_Column col, int desc, int limit);
+
+/**
+ * Stable LSD radix sort of 'rows' by keys[rows[i]] (8 bits per pass).
+ * 'threads' <= 0 picks a count from the input size.
+ */
+void order_radix(const int *keys, int *rows, int n, int desc, int threads);
+
+/**
+ * Write into 'out' the 'k' rows from 'rows' with the smallest (or largest,
+ * if desc) keys[row], in order. Returns min(k, n).
+ */
+int order_topk_int(const int *keys, const int *rows, int n, int k, int desc, int *out);
+
+#endif /* ORDER_H */
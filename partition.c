@@ -0,0 +1,372 @@
+#include "partition.h"
+#include "columns.h"
+#include "dinamic_vector.h"
+#include "schema.h"
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PART_MAX_THREADS 16
+
+/*
+ * Month of a packed YYYYMMDD date, or PART_UNDATED.
+ */
+static int part_month(int packed) {
+    if (packed == COL_NULL) {
+        return PART_UNDATED;
+    }
+    int month = packed / 100 % 100;
+    if (packed < 0 || month < 1 || month > 12) {
+        return PART_UNDATED;
+    }
+    return packed / 10000 * 12 + month - 1;
+}
+
+static int row_month(const struct LinkedList *row) {
+    const struct ListNode *node = row->first;
+    for (int col = 0; node != NULL && col < PC_DATA; col++) {
+        node = node->next;
+    }
+    if (node == NULL || node->field.type != FIELD_STRING) {
+        return PART_UNDATED;
+    }
+    return part_month(col_pack_date(node->field.s));
+}
+
+/*
+ * File name of a month's partition, inside 'dir'.
+ */
+static void part_path(const char *dir, int month, char *buf, size_t size) {
+    if (month == PART_UNDATED) {
+        snprintf(buf, size, "%s/sem-data.csv", dir);
+    } else {
+        snprintf(buf, size, "%s/%04d-%02d.csv", dir, month / 12, month % 12 + 1);
+    }
+}
+
+/*
+ * Parse a partition file name; returns 1 and sets *month if it is one.
+ */
+static int part_parse_name(const char *name, int *month) {
+    if (strcmp(name, "sem-data.csv") == 0) {
+        *month = PART_UNDATED;
+        return 1;
+    }
+    int y, m;
+    char rest[8];
+    if (strlen(name) != 11 || sscanf(name, "%4d-%2d%7s", &y, &m, rest) != 3 ||
+        strcmp(rest, ".csv") != 0 || m < 1 || m > 12) {
+        return 0;
+    }
+    *month = y * 12 + m - 1;
+    return 1;
+}
+
+static struct Partition_Set *part_create(const char *dir) {
+    struct Partition_Set *ps = (struct Partition_Set *)malloc(sizeof(struct Partition_Set));
+    if (ps == NULL) {
+        exit(1);
+    }
+    ps->dir = strdup(dir);
+    ps->n = 0;
+    ps->n_max = 16;
+    ps->p = (struct Partition *)malloc(sizeof(struct Partition) * (size_t)ps->n_max);
+    if (ps->dir == NULL || ps->p == NULL) {
+        exit(1);
+    }
+    return ps;
+}
+
+/*
+ * Return the partition for 'month', adding it (clean) if missing.
+ */
+static struct Partition *part_get(struct Partition_Set *ps, int month) {
+    int lo = 0, hi = ps->n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (ps->p[mid].month < month) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < ps->n && ps->p[lo].month == month) {
+        return &ps->p[lo];
+    }
+    if (ps->n == ps->n_max) {
+        ps->n_max *= 2;
+        struct Partition *grown = (struct Partition *)realloc(ps->p, sizeof(struct Partition) * (size_t)ps->n_max);
+        if (grown == NULL) {
+            exit(1);
+        }
+        ps->p = grown;
+    }
+    memmove(&ps->p[lo + 1], &ps->p[lo], sizeof(struct Partition) * (size_t)(ps->n - lo));
+    ps->n++;
+    ps->p[lo].month = month;
+    ps->p[lo].dirty = 0;
+    return &ps->p[lo];
+}
+
+void part_touch(struct Partition_Set *ps, const struct LinkedList *row) {
+    if (ps == NULL || row == NULL) {
+        return;
+    }
+    part_get(ps, row_month(row))->dirty = 1;
+}
+
+/*
+ * Parallel load: thread t reads files t, t + count, t + 2*count, ...
+ * each into its own vector.
+ */
+struct Part_Load_Task {
+    char **paths;
+    struct Dinamic_Vector **parts;
+    int n_files;
+    int first;
+    int stride;
+    int status;
+};
+
+static void *part_load_worker(void *arg) {
+    struct Part_Load_Task *t = (struct Part_Load_Task *)arg;
+    t->status = 0;
+    for (int f = t->first; f < t->n_files; f += t->stride) {
+        if (dv_read_from_csv(t->parts[f], t->paths[f]) != 0) {
+            t->status = 1;
+        }
+    }
+    return NULL;
+}
+
+static int cmp_month(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Read every partition file of 'dir' into 'dv', in month order.
+ */
+static int part_load(struct Dinamic_Vector *dv, DIR *d, struct Partition_Set *ps) {
+    int n_files = 0, cap = 16;
+    int *months = (int *)malloc(sizeof(int) * (size_t)cap);
+    if (months == NULL) {
+        exit(1);
+    }
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        int month;
+        if (!part_parse_name(e->d_name, &month)) {
+            continue;
+        }
+        if (n_files == cap) {
+            cap *= 2;
+            int *grown = (int *)realloc(months, sizeof(int) * (size_t)cap);
+            if (grown == NULL) {
+                exit(1);
+            }
+            months = grown;
+        }
+        months[n_files++] = month;
+    }
+    qsort(months, (size_t)n_files, sizeof(int), cmp_month);
+
+    char **paths = (char **)malloc(sizeof(char *) * (size_t)(n_files > 0 ? n_files : 1));
+    struct Dinamic_Vector **parts = (struct Dinamic_Vector **)malloc(sizeof(struct Dinamic_Vector *) * (size_t)(n_files > 0 ? n_files : 1));
+    if (paths == NULL || parts == NULL) {
+        exit(1);
+    }
+    size_t path_size = strlen(ps->dir) + 32;
+    for (int f = 0; f < n_files; f++) {
+        paths[f] = (char *)malloc(path_size);
+        if (paths[f] == NULL) {
+            exit(1);
+        }
+        part_path(ps->dir, months[f], paths[f], path_size);
+        parts[f] = dv_create();
+        part_get(ps, months[f]);
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int count = (cpus < 1) ? 1 : (cpus < PART_MAX_THREADS ? (int)cpus : PART_MAX_THREADS);
+    if (count > n_files) {
+        count = (n_files > 0) ? n_files : 1;
+    }
+    struct Part_Load_Task tasks[PART_MAX_THREADS];
+    pthread_t tid[PART_MAX_THREADS];
+    int started[PART_MAX_THREADS];
+    for (int t = 0; t < count; t++) {
+        tasks[t].paths = paths;
+        tasks[t].parts = parts;
+        tasks[t].n_files = n_files;
+        tasks[t].first = t;
+        tasks[t].stride = count;
+    }
+    for (int t = 1; t < count; t++) {
+        started[t] = (pthread_create(&tid[t], NULL, part_load_worker, &tasks[t]) == 0);
+        if (!started[t]) {
+            part_load_worker(&tasks[t]);
+        }
+    }
+    part_load_worker(&tasks[0]);
+    int status = tasks[0].status;
+    for (int t = 1; t < count; t++) {
+        if (started[t]) {
+            pthread_join(tid[t], NULL);
+        }
+        status |= tasks[t].status;
+    }
+
+    /* Append each segment; the rows move, only the small vectors are freed */
+    for (int f = 0; f < n_files; f++) {
+        for (int i = 0; i < dv_size(parts[f]); i++) {
+            struct LinkedList *row = dv_get(parts[f], i);
+            if (row_month(row) != months[f]) {
+                /* misfiled row: rewrite both files so it moves on the next save */
+                part_get(ps, months[f])->dirty = 1;
+                part_touch(ps, row);
+            }
+            dv_insert(dv, row);
+        }
+        dv_free(parts[f]);
+        free(paths[f]);
+    }
+    free(parts);
+    free(paths);
+    free(months);
+    dv_reassign_ids(dv);
+    return status;
+}
+
+int part_open(struct Dinamic_Vector *dv, const char *dir, const char *fallback_csv) {
+    if (dv == NULL || dir == NULL || dv->parts != NULL) {
+        return 1;
+    }
+    struct Partition_Set *ps = part_create(dir);
+    DIR *d = opendir(dir);
+    if (d != NULL) {
+        int status = part_load(dv, d, ps);
+        closedir(d);
+        if (status != 0) {
+            part_free(ps);
+            return 1;
+        }
+        dv->parts = ps;
+        return 0;
+    }
+    if (errno != ENOENT || fallback_csv == NULL || dv_read_from_csv(dv, fallback_csv) != 0) {
+        part_free(ps);
+        return 1;
+    }
+    /* Migration: every month present is written on the first save */
+    dv->parts = ps;
+    for (int i = 0; i < dv_size(dv); i++) {
+        part_touch(ps, dv_get(dv, i));
+    }
+    return 0;
+}
+
+int part_save(struct Dinamic_Vector *dv, int *written) {
+    if (written != NULL) {
+        *written = 0;
+    }
+    struct Partition_Set *ps = (dv != NULL) ? dv->parts : NULL;
+    if (ps == NULL) {
+        return 1;
+    }
+    if (mkdir(ps->dir, 0755) != 0 && errno != EEXIST) {
+        return 1;
+    }
+
+    /* Bucket the rows of dirty partitions, keeping vector order */
+    const struct Int_Columns *cols = dv_columns(dv);
+    int n = cols->n;
+    int *owner = (int *)malloc(sizeof(int) * (size_t)(n > 0 ? n : 1));
+    int *rows = (int *)malloc(sizeof(int) * (size_t)(n > 0 ? n : 1));
+    if (owner == NULL || rows == NULL) {
+        exit(1);
+    }
+    /* first every month gets its partition: part_get inserts in sorted
+       order, which moves the partitions after it, so no index is taken
+       until the set is complete */
+    for (int i = 0; i < n; i++) {
+        part_get(ps, part_month(cols->data[i]));
+    }
+    for (int i = 0; i < n; i++) {
+        struct Partition *p = part_get(ps, part_month(cols->data[i]));
+        owner[i] = p->dirty ? (int)(p - ps->p) : -1;
+    }
+    int *start = (int *)calloc((size_t)ps->n + 1, sizeof(int));
+    if (start == NULL) {
+        exit(1);
+    }
+    for (int i = 0; i < n; i++) {
+        if (owner[i] >= 0) {
+            start[owner[i] + 1]++;
+        }
+    }
+    for (int k = 0; k < ps->n; k++) {
+        start[k + 1] += start[k];
+    }
+    int *fill = (int *)malloc(sizeof(int) * (size_t)(ps->n > 0 ? ps->n : 1));
+    if (fill == NULL) {
+        exit(1);
+    }
+    memcpy(fill, start, sizeof(int) * (size_t)ps->n);
+    for (int i = 0; i < n; i++) {
+        if (owner[i] >= 0) {
+            rows[fill[owner[i]]++] = i;
+        }
+    }
+
+    int status = 0;
+    size_t path_size = strlen(ps->dir) + 32;
+    char *path = (char *)malloc(path_size);
+    char *tmp = (char *)malloc(path_size + 4);
+    if (path == NULL || tmp == NULL) {
+        exit(1);
+    }
+    for (int k = 0; k < ps->n; k++) {
+        if (!ps->p[k].dirty) {
+            continue;
+        }
+        int count = start[k + 1] - start[k];
+        part_path(ps->dir, ps->p[k].month, path, path_size);
+        if (count == 0) {
+            /* the month lost all its rows */
+            if (remove(path) != 0 && errno != ENOENT) {
+                status = 1;
+                continue;
+            }
+        } else {
+            /* write aside, then rename, so a failed save keeps the old file */
+            snprintf(tmp, path_size + 4, "%s.tmp", path);
+            if (dv_write_rows_to_csv(dv, tmp, rows + start[k], count) != 0 || rename(tmp, path) != 0) {
+                status = 1;
+                continue;
+            }
+        }
+        ps->p[k].dirty = 0;
+        if (written != NULL) {
+            (*written)++;
+        }
+    }
+    free(path);
+    free(tmp);
+    free(fill);
+    free(rows);
+    free(start);
+    free(owner);
+    return status;
+}
+
+void part_free(struct Partition_Set *ps) {
+    if (ps == NULL) {
+        return;
+    }
+    free(ps->dir);
+    free(ps->p);
+    free(ps);
+}
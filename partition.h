@@ -0,0 +1,65 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+struct Dinamic_Vector;
+struct LinkedList;
+
+/*
+ * Partitioned storage: instead of one CSV, the database is a directory with
+ * one CSV per registration month (Data_Cadastro), named "YYYY-MM.csv", plus
+ * "sem-data.csv" for rows without a valid date.
+ *
+ *  - Loading reads the partition files in parallel, one vector per file,
+ *    and appends them to the main vector in month order, so each partition
+ *    is a contiguous segment of rows (the zone map in columns.h then lets
+ *    date filters skip the segments out of range).
+ *  - Every insert/update/remove marks the partition of the rows it touches
+ *    as dirty; saving rewrites only the dirty partition files.
+ *
+ * IDs are positions in the vector: they are renumbered on load, so a
+ * partition is not made dirty just because rows before it were removed.
+ */
+
+#define PART_UNDATED (-1)   /* month of rows without a valid Data_Cadastro */
+
+struct Partition {
+    int month;   /* year * 12 + (month - 1), or PART_UNDATED */
+    int dirty;   /* rows of this month changed since the last load/save */
+};
+
+struct Partition_Set {
+    char *dir;              /* directory holding the partition files */
+    struct Partition *p;    /* sorted by month */
+    int n;
+    int n_max;
+};
+
+/**
+ * Open the partitioned database in 'dir' into the empty vector 'dv'.
+ * If 'dir' does not exist yet, rows are read from the single CSV
+ * 'fallback_csv' instead and every partition starts dirty, so the first
+ * save creates the directory (migration).
+ * Returns 0 on success; returns 1 on error.
+ * If malloc fails, exits(1).
+ */
+int part_open(struct Dinamic_Vector *dv, const char *dir, const char *fallback_csv);
+
+/**
+ * Mark the partition holding 'row' (by its Data_Cadastro) as dirty.
+ * Does nothing if ps==NULL or row==NULL.
+ */
+void part_touch(struct Partition_Set *ps, const struct LinkedList *row);
+
+/**
+ * Rewrite the dirty partition files of 'dv' (and delete those left empty).
+ * '*written' (if given) receives the number of files rewritten.
+ * Returns 0 on success; returns 1 on error (failed partitions stay dirty).
+ */
+int part_save(struct Dinamic_Vector *dv, int *written);
+
+/**
+ * Free the partition set. Safe if ps==NULL.
+ */
+void part_free(struct Partition_Set *ps);
+
+#endif /* PARTITION_H */
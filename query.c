@@ -0,0 +1,724 @@
+#include "query.h"
+#include "columns.h"
+#include "cpf_index.h"
+#include "dinamic_vector.h"
+#include "fold.h"
+#include "order.h"
+#include "schema.h"
+#include "slab.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+/* ---------------------------------------------------------------------- */
+/* Lexer                                                                  */
+/* ---------------------------------------------------------------------- */
+
+enum Tok { T_END, T_WORD, T_NUMBER, T_STRING, T_OP, T_LPAREN, T_RPAREN };
+
+struct Lexer {
+    const char *p;
+    enum Tok tok;
+    char text[256];
+    char *err;
+    size_t err_size;
+    int failed;
+};
+
+static void lex_error(struct Lexer *lx, const char *msg) {
+    if (!lx->failed) {
+        snprintf(lx->err, lx->err_size, "%s", msg);
+    }
+    lx->failed = 1;
+}
+
+static int is_word_char(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+static void lex_take(struct Lexer *lx, const char *start, size_t len, enum Tok tok) {
+    if (len >= sizeof(lx->text)) {
+        len = sizeof(lx->text) - 1;
+    }
+    memcpy(lx->text, start, len);
+    lx->text[len] = '\0';
+    lx->tok = tok;
+}
+
+static void lex_next(struct Lexer *lx) {
+    while (*lx->p == ' ' || *lx->p == '\t') {
+        lx->p++;
+    }
+    const char *s = lx->p;
+    unsigned char c = (unsigned char)*s;
+
+    if (c == '\0') {
+        lex_take(lx, s, 0, T_END);
+    } else if (c == '(' || c == ')') {
+        lex_take(lx, s, 1, c == '(' ? T_LPAREN : T_RPAREN);
+        lx->p++;
+    } else if (c == '"') {
+        const char *end = strchr(s + 1, '"');
+        if (end == NULL) {
+            lex_error(lx, "Aspas não fechadas.");
+            lex_take(lx, s, 0, T_END);
+            return;
+        }
+        lex_take(lx, s + 1, (size_t)(end - s - 1), T_STRING);
+        lx->p = end + 1;
+    } else if (strchr("=!<>^~", c) != NULL) {
+        size_t len = (s[1] == '=') ? 2 : 1;
+        lex_take(lx, s, len, T_OP);
+        lx->p += len;
+    } else if (c >= '0' && c <= '9') {
+        /* numbers, dates (2024-12-01) and CPFs (123.456.789-09) */
+        size_t len = strspn(s, "0123456789.-/");
+        lex_take(lx, s, len, T_NUMBER);
+        lx->p += len;
+    } else if (is_word_char(c)) {
+        size_t len = 0;
+        while (is_word_char((unsigned char)s[len])) len++;
+        lex_take(lx, s, len, T_WORD);
+        lx->p += len;
+    } else {
+        lex_error(lx, "Caractere inesperado na consulta.");
+        lex_take(lx, s, 0, T_END);
+    }
+}
+
+static int lex_keyword(const struct Lexer *lx, const char *kw) {
+    return lx->tok == T_WORD && strcasecmp(lx->text, kw) == 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Parser                                                                 */
+/* ---------------------------------------------------------------------- */
+
+static struct Query_Node *node_new(enum Query_Node_Kind kind) {
+    struct Query_Node *n = (struct Query_Node *)calloc(1, sizeof(struct Query_Node));
+    if (n == NULL) {
+        exit(1);
+    }
+    n->kind = kind;
+    return n;
+}
+
+static void node_free(struct Query_Node *n) {
+    if (n == NULL) {
+        return;
+    }
+    for (int i = 0; i < n->n_children; i++) {
+        node_free(n->children[i]);
+    }
+    free(n->children);
+    slab_str_free(n->sval);
+    free(n);
+}
+
+static void node_add_child(struct Query_Node *parent, struct Query_Node *child) {
+    /* flatten nested AND/AND and OR/OR */
+    if (child->kind == parent->kind && (child->kind == QN_AND || child->kind == QN_OR)) {
+        for (int i = 0; i < child->n_children; i++) {
+            node_add_child(parent, child->children[i]);
+        }
+        child->n_children = 0;
+        node_free(child);
+        return;
+    }
+    struct Query_Node **grown = (struct Query_Node **)realloc(parent->children,
+                                    sizeof(struct Query_Node *) * (size_t)(parent->n_children + 1));
+    if (grown == NULL) {
+        exit(1);
+    }
+    parent->children = grown;
+    parent->children[parent->n_children++] = child;
+}
+
+/*
+ * Evaluation cost class of a node: indexed lookup < int test < string test < compound.
+ */
+static int node_cost(const struct Query_Node *n) {
+    if (n->kind != QN_PRED) return 3;
+    if (n->col == QC_CPF && n->op == QO_EQ) return 0;
+    if (n->col == QC_ID || n->col == QC_IDADE || n->col == QC_DATA) return 1;
+    return 2;
+}
+
+/* Stable insertion sort of AND terms by cost (AND chains are short) */
+static void order_and_terms(struct Query_Node *n) {
+    for (int i = 1; i < n->n_children; i++) {
+        struct Query_Node *c = n->children[i];
+        int j = i - 1;
+        while (j >= 0 && node_cost(n->children[j]) > node_cost(c)) {
+            n->children[j + 1] = n->children[j];
+            j--;
+        }
+        n->children[j + 1] = c;
+    }
+}
+
+static struct Query_Node *parse_or(struct Lexer *lx);
+
+/*
+ * Read a column name into '*col'. Returns 0 on success, 1 (with error set) otherwise.
+ */
+static int parse_column(struct Lexer *lx, enum Query_Column *col) {
+    if (lx->tok != T_WORD) {
+        lex_error(lx, "Esperado nome de coluna (id, cpf, nome, idade, data).");
+        return 1;
+    }
+    if (strcasecmp(lx->text, "id") == 0) *col = QC_ID;
+    else if (strcasecmp(lx->text, "cpf") == 0) *col = QC_CPF;
+    else if (strcasecmp(lx->text, "nome") == 0) *col = QC_NOME;
+    else if (strcasecmp(lx->text, "idade") == 0) *col = QC_IDADE;
+    else if (strcasecmp(lx->text, "data") == 0) *col = QC_DATA;
+    else {
+        lex_error(lx, "Coluna desconhecida (use id, cpf, nome, idade, data).");
+        return 1;
+    }
+    lex_next(lx);
+    return 0;
+}
+
+static struct Query_Node *parse_pred(struct Lexer *lx) {
+    struct Query_Node *n = node_new(QN_PRED);
+    if (parse_column(lx, &n->col) != 0) {
+        node_free(n);
+        return NULL;
+    }
+
+    if (lx->tok != T_OP) {
+        lex_error(lx, "Esperado operador (= != < <= > >= ^= ~=).");
+        node_free(n);
+        return NULL;
+    }
+    const char *op = lx->text;
+    if (strcmp(op, "=") == 0) n->op = QO_EQ;
+    else if (strcmp(op, "!=") == 0) n->op = QO_NE;
+    else if (strcmp(op, "<") == 0) n->op = QO_LT;
+    else if (strcmp(op, "<=") == 0) n->op = QO_LE;
+    else if (strcmp(op, ">") == 0) n->op = QO_GT;
+    else if (strcmp(op, ">=") == 0) n->op = QO_GE;
+    else if (strcmp(op, "^=") == 0) n->op = QO_PREFIX;
+    else if (strcmp(op, "~=") == 0) n->op = QO_CONTAINS;
+    else {
+        lex_error(lx, "Operador desconhecido.");
+        node_free(n);
+        return NULL;
+    }
+    lex_next(lx);
+
+    if (lx->tok != T_WORD && lx->tok != T_NUMBER && lx->tok != T_STRING) {
+        lex_error(lx, "Esperado valor após o operador.");
+        node_free(n);
+        return NULL;
+    }
+    const char *value = lx->text;
+    int is_int_col = (n->col == QC_ID || n->col == QC_IDADE || n->col == QC_DATA);
+    if (is_int_col && (n->op == QO_PREFIX || n->op == QO_CONTAINS)) {
+        lex_error(lx, "^= e ~= só se aplicam a cpf e nome.");
+        node_free(n);
+        return NULL;
+    }
+    if (n->col == QC_DATA) {
+        n->ival = col_pack_date(value);
+        if (n->ival == COL_NULL) {
+            lex_error(lx, "Data inválida (use AAAA-MM-DD).");
+            node_free(n);
+            return NULL;
+        }
+    } else if (is_int_col) {
+        char *end = NULL;
+        long v = strtol(value, &end, 10);
+        if (end == value || *end != '\0') {
+            lex_error(lx, "Valor numérico inválido.");
+            node_free(n);
+            return NULL;
+        }
+        n->ival = (int)v;
+    } else if (n->col == QC_NOME) {
+        n->sval = fold_key(value, &n->sval_len);
+    } else {
+        n->sval = slab_strdup(value);
+        n->sval_len = (int)strlen(value);
+        n->key = cpf_key(value);
+    }
+    lex_next(lx);
+    return n;
+}
+
+static struct Query_Node *parse_not(struct Lexer *lx) {
+    if (lex_keyword(lx, "NOT")) {
+        lex_next(lx);
+        struct Query_Node *child = parse_not(lx);
+        if (child == NULL) {
+            return NULL;
+        }
+        struct Query_Node *n = node_new(QN_NOT);
+        node_add_child(n, child);
+        return n;
+    }
+    if (lx->tok == T_LPAREN) {
+        lex_next(lx);
+        struct Query_Node *inner = parse_or(lx);
+        if (inner == NULL) {
+            return NULL;
+        }
+        if (lx->tok != T_RPAREN) {
+            lex_error(lx, "Esperado ')'.");
+            node_free(inner);
+            return NULL;
+        }
+        lex_next(lx);
+        return inner;
+    }
+    return parse_pred(lx);
+}
+
+static struct Query_Node *parse_and(struct Lexer *lx) {
+    struct Query_Node *first = parse_not(lx);
+    if (first == NULL || !lex_keyword(lx, "AND")) {
+        return first;
+    }
+    struct Query_Node *n = node_new(QN_AND);
+    node_add_child(n, first);
+    while (lex_keyword(lx, "AND")) {
+        lex_next(lx);
+        struct Query_Node *next = parse_not(lx);
+        if (next == NULL) {
+            node_free(n);
+            return NULL;
+        }
+        node_add_child(n, next);
+    }
+    order_and_terms(n);
+    return n;
+}
+
+static struct Query_Node *parse_or(struct Lexer *lx) {
+    struct Query_Node *first = parse_and(lx);
+    if (first == NULL || !lex_keyword(lx, "OR")) {
+        return first;
+    }
+    struct Query_Node *n = node_new(QN_OR);
+    node_add_child(n, first);
+    while (lex_keyword(lx, "OR")) {
+        lex_next(lx);
+        struct Query_Node *next = parse_and(lx);
+        if (next == NULL) {
+            node_free(n);
+            return NULL;
+        }
+        node_add_child(n, next);
+    }
+    return n;
+}
+
+/*
+ * Parse the optional "ORDER BY <col> [ASC|DESC]" and "LIMIT <k>" clauses.
+ */
+static void parse_order(struct Lexer *lx, struct Query_Plan *plan) {
+    if (lex_keyword(lx, "ORDER")) {
+        lex_next(lx);
+        if (!lex_keyword(lx, "BY")) {
+            lex_error(lx, "Esperado BY após ORDER.");
+            return;
+        }
+        lex_next(lx);
+        if (parse_column(lx, &plan->order_col) != 0) {
+            return;
+        }
+        plan->ordered = 1;
+        if (lex_keyword(lx, "DESC")) {
+            plan->order_desc = 1;
+            lex_next(lx);
+        } else if (lex_keyword(lx, "ASC")) {
+            lex_next(lx);
+        }
+    }
+    if (lex_keyword(lx, "LIMIT")) {
+        lex_next(lx);
+        char *end = NULL;
+        long k = (lx->tok == T_NUMBER) ? strtol(lx->text, &end, 10) : -1;
+        if (k < 0 || end == NULL || *end != '\0') {
+            lex_error(lx, "LIMIT espera um número inteiro.");
+            return;
+        }
+        plan->limit = (int)k;
+        lex_next(lx);
+    }
+}
+
+struct Query_Plan *query_compile(const char *text, char *err, size_t err_size) {
+    struct Lexer lx;
+    lx.p = text;
+    lx.err = err;
+    lx.err_size = err_size;
+    lx.failed = 0;
+    lex_next(&lx);
+
+    struct Query_Plan *plan = (struct Query_Plan *)malloc(sizeof(struct Query_Plan));
+    if (plan == NULL) {
+        exit(1);
+    }
+    plan->root = NULL;
+    plan->ordered = 0;
+    plan->order_col = QC_ID;
+    plan->order_desc = 0;
+    plan->limit = -1;
+
+    /* The filter is optional when the query starts with ORDER or LIMIT */
+    if (!lex_keyword(&lx, "ORDER") && !lex_keyword(&lx, "LIMIT")) {
+        plan->root = parse_or(&lx);
+        if (plan->root == NULL && !lx.failed) {
+            lex_error(&lx, "Consulta inválida.");
+        }
+    }
+    if (!lx.failed) {
+        parse_order(&lx, plan);
+    }
+    if (!lx.failed && lx.tok != T_END) {
+        lex_error(&lx, "Texto inesperado no fim da consulta.");
+    }
+    if (lx.failed) {
+        query_free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void query_free(struct Query_Plan *plan) {
+    if (plan == NULL) {
+        return;
+    }
+    node_free(plan->root);
+    free(plan);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Execution                                                              */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * Run 'cond' for every selected row; 'sel' == NULL selects all n_sel rows.
+ * Matching positions are appended to out[m].
+ */
+#define SEL_LOOP(cond)                                              \
+    do {                                                            \
+        if (sel == NULL) {                                          \
+            for (int i = 0; i < n_sel; i++) {                       \
+                if (cond) out[m++] = i;                             \
+            }                                                       \
+        } else {                                                    \
+            for (int k = 0; k < n_sel; k++) {                       \
+                int i = sel[k];                                     \
+                if (cond) out[m++] = i;                             \
+            }                                                       \
+        }                                                           \
+    } while (0)
+
+/*
+ * Int column test: one loop per operator, nulls never match.
+ */
+static int sel_int(const int *col, enum Query_Op op, int x, const int *sel, int n_sel, int *out) {
+    int m = 0;
+    switch (op) {
+    case QO_EQ: SEL_LOOP(col[i] == x && col[i] != COL_NULL); break;
+    case QO_NE: SEL_LOOP(col[i] != x && col[i] != COL_NULL); break;
+    case QO_LT: SEL_LOOP(col[i] < x && col[i] != COL_NULL); break;
+    case QO_LE: SEL_LOOP(col[i] <= x && col[i] != COL_NULL); break;
+    case QO_GT: SEL_LOOP(col[i] > x); break;   /* COL_NULL is INT_MIN */
+    case QO_GE: SEL_LOOP(col[i] >= x && col[i] != COL_NULL); break;
+    default: break;
+    }
+    return m;
+}
+
+static const char *row_text(struct Dinamic_Vector *dv, int row, int column) {
+    struct Field *f = get_field_by_index(dv, row, column);
+    return (f != NULL && f->type == FIELD_STRING && f->s != NULL) ? f->s : NULL;
+}
+
+static int cmp_text_op(int c, enum Query_Op op) {
+    switch (op) {
+    case QO_EQ: return c == 0;
+    case QO_NE: return c != 0;
+    case QO_LT: return c < 0;
+    case QO_LE: return c <= 0;
+    case QO_GT: return c > 0;
+    case QO_GE: return c >= 0;
+    default: return 0;
+    }
+}
+
+/*
+ * Name test on the folded keys kept in each row.
+ */
+static int sel_nome(struct Dinamic_Vector *dv, const struct Query_Node *p, const int *sel, int n_sel, int *out) {
+    int m = 0;
+    const char *q = p->sval;
+    int q_len = p->sval_len;
+#define NOME_KEY (dv_get(dv, i))
+    switch (p->op) {
+    case QO_PREFIX:
+        SEL_LOOP(fold_has_prefix(NOME_KEY->key, NOME_KEY->key_len, q, q_len));
+        break;
+    case QO_CONTAINS:
+        SEL_LOOP(fold_contains(NOME_KEY->key, NOME_KEY->key_len, q, q_len));
+        break;
+    case QO_EQ:
+        SEL_LOOP(NOME_KEY->key_len == q_len && memcmp(NOME_KEY->key, q, (size_t)q_len) == 0);
+        break;
+    default:
+        SEL_LOOP(cmp_text_op(strcmp(NOME_KEY->key, q), p->op));
+        break;
+    }
+#undef NOME_KEY
+    return m;
+}
+
+/*
+ * CPF test. Equality compares index keys (formatting ignored) and, over the
+ * whole table, is answered by the CPF index instead of a scan: every row
+ * indexed under the key, so a base loaded with repeated CPFs gives the same
+ * rows as the scan.
+ */
+static int sel_cpf(struct Dinamic_Vector *dv, const struct Query_Node *p, const int *sel, int n_sel, int *out) {
+    int m = 0;
+    if (p->op == QO_EQ && sel == NULL) {
+        int slot = -1;
+        int row;
+        while ((row = dv_cpf_next(dv, p->key, &slot)) >= 0) {
+            /* index order is arbitrary: insert to keep 'out' ascending (few rows) */
+            int k = m++;
+            while (k > 0 && out[k - 1] > row) {
+                out[k] = out[k - 1];
+                k--;
+            }
+            out[k] = row;
+        }
+        return m;
+    }
+    const char *t;
+    switch (p->op) {
+    case QO_EQ:
+        SEL_LOOP(cpf_key(row_text(dv, i, 1)) == p->key);
+        break;
+    case QO_NE:
+        SEL_LOOP((t = row_text(dv, i, 1)) != NULL && cpf_key(t) != p->key);
+        break;
+    case QO_PREFIX:
+        SEL_LOOP((t = row_text(dv, i, 1)) != NULL && strncasecmp(t, p->sval, (size_t)p->sval_len) == 0);
+        break;
+    case QO_CONTAINS:
+        SEL_LOOP((t = row_text(dv, i, 1)) != NULL && strstr(t, p->sval) != NULL);
+        break;
+    default:
+        SEL_LOOP((t = row_text(dv, i, 1)) != NULL && cmp_text_op(strcmp(t, p->sval), p->op));
+        break;
+    }
+    return m;
+}
+
+static int *sel_alloc(int n) {
+    int *s = (int *)malloc(sizeof(int) * (size_t)(n > 0 ? n : 1));
+    if (s == NULL) {
+        exit(1);
+    }
+    return s;
+}
+
+/*
+ * Evaluate 'node' over the selection (sel, n_sel) and write the surviving
+ * positions, still ascending, into 'out' (room for n_sel). Returns the count.
+ */
+static int eval_node(const struct Query_Node *node, struct Dinamic_Vector *dv, const struct Int_Columns *cols,
+                     const int *sel, int n_sel, int *out) {
+    switch (node->kind) {
+    case QN_PRED:
+        switch (node->col) {
+        case QC_ID: return sel_int(cols->id, node->op, node->ival, sel, n_sel, out);
+        case QC_IDADE: return sel_int(cols->idade, node->op, node->ival, sel, n_sel, out);
+        case QC_DATA: return sel_int(cols->data, node->op, node->ival, sel, n_sel, out);
+        case QC_NOME: return sel_nome(dv, node, sel, n_sel, out);
+        case QC_CPF: return sel_cpf(dv, node, sel, n_sel, out);
+        }
+        return 0;
+
+    case QN_AND: {
+        /* each term narrows the previous term's output */
+        int *cur = NULL;
+        int n = n_sel;
+        for (int c = 0; c < node->n_children && n > 0; c++) {
+            int *next = sel_alloc(n);
+            n = eval_node(node->children[c], dv, cols, (c == 0) ? sel : cur, n, next);
+            free(cur);
+            cur = next;
+        }
+        if (cur != NULL) {
+            memcpy(out, cur, sizeof(int) * (size_t)n);
+            free(cur);
+        }
+        return n;
+    }
+
+    case QN_OR: {
+        /* union of the children's outputs, merged in order */
+        int n = 0;
+        int *acc = sel_alloc(n_sel);
+        int *part = sel_alloc(n_sel);
+        int *merged = sel_alloc(n_sel);
+        for (int c = 0; c < node->n_children; c++) {
+            int np = eval_node(node->children[c], dv, cols, sel, n_sel, part);
+            int a = 0, b = 0, k = 0;
+            while (a < n || b < np) {
+                if (b >= np || (a < n && acc[a] < part[b])) merged[k++] = acc[a++];
+                else if (a >= n || part[b] < acc[a]) merged[k++] = part[b++];
+                else { merged[k++] = acc[a++]; b++; }
+            }
+            int *t = acc; acc = merged; merged = t;
+            n = k;
+        }
+        memcpy(out, acc, sizeof(int) * (size_t)n);
+        free(acc);
+        free(part);
+        free(merged);
+        return n;
+    }
+
+    case QN_NOT: {
+        /* selection minus the child's output */
+        int *hit = sel_alloc(n_sel);
+        int nh = eval_node(node->children[0], dv, cols, sel, n_sel, hit);
+        int m = 0, h = 0;
+        for (int k = 0; k < n_sel; k++) {
+            int i = (sel == NULL) ? k : sel[k];
+            while (h < nh && hit[h] < i) h++;
+            if (h < nh && hit[h] == i) continue;
+            out[m++] = i;
+        }
+        free(hit);
+        return m;
+    }
+    }
+    return 0;
+}
+
+/*
+ * Narrow [*lo, *hi] by a data predicate that every match must satisfy:
+ * the root itself or a direct term of a root AND.
+ */
+static void date_bounds(const struct Query_Node *p, int *lo, int *hi) {
+    if (p->kind != QN_PRED || p->col != QC_DATA) {
+        return;
+    }
+    switch (p->op) {
+    case QO_EQ: if (p->ival > *lo) *lo = p->ival; if (p->ival < *hi) *hi = p->ival; break;
+    case QO_LT: if (p->ival - 1 < *hi) *hi = p->ival - 1; break;
+    case QO_LE: if (p->ival < *hi) *hi = p->ival; break;
+    case QO_GT: if (p->ival + 1 > *lo) *lo = p->ival + 1; break;
+    case QO_GE: if (p->ival > *lo) *lo = p->ival; break;
+    default: break;
+    }
+}
+
+/*
+ * Start selection from the zone map: rows of the zones whose date range
+ * overlaps the bounds implied by 'root'. Returns NULL (select all) when no
+ * zone can be skipped; otherwise a malloc'd selection of '*n_sel' rows.
+ */
+static int *zone_selection(const struct Query_Node *root, const struct Int_Columns *cols, int *n_sel) {
+    const struct Query_Node *first = (root->kind == QN_AND) ? root->children[0] : root;
+    if (first->kind == QN_PRED && first->col == QC_CPF && first->op == QO_EQ) {
+        return NULL;  /* the CPF index lookup is cheaper than any zone scan */
+    }
+    int lo = INT_MIN, hi = INT_MAX;
+    if (root->kind == QN_AND) {
+        for (int c = 0; c < root->n_children; c++) {
+            date_bounds(root->children[c], &lo, &hi);
+        }
+    } else {
+        date_bounds(root, &lo, &hi);
+    }
+    if (lo == INT_MIN && hi == INT_MAX) {
+        return NULL;
+    }
+    int keep = 0;
+    for (int z = 0; z < cols->n_zones; z++) {
+        const struct Col_Zone *zone = &cols->zones[z];
+        if (zone->min <= hi && zone->max >= lo) {
+            keep += zone->end - zone->begin;
+        }
+    }
+    if (keep == cols->n) {
+        return NULL;
+    }
+    int *sel = sel_alloc(keep);
+    int m = 0;
+    for (int z = 0; z < cols->n_zones; z++) {
+        const struct Col_Zone *zone = &cols->zones[z];
+        if (zone->min <= hi && zone->max >= lo) {
+            for (int i = zone->begin; i < zone->end; i++) {
+                sel[m++] = i;
+            }
+        }
+    }
+    *n_sel = m;
+    return sel;
+}
+
+int query_execute(const struct Query_Plan *plan, struct Dinamic_Vector *dv, int **rows) {
+    const struct Int_Columns *cols = dv_columns(dv);
+    int n = cols->n;
+    int *out = sel_alloc(n);
+    int m = 0;
+    if (plan != NULL && plan->root != NULL) {
+        int n_sel = n;
+        int *sel = zone_selection(plan->root, cols, &n_sel);
+        m = (n_sel > 0) ? eval_node(plan->root, dv, cols, sel, n_sel, out) : 0;
+        free(sel);
+    } else if (plan != NULL) {
+        for (m = 0; m < n; m++) {
+            out[m] = m;
+        }
+    }
+    if (plan != NULL && plan->ordered) {
+        m = order_rows(dv, out, m, plan->order_col, plan->order_desc, plan->limit);
+    } else if (plan != NULL && plan->limit >= 0 && plan->limit < m) {
+        m = plan->limit;
+    }
+    *rows = out;
+    return m;
+}
+
+int query_run(struct Dinamic_Vector *dv, const char *text, int timed, FILE *out) {
+    char err[128];
+    struct Query_Plan *plan = query_compile(text, err, sizeof(err));
+    if (plan == NULL) {
+        fprintf(out, "Erro na consulta: %s\n", err);
+        return 1;
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int *rows = NULL;
+    int found = query_execute(plan, dv, &rows);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    schema_print_header(out);
+    for (int k = 0; k < found; k++) {
+        ll_fprint(out, dv_get(dv, rows[k]));
+    }
+    if (timed) {
+        double ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+        fprintf(out, "(%d registro(s), %.3f ms)\n", found, ms);
+    } else {
+        fprintf(out, "(%d registro(s))\n", found);
+    }
+
+    free(rows);
+    query_free(plan);
+    return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdio.h>
+
+struct Dinamic_Vector;
+
+/*
+ * Filter queries over the patient columns, e.g.
+ *
+ *     idade>=60 AND nome^="Maria" AND data>=2024-12-01
+ *     (cpf=123.456.789-09 OR nome~=silva) AND NOT idade<18
+ *
+ * Columns: id, cpf, nome, idade, data.
+ * Operators: = != < <= > >= on every column (data compares as a date),
+ *            ^= (starts with) and ~= (contains) on cpf and nome.
+ * Names compare on folded keys (accents/case ignored). AND binds tighter
+ * than OR; keywords are case-insensitive; strings may be "quoted".
+ *
+ * The filter may be followed (or replaced) by ordering clauses:
+ *
+ *     idade>=60 ORDER BY data DESC LIMIT 10
+ *     ORDER BY nome
+ *
+ * See order.h for how rows are ordered.
+ *
+ * A query is compiled once into a plan. AND chains are flattened and their
+ * terms ordered by cost: an indexed lookup (cpf=...) first, then int column
+ * tests, then string tests. Execution narrows a selection vector of row
+ * positions term by term, each test being a tight loop for one column/op.
+ */
+
+enum Query_Column { QC_ID, QC_CPF, QC_NOME, QC_IDADE, QC_DATA };
+
+enum Query_Op { QO_EQ, QO_NE, QO_LT, QO_LE, QO_GT, QO_GE, QO_PREFIX, QO_CONTAINS };
+
+enum Query_Node_Kind { QN_PRED, QN_AND, QN_OR, QN_NOT };
+
+struct Query_Node {
+    enum Query_Node_Kind kind;
+    /* QN_AND / QN_OR: 'n_children' children, in evaluation order; QN_NOT: one child */
+    struct Query_Node **children;
+    int n_children;
+    /* QN_PRED */
+    enum Query_Column col;
+    enum Query_Op op;
+    int ival;                 /* id/idade value, or packed date */
+    char *sval;               /* cpf text, or folded name (fold_key buffer) */
+    int sval_len;
+    unsigned long long key;   /* cpf_key(sval) for cpf predicates */
+};
+
+struct Query_Plan {
+    struct Query_Node *root;        /* NULL: every row */
+    int ordered;                    /* ORDER BY given */
+    enum Query_Column order_col;
+    int order_desc;
+    int limit;                      /* LIMIT k, or -1 */
+};
+
+/**
+ * Compile 'text' into a plan. On a syntax error returns NULL and writes a
+ * message into 'err' (at most 'err_size' bytes).
+ * If malloc fails, exits(1).
+ */
+struct Query_Plan *query_compile(const char *text, char *err, size_t err_size);
+
+/**
+ * Run 'plan' against 'dv'. '*rows' receives a malloc'd array (caller frees)
+ * with the matching row positions, in vector order unless the plan has ORDER BY.
+ * Returns the number of matches.
+ */
+int query_execute(const struct Query_Plan *plan, struct Dinamic_Vector *dv, int **rows);
+
+/**
+ * Compile, run and print the matching rows to 'out', then their count and,
+ * if 'timed', the execution time (off in batch mode).
+ * Returns 0 on success; returns 1 (after printing the error) on a bad query.
+ */
+int query_run(struct Dinamic_Vector *dv, const char *text, int timed, FILE *out);
+
+/**
+ * Free a plan. Safe if plan==NULL.
+ */
+void query_free(struct Query_Plan *plan);
+
+#endif /* QUERY_H */
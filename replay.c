@@ -0,0 +1,376 @@
+/*
+ * Load driver: replays session traces recorded with --gravar (see trace.h)
+ * against a store loaded from a CSV, and reports throughput and latency
+ * percentiles per operation type.
+ *
+ *     Hospital_Patients_Replay <trace> [--base=arquivo.csv] [--max | --escala=F]
+ *                              [--clientes=N] [--lazy | --paginado[=N]]
+ *
+ * Pacing: by default each operation is issued at its recorded time; with
+ * --escala=F the recorded gaps are divided by F, and with --max every
+ * operation is issued as soon as the previous one returns.
+ *
+ * --clientes=N runs N virtual clients, each replaying the whole trace on
+ * its own thread against the same store. Every operation, reads included,
+ * runs under one mutex: the store's read paths are not safe to run
+ * concurrently (the CPF and trigram indexes, the column cache and the
+ * lazy/paged row caches are built or filled on first use), so clients are
+ * serialized and the time spent waiting for the mutex counts as latency.
+ * The report header says so; the figures measure a single-threaded store
+ * under N clients' load, not parallel reads. When pacing, latency is
+ * measured from the operation's scheduled time, not from when a late client
+ * got around to issuing it, so a stall shows up in the tail.
+ *
+ * Output of the operations goes to /dev/null; the store is never saved.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "aggregate.h"
+#include "cursor.h"
+#include "dinamic_vector.h"
+#include "extsort.h"
+#include "ingest.h"
+#include "memstat.h"
+#include "query.h"
+#include "schema.h"
+#include "trace.h"
+#include "trigram.h"
+
+#define REPLAY_MAX_CLIENTS 256
+
+/* Latencies of one operation type, in microseconds */
+struct Latencies {
+    double *v;
+    int n;
+    int cap;
+    int failed;
+};
+
+struct Replay {
+    struct Dinamic_Vector *dv;
+    pthread_mutex_t lock;       /* one operation on the store at a time */
+    const struct Trace_Event *ev;
+    int n_ev;
+    double scale;               /* speed factor; 0: as fast as possible */
+    struct timespec start;
+    FILE *sink;
+};
+
+struct Client {
+    struct Replay *r;
+    struct Latencies lat[TR_OPS];
+};
+
+static double elapsed_us(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) * 1e6 + (to->tv_nsec - from->tv_nsec) / 1e3;
+}
+
+static void lat_add(struct Latencies *l, double us) {
+    if (l->n == l->cap) {
+        l->cap = (l->cap > 0) ? 2 * l->cap : 64;
+        double *grown = (double *)realloc(l->v, sizeof(double) * (size_t)l->cap);
+        if (grown == NULL) {
+            exit(1);
+        }
+        l->v = grown;
+    }
+    l->v[l->n++] = us;
+}
+
+static const char *arg(const struct Trace_Event *e, int k) {
+    return (k < e->n_args) ? e->args[k] : NULL;
+}
+
+static int replay_consult(struct Replay *r, const struct Trace_Event *e, int column, int substring) {
+    if (arg(e, 0) == NULL) {
+        return 1;
+    }
+    int pages = (arg(e, 1) != NULL) ? atoi(arg(e, 1)) : 1;
+    struct Consult_Cursor *c = cursor_open(r->dv, column, substring, arg(e, 0));
+    if (c == NULL) {
+        return 1;
+    }
+    for (int p = 0; p < (pages > 0 ? pages : 1); p++) {
+        cursor_print_page(c, r->dv, TRACE_PAGE_ROWS, r->sink);
+        if (!cursor_has_more(c, r->dv)) {
+            break;
+        }
+    }
+    cursor_close(c);
+    return 0;
+}
+
+/*
+ * Run one traced operation on the store (lock held).
+ * Returns 0 if the store accepted it, 1 if it failed or was refused.
+ */
+static int replay_op(struct Replay *r, const struct Trace_Event *e) {
+    struct Dinamic_Vector *dv = r->dv;
+    switch (e->op) {
+    case TR_CONSULTA_NOME:
+        return replay_consult(r, e, PC_NOME, 0);
+    case TR_CONSULTA_CPF:
+        return replay_consult(r, e, PC_CPF, 0);
+    case TR_CONSULTA_TRECHO:
+        return replay_consult(r, e, PC_NOME, 1);
+    case TR_CONSULTA_APROX:
+        if (arg(e, 0) == NULL) {
+            return 1;
+        }
+        tri_consult(dv, arg(e, 0), 5, r->sink);  /* what menu option 1-4 runs */
+        return 0;
+    case TR_ATUALIZA: {
+        int id = (arg(e, 0) != NULL) ? atoi(arg(e, 0)) : 0;
+        if (e->n_args < 5 || id < 1 || id > dv_size(dv)) {
+            return 1;
+        }
+        return dv_update(dv, id - 1, arg(e, 1), arg(e, 2), arg(e, 3), arg(e, 4)) != 0;
+    }
+    case TR_REMOVE: {
+        int id = (arg(e, 0) != NULL) ? atoi(arg(e, 0)) : 0;
+        if (id < 1 || id > dv_size(dv)) {
+            return 1;
+        }
+        return dv_remove(dv, id - 1) != 0;
+    }
+    case TR_INSERE: {
+        if (e->n_args < 4) {
+            return 1;
+        }
+        char id[16];
+        snprintf(id, sizeof(id), "%d", dv_size(dv) + 1);
+        const char *vals[PC_COUNT] = {NULL};
+        vals[PC_ID] = id;
+        vals[PC_CPF] = arg(e, 0);
+        vals[PC_NOME] = arg(e, 1);
+        vals[PC_IDADE] = arg(e, 2);
+        vals[PC_DATA] = arg(e, 3);
+        struct LinkedList *row = schema_row_from_texts(vals);
+        if (dv_insert_unique(dv, row) != 0) {
+            ll_free(row);
+            return 1;
+        }
+        return 0;
+    }
+    case TR_IMPRIME:
+        for (int i = 0; i < dv_size(dv); i++) {
+            ll_fprint(r->sink, dv_get(dv, i));
+        }
+        return 0;
+    case TR_ESTATISTICA:
+        return arg(e, 0) == NULL || agg_run(dv, arg(e, 0), 0, r->sink) != 0;
+    case TR_FILTRA:
+        return arg(e, 0) == NULL || query_run(dv, arg(e, 0), 0, r->sink) != 0;
+    case TR_IMPORTA:
+        return arg(e, 0) == NULL || ingest_import_csv(dv, arg(e, 0), 0, 0, r->sink) != 0;
+    case TR_MESCLA:
+        return arg(e, 0) == NULL || ext_import_csv(dv, arg(e, 0), 0, NULL, NULL) != 0;
+    case TR_MEMORIA: {
+        struct Mem_Report mr;
+        mem_measure(dv, &mr);
+        mem_report(&mr, r->sink);
+        return 0;
+    }
+    default:
+        return 1;
+    }
+}
+
+static void *client_run(void *arg_ptr) {
+    struct Client *c = (struct Client *)arg_ptr;
+    struct Replay *r = c->r;
+    for (int i = 0; i < r->n_ev; i++) {
+        const struct Trace_Event *e = &r->ev[i];
+        struct timespec issue;
+        if (r->scale > 0) {
+            /* wait for the scheduled time; latency counts from it */
+            long long due_ns = (long long)((double)e->usec * 1e3 / r->scale);
+            issue = r->start;
+            issue.tv_sec += (time_t)(due_ns / 1000000000LL);
+            issue.tv_nsec += (long)(due_ns % 1000000000LL);
+            if (issue.tv_nsec >= 1000000000L) {
+                issue.tv_sec++;
+                issue.tv_nsec -= 1000000000L;
+            }
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &issue, NULL) == EINTR) {
+                /* interrupted: sleep again until the same instant */
+            }
+        } else {
+            clock_gettime(CLOCK_MONOTONIC, &issue);
+        }
+        pthread_mutex_lock(&r->lock);
+        int failed = replay_op(r, e);
+        pthread_mutex_unlock(&r->lock);
+        struct timespec done;
+        clock_gettime(CLOCK_MONOTONIC, &done);
+        lat_add(&c->lat[e->op], elapsed_us(&issue, &done));
+        c->lat[e->op].failed += failed;
+    }
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of the sorted 'v' */
+static double percentile(const double *v, int n, double q) {
+    int k = (int)(q * n + 0.999999) - 1;
+    if (k < 0) {
+        k = 0;
+    }
+    return v[k < n ? k : n - 1];
+}
+
+static void report_line(FILE *out, const char *name, struct Latencies *l, double wall_s) {
+    qsort(l->v, (size_t)l->n, sizeof(double), cmp_double);
+    double sum = 0;
+    for (int k = 0; k < l->n; k++) {
+        sum += l->v[k];
+    }
+    fprintf(out, "%-16s %8d %7d %10.1f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", name, l->n, l->failed,
+            wall_s > 0 ? l->n / wall_s : 0.0, sum / l->n / 1e3,
+            percentile(l->v, l->n, 0.50) / 1e3, percentile(l->v, l->n, 0.95) / 1e3,
+            percentile(l->v, l->n, 0.99) / 1e3, percentile(l->v, l->n, 0.999) / 1e3, l->v[l->n - 1] / 1e3);
+}
+
+static void usage(void) {
+    printf("Uso: Hospital_Patients_Replay <trace> [--base=arquivo.csv] [--max | --escala=F]\n"
+           "                                [--clientes=N] [--lazy | --paginado[=N]]\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *trace_path = NULL;
+    const char *base = "bd_paciente.csv";
+    double scale = 1.0;
+    int clients = 1;
+    int lazy = 0;
+    int paged_frames = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--base=", 7) == 0) {
+            base = argv[i] + 7;
+        } else if (strcmp(argv[i], "--max") == 0) {
+            scale = 0;
+        } else if (strncmp(argv[i], "--escala=", 9) == 0) {
+            scale = atof(argv[i] + 9);
+            if (scale <= 0) {
+                usage();
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--clientes=", 11) == 0) {
+            clients = atoi(argv[i] + 11);
+            if (clients < 1 || clients > REPLAY_MAX_CLIENTS) {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--lazy") == 0) {
+            lazy = 1;
+        } else if (strncmp(argv[i], "--paginado", 10) == 0) {
+            paged_frames = (argv[i][10] == '=') ? atoi(argv[i] + 11) : 0;
+            if (paged_frames <= 0) {
+                paged_frames = 1024;
+            }
+        } else if (argv[i][0] != '-' && trace_path == NULL) {
+            trace_path = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (trace_path == NULL) {
+        usage();
+        return 1;
+    }
+
+    struct Replay r;
+    struct Trace_Event *ev = NULL;
+    if (trace_load(trace_path, &ev, &r.n_ev) != 0) {
+        printf("Não foi possível ler a gravação %s.\n", trace_path);
+        return 1;
+    }
+    r.ev = ev;
+    r.dv = dv_create();
+    int load_status = paged_frames > 0 ? dv_read_from_csv_paged(r.dv, base, paged_frames, 4 * paged_frames)
+                    : lazy ? dv_read_from_csv_lazy(r.dv, base)
+                           : dv_read_from_csv(r.dv, base);
+    if (load_status != 0) {
+        printf("Erro ao carregar %s.\n", base);
+        trace_free_events(ev, r.n_ev);
+        dv_free(r.dv);
+        return 1;
+    }
+    r.sink = fopen("/dev/null", "w");
+    if (r.sink == NULL && (r.sink = tmpfile()) == NULL) {
+        printf("Não foi possível abrir a saída descartável.\n");
+        return 1;
+    }
+    r.scale = scale;
+    pthread_mutex_init(&r.lock, NULL);
+
+    struct Client *c = (struct Client *)calloc((size_t)clients, sizeof(struct Client));
+    pthread_t *tid = (pthread_t *)malloc(sizeof(pthread_t) * (size_t)clients);
+    if (c == NULL || tid == NULL) {
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &r.start);
+    for (int k = 0; k < clients; k++) {
+        c[k].r = &r;
+        if (pthread_create(&tid[k], NULL, client_run, &c[k]) != 0) {
+            printf("Não foi possível iniciar o cliente %d.\n", k + 1);
+            exit(1);
+        }
+    }
+    for (int k = 0; k < clients; k++) {
+        pthread_join(tid[k], NULL);
+    }
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double wall_s = elapsed_us(&r.start, &end) / 1e6;
+
+    /* merge the clients' latencies per operation, and all of them for the total */
+    struct Latencies all = {NULL, 0, 0, 0};
+    if (scale > 0) {
+        printf("Reprodução: %d cliente(s) x %d operação(ões), velocidade x%.2f, %.3f s\n", clients, r.n_ev, scale, wall_s);
+    } else {
+        printf("Reprodução: %d cliente(s) x %d operação(ões), velocidade máxima, %.3f s\n", clients, r.n_ev, wall_s);
+    }
+    if (clients > 1) {
+        printf("Operações serializadas: um cliente por vez na base (leituras inclusive); a espera conta na latência.\n");
+    }
+    /* the widths of the accented titles count their extra UTF-8 bytes */
+    printf("%-18s %8s %7s %10s %10s %9s %9s %9s %9s %10s\n", "Operação", "Qtde", "Falhas", "ops/s",
+           "média ms", "p50 ms", "p95 ms", "p99 ms", "p99.9 ms", "máx ms");
+    for (int op = 0; op < TR_OPS; op++) {
+        struct Latencies merged = {NULL, 0, 0, 0};
+        for (int k = 0; k < clients; k++) {
+            for (int j = 0; j < c[k].lat[op].n; j++) {
+                lat_add(&merged, c[k].lat[op].v[j]);
+                lat_add(&all, c[k].lat[op].v[j]);
+            }
+            merged.failed += c[k].lat[op].failed;
+            free(c[k].lat[op].v);
+        }
+        all.failed += merged.failed;
+        if (merged.n > 0) {
+            report_line(stdout, trace_op_names[op], &merged, wall_s);
+        }
+        free(merged.v);
+    }
+    if (all.n > 0) {
+        report_line(stdout, "Total", &all, wall_s);
+    }
+    free(all.v);
+
+    free(c);
+    free(tid);
+    fclose(r.sink);
+    pthread_mutex_destroy(&r.lock);
+    trace_free_events(ev, r.n_ev);
+    dv_free_all(r.dv);
+    return 0;
+}
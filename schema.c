@@ -0,0 +1,210 @@
+#include "schema.h"
+#include "linkedlist.h"
+#include "slab.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Per-kind building blocks. Every generated routine below is the
+ * PATIENT_SCHEMA list expanded over one of these, so a row is handled
+ * column after column with the kind fixed at compile time.
+ */
+
+static struct Field parse_INT(const char *text, size_t len) {
+    struct Field f;
+    f.type = (len > 0) ? FIELD_INT : FIELD_NULL;
+    f.i = (len > 0) ? atoi(text) : 0;  /* atoi stops at the delimiter */
+    f.s = NULL;
+    return f;
+}
+
+static struct Field parse_STR(const char *text, size_t len) {
+    struct Field f;
+    f.i = 0;
+    if (len == 0) {
+        f.type = FIELD_NULL;
+        f.s = NULL;
+        return f;
+    }
+    f.type = FIELD_STRING;
+    f.s = slab_strndup(text, len);
+    return f;
+}
+
+static void write_INT(FILE *fp, const struct Field *f) {
+    if (f != NULL && f->type == FIELD_INT) {
+        fprintf(fp, "%d", f->i);
+    }
+}
+
+static void write_STR(FILE *fp, const struct Field *f) {
+    if (f != NULL && f->type == FIELD_STRING && f->s != NULL) {
+        fputs(f->s, fp);
+    }
+}
+
+static void print_INT(FILE *out, const struct Field *f) {
+    if (f != NULL && f->type == FIELD_INT) {
+        fprintf(out, "%d ", f->i);
+    }
+}
+
+static void print_STR(FILE *out, const struct Field *f) {
+    if (f != NULL && f->type == FIELD_STRING && f->s != NULL) {
+        fprintf(out, "%s ", f->s);
+    }
+}
+
+static int cmp_INT(const struct Field *a, const struct Field *b) {
+    int na = (a == NULL || a->type != FIELD_INT);
+    int nb = (b == NULL || b->type != FIELD_INT);
+    if (na || nb) {
+        return nb - na;
+    }
+    return (a->i > b->i) - (a->i < b->i);
+}
+
+static int cmp_STR(const struct Field *a, const struct Field *b) {
+    int na = (a == NULL || a->type != FIELD_STRING || a->s == NULL);
+    int nb = (b == NULL || b->type != FIELD_STRING || b->s == NULL);
+    if (na || nb) {
+        return nb - na;
+    }
+    return strcmp(a->s, b->s);
+}
+
+/* A value that replaces the current one in schema_update_row */
+static int is_change(const char *v) {
+    return v != NULL && strcmp(v, "-") != 0;
+}
+
+void schema_fields(const struct LinkedList *row, const struct Field *f[PC_COUNT]) {
+    const struct ListNode *node = (row != NULL) ? row->first : NULL;
+    for (int c = 0; c < PC_COUNT; c++) {
+        f[c] = (node != NULL) ? &node->field : NULL;
+        if (node != NULL) {
+            node = node->next;
+        }
+    }
+}
+
+static void row_fields_mut(struct LinkedList *row, struct Field *f[PC_COUNT]) {
+    struct ListNode *node = row->first;
+    for (int c = 0; c < PC_COUNT; c++) {
+        f[c] = (node != NULL) ? &node->field : NULL;
+        if (node != NULL) {
+            node = node->next;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* Generated routines                                                     */
+/* ---------------------------------------------------------------------- */
+
+struct LinkedList *schema_parse_row(const char *line) {
+    struct LinkedList *row = ll_create();
+    const char *p = line;
+    size_t len;
+#define PARSE_COLUMN(name, header, kind)                 \
+    len = strcspn(p, ",\r\n");                           \
+    ll_append_field(row, parse_##kind(p, len));          \
+    p += len;                                            \
+    if (*p != '\0') {                                    \
+        p++;                                             \
+    }
+    PATIENT_SCHEMA(PARSE_COLUMN)
+#undef PARSE_COLUMN
+    (void)p;
+    ll_refresh_key(row);
+    return row;
+}
+
+struct LinkedList *schema_row_from_texts(const char *const vals[PC_COUNT]) {
+    struct LinkedList *row = ll_create();
+#define TEXT_COLUMN(name, header, kind)                                          \
+    ll_append_field(row, parse_##kind(vals[PC_##name] != NULL ? vals[PC_##name] : "", \
+                                      vals[PC_##name] != NULL ? strlen(vals[PC_##name]) : 0));
+    PATIENT_SCHEMA(TEXT_COLUMN)
+#undef TEXT_COLUMN
+    ll_refresh_key(row);
+    return row;
+}
+
+void schema_update_row(struct LinkedList *row, const char *const vals[PC_COUNT]) {
+    if (row == NULL) {
+        return;
+    }
+    struct Field *f[PC_COUNT];
+    row_fields_mut(row, f);
+#define UPDATE_COLUMN(name, header, kind)                                        \
+    if (f[PC_##name] != NULL && is_change(vals[PC_##name])) {                    \
+        if (f[PC_##name]->type == FIELD_STRING) {                                \
+            slab_str_free(f[PC_##name]->s);                                      \
+        }                                                                        \
+        *f[PC_##name] = parse_##kind(vals[PC_##name], strlen(vals[PC_##name]));  \
+    }
+    PATIENT_SCHEMA(UPDATE_COLUMN)
+#undef UPDATE_COLUMN
+    if (is_change(vals[PC_NOME])) {
+        ll_refresh_key(row);
+    }
+}
+
+#define HEADER_TEXT(name, header, kind) "," header
+static const char header_line[] = PATIENT_SCHEMA(HEADER_TEXT) "\n";
+#undef HEADER_TEXT
+#define TITLE_TEXT(name, header, kind) " " header
+static const char title_line[] = PATIENT_SCHEMA(TITLE_TEXT) "\n";
+#undef TITLE_TEXT
+
+void schema_write_header(FILE *fp) {
+    fputs(header_line + 1, fp);  /* skip the leading comma */
+}
+
+void schema_print_header(FILE *out) {
+    fputs(title_line + 1, out);
+}
+
+void schema_write_row(FILE *fp, const struct LinkedList *row) {
+    const struct Field *f[PC_COUNT];
+    schema_fields(row, f);
+#define WRITE_COLUMN(name, header, kind) \
+    if (PC_##name > 0) {                 \
+        putc(',', fp);                   \
+    }                                    \
+    write_##kind(fp, f[PC_##name]);
+    PATIENT_SCHEMA(WRITE_COLUMN)
+#undef WRITE_COLUMN
+    putc('\n', fp);
+}
+
+void schema_print_row(FILE *out, const struct LinkedList *row) {
+    if (row != NULL) {
+        const struct Field *f[PC_COUNT];
+        schema_fields(row, f);
+#define PRINT_COLUMN(name, header, kind) print_##kind(out, f[PC_##name]);
+        PATIENT_SCHEMA(PRINT_COLUMN)
+#undef PRINT_COLUMN
+    }
+    fprintf(out, "\n");
+}
+
+static const struct Field *column_of(const struct LinkedList *row, int col) {
+    const struct ListNode *node = (row != NULL) ? row->first : NULL;
+    for (int c = 0; c < col && node != NULL; c++) {
+        node = node->next;
+    }
+    return (node != NULL) ? &node->field : NULL;
+}
+
+#define CMP_COLUMN(name, header, kind)                                             \
+    int schema_cmp_##name(const struct LinkedList *a, const struct LinkedList *b) { \
+        return cmp_##kind(column_of(a, PC_##name), column_of(b, PC_##name));       \
+    }
+PATIENT_SCHEMA(CMP_COLUMN)
+#undef CMP_COLUMN
+
+#define CMP_ENTRY(name, header, kind) schema_cmp_##name,
+const Schema_Cmp schema_cmp[PC_COUNT] = { PATIENT_SCHEMA(CMP_ENTRY) };
+#undef CMP_ENTRY
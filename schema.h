@@ -0,0 +1,103 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include <stdio.h>
+
+struct LinkedList;
+struct Field;
+
+/*
+ * The patient record, declared once. Each X(name, header, kind) entry is
+ * one column, in file order: 'header' is its CSV header text and 'kind'
+ * is INT (FIELD_INT, parsed with atoi) or STR (FIELD_STRING). An empty
+ * value is FIELD_NULL in either kind.
+ *
+ * schema.c expands this list into straight-line parse, write, print and
+ * compare code per column (no loop over a column table, no switch on the
+ * type), so adding a column is one more X(...) line here. Code that needs
+ * a particular column names it with its PC_* constant.
+ */
+#define PATIENT_SCHEMA(X)                  \
+    X(ID,    "ID",            INT)         \
+    X(CPF,   "CPF",           STR)         \
+    X(NOME,  "Nome",          STR)         \
+    X(IDADE, "Idade",         INT)         \
+    X(DATA,  "Data_Cadastro", STR)
+
+#define PC_ENUM(name, header, kind) PC_##name,
+enum Patient_Column {
+    PATIENT_SCHEMA(PC_ENUM)
+    PC_COUNT
+};
+#undef PC_ENUM
+
+/**
+ * Build a row from one CSV data line (commas separate the columns; a line
+ * break or the end of the string ends the last one). Missing trailing
+ * columns are FIELD_NULL, extra ones are ignored. The folded name key is
+ * set. Reentrant.
+ * If malloc fails, exits(1).
+ */
+struct LinkedList *schema_parse_row(const char *line);
+
+/**
+ * Build a row from one text value per column, converted as the parser
+ * does; NULL or "" gives FIELD_NULL.
+ * If malloc fails, exits(1).
+ */
+struct LinkedList *schema_row_from_texts(const char *const vals[PC_COUNT]);
+
+/**
+ * Replace the columns of 'row' whose value in 'vals' is neither NULL nor
+ * "-", converted as the parser does. The folded name key is refreshed when
+ * the name changes. Columns missing from 'row' are left alone.
+ * If malloc fails, exits(1).
+ */
+void schema_update_row(struct LinkedList *row, const char *const vals[PC_COUNT]);
+
+/**
+ * Point f[c] at column c of 'row' (NULL where the row is shorter).
+ */
+void schema_fields(const struct LinkedList *row, const struct Field *f[PC_COUNT]);
+
+/**
+ * Write the header line ("ID,CPF,...\n").
+ */
+void schema_write_header(FILE *fp);
+
+/**
+ * Print the column headers separated by spaces, then a newline (the title
+ * line of schema_print_row listings).
+ */
+void schema_print_header(FILE *out);
+
+/**
+ * Write 'row' as one CSV data line, newline included; FIELD_NULL and
+ * missing columns are written empty.
+ */
+void schema_write_row(FILE *fp, const struct LinkedList *row);
+
+/**
+ * Print the non-null columns of 'row' separated (and followed) by a
+ * space, then a newline. A NULL row prints just the newline.
+ */
+void schema_print_row(FILE *out, const struct LinkedList *row);
+
+/*
+ * Per-column comparison, one function per schema entry: INT columns
+ * compare numerically, STR columns with strcmp; FIELD_NULL sorts first.
+ * Returns <0, 0 or >0 like strcmp.
+ */
+#define PC_CMP_DECL(name, header, kind) \
+    int schema_cmp_##name(const struct LinkedList *a, const struct LinkedList *b);
+PATIENT_SCHEMA(PC_CMP_DECL)
+#undef PC_CMP_DECL
+
+typedef int (*Schema_Cmp)(const struct LinkedList *a, const struct LinkedList *b);
+
+/**
+ * schema_cmp[c] is the comparison of column c.
+ */
+extern const Schema_Cmp schema_cmp[PC_COUNT];
+
+#endif /* SCHEMA_H */
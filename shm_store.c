@@ -0,0 +1,571 @@
+#include "shm_store.h"
+#include "columns.h"
+#include "dinamic_vector.h"
+#include "schema.h"
+#include "slab.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SHM_MAGIC 0x324D5048u        /* "HPM2" */
+#define SHM_ATTACH_TRIES 500         /* x 10 ms waiting for a loader to finish */
+
+struct Shm_Header {
+    unsigned magic;
+    volatile int ready;              /* set last by the loader */
+    volatile pid_t loader;           /* process building the segment; -1 once reclaimed */
+    pthread_rwlock_t lock;           /* PTHREAD_PROCESS_SHARED */
+    unsigned long epoch;             /* bumped by every write */
+    int n;                           /* records in use */
+    int row_cap;
+    int table_cap;                   /* power of two, >= 2 * row_cap */
+    size_t heap_used;                /* offset 0 is reserved: it means "no string" */
+    size_t heap_cap;
+    size_t rows_off;                 /* offsets from the start of the segment */
+    size_t keys_off;
+    size_t slots_off;
+    size_t heap_off;
+};
+
+/*
+ * One row. Strings are offsets into the heap; 'null_mask' bit c is set
+ * when column c is empty.
+ */
+struct Shm_Row {
+    int id;
+    int idade;
+    int data;                        /* packed YYYYMMDD, COL_NULL if none */
+    int null_mask;
+    size_t cpf;
+    size_t nome;
+    size_t date;
+    unsigned long long cpf_key;
+};
+
+static struct Shm_Row *shm_rows(struct Shm_Store *s) {
+    return (struct Shm_Row *)(s->base + s->hdr->rows_off);
+}
+
+static unsigned long long *shm_keys(struct Shm_Store *s) {
+    return (unsigned long long *)(s->base + s->hdr->keys_off);
+}
+
+static int *shm_slots(struct Shm_Store *s) {
+    return (int *)(s->base + s->hdr->slots_off);
+}
+
+static char *shm_heap(struct Shm_Store *s) {
+    return s->base + s->hdr->heap_off;
+}
+
+static size_t align16(size_t x) {
+    return (x + 15) & ~(size_t)15;
+}
+
+/* ---------------------------------------------------------------------- */
+/* CPF table: linear probing, deletion by backward shift (no tombstones)  */
+/* ---------------------------------------------------------------------- */
+
+static int tab_home(const struct Shm_Store *s, unsigned long long key) {
+    unsigned long long h = key * 0x9E3779B97F4A7C15ULL;
+    return (int)((h >> 32) & (unsigned long long)(s->hdr->table_cap - 1));
+}
+
+static void tab_add(struct Shm_Store *s, unsigned long long key, int row) {
+    if (key == 0) {
+        return;
+    }
+    unsigned long long *keys = shm_keys(s);
+    int mask = s->hdr->table_cap - 1;
+    int slot = tab_home(s, key);
+    while (keys[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    keys[slot] = key;
+    shm_slots(s)[slot] = row;
+}
+
+static void tab_remove(struct Shm_Store *s, unsigned long long key, int row) {
+    if (key == 0) {
+        return;
+    }
+    unsigned long long *keys = shm_keys(s);
+    int *rows = shm_slots(s);
+    int mask = s->hdr->table_cap - 1;
+    int i = tab_home(s, key);
+    while (keys[i] != 0 && !(keys[i] == key && rows[i] == row)) {
+        i = (i + 1) & mask;
+    }
+    if (keys[i] == 0) {
+        return;
+    }
+    /* pull back later entries of the cluster that may no longer be reachable */
+    for (int j = (i + 1) & mask; keys[j] != 0; j = (j + 1) & mask) {
+        int home = tab_home(s, keys[j]);
+        int reachable = (i <= j) ? (home > i && home <= j) : (home > i || home <= j);
+        if (!reachable) {
+            keys[i] = keys[j];
+            rows[i] = rows[j];
+            i = j;
+        }
+    }
+    keys[i] = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Records                                                                */
+/* ---------------------------------------------------------------------- */
+
+static const char *field_text(const struct Field *f) {
+    return (f != NULL && f->type == FIELD_STRING && f->s != NULL) ? f->s : NULL;
+}
+
+static size_t heap_put(struct Shm_Store *s, const char *text) {
+    if (text == NULL) {
+        return 0;
+    }
+    size_t at = s->hdr->heap_used;
+    size_t len = strlen(text) + 1;
+    memcpy(shm_heap(s) + at, text, len);
+    s->hdr->heap_used += len;
+    return at;
+}
+
+/*
+ * Fill 'r' from 'row', copying its strings into the heap.
+ * Returns SHM_FULL (nothing written) if the strings do not fit.
+ */
+static int record_put(struct Shm_Store *s, struct Shm_Row *r, const struct LinkedList *row) {
+    const struct Field *f[PC_COUNT];
+    schema_fields(row, f);
+    size_t need = 0;
+    for (int c = PC_CPF; c < PC_COUNT; c++) {
+        const char *t = field_text(f[c]);
+        if (t != NULL) {
+            need += strlen(t) + 1;
+        }
+    }
+    if (s->hdr->heap_used + need > s->hdr->heap_cap) {
+        return SHM_FULL;
+    }
+    r->null_mask = 0;
+    for (int c = 0; c < PC_COUNT; c++) {
+        int empty = (f[c] == NULL || f[c]->type == FIELD_NULL || (f[c]->type == FIELD_STRING && f[c]->s == NULL));
+        if (empty) {
+            r->null_mask |= 1 << c;
+        }
+    }
+    r->id = (f[PC_ID] != NULL && f[PC_ID]->type == FIELD_INT) ? f[PC_ID]->i : 0;
+    r->idade = (f[PC_IDADE] != NULL && f[PC_IDADE]->type == FIELD_INT) ? f[PC_IDADE]->i : 0;
+    r->cpf = heap_put(s, field_text(f[PC_CPF]));
+    r->nome = heap_put(s, field_text(f[PC_NOME]));
+    r->date = heap_put(s, field_text(f[PC_DATA]));
+    r->data = col_pack_date(field_text(f[PC_DATA]));
+    r->cpf_key = cpf_key(field_text(f[PC_CPF]));
+    return SHM_OK;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Segment setup                                                          */
+/* ---------------------------------------------------------------------- */
+
+static struct Shm_Store *store_new(char *base, size_t size) {
+    struct Shm_Store *s = (struct Shm_Store *)malloc(sizeof(struct Shm_Store));
+    if (s == NULL) {
+        exit(1);
+    }
+    s->base = base;
+    s->size = size;
+    s->hdr = (struct Shm_Header *)base;
+    s->seen = 0;
+    s->held = 0;
+    return s;
+}
+
+/*
+ * A segment still being built whose loader no longer runs: claim it (only
+ * one process wins) and remove its name. Returns 1 if this process did.
+ */
+static int reclaim_orphan(const char *name, struct Shm_Header *hdr) {
+    pid_t loader = hdr->loader;
+    if (loader <= 0 || kill(loader, 0) == 0 || errno != ESRCH) {
+        return 0;
+    }
+    if (!__sync_bool_compare_and_swap(&hdr->loader, loader, -1)) {
+        return 0;
+    }
+    shm_unlink(name);
+    return 1;
+}
+
+/*
+ * Map an existing segment, waiting for its loader to finish.
+ * Returns NULL with errno == ENOENT if there is none (or there was one
+ * whose loader died, now removed).
+ */
+static struct Shm_Store *shm_attach(const char *name) {
+    for (int tries = 0; tries < SHM_ATTACH_TRIES; tries++) {
+        /* reopened every time: a reclaimed segment is replaced under the name */
+        int fd = shm_open(name, O_RDWR, 0600);
+        if (fd < 0) {
+            return NULL;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(struct Shm_Header)) {
+            char *base = (char *)mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (base != MAP_FAILED) {
+                struct Shm_Header *hdr = (struct Shm_Header *)base;
+                if (hdr->magic == SHM_MAGIC && hdr->ready) {
+                    close(fd);
+                    return store_new(base, (size_t)st.st_size);
+                }
+                int reclaimed = reclaim_orphan(name, hdr);
+                munmap(base, (size_t)st.st_size);
+                if (reclaimed) {
+                    close(fd);
+                    errno = ENOENT;
+                    return NULL;
+                }
+            }
+        }
+        close(fd);
+        usleep(10000);
+    }
+    errno = ETIMEDOUT;
+    return NULL;
+}
+
+/*
+ * Create the segment from the rows of 'src'.
+ * Returns NULL with errno == EEXIST if another process created it first.
+ */
+static struct Shm_Store *shm_create(const char *name, struct Dinamic_Vector *src) {
+    int n = dv_size(src);
+    size_t strings = 0;
+    for (int i = 0; i < n; i++) {
+        const struct Field *f[PC_COUNT];
+        schema_fields(dv_get(src, i), f);
+        for (int c = PC_CPF; c < PC_COUNT; c++) {
+            const char *t = field_text(f[c]);
+            if (t != NULL) {
+                strings += strlen(t) + 1;
+            }
+        }
+    }
+    /* room to grow: about twice the loaded data */
+    int row_cap = 2 * n + 1024;
+    int table_cap = 1;
+    while (table_cap < 2 * row_cap) {
+        table_cap *= 2;
+    }
+    size_t heap_cap = 2 * strings + (1 << 20);
+
+    size_t rows_off = align16(sizeof(struct Shm_Header));
+    size_t keys_off = align16(rows_off + sizeof(struct Shm_Row) * (size_t)row_cap);
+    size_t slots_off = align16(keys_off + sizeof(unsigned long long) * (size_t)table_cap);
+    size_t heap_off = align16(slots_off + sizeof(int) * (size_t)table_cap);
+    size_t size = heap_off + heap_cap;
+
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    char *base = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    struct Shm_Store *s = store_new(base, size);
+    struct Shm_Header *hdr = s->hdr;
+    hdr->loader = getpid();  /* lets attachers reclaim the segment if this process dies now */
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_rwlock_init(&hdr->lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    hdr->epoch = 1;
+    hdr->n = 0;
+    hdr->row_cap = row_cap;
+    hdr->table_cap = table_cap;
+    hdr->heap_used = 1;
+    hdr->heap_cap = heap_cap;
+    hdr->rows_off = rows_off;
+    hdr->keys_off = keys_off;
+    hdr->slots_off = slots_off;
+    hdr->heap_off = heap_off;
+    /* ftruncate zero-filled the table: every slot starts empty */
+
+    struct Shm_Row *rows = shm_rows(s);
+    for (int i = 0; i < n; i++) {
+        record_put(s, &rows[i], dv_get(src, i));
+        tab_add(s, rows[i].cpf_key, i);
+    }
+    hdr->n = n;
+    hdr->magic = SHM_MAGIC;
+    __sync_synchronize();
+    hdr->ready = 1;
+    return s;
+}
+
+int shm_load(struct Dinamic_Vector *dv, const char *name, const char *csv) {
+    if (dv == NULL || name == NULL || dv->shm != NULL) {
+        return 1;
+    }
+    struct Shm_Store *s = shm_attach(name);
+    if (s == NULL) {
+        if (errno != ENOENT || csv == NULL) {
+            return 1;
+        }
+        struct Dinamic_Vector *loaded = dv_create();
+        if (dv_read_from_csv(loaded, csv) != 0) {
+            dv_free_all(loaded);
+            return 1;
+        }
+        s = shm_create(name, loaded);
+        dv_free_all(loaded);
+        if (s == NULL && errno == EEXIST) {
+            s = shm_attach(name);  /* another process won the race */
+        }
+        if (s == NULL) {
+            return 1;
+        }
+    }
+    dv->shm = s;
+    s->seen = 0;  /* never a valid epoch: the next sync builds the view */
+    dv_sync(dv);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Reads                                                                  */
+/* ---------------------------------------------------------------------- */
+
+/* Read lock for one call, unless the command already holds it */
+static void read_lock(struct Shm_Store *s) {
+    if (!s->held) {
+        pthread_rwlock_rdlock(&s->hdr->lock);
+    }
+}
+
+static void read_unlock(struct Shm_Store *s) {
+    if (!s->held) {
+        pthread_rwlock_unlock(&s->hdr->lock);
+    }
+}
+
+void shm_hold(struct Shm_Store *s) {
+    pthread_rwlock_rdlock(&s->hdr->lock);
+    s->held = 1;
+}
+
+void shm_release(struct Shm_Store *s) {
+    if (s->held) {
+        s->held = 0;
+        pthread_rwlock_unlock(&s->hdr->lock);
+    }
+}
+
+int shm_size(struct Shm_Store *s, unsigned long *epoch) {
+    read_lock(s);
+    int n = s->hdr->n;
+    if (epoch != NULL) {
+        *epoch = s->hdr->epoch;
+    }
+    read_unlock(s);
+    return n;
+}
+
+static void append_int(struct LinkedList *l, int empty, int value) {
+    struct Field f;
+    f.type = empty ? FIELD_NULL : FIELD_INT;
+    f.i = empty ? 0 : value;
+    f.s = NULL;
+    ll_append_field(l, f);
+}
+
+static void append_text(struct LinkedList *l, const char *heap, size_t at) {
+    struct Field f;
+    f.type = (at != 0) ? FIELD_STRING : FIELD_NULL;
+    f.i = 0;
+    f.s = NULL;
+    if (at != 0) {
+        f.s = slab_strdup(heap + at);
+    }
+    ll_append_field(l, f);
+}
+
+struct LinkedList *shm_row(struct Shm_Store *s, int i) {
+    struct LinkedList *l = ll_create();
+    read_lock(s);
+    if (i >= 0 && i < s->hdr->n) {
+        const struct Shm_Row *r = &shm_rows(s)[i];
+        const char *heap = shm_heap(s);
+        append_int(l, r->null_mask & (1 << PC_ID), r->id);
+        append_text(l, heap, r->cpf);
+        append_text(l, heap, r->nome);
+        append_int(l, r->null_mask & (1 << PC_IDADE), r->idade);
+        append_text(l, heap, r->date);
+    } else {
+        for (int c = 0; c < PC_COUNT; c++) {
+            append_int(l, 1, 0);
+        }
+    }
+    read_unlock(s);
+    ll_refresh_key(l);
+    return l;
+}
+
+int shm_cpf_next(struct Shm_Store *s, unsigned long long key, int *slot) {
+    if (key == 0) {
+        return -1;
+    }
+    int found = -1;
+    read_lock(s);
+    const unsigned long long *keys = shm_keys(s);
+    int mask = s->hdr->table_cap - 1;
+    int i = (*slot < 0) ? tab_home(s, key) : ((*slot + 1) & mask);
+    for (; keys[i] != 0; i = (i + 1) & mask) {
+        if (keys[i] == key) {
+            found = shm_slots(s)[i];
+            *slot = i;
+            break;
+        }
+    }
+    read_unlock(s);
+    return found;
+}
+
+int shm_fill_columns(struct Shm_Store *s, int *id, int *idade, int *data, int n) {
+    read_lock(s);
+    int current = (s->hdr->epoch == s->seen && s->hdr->n == n);
+    if (current) {
+        const struct Shm_Row *rows = shm_rows(s);
+        for (int i = 0; i < n; i++) {
+            id[i] = (rows[i].null_mask & (1 << PC_ID)) ? COL_NULL : rows[i].id;
+            idade[i] = (rows[i].null_mask & (1 << PC_IDADE)) ? COL_NULL : rows[i].idade;
+            data[i] = rows[i].data;
+        }
+    }
+    read_unlock(s);
+    return current;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Writes                                                                 */
+/* ---------------------------------------------------------------------- */
+
+/*
+ * Take the write lock if this view is current; else return SHM_STALE.
+ * Refused inside a read hold, where the write lock would never come.
+ */
+static int begin_write(struct Shm_Store *s) {
+    if (s->held) {
+        return SHM_STALE;
+    }
+    pthread_rwlock_wrlock(&s->hdr->lock);
+    if (s->hdr->epoch != s->seen) {
+        pthread_rwlock_unlock(&s->hdr->lock);
+        return SHM_STALE;
+    }
+    return SHM_OK;
+}
+
+static int end_write(struct Shm_Store *s, int status) {
+    if (status == SHM_OK) {
+        s->hdr->epoch++;
+        s->seen = s->hdr->epoch;
+    }
+    pthread_rwlock_unlock(&s->hdr->lock);
+    return status;
+}
+
+int shm_append(struct Shm_Store *s, const struct LinkedList *row) {
+    int status = begin_write(s);
+    if (status != SHM_OK) {
+        return status;
+    }
+    int n = s->hdr->n;
+    if (n == s->hdr->row_cap) {
+        return end_write(s, SHM_FULL);
+    }
+    struct Shm_Row *r = &shm_rows(s)[n];
+    status = record_put(s, r, row);
+    if (status == SHM_OK) {
+        tab_add(s, r->cpf_key, n);
+        s->hdr->n = n + 1;
+    }
+    return end_write(s, status);
+}
+
+int shm_replace(struct Shm_Store *s, int i, const struct LinkedList *row) {
+    int status = begin_write(s);
+    if (status != SHM_OK) {
+        return status;
+    }
+    if (i < 0 || i >= s->hdr->n) {
+        return end_write(s, SHM_STALE);
+    }
+    struct Shm_Row next;
+    status = record_put(s, &next, row);  /* old strings stay in the heap as garbage */
+    if (status == SHM_OK) {
+        struct Shm_Row *r = &shm_rows(s)[i];
+        tab_remove(s, r->cpf_key, i);
+        *r = next;
+        tab_add(s, r->cpf_key, i);
+    }
+    return end_write(s, status);
+}
+
+int shm_remove(struct Shm_Store *s, int i) {
+    int status = begin_write(s);
+    if (status != SHM_OK) {
+        return status;
+    }
+    int n = s->hdr->n;
+    if (i < 0 || i >= n) {
+        return end_write(s, SHM_STALE);
+    }
+    struct Shm_Row *rows = shm_rows(s);
+    tab_remove(s, rows[i].cpf_key, i);
+    memmove(&rows[i], &rows[i + 1], sizeof(struct Shm_Row) * (size_t)(n - 1 - i));
+    s->hdr->n = n - 1;
+
+    unsigned long long *keys = shm_keys(s);
+    int *slots = shm_slots(s);
+    for (int k = 0; k < s->hdr->table_cap; k++) {
+        if (keys[k] != 0 && slots[k] > i) {
+            slots[k]--;
+        }
+    }
+    /* same renumbering as dv_reassign_ids */
+    for (int k = 0; k < n - 1; k++) {
+        rows[k].id = k + 1;
+        rows[k].null_mask &= ~(1 << PC_ID);
+    }
+    return end_write(s, SHM_OK);
+}
+
+void shm_detach(struct Shm_Store *s) {
+    if (s == NULL) {
+        return;
+    }
+    munmap(s->base, s->size);
+    free(s);
+}
+
+int shm_destroy(const char *name) {
+    return (shm_unlink(name) == 0) ? 0 : 1;
+}
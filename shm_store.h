@@ -0,0 +1,121 @@
+#ifndef SHM_STORE_H
+#define SHM_STORE_H
+
+#include <stddef.h>
+
+struct Dinamic_Vector;
+struct LinkedList;
+
+/*
+ * Shared store (--compartilhado): the rows live in a POSIX shared-memory
+ * segment that every local process maps, instead of a private copy each.
+ *
+ * The first process loads the CSV and builds the segment; the others find
+ * it and attach without parsing anything. The segment holds no pointers,
+ * only offsets from its start, so it can be mapped at any address:
+ *
+ *     [header | row records | CPF hash table | string heap]
+ *
+ * Records keep id/idade/packed date as ints and the strings as heap
+ * offsets. The CPF table (open addressing, key -> record) is sized for the
+ * row capacity and never grows. Capacities are fixed when the segment is
+ * created (about twice the loaded data); a write that does not fit fails.
+ *
+ * A process-shared rwlock guards the segment: writers take it exclusively,
+ * readers shared. Each process's vector is a view of the segment at some
+ * epoch (rows are parsed into it on access). Every write bumps the shared
+ * epoch; a write from a view that is no longer current is refused
+ * (SHM_STALE) so it cannot hit the wrong row, and views catch up with
+ * dv_sync between commands. A read-only command holds the lock shared from
+ * its sync to its end (shm_hold), so a scan never sees a record shift
+ * under it; single reads outside a hold lock per call.
+ *
+ * The segment outlives the processes; it is written back to the CSV on
+ * exit like the other modes and removed with --remover-segmento.
+ *
+ * Crashes: the loader records its PID in the header before filling the
+ * segment; if it dies before marking the segment ready, the next process
+ * to attach finds the PID gone, removes the half-built segment and loads
+ * it again. The rwlock is not robust (POSIX has no robust rwlocks): a
+ * process killed while holding it - during a write, or inside a read
+ * command - leaves it locked, and the other processes block on their next
+ * access. Recover by stopping them and running --remover-segmento (the
+ * changes not yet saved to the CSV are lost).
+ */
+
+#define SHM_OK 0
+#define SHM_FULL 1    /* no room left in the records or the string heap */
+#define SHM_STALE 2   /* another process changed the store since this view */
+
+struct Shm_Header;
+
+struct Shm_Store {
+    char *base;                 /* mapping of the segment */
+    size_t size;
+    struct Shm_Header *hdr;
+    unsigned long seen;         /* shared epoch this process's view reflects */
+    int held;                   /* the read lock is held for a command (shm_hold) */
+};
+
+/**
+ * Open the shared store 'name' for 'dv' (an empty vector): attach if the
+ * segment exists, else load 'csv' and create it. 'dv' becomes a view with
+ * one unparsed slot per row.
+ * Returns 0 on success; returns 1 on error.
+ * If malloc fails, exits(1).
+ */
+int shm_load(struct Dinamic_Vector *dv, const char *name, const char *csv);
+
+/**
+ * Take the read lock until shm_release, for a read-only command: the reads
+ * in between need no locking of their own and all see one epoch. No write
+ * may be made while held (it is refused with SHM_STALE). Holds do not nest.
+ */
+void shm_hold(struct Shm_Store *s);
+void shm_release(struct Shm_Store *s);
+
+/**
+ * Number of rows and epoch of the segment (read under the lock).
+ */
+int shm_size(struct Shm_Store *s, unsigned long *epoch);
+
+/**
+ * Build a new LinkedList from record 'i'. A record that no longer exists
+ * (removed by another process) yields a row of empty fields.
+ * If malloc fails, exits(1).
+ */
+struct LinkedList *shm_row(struct Shm_Store *s, int i);
+
+/**
+ * Iterate the records whose CPF key is 'key', like cpf_index_next: start
+ * with *slot = -1; returns the next record, or -1. Hold the store
+ * (shm_hold) to iterate over one epoch.
+ */
+int shm_cpf_next(struct Shm_Store *s, unsigned long long key, int *slot);
+
+/**
+ * Copy id/idade/packed date of the 'n' records into the arrays (see columns.h).
+ * Returns 1 if done; returns 0 (arrays untouched) if the view is not current.
+ */
+int shm_fill_columns(struct Shm_Store *s, int *id, int *idade, int *data, int n);
+
+/**
+ * Append 'row' / replace record 'i' with 'row' / remove record 'i'
+ * (later records shift down and are renumbered).
+ * Returns SHM_OK, SHM_FULL or SHM_STALE; on success the view is current.
+ */
+int shm_append(struct Shm_Store *s, const struct LinkedList *row);
+int shm_replace(struct Shm_Store *s, int i, const struct LinkedList *row);
+int shm_remove(struct Shm_Store *s, int i);
+
+/**
+ * Unmap the segment (it stays available to other processes). Safe if s==NULL.
+ */
+void shm_detach(struct Shm_Store *s);
+
+/**
+ * Remove the segment 'name' from the system. Returns 0 on success, 1 on error.
+ */
+int shm_destroy(const char *name);
+
+#endif /* SHM_STORE_H */
@@ -0,0 +1,259 @@
+#include "slab.h"
+#include "linkedlist.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SLAB_HEADER 16        /* start of a slab: pointer to the previous slab of the class */
+#define STR_FROM_MALLOC 0xFF  /* class byte of a string too long for the string classes */
+
+struct Slab_Free {
+    struct Slab_Free *next;
+};
+
+struct Slab_Pool {
+    pthread_mutex_t lock;
+    struct Slab_Free *free;  /* objects given back */
+    char *bump;              /* part of the newest slab not carved yet */
+    char *bump_end;
+    void *slabs;             /* newest slab; the chain keeps every slab reachable */
+    size_t n_slabs;
+    size_t in_use;
+};
+
+static struct Slab_Pool pools[SLAB_CLASSES];
+static pthread_once_t pools_once = PTHREAD_ONCE_INIT;
+
+static void pools_init(void) {
+    for (int k = 0; k < SLAB_CLASSES; k++) {
+        pthread_mutex_init(&pools[k].lock, NULL);
+    }
+}
+
+size_t slab_class_size(int cls) {
+    if (cls == SLAB_NODE) {
+        return sizeof(struct ListNode);
+    }
+    if (cls == SLAB_ROW) {
+        return sizeof(struct LinkedList);
+    }
+    return (size_t)(cls - SLAB_STR + 1) * SLAB_STR_STEP;
+}
+
+#if SLAB_POOLED
+/*
+ * Take up to 'want' objects of class 'cls' from the shared pool, chained
+ * through their first word into '*list'. Freed objects are used first,
+ * then the newest slab is carved; a new slab is added when both run out.
+ * Returns the number taken (at least 1).
+ */
+static int pool_take(int cls, int want, struct Slab_Free **list) {
+    pthread_once(&pools_once, pools_init);
+    struct Slab_Pool *pool = &pools[cls];
+    size_t size = slab_class_size(cls);
+    struct Slab_Free *head = NULL;
+    int got = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (got < want) {
+        struct Slab_Free *o = pool->free;
+        if (o != NULL) {
+            pool->free = o->next;
+        } else {
+            if (pool->bump == NULL || pool->bump + size > pool->bump_end) {
+                char *slab = (char *)malloc(SLAB_BYTES);
+                if (slab == NULL) {
+                    exit(1);
+                }
+                *(void **)slab = pool->slabs;
+                pool->slabs = slab;
+                pool->n_slabs++;
+                pool->bump = slab + SLAB_HEADER;
+                pool->bump_end = slab + SLAB_BYTES;
+            }
+            o = (struct Slab_Free *)pool->bump;
+            pool->bump += size;
+        }
+        o->next = head;
+        head = o;
+        got++;
+    }
+    pool->in_use += (size_t)got;
+    pthread_mutex_unlock(&pool->lock);
+    *list = head;
+    return got;
+}
+
+/* Give 'count' objects, chained from 'first' to 'last', back to the shared pool */
+static void pool_give(int cls, struct Slab_Free *first, struct Slab_Free *last, int count) {
+    pthread_once(&pools_once, pools_init);
+    struct Slab_Pool *pool = &pools[cls];
+    pthread_mutex_lock(&pool->lock);
+    last->next = pool->free;
+    pool->free = first;
+    pool->in_use -= (size_t)count;
+    pthread_mutex_unlock(&pool->lock);
+}
+#endif
+
+#if SLAB_POOLED && SLAB_CACHE_MAX > 1
+struct Slab_Cache {
+    struct Slab_Free *head[SLAB_CLASSES];
+    int n[SLAB_CLASSES];
+    int registered;  /* the exit hook knows this thread's cache */
+};
+
+static __thread struct Slab_Cache cache;
+static pthread_key_t cache_key;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+/* Thread exit: the cached objects go back to the shared pools */
+static void cache_flush(void *arg) {
+    struct Slab_Cache *c = (struct Slab_Cache *)arg;
+    for (int cls = 0; cls < SLAB_CLASSES; cls++) {
+        if (c->n[cls] == 0) {
+            continue;
+        }
+        struct Slab_Free *last = c->head[cls];
+        while (last->next != NULL) {
+            last = last->next;
+        }
+        pool_give(cls, c->head[cls], last, c->n[cls]);
+        c->head[cls] = NULL;
+        c->n[cls] = 0;
+    }
+}
+
+static void cache_key_init(void) {
+    pthread_key_create(&cache_key, cache_flush);
+}
+
+/* First use of the cache in this thread: have it flushed at thread exit */
+static void cache_register(struct Slab_Cache *c) {
+    pthread_once(&cache_once, cache_key_init);
+    pthread_setspecific(cache_key, c);
+    c->registered = 1;
+}
+#endif
+
+void *slab_alloc(int cls) {
+#if !SLAB_POOLED
+    void *p = malloc(slab_class_size(cls));
+    if (p == NULL) {
+        exit(1);
+    }
+    return p;
+#elif SLAB_CACHE_MAX > 1
+    struct Slab_Cache *c = &cache;
+    if (c->n[cls] == 0) {
+        if (!c->registered) {
+            cache_register(c);
+        }
+        c->n[cls] = pool_take(cls, SLAB_CACHE_MAX / 2, &c->head[cls]);
+    }
+    struct Slab_Free *o = c->head[cls];
+    c->head[cls] = o->next;
+    c->n[cls]--;
+    return o;
+#else
+    struct Slab_Free *o;
+    pool_take(cls, 1, &o);
+    return o;
+#endif
+}
+
+void slab_free(int cls, void *p) {
+    if (p == NULL) {
+        return;
+    }
+#if !SLAB_POOLED
+    (void)cls;
+    free(p);
+#elif SLAB_CACHE_MAX > 1
+    struct Slab_Cache *c = &cache;
+    struct Slab_Free *o = (struct Slab_Free *)p;
+    if (!c->registered) {
+        cache_register(c);
+    }
+    o->next = c->head[cls];
+    c->head[cls] = o;
+    if (++c->n[cls] < SLAB_CACHE_MAX) {
+        return;
+    }
+    /* full: the older half goes back to the shared pool */
+    struct Slab_Free *keep_last = o;
+    for (int k = 1; k < SLAB_CACHE_MAX - SLAB_CACHE_MAX / 2; k++) {
+        keep_last = keep_last->next;
+    }
+    struct Slab_Free *first = keep_last->next, *last = first;
+    int count = SLAB_CACHE_MAX / 2;
+    for (int k = 1; k < count; k++) {
+        last = last->next;
+    }
+    keep_last->next = NULL;
+    c->n[cls] -= count;
+    pool_give(cls, first, last, count);
+#else
+    struct Slab_Free *o = (struct Slab_Free *)p;
+    pool_give(cls, o, o, 1);
+#endif
+}
+
+char *slab_str_alloc(size_t size) {
+    size_t need = size + 1;  /* the class byte */
+    unsigned char *p;
+    if (!SLAB_POOLED || need > SLAB_STR_MAX) {
+        p = (unsigned char *)malloc(need);
+        if (p == NULL) {
+            exit(1);
+        }
+        p[0] = STR_FROM_MALLOC;
+    } else {
+        int k = (int)((need + SLAB_STR_STEP - 1) / SLAB_STR_STEP) - 1;
+        p = (unsigned char *)slab_alloc(SLAB_STR + k);
+        p[0] = (unsigned char)k;
+    }
+    return (char *)p + 1;
+}
+
+char *slab_strndup(const char *s, size_t n) {
+    char *t = slab_str_alloc(n + 1);
+    memcpy(t, s, n);
+    t[n] = '\0';
+    return t;
+}
+
+char *slab_strdup(const char *s) {
+    return slab_strndup(s, strlen(s));
+}
+
+int slab_str_class(const char *s) {
+    unsigned char k = (unsigned char)s[-1];
+    return k == STR_FROM_MALLOC ? -1 : SLAB_STR + k;
+}
+
+void slab_str_free(char *s) {
+    if (s == NULL) {
+        return;
+    }
+    int cls = slab_str_class(s);
+    if (cls < 0) {
+        free(s - 1);
+    } else {
+        slab_free(cls, s - 1);
+    }
+}
+
+void slab_stats(struct Slab_Stats *st) {
+    pthread_once(&pools_once, pools_init);
+    for (int cls = 0; cls < SLAB_CLASSES; cls++) {
+        struct Slab_Pool *pool = &pools[cls];
+        pthread_mutex_lock(&pool->lock);
+        st->size[cls] = slab_class_size(cls);
+        st->slabs[cls] = pool->n_slabs;
+        st->in_use[cls] = pool->in_use;
+        pthread_mutex_unlock(&pool->lock);
+#if SLAB_POOLED && SLAB_CACHE_MAX > 1
+        st->in_use[cls] -= (size_t)cache.n[cls];  /* this thread's cache is free space */
+#endif
+    }
+}
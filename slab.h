@@ -0,0 +1,107 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+
+/*
+ * Slab allocator for the pieces of a row: struct ListNode and struct
+ * LinkedList each have a size class, and short strings (field values and
+ * folded name keys) one class per SLAB_STR_STEP bytes up to SLAB_STR_MAX.
+ *
+ * A class carves SLAB_BYTES blocks obtained from malloc into objects of its
+ * size and keeps the freed ones on a free list (the first word of a free
+ * object points to the next), so a row costs no malloc call once the
+ * session reaches its steady state, objects carry no allocator header, and
+ * the memory of freed rows is reused by the next rows of the same shape
+ * instead of fragmenting the heap. Slabs are never given back.
+ *
+ * Each class has its own mutex. With SLAB_CACHE_MAX > 1 (the default) every
+ * thread also keeps up to that many free objects per class and moves them
+ * to and from the class half a cache at a time, so parsing threads (ingest,
+ * partition load) rarely take the lock; a thread's cache goes back to the
+ * classes when it exits. Build with -DSLAB_CACHE_MAX=0 for no caches, or
+ * with -DSLAB_DISABLE to send every request to malloc (for sanitizers and
+ * leak checkers, which cannot see inside slabs).
+ *
+ * Strings keep their class in the byte just before the text (0xFF: longer
+ * than SLAB_STR_MAX, allocated with malloc), so slab_str_free needs no size
+ * and a string may be shortened in place.
+ */
+
+#define SLAB_BYTES (64 * 1024)
+#define SLAB_STR_STEP 8
+#define SLAB_STR_MAX 128     /* largest string class, class byte included */
+#ifndef SLAB_CACHE_MAX
+#define SLAB_CACHE_MAX 64    /* free objects a thread keeps per class */
+#endif
+
+#if defined(SLAB_DISABLE)
+#define SLAB_POOLED 0
+#else
+#define SLAB_POOLED 1
+#endif
+
+enum Slab_Class {
+    SLAB_NODE,   /* struct ListNode */
+    SLAB_ROW,    /* struct LinkedList */
+    SLAB_STR,    /* first string class: SLAB_STR_STEP bytes; class SLAB_STR + k holds (k + 1) steps */
+    SLAB_CLASSES = SLAB_STR + SLAB_STR_MAX / SLAB_STR_STEP
+};
+
+struct Slab_Stats {
+    size_t size[SLAB_CLASSES];    /* object size */
+    size_t slabs[SLAB_CLASSES];
+    size_t in_use[SLAB_CLASSES];  /* objects handed out (other threads' caches count as in use) */
+};
+
+/**
+ * Return a free object of class 'cls' (uninitialized).
+ * If malloc fails, exits(1).
+ */
+void *slab_alloc(int cls);
+
+/**
+ * Give back an object of class 'cls'. Safe if p==NULL.
+ */
+void slab_free(int cls, void *p);
+
+/**
+ * Return a buffer for a string of 'size' bytes (terminator included),
+ * uninitialized. If malloc fails, exits(1).
+ */
+char *slab_str_alloc(size_t size);
+
+/**
+ * Return a copy of the first 'n' bytes of 's', NUL-terminated.
+ * If malloc fails, exits(1).
+ */
+char *slab_strndup(const char *s, size_t n);
+
+/**
+ * Return a copy of 's'. If malloc fails, exits(1).
+ */
+char *slab_strdup(const char *s);
+
+/**
+ * Free a string from slab_str_alloc, slab_strndup or slab_strdup.
+ * Safe if s==NULL.
+ */
+void slab_str_free(char *s);
+
+/**
+ * Class of a string from slab_str_alloc, or -1 if it came from malloc (the
+ * malloc block then starts at s - 1).
+ */
+int slab_str_class(const char *s);
+
+/**
+ * Bytes of one object of class 'cls'.
+ */
+size_t slab_class_size(int cls);
+
+/**
+ * Fill '*st' with the slabs and objects in use per class.
+ */
+void slab_stats(struct Slab_Stats *st);
+
+#endif /* SLAB_H */
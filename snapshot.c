@@ -0,0 +1,395 @@
+#include "snapshot.h"
+#include "dinamic_vector.h"
+#include "schema.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAP_NULL_ID LLONG_MIN  /* saved ID of a row whose ID column was empty */
+
+/* Every row of the vector is in this process's memory and stays there */
+static int snap_supported(const struct Dinamic_Vector *dv) {
+    return dv->pool == NULL && dv->shm == NULL;
+}
+
+/* Slots of chunk 'c' covered by a snapshot of 'n' rows */
+static int chunk_len(int n, int c) {
+    int len = n - (c << SNAP_CHUNK_SHIFT);
+    return len < SNAP_CHUNK_ROWS ? len : SNAP_CHUNK_ROWS;
+}
+
+/* Drop one chunk's hold on 'row'; the last hold frees a detached row */
+static void release_hold(struct LinkedList *row) {
+    if (row != NULL && --row->shares == 0 && (row->flags & SNAP_ROW_DETACHED)) {
+        ll_free(row);
+    }
+}
+
+static void release_chunk(struct LinkedList **chunk) {
+    for (int k = 0; k < SNAP_CHUNK_ROWS; k++) {
+        release_hold(chunk[k]);
+    }
+    free(chunk);
+}
+
+/* Free what snapshot 's' holds (not the struct itself, which is in the set's array) */
+static void snap_clear(struct Snapshot *s) {
+    for (int c = 0; s->chunks != NULL && c < s->n_chunks; c++) {
+        if (s->chunks[c] != NULL) {
+            release_chunk(s->chunks[c]);
+        }
+    }
+    free(s->chunks);
+    free(s->ids);
+}
+
+/* Position of snapshot 'id' in the set, or -1 */
+static int snap_index(const struct Snapshot_Set *set, int id) {
+    for (int k = 0; set != NULL && k < set->n; k++) {
+        if (set->s[k].id == id) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Chunk 'c' as snapshot k sees it: its own copy, else the copy of the first
+ * newer snapshot that made one (the chunk did not change in between), else
+ * the live vector.
+ */
+static struct LinkedList **chunk_of(const struct Dinamic_Vector *dv, int k, int c) {
+    const struct Snapshot_Set *set = dv->snaps;
+    for (int j = k; j < set->n; j++) {
+        const struct Snapshot *s = &set->s[j];
+        if (s->chunks != NULL && c < s->n_chunks && s->chunks[c] != NULL) {
+            return s->chunks[c];
+        }
+    }
+    return dv->v + ((size_t)c << SNAP_CHUNK_SHIFT);
+}
+
+/* The rows of snapshot k, in order, in a new array */
+static struct LinkedList **snap_rows(const struct Dinamic_Vector *dv, int k) {
+    const struct Snapshot *s = &dv->snaps->s[k];
+    struct LinkedList **rows = (struct LinkedList **)malloc(sizeof(struct LinkedList *) * (size_t)(s->n > 0 ? s->n : 1));
+    if (rows == NULL) {
+        exit(1);
+    }
+    for (int c = 0; c < s->n_chunks; c++) {
+        memcpy(rows + ((size_t)c << SNAP_CHUNK_SHIFT), chunk_of(dv, k, c),
+               sizeof(struct LinkedList *) * (size_t)chunk_len(s->n, c));
+    }
+    return rows;
+}
+
+static void set_id(struct LinkedList *row, long long id) {
+    if (row == NULL || row->first == NULL) {
+        return;
+    }
+    struct Field *f = &row->first->field;
+    if (id == SNAP_NULL_ID) {
+        f->type = FIELD_NULL;
+    } else {
+        f->type = FIELD_INT;
+        f->i = (int)id;
+    }
+}
+
+/* Give rows[0..s->n-1], the rows of 's', the IDs they had when it was taken */
+static void apply_ids(const struct Snapshot *s, struct LinkedList **rows) {
+    if (s->renumbered) {
+        for (int p = 0; p < s->n; p++) {
+            set_id(rows[p], p + 1);
+        }
+    } else if (s->ids != NULL) {
+        for (int p = 0; p < s->n; p++) {
+            set_id(rows[p], s->ids[p]);
+        }
+    }
+    /* otherwise no renumbering ran since: the rows still carry their file IDs */
+}
+
+/*
+ * Remove snapshot k from the set. With 'merge', the chunks the previous
+ * snapshot was reading through this one are handed to it.
+ */
+static void snap_remove_at(struct Snapshot_Set *set, int k, int merge) {
+    struct Snapshot *s = &set->s[k];
+    struct Snapshot *prev = (merge && k > 0) ? &set->s[k - 1] : NULL;
+    for (int c = 0; prev != NULL && s->chunks != NULL && c < s->n_chunks && c < prev->n_chunks; c++) {
+        if (s->chunks[c] == NULL || (prev->chunks != NULL && prev->chunks[c] != NULL)) {
+            continue;
+        }
+        if (prev->chunks == NULL && (prev->chunks = (struct LinkedList ***)calloc((size_t)prev->n_chunks, sizeof(struct LinkedList **))) == NULL) {
+            exit(1);
+        }
+        struct LinkedList **chunk = s->chunks[c];
+        for (int j = chunk_len(prev->n, c); j < SNAP_CHUNK_ROWS; j++) {
+            release_hold(chunk[j]);  /* slots appended after 'prev' was taken */
+            chunk[j] = NULL;
+        }
+        prev->chunks[c] = chunk;
+        prev->copied++;
+        s->chunks[c] = NULL;
+        s->copied--;
+    }
+    snap_clear(s);
+    memmove(&set->s[k], &set->s[k + 1], sizeof(struct Snapshot) * (size_t)(set->n - k - 1));
+    set->n--;
+}
+
+int snap_take(struct Dinamic_Vector *dv, const char *label, int automatic) {
+    if (dv == NULL || !snap_supported(dv) || (automatic && dv->src != NULL)) {
+        return -1;
+    }
+    if (dv->src != NULL) {
+        for (int i = 0; i < dv->n; i++) {
+            dv_get(dv, i);  /* lazy mode: a snapshot shares parsed rows only */
+        }
+    }
+    if (dv->snaps == NULL) {
+        dv->snaps = (struct Snapshot_Set *)calloc(1, sizeof(struct Snapshot_Set));
+        if (dv->snaps == NULL) {
+            exit(1);
+        }
+        dv->snaps->next_id = 1;
+    }
+    struct Snapshot_Set *set = dv->snaps;
+    if (set->n == set->cap) {
+        int cap = set->cap > 0 ? set->cap * 2 : 8;
+        struct Snapshot *grown = (struct Snapshot *)realloc(set->s, sizeof(struct Snapshot) * (size_t)cap);
+        if (grown == NULL) {
+            exit(1);
+        }
+        set->s = grown;
+        set->cap = cap;
+    }
+    struct Snapshot *s = &set->s[set->n++];
+    s->id = set->next_id++;
+    s->automatic = automatic;
+    snprintf(s->label, sizeof(s->label), "%s", label != NULL ? label : "");
+    s->taken = time(NULL);
+    s->n = dv->n;
+    s->renumbered = dv->renumbered;
+    s->ids = NULL;
+    s->chunks = NULL;  /* allocated on the first change */
+    s->n_chunks = (dv->n + SNAP_CHUNK_ROWS - 1) >> SNAP_CHUNK_SHIFT;
+    s->copied = 0;
+    return s->id;
+}
+
+void snap_touch(struct Dinamic_Vector *dv, int from, int to) {
+    if (dv->snaps == NULL || dv->snaps->n == 0) {
+        return;
+    }
+    struct Snapshot *s = &dv->snaps->s[dv->snaps->n - 1];
+    if (to > s->n) {
+        to = s->n;  /* slots appended after the snapshot are not in it */
+    }
+    if (from >= to) {
+        return;
+    }
+    if (s->chunks == NULL && (s->chunks = (struct LinkedList ***)calloc((size_t)s->n_chunks, sizeof(struct LinkedList **))) == NULL) {
+        exit(1);
+    }
+    for (int c = from >> SNAP_CHUNK_SHIFT; c <= (to - 1) >> SNAP_CHUNK_SHIFT; c++) {
+        if (s->chunks[c] != NULL) {
+            continue;
+        }
+        /* unchanged since the snapshot: the live slots are still its rows */
+        struct LinkedList **chunk = (struct LinkedList **)calloc(SNAP_CHUNK_ROWS, sizeof(struct LinkedList *));
+        if (chunk == NULL) {
+            exit(1);
+        }
+        int len = chunk_len(s->n, c);
+        memcpy(chunk, dv->v + ((size_t)c << SNAP_CHUNK_SHIFT), sizeof(struct LinkedList *) * (size_t)len);
+        for (int k = 0; k < len; k++) {
+            chunk[k]->shares++;
+        }
+        s->chunks[c] = chunk;
+        s->copied++;
+    }
+}
+
+void snap_release_row(struct LinkedList *row) {
+    if (row != NULL && row->shares > 0) {
+        row->flags |= SNAP_ROW_DETACHED;
+    } else {
+        ll_free(row);
+    }
+}
+
+void snap_save_ids(struct Dinamic_Vector *dv) {
+    struct Snapshot_Set *set = dv->snaps;
+    for (int k = 0; set != NULL && k < set->n; k++) {
+        struct Snapshot *s = &set->s[k];
+        if (s->renumbered || s->ids != NULL) {
+            continue;
+        }
+        struct LinkedList **rows = snap_rows(dv, k);
+        s->ids = (long long *)malloc(sizeof(long long) * (size_t)(s->n > 0 ? s->n : 1));
+        if (s->ids == NULL) {
+            exit(1);
+        }
+        for (int p = 0; p < s->n; p++) {
+            const struct Field *f[PC_COUNT];
+            schema_fields(rows[p], f);
+            s->ids[p] = (f[PC_ID] != NULL && f[PC_ID]->type == FIELD_INT) ? f[PC_ID]->i : SNAP_NULL_ID;
+        }
+        free(rows);
+    }
+}
+
+struct Snapshot *snap_find(const struct Dinamic_Vector *dv, int id) {
+    int k = snap_index(dv->snaps, id);
+    return k >= 0 ? &dv->snaps->s[k] : NULL;
+}
+
+struct Dinamic_Vector *snap_view(struct Dinamic_Vector *dv, int id) {
+    int k = snap_index(dv->snaps, id);
+    if (k < 0) {
+        return NULL;
+    }
+    const struct Snapshot *s = &dv->snaps->s[k];
+    struct Dinamic_Vector *view = dv_create();
+    free(view->v);
+    view->v = snap_rows(dv, k);
+    view->n = s->n;
+    view->n_max = s->n > 0 ? s->n : 1;
+    view->renumbered = s->renumbered;
+    apply_ids(s, view->v);
+    return view;
+}
+
+void snap_view_close(struct Dinamic_Vector *dv, struct Dinamic_Vector *view) {
+    dv_free(view);
+    if (dv->renumbered) {
+        for (int i = 0; i < dv->n; i++) {
+            set_id(dv->v[i], i + 1);
+        }
+    }
+}
+
+int snap_restore(struct Dinamic_Vector *dv, int id) {
+    int k = snap_index(dv->snaps, id);
+    if (k < 0) {
+        return 1;
+    }
+    struct Snapshot *s = &dv->snaps->s[k];
+    struct LinkedList **rows = snap_rows(dv, k);
+
+    /* rows leaving the vector first, then rows coming back, so the feed never holds one CPF twice */
+    for (int p = 0; p < s->n; p++) {
+        rows[p]->flags |= SNAP_ROW_MARK;
+    }
+    for (int i = 0; i < dv->n; i++) {
+        struct LinkedList *row = dv->v[i];
+        if (!(row->flags & SNAP_ROW_MARK)) {
+            delta_remove(dv->delta, row);
+            part_touch(dv->parts, row);
+            snap_release_row(row);
+        }
+    }
+    for (int p = 0; p < s->n; p++) {
+        struct LinkedList *row = rows[p];
+        row->flags &= ~SNAP_ROW_MARK;
+        if (row->flags & SNAP_ROW_DETACHED) {
+            row->flags &= ~SNAP_ROW_DETACHED;
+            delta_insert(dv->delta, row);
+            part_touch(dv->parts, row);
+        }
+    }
+
+    if (dv->n_max < s->n) {
+        struct LinkedList **grown = (struct LinkedList **)realloc(dv->v, sizeof(struct LinkedList *) * (size_t)s->n);
+        if (grown == NULL) {
+            exit(1);
+        }
+        dv->v = grown;
+        if (dv->src_off != NULL) {
+            long *off = (long *)realloc(dv->src_off, sizeof(long) * (size_t)s->n);
+            if (off == NULL) {
+                exit(1);
+            }
+            dv->src_off = off;
+        }
+        dv->n_max = s->n;
+    }
+    memcpy(dv->v, rows, sizeof(struct LinkedList *) * (size_t)s->n);
+    dv->n = s->n;
+    for (int i = 0; dv->src_off != NULL && i < dv->n; i++) {
+        dv->src_off[i] = -1;  /* every row is parsed (snap_take) */
+    }
+    free(rows);
+    dv->renumbered = s->renumbered;
+    apply_ids(s, dv->v);
+    cpf_index_free(dv->cpf_idx);
+    dv->cpf_idx = NULL;  /* rebuilt on next use */
+    dv->epoch++;
+
+    /* the vector is snapshot k again: the newer ones' copies are not needed to read it */
+    while (dv->snaps->n > k + 1) {
+        snap_remove_at(dv->snaps, dv->snaps->n - 1, 0);
+    }
+    return 0;
+}
+
+void snap_settle(struct Dinamic_Vector *dv, int id, int applied) {
+    if (id < 0 || snap_index(dv->snaps, id) < 0) {
+        return;
+    }
+    if (!applied) {
+        snap_drop(dv, id);
+        return;
+    }
+    struct Snapshot_Set *set = dv->snaps;
+    int autos = 0;
+    for (int k = 0; k < set->n; k++) {
+        autos += set->s[k].automatic;
+    }
+    for (int k = 0; autos > SNAP_AUTO_KEEP && k < set->n; k++) {
+        if (set->s[k].automatic) {
+            snap_remove_at(set, k, 1);
+            autos--;
+            k--;
+        }
+    }
+}
+
+int snap_drop(struct Dinamic_Vector *dv, int id) {
+    int k = snap_index(dv->snaps, id);
+    if (k < 0) {
+        return 1;
+    }
+    snap_remove_at(dv->snaps, k, 1);
+    return 0;
+}
+
+void snap_list(const struct Dinamic_Vector *dv, FILE *out) {
+    const struct Snapshot_Set *set = dv->snaps;
+    if (set == NULL || set->n == 0) {
+        fprintf(out, "Nenhum ponto de restauração.\n");
+        return;
+    }
+    fprintf(out, "%-6s %-19s %10s %8s  %s\n", "Ponto", "Data/hora", "Registros", "Blocos", "Rótulo");
+    for (int k = 0; k < set->n; k++) {
+        const struct Snapshot *s = &set->s[k];
+        char when[32];
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&s->taken));
+        fprintf(out, "%-6d %-19s %10d %8d  %s%s\n", s->id, when, s->n, s->copied, s->label,
+                s->automatic ? " (automático)" : "");
+    }
+    fprintf(out, "(Blocos: grupos de %d registros alterados desde o ponto, guardados por ele)\n", SNAP_CHUNK_ROWS);
+}
+
+void snap_free(struct Snapshot_Set *set) {
+    if (set == NULL) {
+        return;
+    }
+    for (int k = set->n - 1; k >= 0; k--) {
+        snap_clear(&set->s[k]);
+    }
+    free(set->s);
+    free(set);
+}
@@ -0,0 +1,146 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdio.h>
+#include <time.h>
+
+struct Dinamic_Vector;
+struct LinkedList;
+
+/*
+ * Point-in-time snapshots of the store, for undoing mistaken changes and
+ * reading the base as it was.
+ *
+ * The row pointer array is seen as chunks of SNAP_CHUNK_ROWS slots. Taking
+ * a snapshot copies nothing: it records the row count and the time. The
+ * first change to a chunk afterwards (a slot written, shifted, or its row
+ * changed) copies that chunk's pointers into the newest snapshot; chunks
+ * never changed are read from the newer snapshots or from the live vector.
+ * Rows are shared: a row held by a snapshot chunk has 'shares' > 0 and is
+ * never changed in place (dv_update works on a copy) nor freed when it
+ * leaves the vector (it is marked SNAP_ROW_DETACHED and freed when the last
+ * chunk holding it goes). A snapshot therefore costs one pointer array per
+ * chunk changed since, plus the old versions of the rows changed.
+ *
+ * IDs are positions (dv_reassign_ids rewrites them in every row), so a
+ * snapshot does not keep them in its rows: when it was taken after a
+ * renumbering its IDs are position + 1, otherwise the file IDs are saved
+ * once, just before the first renumbering would overwrite them.
+ *
+ * Snapshots need every row in memory: lazy mode parses the rows still
+ * unparsed when the first snapshot is taken; paged and shared mode (rows
+ * evicted or owned by other processes) are not supported.
+ */
+
+#define SNAP_CHUNK_SHIFT 10
+#define SNAP_CHUNK_ROWS (1 << SNAP_CHUNK_SHIFT)
+#define SNAP_AUTO_KEEP 10    /* automatic snapshots kept (oldest dropped first) */
+#define SNAP_LABEL_LEN 64
+
+/* LinkedList.flags bits */
+#define SNAP_ROW_DETACHED 1  /* not in the live vector: only snapshots hold it */
+#define SNAP_ROW_MARK 2      /* scratch bit for one pass over a set of rows */
+
+struct Snapshot {
+    int id;
+    int automatic;            /* taken by the menu before a change */
+    char label[SNAP_LABEL_LEN];
+    time_t taken;
+    int n;                    /* rows when taken */
+    int renumbered;           /* IDs were positions when taken */
+    long long *ids;           /* IDs by position, saved before the first renumbering; NULL if not needed */
+    struct LinkedList ***chunks;  /* chunk c as it was when taken; NULL while unchanged since */
+    int n_chunks;
+    int copied;               /* chunks in 'chunks' */
+};
+
+struct Snapshot_Set {
+    struct Snapshot *s;       /* oldest first */
+    int n;
+    int cap;
+    int next_id;
+};
+
+/**
+ * Take a snapshot of 'dv' named 'label'. 'automatic' snapshots are the
+ * menu's undo points: none is taken in lazy mode (it would parse the whole
+ * file), and each is settled by snap_settle once its change is done.
+ * Returns the snapshot id, or -1 if the mode does not support snapshots.
+ * If malloc fails, exits(1).
+ */
+int snap_take(struct Dinamic_Vector *dv, const char *label, int automatic);
+
+/**
+ * End of the change that automatic snapshot 'id' undoes. If nothing was
+ * 'applied' the snapshot is dropped; otherwise only the newest
+ * SNAP_AUTO_KEEP automatic snapshots are kept. Trimming here rather than
+ * in snap_take means a change that ends up doing nothing never pushes an
+ * older undo point out. Does nothing if id < 0.
+ */
+void snap_settle(struct Dinamic_Vector *dv, int id, int applied);
+
+/**
+ * Called before slots [from, to) of the live vector change: copies the
+ * chunks the newest snapshot still reads from the vector. Does nothing if
+ * no snapshot was taken.
+ */
+void snap_touch(struct Dinamic_Vector *dv, int from, int to);
+
+/**
+ * Release a row that leaves the live vector: freed at once, or marked
+ * SNAP_ROW_DETACHED if a snapshot still holds it.
+ */
+void snap_release_row(struct LinkedList *row);
+
+/**
+ * Called before dv_reassign_ids first overwrites the file IDs: saves them
+ * for the snapshots that still read them from their rows.
+ */
+void snap_save_ids(struct Dinamic_Vector *dv);
+
+/**
+ * Return the snapshot with id 'id', or NULL.
+ */
+struct Snapshot *snap_find(const struct Dinamic_Vector *dv, int id);
+
+/**
+ * Open snapshot 'id' for reading: returns a new vector holding its rows
+ * (shared, not copied) with their IDs as they were, on which every
+ * read-only operation works (consults, filters, aggregates, export).
+ * The live vector must not be used until snap_view_close.
+ * Returns NULL if there is no such snapshot. If malloc fails, exits(1).
+ */
+struct Dinamic_Vector *snap_view(struct Dinamic_Vector *dv, int id);
+
+/**
+ * Close a view opened by snap_view and put back the live IDs.
+ */
+void snap_view_close(struct Dinamic_Vector *dv, struct Dinamic_Vector *view);
+
+/**
+ * Roll 'dv' back to snapshot 'id': the rows, their order and IDs become
+ * what they were. The inverse changes go on the delta feed, changed
+ * partitions are marked dirty and the CPF index is rebuilt on next use.
+ * Snapshots taken after 'id' are dropped; 'id' itself stays.
+ * Returns 0 on success; returns 1 if there is no such snapshot.
+ * If malloc fails, exits(1).
+ */
+int snap_restore(struct Dinamic_Vector *dv, int id);
+
+/**
+ * Drop snapshot 'id' (the rows only it held are freed).
+ * Returns 0 on success; returns 1 if there is no such snapshot.
+ */
+int snap_drop(struct Dinamic_Vector *dv, int id);
+
+/**
+ * Print one line per snapshot: id, time, rows, chunks copied, label.
+ */
+void snap_list(const struct Dinamic_Vector *dv, FILE *out);
+
+/**
+ * Drop every snapshot and free the set. Safe if set==NULL.
+ */
+void snap_free(struct Snapshot_Set *set);
+
+#endif /* SNAPSHOT_H */
@@ -0,0 +1,70 @@
+#!/bin/sh
+# Allocation churn (see slab.h): a large base goes through rounds of
+# remove / import / update in batch mode, then the memory report is read.
+# Prints, per program, the run time and the heap line of `memoria`
+# (arena, free bytes retained, fragmentation), so a pooled build can be
+# compared with one built with -DSLAB_DISABLE (`make churn` does both).
+#
+# usage: tests/churn.sh programa [programa ...]
+# CHURN_ROWS (default 1000000) rows, CHURN_ROUNDS (default 30) rounds of
+# 20000 rows each.
+
+rows=${CHURN_ROWS:-1000000}
+rounds=${CHURN_ROUNDS:-30}
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+
+# CPF with valid check digits from a 9-digit number (imports check them)
+awk_cpf='
+function cpf(v,    d, i, k, s) {
+    for (i = 8; i >= 0; i--) { d[i] = v % 10; v = int(v / 10) }
+    for (k = 9; k <= 10; k++) {
+        s = 0
+        for (i = 0; i < k; i++) s += d[i] * (k + 1 - i)
+        d[k] = (s * 10) % 11 % 10
+    }
+    return d[0] d[1] d[2] "." d[3] d[4] d[5] "." d[6] d[7] d[8] "-" d[9] d[10]
+}'
+
+awk -v rows="$rows" "$awk_cpf"'
+BEGIN {
+    print "ID,CPF,Nome,Idade,Data_Cadastro"
+    for (i = 1; i <= rows; i++)
+        printf "%d,%s,Paciente %d Souza,%d,%d-%02d-%02d\n", i, cpf(100000000 + i * 7), i, i % 97,
+               2015 + i % 10, 1 + i % 12, 1 + i % 28
+}' > "$work/base.csv"
+
+awk -v rows="$rows" -v rounds="$rounds" -v dir="$work" "$awk_cpf"'
+BEGIN {
+    srand(47)
+    for (r = 0; r < rounds; r++) {
+        f = dir "/imp" r ".csv"
+        print "ID,CPF,Nome,Idade,Data_Cadastro" > f
+        for (j = 0; j < 20000; j++)
+            printf "%d,%s,Importado %d %d,%d,2024-%02d-%02d\n", j + 1, cpf(800000000 + r * 20000 + j),
+                   r, j, j % 90, 1 + j % 12, 1 + j % 28 > f
+        close(f)
+        a = 1 + int(rand() * (rows - 20000)); b = 1 + int(rand() * (rows - 20000))
+        printf "remove id>=%d AND id<=%d\n", a, a + 20000
+        printf "importa %s\n", f
+        printf "atualiza id>=%d AND id<=%d SET nome=\"Nome Trocado %d\"\n", b, b + 20000, r
+    }
+    print "memoria"
+}' > "$work/churn.txt"
+
+status=0
+for name in "$@"; do
+    case $name in
+        /*) prog=$name ;;
+        *) prog=$(pwd)/$name ;;
+    esac
+    mkdir "$work/run" && cp "$work/base.csv" "$work/run/bd_paciente.csv" || exit 1
+    start=$(date +%s.%N)
+    (cd "$work/run" && "$prog" --batch < "$work/churn.txt" > out.txt 2>&1) || status=1
+    end=$(date +%s.%N)
+    echo "$name: $(awk "BEGIN { printf \"%.1f\", $end - $start }") s, $rows registros, $rounds rodadas"
+    grep '^Importados:' "$work/run/out.txt" | tail -1
+    grep '^Heap:' "$work/run/out.txt"
+    rm -rf "$work/run"
+done
+exit $status
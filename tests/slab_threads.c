@@ -0,0 +1,228 @@
+/*
+ * Thread-cache handoff of the slab pools (see slab.h) under the threaded
+ * loaders: a concurrent import (ingest.h) whose producers parse the rows
+ * and drop the invalid ones while the applier frees the duplicates, and a
+ * parallel partition load (partition.h) whose workers parse every row.
+ *
+ * Objects move between threads here: parsed by one thread, freed by
+ * another, whose cache fills and hands half of it back (slab_free), and
+ * every worker exits with objects still cached (cache_flush). After each
+ * step the pools must count as in use exactly the objects the live rows
+ * hold, and nothing once every vector is freed: a cache lost at thread
+ * exit, or a half-cache handed back twice or not at all, shows up as a
+ * difference. The rows must also be the same whatever the thread count.
+ *
+ * usage: tests/slab_threads [dir]   (scratch files go to 'dir', default /tmp)
+ * Built and run by `make check`.
+ */
+#include "../dinamic_vector.h"
+#include "../ingest.h"
+#include "../linkedlist.h"
+#include "../partition.h"
+#include "../schema.h"
+#include "../slab.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BASE_ROWS 4000
+#define IMPORT_LINES 40000
+#define PRODUCERS 8
+
+static int failures = 0;
+
+static void check(int ok, const char *what) {
+    if (!ok) {
+        printf("FALHOU: %s\n", what);
+        failures++;
+    }
+}
+
+/* Write CPF number 'seed' (9 digits plus valid check digits) to 'out' */
+static void make_cpf(long seed, char *out) {
+    int d[11];
+    long v = 100000000 + seed * 37;
+    for (int i = 8; i >= 0; i--) {
+        d[i] = (int)(v % 10);
+        v /= 10;
+    }
+    for (int k = 9; k <= 10; k++) {
+        int sum = 0;
+        for (int i = 0; i < k; i++) {
+            sum += d[i] * (k + 1 - i);
+        }
+        d[k] = (sum * 10) % 11 % 10;
+    }
+    sprintf(out, "%d%d%d.%d%d%d.%d%d%d-%d%d", d[0], d[1], d[2], d[3], d[4], d[5], d[6], d[7], d[8], d[9], d[10]);
+}
+
+/*
+ * Base: BASE_ROWS rows over 24 months. Import: every 5th line repeats a
+ * base CPF (freed by the applier), every 7th has an invalid CPF (freed by
+ * its producer), the rest are new.
+ */
+static int write_inputs(const char *base, const char *imp) {
+    FILE *b = fopen(base, "w");
+    FILE *m = fopen(imp, "w");
+    if (b == NULL || m == NULL) {
+        return 1;
+    }
+    char cpf[16];
+    fprintf(b, "ID,CPF,Nome,Idade,Data_Cadastro\n");
+    for (int i = 0; i < BASE_ROWS; i++) {
+        make_cpf(i, cpf);
+        fprintf(b, "%d,%s,Paciente %d da Base,%d,%d-%02d-%02d\n", i + 1, cpf, i, i % 90,
+                2022 + (i % 24) / 12, 1 + i % 12, 1 + i % 28);
+    }
+    fprintf(m, "ID,CPF,Nome,Idade,Data_Cadastro\n");
+    for (int j = 0; j < IMPORT_LINES; j++) {
+        if (j % 7 == 0) {
+            strcpy(cpf, "123.456.789-00");
+        } else {
+            make_cpf(j % 5 == 0 ? j % BASE_ROWS : BASE_ROWS + j, cpf);
+        }
+        fprintf(m, "%d,%s,Importado %d,%d,2023-%02d-%02d\n", j + 1, cpf, j, j % 90, 1 + j % 12, 1 + j % 28);
+    }
+    int status = (fclose(b) != 0) | (fclose(m) != 0);
+    return status;
+}
+
+#if SLAB_POOLED
+/* Objects of the pools held by the rows of 'dv' */
+static size_t row_objects(struct Dinamic_Vector *dv) {
+    size_t n = 0;
+    for (int i = 0; i < dv_size(dv); i++) {
+        const struct LinkedList *row = dv_get(dv, i);
+        n++;
+        for (const struct ListNode *node = row->first; node != NULL; node = node->next) {
+            n++;
+            if (node->field.type == FIELD_STRING && node->field.s != NULL && slab_str_class(node->field.s) >= 0) {
+                n++;
+            }
+        }
+        if (row->key != NULL && slab_str_class(row->key) >= 0) {
+            n++;
+        }
+    }
+    return n;
+}
+
+/* Objects the pools count as in use (this thread's cache excluded) */
+static size_t pool_in_use(void) {
+    struct Slab_Stats st;
+    slab_stats(&st);
+    size_t n = 0;
+    for (int cls = 0; cls < SLAB_CLASSES; cls++) {
+        n += st.in_use[cls];
+    }
+    return n;
+}
+#endif
+
+/* The pools count exactly the objects of the live vectors (NULL-terminated) */
+static void check_pools(const char *step, struct Dinamic_Vector **live) {
+#if SLAB_POOLED
+    size_t held = 0;
+    for (int k = 0; live[k] != NULL; k++) {
+        held += row_objects(live[k]);
+    }
+    size_t counted = pool_in_use();
+    if (counted != held) {
+        printf("FALHOU: %s: %zu objeto(s) em uso nos slabs, %zu nos registros\n", step, counted, held);
+        failures++;
+    }
+#else
+    (void)step;
+    (void)live;
+#endif
+}
+
+/* Same rows, in the same order */
+static int same_rows(struct Dinamic_Vector *a, struct Dinamic_Vector *b) {
+    if (dv_size(a) != dv_size(b)) {
+        return 0;
+    }
+    char *ta = NULL, *tb = NULL;
+    size_t la = 0, lb = 0;
+    FILE *fa = open_memstream(&ta, &la);
+    FILE *fb = open_memstream(&tb, &lb);
+    if (fa == NULL || fb == NULL) {
+        exit(1);
+    }
+    for (int i = 0; i < dv_size(a); i++) {
+        ll_fprint(fa, dv_get(a, i));
+        ll_fprint(fb, dv_get(b, i));
+    }
+    fclose(fa);
+    fclose(fb);
+    int same = (la == lb && memcmp(ta, tb, la) == 0);
+    free(ta);
+    free(tb);
+    return same;
+}
+
+int main(int argc, char **argv) {
+    char dir[256], base[300], imp[300], parts[300], cmd[600];
+    snprintf(dir, sizeof(dir), "%s/slab_threads.XXXXXX", argc > 1 ? argv[1] : "/tmp");
+    if (mkdtemp(dir) == NULL) {
+        printf("FALHOU: não foi possível criar %s\n", dir);
+        return 1;
+    }
+    snprintf(base, sizeof(base), "%s/base.csv", dir);
+    snprintf(imp, sizeof(imp), "%s/imp.csv", dir);
+    snprintf(parts, sizeof(parts), "%s/base.d", dir);
+    if (write_inputs(base, imp) != 0) {
+        printf("FALHOU: não foi possível gravar os arquivos em %s\n", dir);
+        return 1;
+    }
+    FILE *quiet = fopen("/dev/null", "w");
+
+    /* Import with one producer, then with several */
+    struct Dinamic_Vector *one = dv_create();
+    struct Dinamic_Vector *many = dv_create();
+    check(dv_read_from_csv(one, base) == 0 && dv_read_from_csv(many, base) == 0, "carga da base");
+    check(ingest_import_csv(one, imp, 1, 0, quiet) == 0, "importação com 1 produtor");
+    struct Dinamic_Vector *both_live[] = {one, many, NULL};
+    check_pools("importação com 1 produtor", both_live);
+    for (int round = 0; round < 3; round++) {
+        /* the second and third rounds only find duplicates: all freed by the applier */
+        check(ingest_import_csv(many, imp, PRODUCERS, 0, quiet) == 0, "importação concorrente");
+        check_pools("importação concorrente", both_live);
+    }
+    /* lines j = 0 .. IMPORT_LINES - 1: multiples of 5 are duplicates, of 7 invalid */
+    int fifths = (IMPORT_LINES + 4) / 5, sevenths = (IMPORT_LINES + 6) / 7, both = (IMPORT_LINES + 34) / 35;
+    int expected = BASE_ROWS + IMPORT_LINES - fifths - sevenths + both;
+    check(dv_size(one) == expected, "registros importados");
+    check(same_rows(one, many), "mesmos registros com 1 e com vários produtores");
+
+    /* Partition load: migrate once (single file), then load the months in parallel */
+    dv_free_all(many);
+    struct Dinamic_Vector *migrate = dv_create();
+    check(part_open(migrate, parts, base) == 0, "migração para partições");
+    int written = 0;
+    check(part_save(migrate, &written) == 0 && written > 1, "gravação das partições");
+    dv_free_all(migrate);
+    for (int round = 0; round < 3; round++) {
+        struct Dinamic_Vector *loaded = dv_create();
+        check(part_open(loaded, parts, base) == 0, "carga paralela das partições");
+        check(dv_size(loaded) == BASE_ROWS, "registros das partições");
+        struct Dinamic_Vector *live[] = {one, loaded, NULL};
+        check_pools("carga paralela das partições", live);
+        dv_free_all(loaded);
+    }
+
+    dv_free_all(one);
+    struct Dinamic_Vector *none[] = {NULL};
+    check_pools("depois de liberar tudo", none);
+
+    fclose(quiet);
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", dir);
+    if (system(cmd) != 0) {
+        printf("Aviso: %s não foi removido\n", dir);
+    }
+    if (failures == 0) {
+        printf("slab_threads: ok\n");
+    }
+    return failures != 0;
+}
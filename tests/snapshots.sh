@@ -0,0 +1,89 @@
+#!/bin/sh
+# Snapshot regression (see snapshot.h): take -> remove -> update -> take ->
+# drop the middle point -> view -> restore. Every state read from a
+# snapshot is exported and compared with a fresh load of the same base
+# that only runs the commands leading to that state.
+#
+# usage: tests/snapshots.sh [programa]   (default ./Hospital_Patients_Management_System)
+# Extra load options (e.g. --lazy) go in SNAP_OPTS.
+
+prog=${1:-./Hospital_Patients_Management_System}
+case $prog in
+    /*) ;;
+    *) prog=$(pwd)/$prog ;;
+esac
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+cd "$work" || exit 1
+
+# 5000 rows: several snapshot chunks (SNAP_CHUNK_ROWS), distinct CPFs
+awk 'BEGIN {
+    print "ID,CPF,Nome,Idade,Data_Cadastro"
+    for (i = 1; i <= 5000; i++) {
+        c = sprintf("%011d", 10000000000 + i * 7919)
+        printf "%d,%s.%s.%s-%s,Paciente %d,%d,2024-%02d-%02d\n", i,
+               substr(c, 1, 3), substr(c, 4, 3), substr(c, 7, 3), substr(c, 10, 2),
+               i, i % 97, 1 + i % 12, 1 + i % 28
+    }
+}' > bd_paciente.csv
+
+# Changes before the second point, and after it
+cat > antes.txt <<'CMDS'
+remove id>=100 AND id<=1500 AND idade>40
+atualiza id>=2000 AND id<=2600 SET nome="Alterado", idade=77
+CMDS
+cat > meio.txt <<'CMDS'
+remove id>=3000 AND id<=3300
+atualiza id>=1 AND id<=50 SET idade=5
+CMDS
+cat > depois.txt <<'CMDS'
+remove id>=10 AND id<=4000 AND idade<20
+atualiza id>=1 AND id<=3000 SET nome="Depois"
+CMDS
+
+# Not in a pipeline: a failed run sets 'status' in this shell
+status=0
+run() {
+    if ! "$prog" --batch $SNAP_OPTS > "$1.out" 2>&1; then
+        echo "FALHOU: a execução $1 terminou com erro"
+        cat "$1.out"
+        status=1
+    fi
+}
+
+# Expected states, each from a fresh load
+echo "exporta e1.hpz" > e1.txt; run e1 < e1.txt
+cat antes.txt meio.txt > e3.txt; echo "exporta e3.hpz" >> e3.txt; run e3 < e3.txt
+cat antes.txt meio.txt depois.txt > ev.txt; echo "exporta ev.hpz" >> ev.txt; run ev < ev.txt
+
+{
+    echo "snapshot um"
+    cat antes.txt
+    echo "snapshot dois"
+    cat meio.txt
+    echo "snapshot tres"
+    cat depois.txt
+    echo "descarta 2"
+    echo "em 1 exporta v1.hpz"
+    echo "em 3 exporta v3.hpz"
+    echo "exporta vv.hpz"
+    echo "restaura 3"
+    echo "exporta r3.hpz"
+    echo "restaura 1"
+    echo "exporta r1.hpz"
+} > snap.txt
+run snap < snap.txt
+
+for pair in "e1 v1" "e3 v3" "ev vv" "e3 r3" "e1 r1"; do
+    set -- $pair
+    if ! cmp -s "$1.hpz" "$2.hpz"; then
+        echo "FALHOU: $2.hpz difere de $1.hpz (carga nova)"
+        status=1
+    fi
+done
+if [ $status -ne 0 ]; then
+    cat snap.out
+else
+    echo "snapshots: ok"
+fi
+exit $status
@@ -0,0 +1,153 @@
+#include "trace.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *const trace_op_names[TR_OPS] = {
+    "consulta_nome",
+    "consulta_cpf",
+    "consulta_trecho",
+    "consulta_aprox",
+    "atualiza",
+    "remove",
+    "insere",
+    "imprime",
+    "estatistica",
+    "filtra",
+    "importa",
+    "mescla",
+    "memoria",
+};
+
+struct Trace_Writer *trace_open(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        return NULL;
+    }
+    struct Trace_Writer *w = (struct Trace_Writer *)malloc(sizeof(struct Trace_Writer));
+    if (w == NULL) {
+        exit(1);
+    }
+    w->fp = fp;
+    clock_gettime(CLOCK_MONOTONIC, &w->t0);
+    fprintf(fp, "%s\n", TRACE_MAGIC);
+    fflush(fp);
+    return w;
+}
+
+long long trace_now(const struct Trace_Writer *w) {
+    if (w == NULL) {
+        return 0;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)(now.tv_sec - w->t0.tv_sec) * 1000000 + (now.tv_nsec - w->t0.tv_nsec) / 1000;
+}
+
+void trace_add(struct Trace_Writer *w, long long usec, enum Trace_Op op, int n_args, ...) {
+    if (w == NULL) {
+        return;
+    }
+    fprintf(w->fp, "%lld\t%s", usec, trace_op_names[op]);
+    va_list ap;
+    va_start(ap, n_args);
+    for (int k = 0; k < n_args && k < TRACE_MAX_ARGS; k++) {
+        const char *arg = va_arg(ap, const char *);
+        fputc('\t', w->fp);
+        for (const char *p = (arg != NULL) ? arg : ""; *p != '\0'; p++) {
+            fputc((*p == '\t' || *p == '\n' || *p == '\r') ? ' ' : *p, w->fp);
+        }
+    }
+    va_end(ap);
+    fputc('\n', w->fp);
+    fflush(w->fp);
+}
+
+void trace_close(struct Trace_Writer *w) {
+    if (w == NULL) {
+        return;
+    }
+    fclose(w->fp);
+    free(w);
+}
+
+/*
+ * Fill 'e' from one trace line (line break removed). Returns 0 if the line
+ * holds a known operation, else 1.
+ */
+static int parse_event(char *line, struct Trace_Event *e) {
+    char *field[2 + TRACE_MAX_ARGS];
+    int n = 0;
+    /* split on every tab: arguments may be empty */
+    for (char *p = line; p != NULL && n < 2 + TRACE_MAX_ARGS; n++) {
+        field[n] = p;
+        p = strchr(p, '\t');
+        if (p != NULL) {
+            *p++ = '\0';
+        }
+    }
+    if (n < 2) {
+        return 1;
+    }
+    int op = 0;
+    while (op < TR_OPS && strcmp(trace_op_names[op], field[1]) != 0) {
+        op++;
+    }
+    if (op == TR_OPS) {
+        return 1;
+    }
+    e->usec = atoll(field[0]);
+    e->op = (enum Trace_Op)op;
+    e->n_args = n - 2;
+    for (int k = 0; k < e->n_args; k++) {
+        e->args[k] = strdup(field[2 + k]);
+        if (e->args[k] == NULL) {
+            exit(1);
+        }
+    }
+    return 0;
+}
+
+int trace_load(const char *path, struct Trace_Event **events, int *n) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return 1;
+    }
+    char line[4096];
+    if (fgets(line, sizeof(line), fp) == NULL || strncmp(line, TRACE_MAGIC, strlen(TRACE_MAGIC)) != 0) {
+        fclose(fp);
+        return 1;
+    }
+    int cap = 64, count = 0;
+    struct Trace_Event *ev = (struct Trace_Event *)malloc(sizeof(struct Trace_Event) * (size_t)cap);
+    if (ev == NULL) {
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (count == cap) {
+            cap *= 2;
+            struct Trace_Event *grown = (struct Trace_Event *)realloc(ev, sizeof(struct Trace_Event) * (size_t)cap);
+            if (grown == NULL) {
+                exit(1);
+            }
+            ev = grown;
+        }
+        if (parse_event(line, &ev[count]) == 0) {
+            count++;
+        }
+    }
+    fclose(fp);
+    *events = ev;
+    *n = count;
+    return 0;
+}
+
+void trace_free_events(struct Trace_Event *events, int n) {
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < events[i].n_args; k++) {
+            free(events[i].args[k]);
+        }
+    }
+    free(events);
+}
@@ -0,0 +1,111 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Session traces: the menu operations of an interactive session, with the
+ * time each one was issued, so the session can be replayed against a store
+ * (see replay.c).
+ *
+ * A trace is a text file. The first line is TRACE_MAGIC; every other line
+ * is one operation:
+ *
+ *     <microseconds since the session started> \t <operation> [\t <arg>]...
+ *
+ * Arguments never contain tabs or line breaks (the recorder turns them into
+ * spaces). Operations and their arguments:
+ *
+ *     consulta_nome    <texto> <páginas>      menu 1-1 (pages actually shown)
+ *     consulta_cpf     <texto> <páginas>      menu 1-2
+ *     consulta_trecho  <texto> <páginas>      menu 1-3
+ *     consulta_aprox   <texto>                menu 1-4
+ *     atualiza         <id> <cpf> <nome> <idade> <data>   menu 2 ("-" keeps)
+ *     remove           <id>                   menu 3
+ *     insere           <cpf> <nome> <idade> <data>        menu 4
+ *     imprime                                 menu 5
+ *     estatistica      <agregação>            menu 7
+ *     filtra           <filtro>               menu 8
+ *     importa          <arquivo>              menu 9
+ *     mescla           <arquivo>              menu 10
+ *     memoria                                 menu 11
+ *
+ * Only operations that reach the store are recorded: cancelled updates,
+ * removals and inserts are not.
+ */
+
+#define TRACE_MAGIC "# hpms-trace 1"
+#define TRACE_MAX_ARGS 5
+#define TRACE_PAGE_ROWS 10  /* rows per page of a menu consult */
+
+enum Trace_Op {
+    TR_CONSULTA_NOME,
+    TR_CONSULTA_CPF,
+    TR_CONSULTA_TRECHO,
+    TR_CONSULTA_APROX,
+    TR_ATUALIZA,
+    TR_REMOVE,
+    TR_INSERE,
+    TR_IMPRIME,
+    TR_ESTATISTICA,
+    TR_FILTRA,
+    TR_IMPORTA,
+    TR_MESCLA,
+    TR_MEMORIA,
+    TR_OPS
+};
+
+/* Name of each operation in the file */
+extern const char *const trace_op_names[TR_OPS];
+
+struct Trace_Writer {
+    FILE *fp;
+    struct timespec t0;  /* session start */
+};
+
+struct Trace_Event {
+    long long usec;      /* issue time, microseconds after the session start */
+    enum Trace_Op op;
+    int n_args;
+    char *args[TRACE_MAX_ARGS];
+};
+
+/**
+ * Start recording to 'path' (truncated). Returns NULL if it cannot be opened.
+ * If malloc fails, exits(1).
+ */
+struct Trace_Writer *trace_open(const char *path);
+
+/**
+ * Microseconds since 'w' was opened (0 if w==NULL): the issue time to pass
+ * to trace_add, taken before the operation runs.
+ */
+long long trace_now(const struct Trace_Writer *w);
+
+/**
+ * Append operation 'op' issued at 'usec', with 'n_args' (<= TRACE_MAX_ARGS)
+ * string arguments. The line is flushed at once, so a crash keeps the trace
+ * so far. Does nothing if 'w' is NULL.
+ */
+void trace_add(struct Trace_Writer *w, long long usec, enum Trace_Op op, int n_args, ...);
+
+/**
+ * Stop recording and free 'w'. Safe if w==NULL.
+ */
+void trace_close(struct Trace_Writer *w);
+
+/**
+ * Read every operation of the trace 'path' into a new array '*events' of
+ * '*n' entries. Unknown operations are skipped.
+ * Returns 0 on success; returns 1 if the file cannot be read or is not a trace.
+ * If malloc fails, exits(1).
+ */
+int trace_load(const char *path, struct Trace_Event **events, int *n);
+
+/**
+ * Free an array returned by trace_load.
+ */
+void trace_free_events(struct Trace_Event *events, int n);
+
+#endif /* TRACE_H */
@@ -0,0 +1,478 @@
+#include "trigram.h"
+#include "dinamic_vector.h"
+#include "fold.h"
+#include "schema.h"
+#include "slab.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Short list size re-scored with edit distance, per requested result */
+#define TRI_SHORTLIST_FACTOR 8
+#define TRI_SHORTLIST_MIN 32
+/* A search rebuilds the index once added plus dead entries pass rows / SHARE + MIN */
+#define TRI_REBUILD_SHARE 4
+#define TRI_REBUILD_MIN 1024
+
+/*
+ * Map a folded byte to its trigram symbol: space=0, a-z=1..26, 0-9=27..36, other=37.
+ */
+static int tri_symbol(unsigned char c) {
+    if (c == ' ') return 0;
+    if (c >= 'a' && c <= 'z') return 1 + (c - 'a');
+    if (c >= '0' && c <= '9') return 27 + (c - '0');
+    return 37;
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Write the distinct trigram codes of the padded key " key " into 'codes'
+ * (room for 'len' entries) in ascending order. Returns how many were written.
+ */
+static int tri_extract(const char *key, int len, int *codes) {
+    if (len <= 0) {
+        return 0;
+    }
+    int a = 0;                                  /* leading pad */
+    int b = tri_symbol((unsigned char)key[0]);
+    for (int i = 0; i < len; i++) {
+        int c = (i + 1 < len) ? tri_symbol((unsigned char)key[i + 1]) : 0;  /* trailing pad */
+        codes[i] = (a * TRI_ALPHABET + b) * TRI_ALPHABET + c;
+        a = b;
+        b = c;
+    }
+    qsort(codes, (size_t)len, sizeof(int), cmp_int);
+    int n = 1;
+    for (int i = 1; i < len; i++) {
+        if (codes[i] != codes[n - 1]) {
+            codes[n++] = codes[i];
+        }
+    }
+    return n;
+}
+
+/*
+ * Grow the array '*p' of 'size'-byte items to hold at least 'need'.
+ * If realloc fails, exit(1).
+ */
+static void tri_reserve(void **p, int *cap, int need, size_t size) {
+    if (need <= *cap) {
+        return;
+    }
+    int grown_cap = (*cap > 0) ? *cap : 64;
+    while (grown_cap < need) {
+        grown_cap *= 2;
+    }
+    void *grown = realloc(*p, size * (size_t)grown_cap);
+    if (grown == NULL) {
+        exit(1);
+    }
+    *p = grown;
+    *cap = grown_cap;
+}
+
+struct Trigram_Index *tri_build(const struct Dinamic_Vector *dv) {
+    struct Trigram_Index *ix = (struct Trigram_Index *)malloc(sizeof(struct Trigram_Index));
+    if (ix == NULL) {
+        exit(1);
+    }
+    int n = dv_size(dv);
+    int cap = (n > 0) ? n : 1;
+    ix->rows = n;
+    ix->rows_cap = cap;
+    ix->n_entries = n;
+    ix->entries_cap = cap;
+    ix->built = n;
+    ix->dead = 0;
+    ix->n_links = 0;
+    ix->links_cap = 0;
+    ix->link = NULL;
+    ix->link_entry = NULL;
+    ix->epoch = (dv != NULL) ? dv->epoch : 0;
+    ix->start = (int *)calloc(TRI_CODES + 1, sizeof(int));
+    ix->head = (int *)malloc(sizeof(int) * TRI_CODES);
+    ix->entry_tris = (unsigned short *)malloc(sizeof(unsigned short) * (size_t)cap);
+    ix->entry_row = (int *)malloc(sizeof(int) * (size_t)cap);
+    ix->row_entry = (int *)malloc(sizeof(int) * (size_t)cap);
+    if (ix->start == NULL || ix->head == NULL || ix->entry_tris == NULL || ix->entry_row == NULL ||
+        ix->row_entry == NULL) {
+        exit(1);
+    }
+    memset(ix->head, -1, sizeof(int) * TRI_CODES);
+    for (int i = 0; i < n; i++) {
+        ix->entry_row[i] = i;
+        ix->row_entry[i] = i;
+    }
+
+    int codes_cap = 64;
+    int *codes = (int *)malloc(sizeof(int) * codes_cap);
+    if (codes == NULL) {
+        exit(1);
+    }
+
+    /* Pass 1: count postings per trigram */
+    for (int i = 0; i < n; i++) {
+        struct LinkedList *row = dv_get(dv, i);
+        if (row->key_len > codes_cap) {
+            codes_cap = row->key_len;
+            free(codes);
+            codes = (int *)malloc(sizeof(int) * codes_cap);
+            if (codes == NULL) {
+                exit(1);
+            }
+        }
+        int m = tri_extract(row->key, row->key_len, codes);
+        ix->entry_tris[i] = (unsigned short)(m < 65535 ? m : 65535);
+        for (int j = 0; j < m; j++) {
+            ix->start[codes[j] + 1]++;
+        }
+    }
+    for (int t = 0; t < TRI_CODES; t++) {
+        ix->start[t + 1] += ix->start[t];
+    }
+
+    /* Pass 2: fill; rows are visited in order so each list comes out sorted */
+    int total = ix->start[TRI_CODES];
+    ix->post = (int *)malloc(sizeof(int) * (size_t)(total > 0 ? total : 1));
+    int *fill = (int *)malloc(sizeof(int) * TRI_CODES);
+    if (ix->post == NULL || fill == NULL) {
+        exit(1);
+    }
+    memcpy(fill, ix->start, sizeof(int) * TRI_CODES);
+    for (int i = 0; i < n; i++) {
+        struct LinkedList *row = dv_get(dv, i);
+        int m = tri_extract(row->key, row->key_len, codes);
+        for (int j = 0; j < m; j++) {
+            ix->post[fill[codes[j]]++] = i;
+        }
+    }
+    free(fill);
+    free(codes);
+    return ix;
+}
+
+/*
+ * The index of 'dv' if it reflects the vector as it is now (before the
+ * change being reported), else NULL.
+ */
+static struct Trigram_Index *tri_following(struct Dinamic_Vector *dv) {
+    struct Trigram_Index *ix = dv->tri_idx;
+    return (ix != NULL && ix->epoch == dv->epoch) ? ix : NULL;
+}
+
+/*
+ * New entry for the name of 'row' at position 'pos', its postings chained.
+ * Returns the entry id.
+ */
+static int tri_add_entry(struct Trigram_Index *ix, int pos, const struct LinkedList *row) {
+    int *codes = (int *)malloc(sizeof(int) * (size_t)(row->key_len > 0 ? row->key_len : 1));
+    if (codes == NULL) {
+        exit(1);
+    }
+    int m = tri_extract(row->key, row->key_len, codes);
+    /* parallel arrays: both grow from the same capacity to the same one */
+    int cap = ix->entries_cap;
+    tri_reserve((void **)&ix->entry_row, &cap, ix->n_entries + 1, sizeof(int));
+    tri_reserve((void **)&ix->entry_tris, &ix->entries_cap, ix->n_entries + 1, sizeof(unsigned short));
+    int e = ix->n_entries++;
+    ix->entry_row[e] = pos;
+    ix->entry_tris[e] = (unsigned short)(m < 65535 ? m : 65535);
+    cap = ix->links_cap;
+    tri_reserve((void **)&ix->link, &cap, ix->n_links + m, sizeof(int));
+    tri_reserve((void **)&ix->link_entry, &ix->links_cap, ix->n_links + m, sizeof(int));
+    for (int j = 0; j < m; j++) {
+        int l = ix->n_links++;
+        ix->link_entry[l] = e;
+        ix->link[l] = ix->head[codes[j]];
+        ix->head[codes[j]] = l;
+    }
+    free(codes);
+    return e;
+}
+
+static void tri_kill_entry(struct Trigram_Index *ix, int e) {
+    ix->entry_row[e] = -1;
+    ix->dead++;
+}
+
+void tri_row_added(struct Dinamic_Vector *dv, int pos, const struct LinkedList *row) {
+    struct Trigram_Index *ix = tri_following(dv);
+    if (ix == NULL) {
+        return;
+    }
+    tri_reserve((void **)&ix->row_entry, &ix->rows_cap, ix->rows + 1, sizeof(int));
+    ix->row_entry[pos] = tri_add_entry(ix, pos, row);
+    ix->rows++;
+}
+
+void tri_row_renamed(struct Dinamic_Vector *dv, int pos, const struct LinkedList *row) {
+    struct Trigram_Index *ix = tri_following(dv);
+    if (ix == NULL) {
+        return;
+    }
+    tri_kill_entry(ix, ix->row_entry[pos]);
+    ix->row_entry[pos] = tri_add_entry(ix, pos, row);
+}
+
+void tri_row_removed(struct Dinamic_Vector *dv, int pos) {
+    struct Trigram_Index *ix = tri_following(dv);
+    if (ix == NULL) {
+        return;
+    }
+    tri_kill_entry(ix, ix->row_entry[pos]);
+    memmove(&ix->row_entry[pos], &ix->row_entry[pos + 1], sizeof(int) * (size_t)(ix->rows - 1 - pos));
+    ix->rows--;
+    for (int e = 0; e < ix->n_entries; e++) {
+        if (ix->entry_row[e] > pos) {
+            ix->entry_row[e]--;
+        }
+    }
+}
+
+void tri_rows_remapped(struct Dinamic_Vector *dv, const int *map, int new_rows) {
+    struct Trigram_Index *ix = tri_following(dv);
+    if (ix == NULL) {
+        return;
+    }
+    for (int e = 0; e < ix->n_entries; e++) {
+        int row = ix->entry_row[e];
+        if (row < 0) {
+            continue;
+        }
+        if (map[row] < 0) {
+            tri_kill_entry(ix, e);
+        } else {
+            ix->entry_row[e] = map[row];
+            ix->row_entry[map[row]] = e;
+        }
+    }
+    ix->rows = new_rows;
+}
+
+void tri_changed(struct Dinamic_Vector *dv, unsigned long before) {
+    if (dv->tri_idx != NULL && dv->tri_idx->epoch == before) {
+        dv->tri_idx->epoch = dv->epoch;
+    }
+}
+
+/*
+ * Edit distance between 'q' and the best-matching substring of 'key'
+ * (free start and end in the key), so "mria" is 1 away from "maria oliveira".
+ * Stops early and returns bound + 1 once every alignment exceeds 'bound'.
+ */
+static int tri_distance(const char *q, int q_len, const char *key, int key_len, int bound) {
+    int *d = (int *)malloc(sizeof(int) * (size_t)(key_len + 1));
+    if (d == NULL) {
+        exit(1);
+    }
+    for (int j = 0; j <= key_len; j++) {
+        d[j] = 0;
+    }
+    for (int i = 1; i <= q_len; i++) {
+        int diag = d[0];
+        d[0] = i;
+        int row_min = d[0];
+        for (int j = 1; j <= key_len; j++) {
+            int up = d[j];
+            int best = diag + (q[i - 1] != key[j - 1]);
+            if (up + 1 < best) best = up + 1;
+            if (d[j - 1] + 1 < best) best = d[j - 1] + 1;
+            d[j] = best;
+            diag = up;
+            if (best < row_min) row_min = best;
+        }
+        if (row_min > bound) {
+            free(d);
+            return bound + 1;
+        }
+    }
+    int result = d[0];
+    for (int j = 1; j <= key_len; j++) {
+        if (d[j] < result) result = d[j];
+    }
+    free(d);
+    return result;
+}
+
+/*
+ * Order of the short list: lower similarity is worse, and among equal
+ * similarities the later row, so the list does not depend on the order the
+ * candidates were found in (CSR lists first, chained postings after).
+ */
+static int tri_worse(const struct Tri_Match *a, const struct Tri_Match *b) {
+    return a->sim < b->sim || (a->sim == b->sim && a->row > b->row);
+}
+
+/*
+ * Min-heap on tri_worse, used to keep the best short list of candidates.
+ */
+static void heap_sift_down(struct Tri_Match *h, int n, int i) {
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && tri_worse(&h[l], &h[m])) m = l;
+        if (r < n && tri_worse(&h[r], &h[m])) m = r;
+        if (m == i) return;
+        struct Tri_Match t = h[i]; h[i] = h[m]; h[m] = t;
+        i = m;
+    }
+}
+
+static void heap_sift_up(struct Tri_Match *h, int i) {
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        if (!tri_worse(&h[i], &h[p])) return;
+        struct Tri_Match t = h[i]; h[i] = h[p]; h[p] = t;
+        i = p;
+    }
+}
+
+static int cmp_match(const void *a, const void *b) {
+    const struct Tri_Match *x = (const struct Tri_Match *)a, *y = (const struct Tri_Match *)b;
+    if (x->distance != y->distance) return x->distance - y->distance;
+    if (x->sim != y->sim) return (x->sim < y->sim) ? 1 : -1;
+    return x->row - y->row;
+}
+
+/*
+ * Count one shared trigram for 'row' (skipped if -1, a dead entry); a row
+ * seen for the first time becomes a candidate.
+ */
+static void tri_count(int row, unsigned short *shared, int **cand, int *n_cand, int *cand_cap) {
+    if (row < 0 || shared[row]++ != 0) {
+        return;
+    }
+    if (*n_cand == *cand_cap) {
+        *cand_cap *= 2;
+        int *grown = (int *)realloc(*cand, sizeof(int) * (size_t)*cand_cap);
+        if (grown == NULL) {
+            exit(1);
+        }
+        *cand = grown;
+    }
+    (*cand)[(*n_cand)++] = row;
+}
+
+int tri_search(struct Dinamic_Vector *dv, const char *query, int k, struct Tri_Match *out) {
+    if (dv == NULL || query == NULL || k <= 0) {
+        return 0;
+    }
+    struct Trigram_Index *stale = dv->tri_idx;
+    if (stale == NULL || stale->epoch != dv->epoch ||
+        (stale->n_entries - stale->built) + stale->dead > stale->rows / TRI_REBUILD_SHARE + TRI_REBUILD_MIN) {
+        tri_free(dv->tri_idx);
+        dv->tri_idx = tri_build(dv);
+    }
+    struct Trigram_Index *ix = dv->tri_idx;
+
+    int q_len = 0;
+    char *q = fold_key(query, &q_len);
+    int *q_codes = (int *)malloc(sizeof(int) * (size_t)(q_len > 0 ? q_len : 1));
+    if (q_codes == NULL) {
+        exit(1);
+    }
+    int qn = tri_extract(q, q_len, q_codes);
+    if (qn == 0 || ix->rows == 0) {
+        free(q_codes);
+        slab_str_free(q);
+        return 0;
+    }
+
+    /* Count shared trigrams per row by walking only the query's posting lists */
+    unsigned short *shared = (unsigned short *)calloc((size_t)ix->rows, sizeof(unsigned short));
+    int cand_cap = 256, n_cand = 0;
+    int *cand = (int *)malloc(sizeof(int) * cand_cap);
+    if (shared == NULL || cand == NULL) {
+        exit(1);
+    }
+    for (int t = 0; t < qn; t++) {
+        /* the CSR list, then the chain of postings added since the build */
+        for (int p = ix->start[q_codes[t]]; p < ix->start[q_codes[t] + 1]; p++) {
+            tri_count(ix->entry_row[ix->post[p]], shared, &cand, &n_cand, &cand_cap);
+        }
+        for (int l = ix->head[q_codes[t]]; l >= 0; l = ix->link[l]) {
+            tri_count(ix->entry_row[ix->link_entry[l]], shared, &cand, &n_cand, &cand_cap);
+        }
+    }
+
+    /* Keep the short list with the best trigram similarity */
+    int list_cap = k * TRI_SHORTLIST_FACTOR;
+    if (list_cap < TRI_SHORTLIST_MIN) list_cap = TRI_SHORTLIST_MIN;
+    struct Tri_Match *list = (struct Tri_Match *)malloc(sizeof(struct Tri_Match) * list_cap);
+    if (list == NULL) {
+        exit(1);
+    }
+    int n_list = 0;
+    for (int c = 0; c < n_cand; c++) {
+        int row = cand[c];
+        int s = shared[row];
+        struct Tri_Match m;
+        m.row = row;
+        m.distance = 0;
+        m.sim = (double)s / (double)(qn + ix->entry_tris[ix->row_entry[row]] - s);
+        if (n_list < list_cap) {
+            list[n_list] = m;
+            heap_sift_up(list, n_list++);
+        } else if (tri_worse(&list[0], &m)) {
+            list[0] = m;
+            heap_sift_down(list, n_list, 0);
+        }
+    }
+
+    /* Re-score the short list with the bounded edit distance */
+    int bound = q_len / 3;
+    if (bound < 2) bound = 2;
+    int n_out = 0;
+    for (int i = 0; i < n_list; i++) {
+        struct LinkedList *row = dv_get(dv, list[i].row);
+        list[i].distance = tri_distance(q, q_len, row->key, row->key_len, bound);
+        if (list[i].distance <= bound) {
+            list[n_out++] = list[i];
+        }
+    }
+    qsort(list, (size_t)n_out, sizeof(struct Tri_Match), cmp_match);
+    if (n_out > k) n_out = k;
+    memcpy(out, list, sizeof(struct Tri_Match) * (size_t)n_out);
+
+    free(list);
+    free(cand);
+    free(shared);
+    free(q_codes);
+    slab_str_free(q);
+    return n_out;
+}
+
+void tri_consult(struct Dinamic_Vector *dv, const char *search, int k, FILE *out) {
+    struct Tri_Match *matches = (struct Tri_Match *)malloc(sizeof(struct Tri_Match) * (size_t)(k > 0 ? k : 1));
+    if (matches == NULL) {
+        exit(1);
+    }
+    int found = tri_search(dv, search, k, matches);
+
+    schema_print_header(out);
+    for (int i = 0; i < found; i++) {
+        ll_fprint(out, dv_get(dv, matches[i].row));
+    }
+    if (found == 0) {
+        fprintf(out, "Nenhum nome parecido encontrado.\n");
+    }
+    free(matches);
+}
+
+void tri_free(struct Trigram_Index *ix) {
+    if (ix == NULL) {
+        return;
+    }
+    free(ix->start);
+    free(ix->post);
+    free(ix->head);
+    free(ix->link);
+    free(ix->link_entry);
+    free(ix->entry_row);
+    free(ix->entry_tris);
+    free(ix->row_entry);
+    free(ix);
+}
@@ -0,0 +1,106 @@
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+
+#include <stdio.h>
+
+struct Dinamic_Vector;
+struct LinkedList;
+
+/*
+ * Trigram inverted index over the folded Nome keys (see fold.h).
+ *
+ * Every key is padded as " key " and cut into overlapping 3-character
+ * trigrams over a 38-symbol alphabet (space, a-z, 0-9, other), so each
+ * trigram is a small integer and the posting lists are stored CSR style:
+ * entries of trigram t are post[start[t] .. start[t+1]-1], in ascending order.
+ *
+ * The vector keeps the index in step with its changes instead of dropping
+ * it: each indexed name is an entry, and the CSR lists hold entry ids. An
+ * inserted row, or a row whose name changes, gets a new entry whose
+ * postings are pushed on per-trigram chains beside the CSR lists; the
+ * entry it replaces, or the entry of a removed row, is only marked dead.
+ * entry_row maps entries to current row positions (removals shift it), so
+ * a search walks the CSR list and the chain of each query trigram and
+ * skips dead entries. Once the chains and dead entries pass a share of
+ * the rows the next search rebuilds the CSR from scratch, as it does when
+ * the vector changed without telling the index (dv->epoch moved on).
+ */
+#define TRI_ALPHABET 38
+#define TRI_CODES (TRI_ALPHABET * TRI_ALPHABET * TRI_ALPHABET)
+
+struct Trigram_Index {
+    int *start;              /* TRI_CODES + 1 offsets into 'post' */
+    int *post;               /* concatenated CSR posting lists (entry ids) */
+    int *head;               /* TRI_CODES: newest chained posting of each trigram, or -1 */
+    int *link;               /* chained postings: next posting of the same trigram */
+    int *link_entry;         /* chained postings: entry id */
+    int n_links;
+    int links_cap;
+    int *entry_row;          /* row position of each entry, -1 once dead */
+    unsigned short *entry_tris;  /* distinct trigrams of each entry */
+    int n_entries;
+    int entries_cap;
+    int built;               /* entries in the CSR lists (ids 0 .. built - 1) */
+    int dead;                /* dead entries */
+    int *row_entry;          /* live entry of each row position */
+    int rows;                /* number of rows indexed */
+    int rows_cap;
+    unsigned long epoch;     /* vector epoch the index reflects */
+};
+
+/*
+ * One fuzzy search result.
+ */
+struct Tri_Match {
+    int row;        /* row position in the vector */
+    int distance;   /* edit distance from the query to the best-matching part of the name */
+    double sim;     /* trigram similarity (Jaccard) in [0, 1] */
+};
+
+/**
+ * Build a trigram index over every row of 'dv'.
+ * If malloc fails, exits(1).
+ */
+struct Trigram_Index *tri_build(const struct Dinamic_Vector *dv);
+
+/**
+ * Find up to 'k' names closest to 'query' and store them in 'out', best first.
+ * Candidates sharing trigrams with the query are counted from the posting
+ * lists; only the best-scoring short list is re-scored with a bounded edit
+ * distance. The index attached to 'dv' is (re)built when stale.
+ * Returns the number of matches written (0..k).
+ */
+int tri_search(struct Dinamic_Vector *dv, const char *query, int k, struct Tri_Match *out);
+
+/**
+ * Print to 'out' the 'k' rows closest to 'search', or a message if none is close.
+ */
+void tri_consult(struct Dinamic_Vector *dv, const char *search, int k, FILE *out);
+
+/**
+ * Keep the index of 'dv' in step with a change. Each call must come before
+ * the change bumps dv->epoch, and the change ends with tri_changed; an
+ * index that is already stale (or absent) is left alone.
+ * tri_row_added: 'row' becomes position 'pos' == the current row count.
+ * tri_row_renamed: the name of the row at 'pos' is now that of 'row'.
+ * tri_row_removed: the row at 'pos' goes away and later rows shift down.
+ * tri_rows_remapped: row p moves to map[p], or goes away if map[p] < 0.
+ * If malloc fails, exits(1).
+ */
+void tri_row_added(struct Dinamic_Vector *dv, int pos, const struct LinkedList *row);
+void tri_row_renamed(struct Dinamic_Vector *dv, int pos, const struct LinkedList *row);
+void tri_row_removed(struct Dinamic_Vector *dv, int pos);
+void tri_rows_remapped(struct Dinamic_Vector *dv, const int *map, int new_rows);
+
+/**
+ * End of a change the index followed: the change moved dv->epoch on from
+ * 'before'; an index that was current at 'before' is current again.
+ */
+void tri_changed(struct Dinamic_Vector *dv, unsigned long before);
+
+/**
+ * Free the index. Safe if ix==NULL.
+ */
+void tri_free(struct Trigram_Index *ix);
+
+#endif /* TRIGRAM_H */